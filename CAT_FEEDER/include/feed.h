@@ -0,0 +1,171 @@
+#ifndef FEED_H
+#define FEED_H
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              FEED CONSTANTS                                     *
+ *                                                                                 *
+ ***********************************************************************************/
+
+#define FEED_MAX_TIMES			8	/*!< Daily feed times */
+#define FEED_MAX_PORTIONS		10	/*!< Push / home cycles per feed */
+#define FEED_LOG_SIZE			32	/*!< Feeds kept in the log (newest win) */
+#define FEED_LATE_S			((uint32_t) 300U)	/*!< Alarms handled later than this are missed */
+#define FEED_SECONDS_PER_DAY		((uint32_t) 86400U)
+
+#define FEED_SLOT_MANUAL		((uint8_t) 0xFF)	/*!< Log slot of button feeds */
+
+/* Events feed_service handles; the feed task's own events take other bits */
+#define FEED_EVT_ALARM			((uint32_t) 0x01)	/*!< DS3231 alarm 1 (INT/SQW) */
+#define FEED_EVT_BUTTON			((uint32_t) 0x02)	/*!< Feed button pressed */
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              FEED STRUCTS                                       *
+ *                                                                                 *
+ ***********************************************************************************/
+
+typedef struct
+{
+	uint8_t hour;		/*!< 0 - 23 */
+	uint8_t minute;		/*!< 0 - 59 */
+	uint8_t portions;	/*!< 1 - FEED_MAX_PORTIONS */
+} FEED_TimeTypeDef;
+
+typedef struct
+{
+	uint16_t year;
+	uint8_t month;
+	uint8_t date;
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t second;
+	uint8_t slot;		/*!< Index in the schedule, or FEED_SLOT_MANUAL */
+	uint8_t portions;
+} FEED_LogTypeDef;
+
+typedef struct
+{
+	uint32_t scheduled;	/*!< Scheduled feeds dispensed */
+	uint32_t manual;	/*!< Button feeds dispensed */
+	uint32_t missed;	/*!< Feeds handled more than FEED_LATE_S late */
+	uint32_t portions;	/*!< Portions dispensed in all */
+	uint32_t alarms;	/*!< DS3231 alarms serviced */
+	uint32_t errors;	/*!< Events feed_service handed back (DS3231 I2C errors) */
+} FEED_StatsTypeDef;
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              FEED FUNCTIONS                                     *
+ *                                                                                 *
+ * The schedule lives in a table sorted by time of day. Only the next feed time is *
+ * programmed into DS3231 alarm 1 (hours, minutes and seconds match), so the MCU   *
+ * can stay in Stop mode until then. Interrupt handlers only post FEED_EVT_*       *
+ * events to the feed task; feed_service does the I2C work and starts the servos   *
+ * from it.                                                                        *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Clears the schedule, the log and the counters.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @retval None
+  */
+void feed_init(DS3231_TypeDef *rtc);
+
+/**
+  * @brief Adds a daily feed time, or changes the portions of an existing one.
+  *	   Call feed_arm afterwards for it to be taken into account.
+  * @param hour : 0 - 23.
+  * @param minute : 0 - 59.
+  * @param portions : 1 - FEED_MAX_PORTIONS.
+  * @retval 0 on success, -1 if out of range or the table is full
+  */
+int feed_add(uint8_t hour, uint8_t minute, uint8_t portions);
+
+/**
+  * @brief Removes a daily feed time. Call feed_arm afterwards.
+  * @param hour : 0 - 23.
+  * @param minute : 0 - 59.
+  * @retval 0 on success, -1 if there is no feed at that time
+  */
+int feed_remove(uint8_t hour, uint8_t minute);
+
+/**
+  * @brief Returns a feed time from the schedule, earliest first.
+  * @param slot : Index (0 - feed_count() - 1).
+  * @retval The feed time, or NULL if slot is out of range
+  */
+const FEED_TimeTypeDef *feed_get(uint8_t slot);
+
+/**
+  * @brief Returns the number of daily feed times.
+  * @param None
+  * @retval Number of feed times
+  */
+uint8_t feed_count(void);
+
+/**
+  * @brief Finds the first feed strictly after a time of day, wrapping to the
+  *	   next day.
+  * @param hour : Time of day.
+  * @param minute : Time of day.
+  * @param second : Time of day.
+  * @retval Its slot, or -1 if the schedule is empty
+  */
+int feed_next(uint8_t hour, uint8_t minute, uint8_t second);
+
+/**
+  * @brief Reads the DS3231 and programs alarm 1 for the next feed. If
+  *	   programming it failed last time and a feed has passed since,
+  *	   serves that feed first, as its alarm would have.
+  * @param None
+  * @retval Slot armed, or -1 if the schedule is empty or the DS3231 could
+  *	   not be read or programmed
+  */
+int feed_arm(void);
+
+/**
+  * @brief Handles the events posted since the feed task last ran. On
+  *	   FEED_EVT_ALARM : dispenses the feed the alarm was set for and any
+  *	   that came due while it waited (those more than FEED_LATE_S late
+  *	   count as missed), logs them and arms the next one. On
+  *	   FEED_EVT_BUTTON : one portion, unless a feed is running. Call from
+  *	   the feed task. If the DS3231 cannot be read, or the alarm flag
+  *	   cleared, nothing is dispensed, logged or armed for those events.
+  * @param events : Feed task events; bits other than FEED_EVT_* are ignored.
+  * @retval The FEED_EVT_* events to pass again later, 0 if all were handled
+  */
+uint32_t feed_service(uint32_t events);
+
+/**
+  * @brief Tells whether alarm 1 is set for the next feed.
+  * @param None
+  * @retval 1 if so or if the schedule is empty, 0 if programming the
+  *	   DS3231 failed and feed_arm is to be called again
+  */
+uint8_t feed_armed(void);
+
+/**
+  * @brief Tells whether portions are still being dispensed.
+  * @param None
+  * @retval 1 if the servos are running a feed, 0 otherwise
+  */
+uint8_t feed_busy(void);
+
+/**
+  * @brief Fetches a logged feed.
+  * @param age : 0 for the latest feed, 1 for the one before...
+  * @param entry : Where to store it.
+  * @retval 1 if found, 0 if fewer feeds are logged
+  */
+uint8_t feed_log_get(uint8_t age, FEED_LogTypeDef *entry);
+
+/**
+  * @brief Copies the counters.
+  * @param stats : Where to store them.
+  * @retval None
+  */
+void feed_get_stats(FEED_StatsTypeDef *stats);
+
+#endif
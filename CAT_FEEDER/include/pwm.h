@@ -0,0 +1,80 @@
+#ifndef PWM_H
+#define PWM_H
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              PWM CONSTANTS                                      *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/* Clock sources the SYSCLK mux can pick (RCC_CFGR_SWS) */
+#define PWM_HSI_FREQ			((uint32_t) 16000000U)
+#define PWM_HSE_FREQ			((uint32_t) 8000000U)	/*!< Only if a crystal is fitted */
+#define PWM_MSI_RESET_FREQ		((uint32_t) 4000000U)	/*!< MSI range 6, out of reset */
+
+#define PWM_MAX_PSC			((uint32_t) 0xFFFFU)
+#define PWM_MAX_ARR16			((uint32_t) 0xFFFFU)
+#define PWM_MAX_ARR32			((uint32_t) 0xFFFFFFFFU)	/*!< TIM2 and TIM5 */
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              PWM STRUCTS                                        *
+ *                                                                                 *
+ ***********************************************************************************/
+
+typedef struct
+{
+	uint32_t psc;		/*!< Prescaler register value */
+	uint32_t arr;		/*!< Auto-reload register value */
+	uint64_t tick_ps;	/*!< Counter step (picoseconds) */
+	uint64_t period_ns;	/*!< Period actually obtained (TIM2 / TIM5 reach past 4.29 s) */
+} PWM_TimingTypeDef;
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              PWM FUNCTIONS                                      *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Picks PSC and ARR for a period : the smallest prescaler whose
+  *	   counter range still covers the period, so the step is as fine as
+  *	   the timer allows. ARR is rounded to the nearest count.
+  * @param clk : Counter input clock (Hz).
+  * @param period_us : Period wanted (microseconds).
+  * @param resolution_ns : Coarsest step acceptable (nanoseconds).
+  * @param max_arr : PWM_MAX_ARR16 or PWM_MAX_ARR32.
+  * @param timing : Where to store the result.
+  * @retval 0 on success, -1 if the period cannot be reached with that step
+  */
+int pwm_timing(uint32_t clk, uint32_t period_us, uint32_t resolution_ns, uint32_t max_arr,
+	       PWM_TimingTypeDef *timing);
+
+/**
+  * @brief Works out the frequency the counter of TIMx is clocked at : the
+  *	   APB clock it sits on, doubled when that APB is divided.
+  * @param TIMx : Timer.
+  * @retval Counter input clock (Hz)
+  */
+uint32_t pwm_get_clk(TIM_TypeDef *TIMx);
+
+/**
+  * @brief Sets the period of TIMx from the current clock tree and loads the
+  *	   new prescaler at once (update event).
+  * @param TIMx : Timer.
+  * @param period_us : Period wanted (microseconds).
+  * @param resolution_ns : Coarsest step acceptable (nanoseconds).
+  * @retval 0 on success, -1 (TIMx left untouched) if out of reach
+  */
+int pwm_set_period(TIM_TypeDef *TIMx, uint32_t period_us, uint32_t resolution_ns);
+
+/**
+  * @brief Converts a pulse width to a compare value for TIMx's current
+  *	   prescaler, rounded to the nearest step.
+  * @param TIMx : Timer.
+  * @param ns : Pulse width (nanoseconds).
+  * @retval CCR value
+  */
+uint32_t pwm_ns_to_ccr(TIM_TypeDef *TIMx, uint32_t ns);
+
+#endif
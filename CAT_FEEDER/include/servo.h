@@ -1,11 +1,152 @@
 #ifndef SERVO_H
 #define SERVO_H
 
-void servo_push(void);
-void rotate_servo1(uint16_t ccr);
-void rotate_servo2(uint16_t ccr);
+/***********************************************************************************
+ *                                                                                 *
+ *                              SERVO CONSTANTS                                    *
+ *                                                                                 *
+ ***********************************************************************************/
+
+#define SERVO_1				((uint8_t) 0)	/*!< TIM2_CH2 on PB3 */
+#define SERVO_2				((uint8_t) 1)	/*!< TIM5_CH2 on PA1 */
+#define SERVO_COUNT			2
+
+#define SERVO_PERIOD_US			((uint32_t) 20000U)	/*!< PWM period; one trajectory step per period */
+#define SERVO_PERIOD_MS			(SERVO_PERIOD_US / 1000U)
+#define SERVO_RESOLUTION_NS		((uint32_t) 250U)	/*!< Coarsest pulse step accepted */
+
+/* Trajectory profiles */
+#define SERVO_PROFILE_TRAPEZOID		((uint8_t) 0)	/*!< Constant accel. over the first and last quarter */
+#define SERVO_PROFILE_SCURVE		((uint8_t) 1)	/*!< Quintic : no jump in speed or acceleration */
+
+/* Default calibration : 0.5 ms - 2.5 ms pulse over 0 - 180 degrees */
+#define SERVO_MIN_PULSE_NS		((uint32_t) 500000U)
+#define SERVO_MAX_PULSE_NS		((uint32_t) 2500000U)
+#define SERVO_MIN_ANGLE			((int16_t) 0)		/*!< Tenths of a degree */
+#define SERVO_MAX_ANGLE			((int16_t) 1800)
+
+/* Positions (tenths of a degree) and move used by the feeding sequence */
+#define SERVO_HOME_ANGLE		((int16_t) 900)
+#define SERVO1_PUSH_ANGLE		((int16_t) 1800)
+#define SERVO2_PUSH_ANGLE		((int16_t) 0)
+#define SERVO_MOVE_MS			((uint16_t) 600)
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              SERVO STRUCTS                                      *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/* Pulse widths a servo needs to reach the two ends of its travel. The pulses
+ * may be swapped (min_ns > max_ns) for a servo mounted the other way round. */
+typedef struct
+{
+	uint32_t min_ns;	/*!< Pulse at min_angle */
+	uint32_t max_ns;	/*!< Pulse at max_angle */
+	int16_t min_angle;	/*!< Tenths of a degree */
+	int16_t max_angle;
+} SERVO_CalibrationTypeDef;
+
+/* Called from the TIM2 interrupt once a servo reaches its target */
+typedef void (*SERVO_CallbackTypeDef)(uint8_t servo);
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              SERVO FUNCTIONS                                    *
+ *                                                                                 *
+ * Moves are stepped from the TIM2 update interrupt, once per PWM period. The new  *
+ * CCR goes to the preload register and takes effect at the next update, so each  *
+ * pulse is whole. TIM2 and TIM5 must already be generating PWM.                   *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Registers the TIM2 update interrupt with the NVIC. The interrupt
+  *	   itself is only enabled while a servo is moving.
+  * @param None
+  * @retval None
+  */
+void servo_init(void);
+
+/**
+  * @brief Starts moving a servo from where it is now to ccr. A move already
+  *	   running on that servo is replaced (its callback is not called).
+  * @param servo : SERVO_1 or SERVO_2.
+  * @param ccr : Target compare value.
+  * @param duration_ms : Length of the move; 0 or less than SERVO_PERIOD_MS
+  *	   jumps at the next period.
+  * @param profile : SERVO_PROFILE_TRAPEZOID or SERVO_PROFILE_SCURVE.
+  * @param done : Called when the target is reached, or NULL.
+  * @retval 1 if started, 0 if servo is out of range
+  */
+uint8_t servo_move(uint8_t servo, uint32_t ccr, uint16_t duration_ms, uint8_t profile,
+		   SERVO_CallbackTypeDef done);
+
+/**
+  * @brief servo_move to an angle, through the servo's calibration.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @param angle : Target (tenths of a degree); clamped to the calibration.
+  * @param duration_ms : Length of the move.
+  * @param profile : SERVO_PROFILE_TRAPEZOID or SERVO_PROFILE_SCURVE.
+  * @param done : Called when the target is reached, or NULL.
+  * @retval 1 if started, 0 if servo is out of range
+  */
+uint8_t servo_move_angle(uint8_t servo, int16_t angle, uint16_t duration_ms, uint8_t profile,
+			 SERVO_CallbackTypeDef done);
+
+/**
+  * @brief Replaces a servo's calibration (the default is SERVO_MIN/MAX_*).
+  *	   Takes effect on the next move.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @param cal : Calibration; copied.
+  * @retval None
+  */
+void servo_calibrate(uint8_t servo, const SERVO_CalibrationTypeDef *cal);
+
+/**
+  * @brief Converts an angle to the compare value giving that pulse width on
+  *	   the servo's timer, at the timer's current prescaler.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @param angle : Tenths of a degree; clamped to the calibration.
+  * @retval CCR value, 0 if servo is out of range
+  */
+uint32_t servo_angle_to_ccr(uint8_t servo, int16_t angle);
+
+/**
+  * @brief Cancels a move, leaving the servo where it currently is. Its
+  *	   callback is not called.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @retval None
+  */
+void servo_stop(uint8_t servo);
+
+/**
+  * @brief Tells whether a servo is still moving.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @retval 1 if moving, 0 otherwise
+  */
+uint8_t servo_busy(uint8_t servo);
+
+/**
+  * @brief Moves both servos to their push positions together.
+  * @param done : Called once both have arrived, or NULL.
+  * @retval None
+  */
+void servo_push(SERVO_CallbackTypeDef done);
+
+/**
+  * @brief Moves both servos back to SERVO_HOME_ANGLE together.
+  * @param done : Called once both have arrived, or NULL.
+  * @retval None
+  */
+void servo_home(SERVO_CallbackTypeDef done);
+
+void rotate_servo1(uint32_t ccr);
+void rotate_servo2(uint32_t ccr);
 void home_servo1(void);
 void home_servo2(void);
+void servo1_signal_on(void);
+void servo2_signal_on(void);
 void servo1_signal_off(void);
 void servo2_signal_off(void);
 
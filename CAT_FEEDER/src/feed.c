@@ -0,0 +1,357 @@
+#include <stm32l476xx.h>
+#include <stddef.h>
+#include "../../DS3231/include/ds3231.h"
+#include "../include/servo.h"
+#include "../include/feed.h"
+#include "../include/irq.h"
+
+/* Private defines ---------------------------------------------------------------*/
+#define FEED_IDLE		((uint8_t) 0)
+#define FEED_PUSHING		((uint8_t) 1)
+#define FEED_HOMING		((uint8_t) 2)
+
+/* Private variables -------------------------------------------------------------*/
+static DS3231_TypeDef *feed_rtc;
+static Date_TypeDef now;		// Last date read from the DS3231
+
+static FEED_TimeTypeDef times[FEED_MAX_TIMES];
+static uint8_t ntimes;
+static int32_t armed_tod;		// Time of day alarm 1 is set for, -1 if none
+static uint8_t alarm_ok;		// 0 while alarm 1 is to be programmed again
+static int32_t arm_failed_at;		// Time of day programming it failed, -1 if it did not
+
+static FEED_LogTypeDef log_buf[FEED_LOG_SIZE];
+static uint8_t log_next;		// Where the next entry goes
+static uint8_t log_used;
+
+/* The TIM2 interrupt steps the feed too : changed here with it masked */
+static volatile uint8_t phase;
+static volatile uint8_t remaining;	// Portions left, including the one running
+static FEED_StatsTypeDef feed_stats;
+
+/* Private functions -------------------------------------------------------------*/
+static uint32_t feed_tod(uint8_t hour, uint8_t minute, uint8_t second);
+static int feed_arm_from(const Date_TypeDef *d);
+static void feed_catch_up(const Date_TypeDef *d);
+static void feed_dispense(uint8_t slot, uint8_t portions, const Date_TypeDef *d);
+static void feed_step(uint8_t servo);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void feed_init(DS3231_TypeDef *rtc)
+{
+	feed_rtc = rtc;
+	ntimes = 0;
+	armed_tod = -1;
+	alarm_ok = 0;
+	arm_failed_at = -1;
+	log_next = 0;
+	log_used = 0;
+	phase = FEED_IDLE;
+	remaining = 0;
+
+	feed_stats.scheduled = 0;
+	feed_stats.manual = 0;
+	feed_stats.missed = 0;
+	feed_stats.portions = 0;
+	feed_stats.alarms = 0;
+	feed_stats.errors = 0;
+}
+
+int feed_add(uint8_t hour, uint8_t minute, uint8_t portions)
+{
+	uint32_t t = feed_tod(hour, minute, 0);
+	uint8_t i, j;
+
+	if (hour > 23 || minute > 59 || portions == 0 || portions > FEED_MAX_PORTIONS)
+		return -1;
+
+	for (i = 0; i < ntimes && feed_tod(times[i].hour, times[i].minute, 0) < t; i++)
+		;
+
+	if (i < ntimes && times[i].hour == hour && times[i].minute == minute) {
+		times[i].portions = portions;
+		return 0;
+	}
+	if (ntimes >= FEED_MAX_TIMES)
+		return -1;
+
+	/* Keep the table sorted : open a gap at i */
+	for (j = ntimes; j > i; j--)
+		times[j] = times[j - 1];
+	times[i].hour = hour;
+	times[i].minute = minute;
+	times[i].portions = portions;
+	ntimes++;
+
+	return 0;
+}
+
+int feed_remove(uint8_t hour, uint8_t minute)
+{
+	uint8_t i;
+
+	for (i = 0; i < ntimes; i++)
+		if (times[i].hour == hour && times[i].minute == minute)
+			break;
+	if (i == ntimes)
+		return -1;
+
+	for (ntimes--; i < ntimes; i++)
+		times[i] = times[i + 1];
+
+	return 0;
+}
+
+const FEED_TimeTypeDef *feed_get(uint8_t slot)
+{
+	return (slot < ntimes) ? &times[slot] : NULL;
+}
+
+uint8_t feed_count(void)
+{
+	return ntimes;
+}
+
+int feed_next(uint8_t hour, uint8_t minute, uint8_t second)
+{
+	uint32_t t = feed_tod(hour, minute, second);
+	uint8_t i;
+
+	if (ntimes == 0)
+		return -1;
+
+	for (i = 0; i < ntimes; i++)
+		if (feed_tod(times[i].hour, times[i].minute, 0) > t)
+			return i;
+
+	return 0;  // Past the last one today : first one tomorrow
+}
+
+int feed_arm(void)
+{
+	uint32_t t, failed;
+
+	if (RTC_read_date(&now, feed_rtc) != I2C_OK) {
+		alarm_ok = 0;  // Retried while feed_armed says so
+		return -1;
+	}
+
+	/* No alarm comes for a feed that passed while alarm 1 could not be
+	   programmed : serve it as the alarm would have */
+	if (arm_failed_at >= 0 && armed_tod >= 0) {
+		t = feed_tod(now.hour, now.minute, now.second);
+		failed = (uint32_t) arm_failed_at;
+		if ((t + FEED_SECONDS_PER_DAY - failed) % FEED_SECONDS_PER_DAY >=
+		    ((uint32_t) armed_tod + FEED_SECONDS_PER_DAY - 1 - failed) % FEED_SECONDS_PER_DAY + 1)
+			feed_catch_up(&now);
+	}
+
+	return feed_arm_from(&now);
+}
+
+uint32_t feed_service(uint32_t events)
+{
+	events &= FEED_EVT_ALARM | FEED_EVT_BUTTON;
+	if (!events)
+		return 0;
+
+	/* Without the date nothing can be logged or armed : hand it all back */
+	if (RTC_read_date(&now, feed_rtc) != I2C_OK) {
+		feed_stats.errors++;
+		return events;
+	}
+
+	/* A press during a feed is most likely contact bounce */
+	if ((events & FEED_EVT_BUTTON) && !feed_busy()) {
+		feed_dispense(FEED_SLOT_MANUAL, 1, &now);
+		feed_stats.manual++;
+	}
+
+	if (events & FEED_EVT_ALARM) {
+		/* INT/SQW stays low until A1F is cleared, and no other edge comes */
+		if (RTC_clear_interrupt_flag(feed_rtc, ALARM1) != I2C_OK) {
+			feed_stats.errors++;
+			return FEED_EVT_ALARM;
+		}
+		feed_stats.alarms++;
+
+		feed_catch_up(&now);
+		feed_arm_from(&now);
+	}
+
+	return 0;
+}
+
+uint8_t feed_armed(void)
+{
+	return alarm_ok || ntimes == 0;
+}
+
+uint8_t feed_busy(void)
+{
+	return phase != FEED_IDLE;
+}
+
+uint8_t feed_log_get(uint8_t age, FEED_LogTypeDef *entry)
+{
+	if (age >= log_used)
+		return 0;
+
+	*entry = log_buf[(log_next + FEED_LOG_SIZE - 1 - age) % FEED_LOG_SIZE];
+	return 1;
+}
+
+void feed_get_stats(FEED_StatsTypeDef *stats)
+{
+	*stats = feed_stats;
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Seconds since midnight.
+  * @param hour : 0 - 23.
+  * @param minute : 0 - 59.
+  * @param second : 0 - 59.
+  * @retval Time of day (s)
+  */
+static uint32_t feed_tod(uint8_t hour, uint8_t minute, uint8_t second)
+{
+	return (uint32_t) hour * 3600U + (uint32_t) minute * 60U + second;
+}
+
+/**
+  * @brief Programs alarm 1 for the first feed after d, so the day's last
+  *	   feed arms the first one of the next day.
+  * @param d : Current date.
+  * @retval Slot armed, or -1 if the schedule is empty or the DS3231 could
+  *	   not be programmed
+  */
+static int feed_arm_from(const Date_TypeDef *d)
+{
+	Alarm_TypeDef alarm;
+	int armed = feed_next(d->hour, d->minute, d->second);
+
+	if (armed < 0) {
+		armed_tod = -1;
+		return -1;
+	}
+	armed_tod = (int32_t) feed_tod(times[armed].hour, times[armed].minute, 0);
+
+	alarm.second = 0;
+	alarm.minute = times[armed].minute;
+	alarm.hour = times[armed].hour;
+	alarm.day = 0;
+	alarm.date = 0;
+	alarm.alrm_num = ALARM1;
+	alarm.rate = PERDAY;
+
+	/* The alarm registers may be written even if a later transfer fails :
+	   keep armed_tod, so an alarm that fires all the same is served */
+	if (RTC_clear_interrupt_flag(feed_rtc, ALARM1) != I2C_OK ||
+	    RTC_enable_interrupts(feed_rtc, &alarm) != I2C_OK) {
+		alarm_ok = 0;
+		arm_failed_at = (int32_t) feed_tod(d->hour, d->minute, d->second);
+		return -1;
+	}
+	alarm_ok = 1;
+	arm_failed_at = -1;
+
+	return armed;
+}
+
+/**
+  * @brief Serves every feed from the armed one up to d : the alarm only
+  *	   covers the first, others may have passed while it waited. Those
+  *	   more than FEED_LATE_S late count as missed. Nothing is done if the
+  *	   clock was set back.
+  * @param d : Current date.
+  * @retval None
+  */
+static void feed_catch_up(const Date_TypeDef *d)
+{
+	uint32_t t, span, late;
+	uint8_t i;
+
+	if (armed_tod < 0)
+		return;
+
+	t = feed_tod(d->hour, d->minute, d->second);
+	span = (t + FEED_SECONDS_PER_DAY - (uint32_t) armed_tod) % FEED_SECONDS_PER_DAY;
+
+	for (i = 0; i < ntimes && span <= FEED_SECONDS_PER_DAY / 2; i++) {
+		late = (t + FEED_SECONDS_PER_DAY -
+			feed_tod(times[i].hour, times[i].minute, 0)) % FEED_SECONDS_PER_DAY;
+		if (late > span)
+			continue;
+
+		if (late <= FEED_LATE_S) {
+			feed_dispense(i, times[i].portions, d);
+			feed_stats.scheduled++;
+		} else {
+			feed_stats.missed++;
+		}
+	}
+}
+
+/**
+  * @brief Logs a feed and queues its portions. Portions requested while a
+  *	   feed is running are added to it.
+  * @param slot : Schedule slot, or FEED_SLOT_MANUAL.
+  * @param portions : Push / home cycles.
+  * @param d : Date of the feed.
+  * @retval None
+  */
+static void feed_dispense(uint8_t slot, uint8_t portions, const Date_TypeDef *d)
+{
+	FEED_LogTypeDef *e = &log_buf[log_next];
+	uint32_t primask;
+
+	e->year = d->year;
+	e->month = d->month;
+	e->date = d->date;
+	e->hour = d->hour;
+	e->minute = d->minute;
+	e->second = d->second;
+	e->slot = slot;
+	e->portions = portions;
+	log_next = (log_next + 1) % FEED_LOG_SIZE;
+	if (log_used < FEED_LOG_SIZE)
+		log_used++;
+
+	feed_stats.portions += portions;
+
+	primask = irq_save();
+	remaining = ((uint16_t) remaining + portions > 0xFF) ? 0xFF : remaining + portions;
+	if (phase == FEED_IDLE) {
+		phase = FEED_PUSHING;
+		servo_push(feed_step);
+	}
+	irq_restore(primask);
+}
+
+/**
+  * @brief Servo completion callback : push, home, and again while portions
+  *	   are left.
+  * @param servo : Servo that arrived last.
+  * @retval None
+  */
+static void feed_step(uint8_t servo)
+{
+	if (phase == FEED_PUSHING) {
+		phase = FEED_HOMING;
+		servo_home(feed_step);
+		return;
+	}
+
+	if (remaining > 0)
+		remaining--;
+
+	if (remaining > 0) {
+		phase = FEED_PUSHING;
+		servo_push(feed_step);
+	} else {
+		phase = FEED_IDLE;
+	}
+}
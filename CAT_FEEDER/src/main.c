@@ -1,22 +1,42 @@
 /* Includes ----------------------------------------------------------------------*/
 #include <stm32l476xx.h>
+#include "../../DS3231/include/i2c.h"
+#include "../../DS3231/include/dma.h"
+#include "../../DS3231/include/ds3231.h"
 #include "../include/servo.h"
+#include "../include/pwm.h"
+#include "../include/feed.h"
+#include "../include/swtimer.h"
+#include "../../SCHED/include/sched.h"
 #include "../include/delay.h"
+#include "../include/irq.h"
 
 /* Private defines ---------------------------------------------------------------*/
 #define PA1_AF2_TIM5_CH2        ((uint32_t) 0x02 << (4 * 1))
 #define PB3_AF1_TIM2_CH2	((uint32_t) 0x01 << (4 * 3))
 #define CK_PSC_NODIV		((uint16_t) 0x00)
+#define SYSCLK_HZ		((uint32_t) 16000000U)
 
-volatile uint8_t homed = 1;
+/* Feed task events, besides the FEED_EVT_* ones feed_service handles */
+#define FEED_EVT_REARM		((uint32_t) 0x04)
+#define FEED_REARM_MS		((uint32_t) 5000U)	// DS3231 retry interval
+
+static DS3231_TypeDef rtc;
+static int feed_task;
+static SWTIMER_TypeDef rearm_timer;
+static uint32_t feed_retry;		// FEED_EVT_* feed_service handed back
 
 /* Private function prototypes ---------------------------------------------------*/
 static void sysclk_init(void);
 static void pa1_pwm_config(void);
 static void pb3_pwm_config(void);
-static void tim5_ch2_config(void);
-static void tim2_ch2_config(void);
+static int tim5_ch2_config(void);
+static int tim2_ch2_config(void);
 static void button_pin_init(void);
+static void rtc_alarm_pin_init(void);
+static void feed_task_run(uint32_t events);
+static void feed_rearm_tick(void *arg);
+static void feeder_sleep(void);
 /* Private functions -------------------------------------------------------------*/
 
 /**
@@ -30,13 +50,92 @@ void main(void)
 	sysclk_init();  // Setup SYSCLK (HSI16)
 	pa1_pwm_config();  // Connect PA1 to TIM5_CH2 PWM output 
 	pb3_pwm_config();  // Connect PB3 to TIM2_CH2 PWM output
-	tim2_ch2_config();  // Setup and start TIM5_CH2
-	tim5_ch2_config();  // Setup and start TIM2_CH4
+
+	/* Setup and start TIM2_CH2 and TIM5_CH2. A servo period out of reach at
+	   this SYSCLK would drive the servos with the wrong pulses : stop here,
+	   before either one is moved, instead */
+	if (tim2_ch2_config() != 0 || tim5_ch2_config() != 0)
+		while (1);
+
+	servo_init();  // Step servo moves from the TIM2 update interrupt
 	button_pin_init();  // Configure button
-	systick_init(16000);
-	
-	while(1) {
-	}
+	swtimer_init();  // LPTIM1 time base for delay() and software timers
+
+	/* Handlers only post events : the work runs in tasks */
+	sched_init(SYSCLK_HZ, swtimer_ticks, SWTIMER_TICK_HZ);
+	feed_task = sched_add("feed", SCHED_PRIO_HIGHEST, feed_task_run);
+	sched_set_idle(feeder_sleep);
+
+	i2c1_init();  // DS3231 on PB6 (SCL) / PB7 (SDA)
+	dma_i2c_rx_init();
+	dma_i2c_tx_init();
+
+	/* Daily feeds : time and portions */
+	feed_init(&rtc);
+	feed_add(7, 30, 2);
+	feed_add(18, 0, 2);
+
+	rtc_alarm_pin_init();  // DS3231 INT/SQW on PA2
+	sched_post(feed_task, FEED_EVT_REARM);  // Armed by the feed task
+
+	/* Stop 2 keeps SRAM and the EXTI lines; wake up on HSI16 like sysclk_init */
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+	PWR->CR1 &= ~PWR_CR1_LPMS;
+	PWR->CR1 |= PWR_CR1_LPMS_STOP2;
+	RCC->CFGR |= RCC_CFGR_STOPWUCK;
+
+	sched_run();
+}
+
+/**
+  * @brief Feed task : serves the button and alarm events (DS3231 reads,
+  *	   alarm re-arming, servo moves).
+  * @param events : FEED_EVT_* bits.
+  * @retval None
+  */
+static void feed_task_run(uint32_t events)
+{
+	/* Events the DS3231 did not answer for come round with the rearm tick;
+	   alarm 1 is left as it is until a held-back alarm has been serviced */
+	events |= feed_retry;
+	feed_retry = feed_service(events);
+
+	if ((events & FEED_EVT_REARM) && !(feed_retry & FEED_EVT_ALARM))
+		feed_arm();
+
+	/* Keep trying while the DS3231 does not answer, or no feed is ever due */
+	if (!feed_armed() || feed_retry != 0)
+		swtimer_start(&rearm_timer, FEED_REARM_MS, 0, feed_rearm_tick, NULL);
+}
+
+/**
+  * @brief Rearm timer callback (LPTIM1 interrupt) : alarm 1 is to be
+  *	   programmed, or a held-back event serviced, again.
+  * @param arg : Unused.
+  * @retval None
+  */
+static void feed_rearm_tick(void *arg)
+{
+	sched_post(feed_task, FEED_EVT_REARM);
+}
+
+/**
+  * @brief Idle hook : Stop 2 when no feed is running, Sleep while the servos
+  *	   (TIM2 / TIM5) are. Called with interrupts masked.
+  * @param None
+  * @retval None
+  */
+static void feeder_sleep(void)
+{
+	uint8_t deep = !feed_busy();
+
+	if (deep)
+		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	irq_wait();
+
+	if (deep)
+		SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
 }
 
 /**
@@ -161,18 +260,19 @@ static void tim1_ch1n_config(void)
   *        Channel 1 is active as long as TIM2_CNT < TIM2_CCR1;
   *        otherwise, it is inactive.
   * @param None
-  * @retval None
+  * @retval 0 on success, -1 (TIM2 left off) if the period is out of reach
   */
-static void tim2_ch2_config(void)
+static int tim2_ch2_config(void)
 {
 	// Clock the TIM2 peripheral
 	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM2EN; 
 	
-	// Setup input clock divider and auto-reload register
-	TIM2->PSC = 400 - 1;  // CK_CNT freq. = (16 MHz / 400) = 40 kHz 
-	TIM2->ARR = 800;  /* Data bit signal duration = (1.0 / 40 kHz) * 800 = 20 milliseconds : */
-				 
-	TIM2->CCR2 = 60;  // Set capture and compare register to 0
+	/* Setup input clock divider and auto-reload register :
+	   20 ms period with the finest step SYSCLK allows (62.5 ns at 16 MHz) */
+	if (pwm_set_period(TIM2, SERVO_PERIOD_US, SERVO_RESOLUTION_NS) != 0)
+		return -1;
+
+	TIM2->CCR2 = servo_angle_to_ccr(SERVO_1, SERVO_HOME_ANGLE);  // Start at the home position
 	
 	// Configure the counter as an up-counter
 	TIM2->CR1 &= ~TIM_CR1_DIR;
@@ -197,6 +297,8 @@ static void tim2_ch2_config(void)
 	
 	// Enable TIM2
 	TIM2->CR1 |= TIM_CR1_CEN;
+
+	return 0;
 }
 
 /**
@@ -204,18 +306,19 @@ static void tim2_ch2_config(void)
   *        Channel 2 is active as long as TIM5_CNT < TIM5_CCR2;
   *        otherwise, it is inactive.
   * @param None
-  * @retval None
+  * @retval 0 on success, -1 (TIM5 left off) if the period is out of reach
   */
-static void tim5_ch2_config(void)
+static int tim5_ch2_config(void)
 {
 	// Clock the TIM5 peripheral
 	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM5EN;
 	
-	// Setup input clock divider and auto-reload register
-	TIM5->PSC = 400 - 1;  // CK_CNT freq. = (16 MHz / 400) = 40 kHz 
-	TIM5->ARR = 800;  /* Data bit signal duration = (1.0 / 40 kHz) * 800 = 20 milliseconds */
-				 
-	TIM5->CCR2 = 60;  // Set capture and compare register to 0
+	/* Setup input clock divider and auto-reload register :
+	   20 ms period with the finest step SYSCLK allows (62.5 ns at 16 MHz) */
+	if (pwm_set_period(TIM5, SERVO_PERIOD_US, SERVO_RESOLUTION_NS) != 0)
+		return -1;
+
+	TIM5->CCR2 = servo_angle_to_ccr(SERVO_2, SERVO_HOME_ANGLE);  // Start at the home position
 	
 	// Configure the counter as an up-counter
 	TIM5->CR1 &= ~TIM_CR1_DIR;
@@ -240,6 +343,8 @@ static void tim5_ch2_config(void)
 	
 	// Enable TIM5
 	TIM5->CR1 |= TIM_CR1_CEN;
+
+	return 0;
 }
 
 /**
@@ -278,27 +383,64 @@ void button_pin_init(void)
 }
 
 /**
-  * @brief Handle interrupts generated by the button
+  * @brief Configures PA2 for the interrupts generated by the DS3231
+  *	   (INT/SQW is open-drain, active low).
   * @param None
   * @retval None
   */
-void EXTI0_IRQHandler(void)
-{       
-	size_t i;
+static void rtc_alarm_pin_init(void)
+{
+        // Enable Port A IO Clock
+        RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
 
+        // Configure PA2 as a digital input pin with a pull-up
+        GPIOA->MODER &= ~GPIO_MODER_MODER2;  // bit field = 0b00
+        GPIOA->PUPDR &= ~GPIO_PUPDR_PUPDR2;
+        GPIOA->PUPDR |= GPIO_PUPDR_PUPDR2_0;
+
+        // Enable the SYSCFG clock
+        RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+        // Connect EXTI2 to PA2
+        SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI2;
+        SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI2_PA;
+
+        // Unmask interrupt request from line 2
+        EXTI->IMR1 |= EXTI_IMR1_IM2;
+
+        // Disable rising edge trigger for input line 2
+        EXTI->RTSR1 &= ~EXTI_RTSR1_RT2;
+
+        // Enable falling edge trigger for input line 2
+        EXTI->FTSR1 |= EXTI_FTSR1_FT2;
+
+        // Register EXTI2 interrupt handler with NVIC
+        NVIC_SetPriority(EXTI2_IRQn, 0x03);
+        NVIC_EnableIRQ(EXTI2_IRQn);
+}
+
+/**
+  * @brief Handle interrupts generated by the button : asks for one portion.
+  *	   Presses (and contact bounce) during a feed are ignored.
+  * @param None
+  * @retval None
+  */
+void EXTI0_IRQHandler(void)
+{
         EXTI->PR1 |= EXTI_PR1_PIF0;
-        
-        // Wait for the button to be released   
-        while (GPIOA->IDR & GPIO_IDR_IDR_0);
-	
-	if (homed == 1)	{
-		servo_push();
-		homed = 0;
-	} else {
-		home_servo2();
-		home_servo1();
-		homed = 1;
-	}
-	
+
+	sched_post(feed_task, FEED_EVT_BUTTON);
+}
+
+/**
+  * @brief Handle the DS3231 alarm : the I2C work is left to the feed task.
+  * @param None
+  * @retval None
+  */
+void EXTI2_IRQHandler(void)
+{
+        EXTI->PR1 |= EXTI_PR1_PIF2;
+
+	sched_post(feed_task, FEED_EVT_ALARM);
 }
 /**** END OF FILE ****/
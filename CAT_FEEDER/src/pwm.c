@@ -0,0 +1,156 @@
+#include <stm32l476xx.h>
+#include "../include/pwm.h"
+
+/* Private variables -------------------------------------------------------------*/
+
+/* MSI frequency for each MSIRANGE value (kHz) */
+static const uint16_t msi_khz[12] = {
+	100, 200, 400, 800, 1000, 2000, 4000, 8000, 16000, 24000, 32000, 48000
+};
+
+/* Private functions -------------------------------------------------------------*/
+static uint32_t pwm_sysclk(void);
+static uint32_t pwm_pll_input(void);
+static uint32_t pwm_msi(void);
+
+/* Function Implementations ------------------------------------------------------*/
+
+int pwm_timing(uint32_t clk, uint32_t period_us, uint32_t resolution_ns, uint32_t max_arr,
+	       PWM_TimingTypeDef *timing)
+{
+	uint64_t counts, div, tick_ps, steps;
+
+	if (clk == 0 || period_us == 0)
+		return -1;
+
+	/* Counter steps in one period at CK_PSC */
+	counts = ((uint64_t) clk * period_us + 500000U) / 1000000U;
+
+	/* Smallest divider that brings the period within ARR's range */
+	div = (counts + max_arr) / ((uint64_t) max_arr + 1);
+	if (div == 0)
+		div = 1;
+	if (div - 1 > PWM_MAX_PSC || counts < 2)
+		return -1;
+
+	tick_ps = (div * 1000000000000ULL) / clk;
+	if (tick_ps > (uint64_t) resolution_ns * 1000U)
+		return -1;
+
+	timing->psc = (uint32_t) (div - 1);
+	timing->arr = (uint32_t) ((counts + div / 2) / div - 1);
+	timing->tick_ps = tick_ps;
+
+	/* Up to 2^48 CK_PSC cycles : split so the nanoseconds cannot overflow */
+	steps = ((uint64_t) timing->arr + 1) * div;
+	timing->period_ns = steps / clk * 1000000000U + steps % clk * 1000000000U / clk;
+
+	return 0;
+}
+
+uint32_t pwm_get_clk(TIM_TypeDef *TIMx)
+{
+	uint32_t hpre = (RCC->CFGR & RCC_CFGR_HPRE) >> 4;
+	uint32_t ppre, hclk = pwm_sysclk();
+
+	/* HPRE 0xxx = /1, 1000 - 1011 = /2 - /16, 1100 - 1111 = /64 - /512 */
+	if (hpre & 0x8)
+		hclk >>= (hpre & 0x7) + ((hpre >= 0xC) ? 2 : 1);
+
+	/* TIM1, TIM8, TIM15 - TIM17 are on APB2, the others on APB1 */
+	if (TIMx == TIM1 || TIMx == TIM8 || TIMx == TIM15 || TIMx == TIM16 || TIMx == TIM17)
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> 11;
+	else
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> 8;
+
+	/* PPREx 0xx = /1, 1xx = /2 - /16; timers then get twice PCLK */
+	if (ppre & 0x4)
+		hclk = (hclk >> ((ppre & 0x3) + 1)) * 2;
+
+	return hclk;
+}
+
+int pwm_set_period(TIM_TypeDef *TIMx, uint32_t period_us, uint32_t resolution_ns)
+{
+	PWM_TimingTypeDef t;
+	uint32_t max_arr = (TIMx == TIM2 || TIMx == TIM5) ? PWM_MAX_ARR32 : PWM_MAX_ARR16;
+
+	if (pwm_timing(pwm_get_clk(TIMx), period_us, resolution_ns, max_arr, &t) != 0)
+		return -1;
+
+	TIMx->PSC = t.psc;
+	TIMx->ARR = t.arr;
+
+	// PSC is only loaded at an update event : force one now
+	TIMx->EGR |= TIM_EGR_UG;
+	TIMx->SR &= ~TIM_SR_UIF;
+
+	return 0;
+}
+
+uint32_t pwm_ns_to_ccr(TIM_TypeDef *TIMx, uint32_t ns)
+{
+	uint64_t den = ((uint64_t) TIMx->PSC + 1) * 1000000000U;
+
+	return (uint32_t) (((uint64_t) ns * pwm_get_clk(TIMx) + den / 2) / den);
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Follows the SYSCLK mux to the frequency it selects.
+  * @param None
+  * @retval SYSCLK (Hz)
+  */
+static uint32_t pwm_sysclk(void)
+{
+	uint32_t pllcfgr = RCC->PLLCFGR;
+	uint32_t m, n, r;
+
+	switch (RCC->CFGR & RCC_CFGR_SWS) {
+	case RCC_CFGR_SWS_HSI:
+		return PWM_HSI_FREQ;
+	case RCC_CFGR_SWS_HSE:
+		return PWM_HSE_FREQ;
+	case RCC_CFGR_SWS_PLL:
+		/* f_VCO = f_in / PLLM * PLLN; PLLCLK = f_VCO / PLLR */
+		m = ((pllcfgr & RCC_PLLCFGR_PLLM) >> 4) + 1;
+		n = (pllcfgr & RCC_PLLCFGR_PLLN) >> 8;
+		r = (((pllcfgr & RCC_PLLCFGR_PLLR) >> 25) + 1) * 2;
+		return (uint32_t) ((uint64_t) pwm_pll_input() * n / (m * r));
+	default:
+		return pwm_msi();
+	}
+}
+
+/**
+  * @brief Follows the PLL source mux.
+  * @param None
+  * @retval PLL input (Hz)
+  */
+static uint32_t pwm_pll_input(void)
+{
+	switch (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) {
+	case RCC_PLLCFGR_PLLSRC_HSI:
+		return PWM_HSI_FREQ;
+	case RCC_PLLCFGR_PLLSRC_HSE:
+		return PWM_HSE_FREQ;
+	default:
+		return pwm_msi();
+	}
+}
+
+/**
+  * @brief MSI runs at the range in RCC_CR once MSIRGSEL is set; before that
+  *	   it is still on its reset range.
+  * @param None
+  * @retval MSI (Hz)
+  */
+static uint32_t pwm_msi(void)
+{
+	uint32_t range = (RCC->CR & RCC_CR_MSIRANGE) >> 4;
+
+	if (!(RCC->CR & RCC_CR_MSIRGSEL) || range >= 12)
+		return PWM_MSI_RESET_FREQ;
+	return (uint32_t) msi_khz[range] * 1000U;
+}
@@ -1,36 +1,173 @@
 #include <stm32l476xx.h>
+#include <stddef.h>
 #include "../include/servo.h"
+#include "../include/pwm.h"
 #include "../include/delay.h"
+#include "../include/irq.h"
 
-void servo_push(void)
+/* Private types -----------------------------------------------------------------*/
+typedef struct
 {
-	TIM5->CCR2 = 20;
-	TIM2->CCR2 = 100;
+	TIM_TypeDef *tim;
+	volatile uint32_t *ccr;		// Compare register driving the servo
+	int32_t start, delta;		// Move from start to start + delta
+	uint16_t step, steps;		// Periods done / in the whole move
+	uint8_t profile;
+	volatile uint8_t moving;
+	SERVO_CallbackTypeDef done;
+	SERVO_CalibrationTypeDef cal;
+} SERVO_MotionTypeDef;
+
+/* Private variables -------------------------------------------------------------*/
+
+/* Stepped by the TIM2 interrupt : moves are set up with it masked */
+static SERVO_MotionTypeDef motion[SERVO_COUNT] = {
+	{TIM2, &TIM2->CCR2, .cal = {SERVO_MIN_PULSE_NS, SERVO_MAX_PULSE_NS,
+				    SERVO_MIN_ANGLE, SERVO_MAX_ANGLE}},
+	{TIM5, &TIM5->CCR2, .cal = {SERVO_MIN_PULSE_NS, SERVO_MAX_PULSE_NS,
+				    SERVO_MIN_ANGLE, SERVO_MAX_ANGLE}},
+};
+
+/* Private functions -------------------------------------------------------------*/
+static int32_t servo_profile(uint8_t profile, int32_t u);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void servo_init(void)
+{
+	TIM2->DIER &= ~TIM_DIER_UIE;
+	TIM2->SR &= ~TIM_SR_UIF;
+
+	NVIC_SetPriority(TIM2_IRQn, 0x02);
+	NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+uint8_t servo_move(uint8_t servo, uint32_t ccr, uint16_t duration_ms, uint8_t profile,
+		   SERVO_CallbackTypeDef done)
+{
+	SERVO_MotionTypeDef *m;
+	uint32_t primask;
+
+	if (servo >= SERVO_COUNT)
+		return 0;
+	m = &motion[servo];
+
+	primask = irq_save();
+
+	/* Start from the value the servo is being driven to right now */
+	m->start = (int32_t) *m->ccr;
+	m->delta = (int32_t) ccr - m->start;
+	m->step = 0;
+	m->steps = duration_ms / SERVO_PERIOD_MS;
+	if (m->steps == 0)
+		m->steps = 1;
+	m->profile = profile;
+	m->done = done;
+	m->moving = 1;
+
+	TIM2->DIER |= TIM_DIER_UIE;
+
+	irq_restore(primask);
+
+	return 1;
+}
+
+uint8_t servo_move_angle(uint8_t servo, int16_t angle, uint16_t duration_ms, uint8_t profile,
+			 SERVO_CallbackTypeDef done)
+{
+	if (servo >= SERVO_COUNT)
+		return 0;
+	return servo_move(servo, servo_angle_to_ccr(servo, angle), duration_ms, profile, done);
+}
+
+void servo_calibrate(uint8_t servo, const SERVO_CalibrationTypeDef *cal)
+{
+	if (servo < SERVO_COUNT && cal->min_angle != cal->max_angle)
+		motion[servo].cal = *cal;
+}
+
+uint32_t servo_angle_to_ccr(uint8_t servo, int16_t angle)
+{
+	const SERVO_CalibrationTypeDef *cal;
+	int32_t lo, hi, span;
+	int64_t ns;
+
+	if (servo >= SERVO_COUNT)
+		return 0;
+	cal = &motion[servo].cal;
+
+	lo = (cal->min_angle < cal->max_angle) ? cal->min_angle : cal->max_angle;
+	hi = (cal->min_angle < cal->max_angle) ? cal->max_angle : cal->min_angle;
+	if (angle < lo)
+		angle = lo;
+	if (angle > hi)
+		angle = hi;
+
+	/* Straight line through (min_angle, min_ns) and (max_angle, max_ns) */
+	span = cal->max_angle - cal->min_angle;
+	ns = (int64_t) cal->min_ns + ((int64_t) cal->max_ns - cal->min_ns) *
+	     (angle - cal->min_angle) / span;
+
+	return pwm_ns_to_ccr(motion[servo].tim, (uint32_t) ns);
+}
+
+void servo_stop(uint8_t servo)
+{
+	if (servo < SERVO_COUNT)
+		motion[servo].moving = 0;
+}
+
+uint8_t servo_busy(uint8_t servo)
+{
+	return (servo < SERVO_COUNT) ? motion[servo].moving : 0;
+}
+
+void servo_push(SERVO_CallbackTypeDef done)
+{
+	uint32_t primask = irq_save();
+
+	/* Same duration, started in the same period : both arrive on the same step */
+	servo_move_angle(SERVO_2, SERVO2_PUSH_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_SCURVE, NULL);
+	servo_move_angle(SERVO_1, SERVO1_PUSH_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_SCURVE, done);
+
+	irq_restore(primask);
+}
+
+void servo_home(SERVO_CallbackTypeDef done)
+{
+	uint32_t primask = irq_save();
+
+	servo_move_angle(SERVO_2, SERVO_HOME_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_SCURVE, NULL);
+	servo_move_angle(SERVO_1, SERVO_HOME_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_SCURVE, done);
+
+	irq_restore(primask);
 }
 
-void rotate_servo1(uint16_t ccr)
+void rotate_servo1(uint32_t ccr)
 {
+	servo_stop(SERVO_1);
 	TIM2->CCR2 = ccr;
 }
 
-void rotate_servo2(uint16_t ccr)
+void rotate_servo2(uint32_t ccr)
 {
+	servo_stop(SERVO_2);
 	TIM5->CCR2 = ccr;
 }
 
 void home_servo1(void)
 {
-	TIM2->CCR2 = 60;
+	servo_move_angle(SERVO_1, SERVO_HOME_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_TRAPEZOID, NULL);
 }
 
 void home_servo2(void)
 {
-	TIM5->CCR2 = 60;
+	servo_move_angle(SERVO_2, SERVO_HOME_ANGLE, SERVO_MOVE_MS, SERVO_PROFILE_TRAPEZOID, NULL);
 }
 
 void servo1_signal_off(void)
 {
-	TIM2->CR1 &= ~TIM_CR1_CEN;	
+	TIM2->CR1 &= ~TIM_CR1_CEN;
 }
 
 void servo2_signal_off(void)
@@ -47,3 +184,81 @@ void servo2_signal_on(void)
 {
 	TIM5->CR1 |= TIM_CR1_CEN;
 }
+
+/**
+  * @brief Steps every moving servo once per PWM period. Callbacks run after
+  *	   all servos have been stepped, so a callback may start new moves.
+  * @param None
+  * @retval None
+  */
+void TIM2_IRQHandler(void)
+{
+	SERVO_CallbackTypeDef done[SERVO_COUNT];
+	SERVO_MotionTypeDef *m;
+	uint8_t i, active = 0;
+
+	TIM2->SR &= ~TIM_SR_UIF;
+
+	for (i = 0; i < SERVO_COUNT; i++) {
+		m = &motion[i];
+		done[i] = NULL;
+		if (!m->moving)
+			continue;
+
+		m->step++;
+		*m->ccr = (uint32_t) (m->start + (int32_t) (((int64_t) m->delta *
+			  servo_profile(m->profile, ((int32_t) m->step << 16) / m->steps)) >> 16));
+
+		if (m->step >= m->steps) {
+			m->moving = 0;
+			done[i] = m->done;
+		} else {
+			active = 1;
+		}
+	}
+
+	/* Nothing left to step : stop interrupting every period */
+	if (!active)
+		TIM2->DIER &= ~TIM_DIER_UIE;
+
+	for (i = 0; i < SERVO_COUNT; i++)
+		if (done[i] != NULL)
+			done[i](i);
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Fraction of the move covered at a point in time, both in Q16.
+  *
+  *	   Trapezoid : accelerates over u < 1/4, cruises at 4/3 of the mean
+  *	   speed, decelerates over u > 3/4.
+  *		s = 8u^2/3,  4(u - 1/8)/3,  1 - 8(1 - u)^2/3
+  *
+  *	   S-curve : s = u^3 (10 - 15u + 6u^2); speed and acceleration both
+  *	   start and end at zero.
+  * @param profile : SERVO_PROFILE_*.
+  * @param u : Time elapsed over the duration (0 - 65536).
+  * @retval Position fraction (0 - 65536)
+  */
+static int32_t servo_profile(uint8_t profile, int32_t u)
+{
+	int64_t s;
+	int32_t r;
+
+	if (profile == SERVO_PROFILE_SCURVE) {
+		/* Horner form, kept in Q32 until the end */
+		s = ((int64_t) 6 * u - (15 << 16)) * u + ((int64_t) 10 << 32);
+		s = (s * u) >> 16;
+		s = (s * u) >> 16;
+		s = (s * u) >> 16;
+		return (int32_t) (s >> 16);
+	}
+
+	if (u < (1 << 14))
+		return (8 * ((u * (int64_t) u) >> 16)) / 3;
+	if (u <= (3 << 14))
+		return (4 * (u - (1 << 13))) / 3;
+	r = (1 << 16) - u;
+	return (1 << 16) - (int32_t) ((8 * ((r * (int64_t) r) >> 16)) / 3);
+}
@@ -1,5 +1,5 @@
 /**********************************************************************************\
- * @file    I2C_PROJECT/include/aux.h                                             *
+ * @file    DS3231/include/aux.h                                                  *
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V2.0                                                                  *
  * @date    26-June-2017                                                          *
@@ -36,19 +36,10 @@ uint8_t get_digit(uint8_t digit, uint32_t num);
 uint8_t rtc_reg_bcd_to_int(uint8_t num);
 
 /**
-  * @brief Converts a digit to 7-segment LED display hexadecimal code. 
-  * @param digit : Digit to be converted to 7-segment code.
-  * @retval digit_to_7seg : The 7-segment hexadecimal code.
+  * @brief Converts an integer (0 - 99) to a BCD value for an RTC register.
+  * @param num : Integer to be converted. Only the last two digits are kept.
+  * @retval int_to_rtc_reg_bcd : Packed BCD (ten's digit in bits 7 - 4).
   */
-uint8_t digit_to_7seg(uint8_t digit);
-
-/**
-  * @brief Converts current hour and minute to an array of 7-segment hex. codes. 
-  * @param hour : The current hour.
-  * @param min : The current minute.
-  * @param segarr : Pointer to the array that holds the 7-segment hex. codes.
-  * @retval None 
-  */
-void time_to_7seg(uint8_t hour, uint8_t min, uint8_t *segarr);
+uint8_t int_to_rtc_reg_bcd(uint8_t num);
 
 #endif
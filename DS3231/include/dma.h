@@ -1,5 +1,5 @@
 /**********************************************************************************\
- * @file    I2C_PROJECT/include/dma.h                                             *
+ * @file    DS3231/include/dma.h                                                  *
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V2.0                                                                  *
  * @date    26-June-2017                                                          *
@@ -22,6 +22,7 @@
 #define DMA1_CH7_MAP_ON_I2C1_RX                 ((uint32_t) 0x3 << 24)
 #define DMA1_CH6_MAP_ON_I2C1_TX			((uint32_t) 0x3 << 20)
 #define DMA1_CH2_MAP_ON_TIM1CH1                 ((uint32_t) 0x7 << 4)
+#define DMA1_CH1_MAP_ON_ADC1			((uint32_t) 0x0 << 0)
 #define PERIPH_SIZE_8_BITS                      ((uint32_t) 0x0 << 8)
 #define PERIPH_SIZE_16_BITS                     ((uint32_t) 0x1 << 8)
 #define MEM_SIZE_8_BITS                         ((uint32_t) 0x0 << 10)
@@ -47,4 +48,13 @@ void dma_i2c_tx_init(void);
   */
 void dma_i2c_rx_init(void);
 
+/**
+  * @brief Creates a circular DMA channel from ADC1_DR to memory and
+  *	   raises an interrupt each time the buffer has been filled.
+  * @param samples : Buffer receiving the conversions.
+  * @param nsamples : Number of 16-bit samples in the buffer.
+  * @retval None
+  */
+void dma_adc1_init(volatile uint16_t *samples, uint16_t nsamples);
+
 #endif
@@ -1,5 +1,5 @@
 /**********************************************************************************\
- * @file    I2C_PROJECT/include/ds3231.h                                          *
+ * @file    DS3231/include/ds3231.h                                               *
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V2.0                                                                  *
  * @date    26-June-2017                                                          *
@@ -14,6 +14,8 @@
 #ifndef DS3231_H
 #define DS3231_H
 
+#include "./i2c.h"
+
 #define __IO			volatile
 
 /***********************************************************************************\
@@ -119,6 +121,8 @@ typedef struct
 #define DS3231_TEMPMSBR_PTR		((uint8_t) 0x11)
 #define DS3231_TEMPLSBR_PTR		((uint8_t) 0x12)	
 
+#define DS3231_DATE_NREGS		((uint8_t) 7)		/*!< SECR - YEARR, read/written in one burst */
+
 /**********************************************************************************\
  *                                                                                *
  *                              DS3231 REGISTER BIT DEFS                          *
@@ -143,6 +147,7 @@ typedef struct
 #define DS3231_HOURR_NONMILTIME		((uint8_t) 0x40)	/*!< Time format is not military time */
 #define DS3231_HOURR_PM			((uint8_t) 0x20)	/*!< Current time is PM */
 #define DS3231_HOURR_20HR		((uint8_t) 0x20)	/*!< Current hour is between 20 and 23 */
+#define DS3231_HOURR_24HR_MASK		((uint8_t) 0x3F)	/*!< BCD hour bits in 24-hour mode */
 // Bit 4 is the ten's digit of the current hour.
 // Bits 3 - 0 are the one's digit of the current hour.
 
@@ -164,7 +169,7 @@ typedef struct
 
 /* MONTHR *************************************************************************/
 
-// Bit 7 determines century
+#define DS3231_MONTHR_CENTURY		((uint8_t) 0x80)	/*!< Year register is in the 2000s */
 // Bits 6 - 5 are reserved:  must be 0.
 #define DS3231_MONTHR_JAN		((uint8_t) 0x01)	/*!< Current month is January */
 #define DS3231_MONTHR_FEB		((uint8_t) 0x02)	/*!< Current month is February */
@@ -278,23 +283,22 @@ typedef struct
 \**********************************************************************************/
 
 /**
-  * @brief
-  *
-  *
-  * @param : date  
-  * @param : rtc
-  * @retval None
+  * @brief Writes a date to the DS3231 (24-hour mode) in a single
+  *	   8-byte burst : register pointer + SECR - YEARR.
+  * @param : date : Date to be written.
+  * @param : rtc : Shadow copy of the DS3231 registers.
+  * @retval I2C_OK, or the error that ended the transfer
   */
-void RTC_set_date(Date_TypeDef *restrict date, DS3231_TypeDef *restrict rtc);
+I2C_StatusTypeDef RTC_set_date(Date_TypeDef *restrict date, DS3231_TypeDef *restrict rtc);
 
 /**
-  * @brief
-  *
-  *
-  * @param : time_arr 
-  * @retval None
+  * @brief Reads SECR - YEARR in a single 7-byte burst and decodes
+  *	   them into d. d is left untouched if the read fails.
+  * @param : d : Date to be filled in.
+  * @param : rtc : Shadow copy of the DS3231 registers.
+  * @retval I2C_OK, or the error that ended the transfer
   */
-void RTC_read_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc);
+I2C_StatusTypeDef RTC_read_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc);
 
 /**
   * @brief
@@ -320,9 +324,9 @@ void RTC_read_alarm(Alarm_TypeDef *restrict alarm);
   *
   * @param alrm_num :
   * @param alrm_rate :
-  * @retval None
+  * @retval I2C_OK, or the error of the first transfer that failed
   */
-void RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict alarm);
+I2C_StatusTypeDef RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict alarm);
 
 /**
   * @brief
@@ -330,9 +334,9 @@ void RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict
   *
   * @param alrm_num :
   * @param alrm_rate :
-  * @retval None
+  * @retval I2C_OK, or the error that ended the transfer
   */
-void RTC_clear_interrupt_flag(DS3231_TypeDef *restrict rtc, DS3231_ALARM_TypeDef alrm);
+I2C_StatusTypeDef RTC_clear_interrupt_flag(DS3231_TypeDef *restrict rtc, DS3231_ALARM_TypeDef alrm);
 
 /**
   * @brief
@@ -0,0 +1,93 @@
+/**********************************************************************************\
+ * @file    DS3231/include/i2c.h                                                  *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V2.0                                                                  *
+ * @date    26-June-2017                                                          *
+ * @brief   I2C Interface.                                                        *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef I2C_H
+#define I2C_H
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              I2C CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define I2C_CLK_FREQ_DIV_2	((uint32_t) 1U << 28)
+
+#define I2C_SYSCLK_FREQ		((uint32_t) 16000000U)	/*!< HSI16 drives SYSCLK (see sysclk_init) */
+#define I2C_TIMEOUT_CYCLES	((uint32_t) (I2C_SYSCLK_FREQ / 100U))	/*!< 10 ms per bus phase */
+#define I2C_MAX_RETRIES		((uint8_t) 3U)		/*!< Attempts after the first failure */
+#define I2C_BUS_CLEAR_PULSES	((uint8_t) 9U)		/*!< SCL pulses needed to free a stuck slave */
+#define I2C_BUS_CLEAR_HALF_CYCLES ((uint32_t) (I2C_SYSCLK_FREQ / 200000U))  /*!< 5 us (100 kHz SCL) */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              I2C ENUMS                                         *
+ *                                                                                *
+\**********************************************************************************/
+typedef enum
+{
+	I2C_OK = 0,		/*!< Transfer completed */
+	I2C_ERR_NACK = 1,	/*!< Slave did not acknowledge its address or data */
+	I2C_ERR_ARLO = 2,	/*!< Arbitration lost */
+	I2C_ERR_BERR = 3,	/*!< Misplaced START/STOP detected on the bus */
+	I2C_ERR_TIMEOUT = 4	/*!< Transfer did not complete in I2C_TIMEOUT_CYCLES */
+} I2C_StatusTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              I2C STRUCTS                                       *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	uint32_t transfers;		/*!< Transfers requested by drivers */
+	uint32_t retries;		/*!< Transfers re-issued after an error */
+	uint32_t failures;		/*!< Transfers abandoned after I2C_MAX_RETRIES */
+	uint32_t nacks;			/*!< NACKF events */
+	uint32_t arlos;			/*!< ARLO events */
+	uint32_t berrs;			/*!< BERR events */
+	uint32_t timeouts;		/*!< Waits that exceeded I2C_TIMEOUT_CYCLES */
+	uint32_t recoveries;		/*!< Bus-clear sequences performed */
+	uint32_t last_recovery_cycles;	/*!< Duration of the latest recovery (SYSCLK cycles) */
+	uint32_t max_recovery_cycles;	/*!< Longest recovery observed (SYSCLK cycles) */
+} I2C_StatsTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              I2C FUNCTIONS                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/* initialize i2c1 peripheral */
+void i2c1_init(void);
+
+/* configure pins used for i2c1 */
+static void i2c1_pins_init(void);
+
+/* transmit data on the i2c1 bus */
+I2C_StatusTypeDef i2c1_transmit(uint8_t nbytes, uint8_t slvaddr, uint8_t *payload);
+
+/* read data from a slave on the i2c1 bus */
+I2C_StatusTypeDef i2c1_read(uint8_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr);
+
+/* wait (bounded) for the bus to go idle, clearing it if it stays busy */
+I2C_StatusTypeDef i2c1_wait_idle(void);
+
+/* free a slave that holds SDA low and restart the peripheral */
+void i2c1_bus_recover(void);
+
+/* copy the error/retry counters */
+void i2c1_get_stats(I2C_StatsTypeDef *stats);
+
+/* zero the error/retry counters */
+void i2c1_reset_stats(void);
+
+#endif
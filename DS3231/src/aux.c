@@ -1,5 +1,5 @@
  /**********************************************************************************\
-  * @file    I2C_PROJECT/include/aux.c                                             *
+  * @file    DS3231/src/aux.c                                                      *
   * @author  Nolan R. Gagnon                                                       *
   * @version V1.0                                                                  *
   * @date    23-June-2017                                                          *
@@ -11,9 +11,28 @@
   * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. Gagnon  </center></h2>           *
   *                                                                                *
  \**********************************************************************************/
-#include <math.h>
 #include "../include/aux.h"
 
+/***********************************************************************************\
+ *                                                                                 *
+ *                              LOOKUP TABLES                                      *
+ *                                                                                 *
+\***********************************************************************************/
+
+/* Packed BCD for 0 - 99 : row = ten's digit, column = one's digit */
+static const uint8_t bcd_table[100] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99
+};
+
 /***********************************************************************************\
  *                                                                                 *
  *                              AUX FUNCTIONS                                      *
@@ -22,67 +41,18 @@
 
 uint8_t get_digit(uint8_t digit, uint32_t num)
 {
-	uint8_t num_digits = floor(log10(num) + 1);
+	while (digit-- > 1)
+		num /= 10;
 
-	if (digit > num_digits)
-		return 0;
-	else
-		return (uint8_t)(((uint32_t)(num / (pow(10, digit - 1)))) % 10);
+	return (uint8_t) (num % 10);
 }
 
 uint8_t rtc_reg_bcd_to_int(uint8_t num)
 {
-	return (((num & 0xF0) >> 4) * 10) + (num & 0x0F);
-}
-
-uint8_t digit_to_7seg(uint8_t digit)
-{
-	switch (digit) {	
-	case 0:
-		return 0x3FU;
-	case 1:
-		return 0x06U;		
-	case 2:
-		return 0x5BU;
-	case 3:
-		return 0x4FU;
-	case 4:
-		return 0x66U;
-	case 5:
-		return 0x6DU;
-	case 6:
-		return 0x7DU;
-	case 7:
-		return 0x07U;
-	case 8:
-		return 0x7FU;
-	case 9:
-		return 0x6FU;
-	default:
-		return 0xFFU;
-	}
+	return (uint8_t) (((num >> 4) * 10) + (num & 0x0F));
 }
 
-void time_to_7seg(uint8_t hour, uint8_t min, uint8_t *segarr)
+uint8_t int_to_rtc_reg_bcd(uint8_t num)
 {
-	uint8_t tens_digit;
-	uint8_t ones_digit;	
-	
-	/* hour */	
-	tens_digit = get_digit(2, hour);
-	ones_digit = get_digit(1, hour);	
-	segarr[0] = digit_to_7seg(tens_digit);
-	segarr[1] = (uint8_t) 0x00;
-	segarr[2] = digit_to_7seg(ones_digit);
-	segarr[3] = (uint8_t) 0x00;
-	segarr[4] = (uint8_t) 0x02;  // Colon
-	segarr[5] = (uint8_t) 0x00;
-	
-	/* minute */
-	tens_digit = get_digit(2, min);
-	ones_digit = get_digit(1, min);
-	segarr[6] = digit_to_7seg(tens_digit);
-	segarr[7] = (uint8_t) 0x00;
-	segarr[8] = digit_to_7seg(ones_digit);	
-	segarr[9] = (uint8_t) 0x00;	
+	return bcd_table[num % 100];
 }
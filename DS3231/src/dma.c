@@ -1,5 +1,5 @@
  /**********************************************************************************\
-  * @file    I2C_PROJECT/src/dma.c						   *
+  * @file    DS3231/src/dma.c						   *
   * @author  Nolan R. Gagnon 		            				   *
   * @version V1.0								   *
   * @date    23-June-2017							   *
@@ -73,3 +73,43 @@ void dma_i2c_tx_init(void)
 	DMA1_Channel6->CCR &= ~DMA_CCR_PSIZE;  // Peripheral size = 8 bits
 	DMA1_Channel6->CCR |= DMA_CCR_PL_1 | DMA_CCR_PL_0;  // Very high transfer priority
 }
+
+/**
+  * @brief Configures a circular DMA channel from ADC1_DR to memory.
+  * @param samples : Buffer receiving the conversions.
+  * @param nsamples : Number of 16-bit samples in the buffer.
+  * @retval None
+  */
+void dma_adc1_init(volatile uint16_t *samples, uint16_t nsamples)
+{
+	/* Clock DMA controller 1 */
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+
+	/* Disable DMA1_Channel1 before changing settings */
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+
+	/* Setup data path (periph ---data---> mem) */
+	DMA1_CSELR->CSELR &= ~DMA_CSELR_C1S;  // Clear channel selection bit field
+	DMA1_CSELR->CSELR |= DMA1_CH1_MAP_ON_ADC1;  // Map DMA1 CH1 on ADC1
+	DMA1_Channel1->CCR &= ~DMA_CCR_DIR;  // DMA reads from peripheral
+	DMA1_Channel1->CPAR = (uint32_t) &(ADC1->DR);  // Read data from ADC1_DR
+	DMA1_Channel1->CMAR = (uint32_t) samples;
+	DMA1_Channel1->CNDTR = nsamples;
+
+	/* Xfer characteristics */
+	DMA1_Channel1->CCR &= ~DMA_CCR_PINC;  // Peripheral address not auto-incremented
+	DMA1_Channel1->CCR |= DMA_CCR_MINC;  // Memory address auto-incremented
+	DMA1_Channel1->CCR |= DMA_CCR_CIRC;  // Wrap around to the start of the buffer
+	DMA1_Channel1->CCR &= ~DMA_CCR_MSIZE;
+	DMA1_Channel1->CCR |= MEM_SIZE_16_BITS;  // Memory size = 16 bits
+	DMA1_Channel1->CCR &= ~DMA_CCR_PSIZE;
+	DMA1_Channel1->CCR |= PERIPH_SIZE_16_BITS;  // Peripheral size = 16 bits
+	DMA1_Channel1->CCR &= ~DMA_CCR_PL;  // Low priority (I2C channels come first)
+
+	/* Interrupt once the whole buffer has been filled */
+	DMA1_Channel1->CCR |= DMA_CCR_TCIE;
+	NVIC_SetPriority(DMA1_Channel1_IRQn, 10);  // Low priority
+	NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+	DMA1_Channel1->CCR |= DMA_CCR_EN;
+}
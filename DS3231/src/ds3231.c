@@ -1,9 +1,9 @@
 /**********************************************************************************\
- * @file    I2C_PROJECT/src/ds3231.c                                              *
+ * @file    DS3231/src/ds3231.c                                                   *
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V1.0                                                                  *
  * @date    26-June-2017                                                          *
- * @brief   DS3231 driver.                                                        *
+ * @brief   DS3231 driver, shared by CAT_FEEDER and I2C_PROJECT.                  *
  *                                                                                *
  **********************************************************************************
  * @attention                                                                     *
@@ -16,127 +16,66 @@
 #include "../include/ds3231.h"
 #include "../include/aux.h"
 
-void RTC_set_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc)
+I2C_StatusTypeDef RTC_set_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc)
 {
-	uint8_t date_settings[8];
-	uint8_t tens_digit;
-	uint8_t ones_digit;
-	uint8_t thousands_digit;
+	uint8_t date_settings[DS3231_DATE_NREGS + 1];
 	
 	RTC_struct_reset(rtc);
 	
-	/* First data byte will be written here */	
+	/* Encode every field straight into the shadow registers (24-hour mode) */
+	rtc->SECR = int_to_rtc_reg_bcd(d->second);
+	rtc->MINR = int_to_rtc_reg_bcd(d->minute);
+	rtc->HOURR = int_to_rtc_reg_bcd(d->hour) & ~DS3231_HOURR_NONMILTIME;
+	rtc->DAYR = d->day;
+	rtc->DATER = int_to_rtc_reg_bcd(d->date);
+	rtc->MONTHR = int_to_rtc_reg_bcd(d->month);
+	if (d->year >= 2000)
+		rtc->MONTHR |= DS3231_MONTHR_CENTURY;
+	rtc->YEARR = int_to_rtc_reg_bcd((uint8_t) (d->year % 100));
+
+	/* Register pointer followed by SECR - YEARR in one burst */
 	date_settings[0] = DS3231_SECR_PTR;
-
-	/* Convert second to BCD */
-	tens_digit = get_digit(2, d->second);		
-	ones_digit = get_digit(1, d->second);
-	
-	rtc->SECR = 0x00 | (tens_digit << 4) | (ones_digit << 0);	
 	date_settings[1] = rtc->SECR;
-
-	/* Convert minute to BCD */
-	tens_digit = get_digit(2, d->minute);		
-	ones_digit = get_digit(1, d->minute);
-	
-	rtc->MINR = 0x00 | (tens_digit << 4) | (ones_digit << 0);	
 	date_settings[2] = rtc->MINR;
-
-	/* Set hour register */
-	tens_digit = get_digit(2, d->hour);
-	ones_digit = get_digit(1, d->hour);
-
-	rtc->HOURR &= ~DS3231_HOURR_NONMILTIME;	// Use military time
-
-	switch (tens_digit) {
-	case 0:
-		rtc->HOURR |= 0 << 4;
-		break;
-	case 1:
-		rtc->HOURR |= 1 << 4;
-		break;
-	case 2:
-		rtc->HOURR |= DS3231_HOURR_20HR;
-		break;
-	default:
-		break;
-	}
-	
-	rtc->HOURR |= ones_digit << 0;
 	date_settings[3] = rtc->HOURR;
-
-	/* Set day register */
-	rtc->DAYR |= d->day;		
 	date_settings[4] = rtc->DAYR;
-
-	/* Set date register */
-	tens_digit = get_digit(2, d->date);
-	ones_digit = get_digit(1, d->date);
-	rtc->DATER |= tens_digit << 4;
-	rtc->DATER |= ones_digit << 0;	
 	date_settings[5] = rtc->DATER;
-
-	/* Set month register */
-	thousands_digit = get_digit(4, (uint32_t) d->year);
-
-	if (thousands_digit == 1)
-		rtc->MONTHR |= 0 << 7;
-	else if (thousands_digit == 2)
-		rtc->MONTHR |= 1 << 7;
-	else
-		rtc->MONTHR |= 1 << 7;
-
-	tens_digit = get_digit(2, (uint32_t) d->month);
-	ones_digit = get_digit(1, (uint32_t) d->month);
-	
-	rtc->MONTHR |= (tens_digit << 4) | (ones_digit << 0);
 	date_settings[6] = rtc->MONTHR;
-
-	/* Set year register */
-	tens_digit = get_digit(2, (uint32_t) d->year);
-	ones_digit = get_digit(1, (uint32_t) d->year);	
-	
-	rtc->YEARR |= (tens_digit << 4)	| (ones_digit << 0);
 	date_settings[7] = rtc->YEARR;
 	
 	/* Transmit date settings to DS3231 via I2C bus */
-	i2c1_transmit(8, DS3231_I2C_ADDR, date_settings);
+	return i2c1_transmit(DS3231_DATE_NREGS + 1, DS3231_I2C_ADDR, date_settings);
 }
 
-void RTC_read_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc)
+I2C_StatusTypeDef RTC_read_date(Date_TypeDef *restrict d, DS3231_TypeDef *restrict rtc)
 {	
 	uint8_t reg[1] = {DS3231_SECR_PTR};
-	uint8_t *storage;
-
-	storage = (uint8_t *) malloc(7 * sizeof(uint8_t));
+	uint8_t storage[DS3231_DATE_NREGS];
+	I2C_StatusTypeDef status;
 
-	i2c1_read(7, DS3231_I2C_ADDR, reg, storage);
+	/* SECR - YEARR in one burst */
+	status = i2c1_read(DS3231_DATE_NREGS, DS3231_I2C_ADDR, reg, storage);
+	if (status != I2C_OK)
+		return status;  // Keep the last good date rather than decode garbage
 	
 	d->second = rtc_reg_bcd_to_int(storage[0]);
 	d->minute = rtc_reg_bcd_to_int(storage[1]);
-	
-	if (0x20 & storage[2]) 
-		storage[2] = 0x20 | (storage[2] & 0x0F);
-	else
-		storage[2] = (0x10 & storage[2]) | (storage[2] & 0x0F);
-
-	d->hour = rtc_reg_bcd_to_int(storage[2]);
-	d->day = storage[3] & 0x0F;
+	d->hour = rtc_reg_bcd_to_int(storage[2] & DS3231_HOURR_24HR_MASK);
+	d->day = storage[3] & 0x07;
 	d->date = rtc_reg_bcd_to_int(storage[4]);
-	d->month = rtc_reg_bcd_to_int((uint8_t) (0x7F & storage[5]));	
+	d->month = rtc_reg_bcd_to_int(storage[5] & ~DS3231_MONTHR_CENTURY);	
 
-	if (0x80 & storage[5])
+	if (storage[5] & DS3231_MONTHR_CENTURY)
 		d->year = 2000 + rtc_reg_bcd_to_int(storage[6]);
 	else
 		d->year = 1900 + rtc_reg_bcd_to_int(storage[6]);
 
-	free(storage);
+	return I2C_OK;
 }
 
-void RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict alarm)
+I2C_StatusTypeDef RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict alarm)
 {
-	uint8_t tens_digit;
-	uint8_t ones_digit;
+	I2C_StatusTypeDef status;
 	uint8_t i2c_payload[5];
 	
 	RTC_struct_reset(rtc);
@@ -158,32 +97,40 @@ void RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict
 			rtc->ALRM1DAYR |= DS3231_ALRM1DAYR_MASK4;
 			
 			/* Set alarm second */
-			tens_digit = get_digit(2, alarm->second);	
-			ones_digit = get_digit(1, alarm->second);
-			rtc->ALRM1SECR |= (0x7F) & ((tens_digit << 4) | (ones_digit << 0));
+			rtc->ALRM1SECR |= (0x7F) & int_to_rtc_reg_bcd(alarm->second);
 			i2c_payload[1] = rtc->ALRM1SECR;
 			
 			/* Set alarm minute */
-			tens_digit = get_digit(2, alarm->minute);
-			ones_digit = get_digit(1, alarm->minute);
-			rtc->ALRM1MINR |= (0x7F) & ((tens_digit << 4) | (ones_digit << 0));
+			rtc->ALRM1MINR |= (0x7F) & int_to_rtc_reg_bcd(alarm->minute);
 			i2c_payload[2] = rtc->ALRM1MINR;
 
-			/* Set alarm hour */
-			tens_digit = get_digit(2, alarm->hour);
-			ones_digit = get_digit(1, alarm->hour);
-
-			if (alarm->hour >= 20)
-				rtc->ALRM1HOURR |= DS3231_ALRM1HOURR_20HR;
-
-			rtc->ALRM1HOURR |= (0x1F) & ((tens_digit << 4) | (ones_digit << 0));
+			/* Set alarm hour (the 20HR bit is part of the BCD ten's digit) */
+			rtc->ALRM1HOURR |= DS3231_HOURR_24HR_MASK & int_to_rtc_reg_bcd(alarm->hour);
 			i2c_payload[3] = rtc->ALRM1HOURR;
 				
 			/* Set alarm day */	
 			rtc->ALRM1DAYR |= DS3231_ALRM1DAYR_DAY;
 			rtc->ALRM1DAYR |= (0x0F) & (alarm->day);
 			i2c_payload[4] = rtc->ALRM1DAYR;
-			
+
+			break;
+
+		case PERDAY:
+
+			/* Match hours, minutes and seconds; ignore the day */
+			rtc->ALRM1DAYR |= DS3231_ALRM1DAYR_MASK4;
+
+			rtc->ALRM1SECR |= (0x7F) & int_to_rtc_reg_bcd(alarm->second);
+			i2c_payload[1] = rtc->ALRM1SECR;
+
+			rtc->ALRM1MINR |= (0x7F) & int_to_rtc_reg_bcd(alarm->minute);
+			i2c_payload[2] = rtc->ALRM1MINR;
+
+			rtc->ALRM1HOURR |= DS3231_HOURR_24HR_MASK & int_to_rtc_reg_bcd(alarm->hour);
+			i2c_payload[3] = rtc->ALRM1HOURR;
+
+			i2c_payload[4] = rtc->ALRM1DAYR;
+
 			break;
 
 		default:
@@ -207,15 +154,17 @@ void RTC_enable_interrupts(DS3231_TypeDef *restrict rtc, Alarm_TypeDef *restrict
 		}
 	}
 
-	i2c1_transmit(5, DS3231_I2C_ADDR, i2c_payload);
+	status = i2c1_transmit(5, DS3231_I2C_ADDR, i2c_payload);
+	if (status != I2C_OK)
+		return status;  // Do not enable an alarm that was not programmed
 		
 	i2c_payload[0] = DS3231_CTLR_PTR;
 	i2c_payload[1] = rtc->CTLR;
 	
-	i2c1_transmit(2, DS3231_I2C_ADDR, i2c_payload);
+	return i2c1_transmit(2, DS3231_I2C_ADDR, i2c_payload);
 }
 
-void RTC_clear_interrupt_flag(DS3231_TypeDef *restrict rtc, DS3231_ALARM_TypeDef alrm)
+I2C_StatusTypeDef RTC_clear_interrupt_flag(DS3231_TypeDef *restrict rtc, DS3231_ALARM_TypeDef alrm)
 {
 	uint8_t payload[2];
 	
@@ -228,7 +177,7 @@ void RTC_clear_interrupt_flag(DS3231_TypeDef *restrict rtc, DS3231_ALARM_TypeDef
 	
 	payload[1] = rtc->SR;
 	
-	i2c1_transmit(2, DS3231_I2C_ADDR, payload);
+	return i2c1_transmit(2, DS3231_I2C_ADDR, payload);
 }
 
 void RTC_struct_reset(DS3231_TypeDef *rtc)
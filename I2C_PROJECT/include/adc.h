@@ -22,7 +22,12 @@
 #define ADCONV_TRIG_RISEDGE		((uint32_t) 0x01 << 10)
 #define ADCONV_TRIG_TIM1CH2		((uint32_t) 0x01 << 6)
 #define NODE_VOLTAGE			ADC1->DR
-#define MAX_REPEAT_ADCONV		10
+#define ADC_OVS_RATIO_16		((uint32_t) 0x3 << 2)	/*!< CFGR2 OVSR : 16 conversions per trigger */
+#define ADC_OVS_SHIFT_4			((uint32_t) 0x4 << 5)	/*!< CFGR2 OVSS : sum / 16 (stays 12-bit) */
+#define ADC_DMA_NSAMPLES		8			/*!< Oversampled results per decision (80 ms) */
+#define ADC_DMA_NSAMPLES_SHIFT		3			/*!< log2(ADC_DMA_NSAMPLES) */
+#define ADC_LEVEL_SHIFT			8			/*!< 4096 counts / 16 brightness levels */
+#define ADC_LEVEL_HYST			((uint16_t) 48U)	/*!< Counts past a level boundary before switching */
 
 /**********************************************************************************\
  *                                                                                *
@@ -58,6 +63,10 @@ static void adc1_resurrect(void);
   *
   *	   (*) Only one conversion int he regular sequence (conversion of channel 6)
   *
+  *	   (*) 16x hardware oversampling per trigger.
+  *
+  *	   (*) Results collected by DMA1 channel 1 in circular mode.
+  *
   * @param None
   * @retval None
   */
@@ -77,4 +86,21 @@ static void adc1_enable(void);
   */
 void adc1_init(void);
 
+/**
+  * @brief Sends the brightness level to the HT16K33 if it changed since
+  *	   the last call. Call from a task (uses the I2C bus).
+  * @param None
+  * @retval None
+  */
+void adc1_brightness_service(void);
+
+/**
+  * @brief Registers a function for the DMA1 channel 1 interrupt to call
+  *	   when the brightness level changes, so that a task can be woken to
+  *	   run adc1_brightness_service.
+  * @param callback : Called from the interrupt, or NULL for none.
+  * @retval None
+  */
+void adc1_on_level_change(void (*callback)(void));
+
 #endif
@@ -3,7 +3,7 @@
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V2.0                                                                  *
  * @date    26-June-2017                                                          *
- * @brief   Provides accurate delays using system timer.                          *
+ * @brief   Provides delays using the LPTIM2 software timers.                     *
  *                                                                                *
  **********************************************************************************
  * @attention                                                                     *
@@ -14,16 +14,6 @@
 #ifndef DELAY_H
 #define DELAY_H
 
-/**********************************************************************************\
- *                                                                                *
- *                               SYSTICK CONSTANTS                                *
- *                                                                                *
-\**********************************************************************************/
-#define SysTick_CTRL_ENABLE             ((uint32_t) 0x00000001)
-#define SysTick_CTRL_TICKINT            ((uint32_t) 0x00000002)
-#define SysTick_CTRL_CLKSOURCE          ((uint32_t) 0x00000004)
-#define SysTick_CTRL_COUNTFLAG          ((uint32_t) 0x00010000)
-
 /**********************************************************************************\
  *                                                                                *
  *                           DELAY FUNCTION PROTOTYPES                            *
@@ -31,21 +21,8 @@
 \**********************************************************************************/
 
 /**
-  * @brief Initializes the SysTick system timer. 
-  * @param ticks : Number of clock pulses required for SysTick counter to reach 0. 
-  * @retval None
-  */
-void systick_init(uint32_t ticks);
-
-/**
-  * @brief Turn of the SysTick counter. 
-  * @param None
-  * @retval None
-  */
-void systick_deinit(void);
-
-/**
-  * @brief Delay the processor for a number of milliseconds.
+  * @brief Sleeps for a number of milliseconds (swtimer_init must have been
+  *	   called). Not for interrupt handlers at or above the LPTIM2 priority.
   * @param time_ms : Number of milliseconds to delay. 
   * @retval None
   */
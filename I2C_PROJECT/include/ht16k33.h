@@ -30,6 +30,8 @@
 #define HT16K33_KEYDATR_PTR			((uint8_t) 0x40)
 #define HT16K33_INTFLGR_PTR			((uint8_t) 0x60)
 
+#define HT16K33_FRAME_NBYTES			((uint8_t) 10)	/*!< Display RAM used by the 4-digit backpack */
+
 /**********************************************************************************\
  *                                                                                *
  *                              HT16K33 COMMANDS                                  *
@@ -83,8 +85,26 @@ void DISPLAY_set_brightness(uint8_t duty);
 
 void DISPLAY_power_on(void);
 
+/**
+  * @brief Writes display RAM bytes that differ from the cached frame.
+  *	   Only the span from the first to the last changed byte is sent,
+  *	   starting at that byte's display RAM address, so a minute tick
+  *	   is normally 2 bytes (address pointer + one digit).
+  * @param tdata : Display RAM image (see time_to_7seg).
+  * @param data_size : Number of bytes in tdata (at most HT16K33_FRAME_NBYTES).
+  * @retval None
+  */
 void DISPLAY_write_time(uint8_t *tdata, uint8_t data_size);
 
 void DISPLAY_set_blink_freq(uint8_t freq);
 
+/**
+  * @brief Converts current hour and minute to an array of 7-segment hex. codes. 
+  * @param hour : The current hour.
+  * @param min : The current minute.
+  * @param segarr : Pointer to the array that holds the 7-segment hex. codes.
+  * @retval None 
+  */
+void time_to_7seg(uint8_t hour, uint8_t min, uint8_t *segarr);
+
 #endif
@@ -0,0 +1,109 @@
+/**********************************************************************************\
+ * @file    I2C_PROJECT/include/swrtc.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    04-July-2017                                                          *
+ * @brief   Software RTC : extrapolates DS3231 time with LPTIM1.                  *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef SWRTC_H
+#define SWRTC_H
+
+#include "../../DS3231/include/ds3231.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              SWRTC CONSTANTS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define SWRTC_TICKS_PER_SEC		((uint32_t) 32768U)	/*!< LPTIM1 runs from LSE */
+#define SWRTC_TICKS_SHIFT		15			/*!< log2(SWRTC_TICKS_PER_SEC) */
+#define SWRTC_RESYNC_PERIOD_S		((uint32_t) 86400U)	/*!< Max. time between DS3231 reads (< 36 h tick wrap) */
+#define LPTIM1_CLKSRC_LSE		((uint32_t) 3U << 18)	/*!< RCC_CCIPR LPTIM1SEL = LSE */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              SWRTC STRUCTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	uint32_t i2c_syncs;		/*!< DS3231 reads performed */
+	uint32_t i2c_errors;		/*!< DS3231 reads that failed or gave an invalid date */
+	uint32_t edge_syncs;		/*!< Re-anchors on the DS3231 alarm edge (no I2C) */
+	int32_t last_error_ticks;	/*!< Extrapolation error seen at the latest edge */
+	int32_t trim_q32;		/*!< Rate correction : fraction of elapsed ticks * 2^32 */
+} SWRTC_StatsTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                           SWRTC FUNCTION PROTOTYPES                            *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Reads the DS3231 once and starts LPTIM1 (clocked by LSE) as the
+  *	   time base. LSE must already be running (LCD_Clock_Init does this).
+  *	   If the read fails the clock counts from 01-Jan-2000 00:00:00 and
+  *	   SWRTC_service / SWRTC_rtc_edge retry it until one succeeds.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @retval 0 if the DS3231 was read, -1 otherwise
+  */
+int SWRTC_init(DS3231_TypeDef *rtc);
+
+/**
+  * @brief Returns the current date without touching the I2C bus.
+  * @param d : Filled in with the current date and time.
+  * @param ms : Filled in with milliseconds into the current second (may be NULL).
+  * @retval None
+  */
+void SWRTC_now(Date_TypeDef *d, uint16_t *ms);
+
+/**
+  * @brief Re-reads the DS3231 and re-anchors the software clock. A failed
+  *	   read keeps the current anchor.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @retval None
+  */
+void SWRTC_sync(DS3231_TypeDef *rtc);
+
+/**
+  * @brief Must be called from the DS3231 alarm interrupt : latches the
+  *	   counter at the edge so SWRTC_rtc_edge can run later from a task.
+  * @param None
+  * @retval None
+  */
+void SWRTC_mark_edge(void);
+
+/**
+  * @brief Handles the alarm edge latched by SWRTC_mark_edge (or, if none
+  *	   was, one happening now). The alarm fires on a whole minute, so this
+  *	   re-anchors the phase and measures drift without any I2C traffic.
+  *	   A full resync is done here when one is due. Must not be called
+  *	   from an interrupt handler.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @retval None
+  */
+void SWRTC_rtc_edge(DS3231_TypeDef *rtc);
+
+/**
+  * @brief Performs a pending resync (when no alarm edges are arriving).
+  *	   Call from the main loop.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @retval None
+  */
+void SWRTC_service(DS3231_TypeDef *rtc);
+
+/**
+  * @brief Copies the sync/drift counters.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void SWRTC_get_stats(SWRTC_StatsTypeDef *stats);
+
+#endif
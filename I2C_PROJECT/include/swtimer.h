@@ -0,0 +1,121 @@
+/**********************************************************************************\
+ * @file    I2C_PROJECT/include/swtimer.h                                         *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    21-July-2017                                                          *
+ * @brief   Tickless software timers on LPTIM2.                                   *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef SWTIMER_H
+#define SWTIMER_H
+
+/**********************************************************************************\
+ *                                                                                *
+ *                               SWTIMER CONSTANTS                                *
+ *                                                                                *
+\**********************************************************************************/
+
+/* LPTIM1 belongs to the software RTC (swrtc.c); LSE is started by LCD_Clock_Init */
+#define SWTIMER_LPTIM			LPTIM2
+#define SWTIMER_IRQn			LPTIM2_IRQn
+#define SWTIMER_IRQHandler		LPTIM2_IRQHandler
+#define SWTIMER_CLKSRC			((uint32_t) 3U << 20)	/*!< RCC_CCIPR LPTIM2SEL = LSE */
+#define SWTIMER_CLK_HZ			((uint32_t) 32768U)	/*!< LSE */
+#define SWTIMER_RCC_ENR			RCC->APB1ENR2
+#define SWTIMER_RCC_EN			RCC_APB1ENR2_LPTIM2EN
+#define SWTIMER_CLKSEL			RCC_CCIPR_LPTIM2SEL	/*!< Field SWTIMER_CLKSRC goes in */
+#define SWTIMER_START_LSI		0	/*!< LSE is already running */
+
+#define SWTIMER_PRESC			((uint32_t) 5U << 9)	/*!< LPTIM_CFGR PRESC = /32 */
+#define SWTIMER_TICK_HZ			(SWTIMER_CLK_HZ / 32U)	/*!< 1024 Hz */
+#define SWTIMER_CNT_MASK		((uint32_t) 0xFFFFU)	/*!< LPTIM counters are 16-bit */
+#define SWTIMER_MAX_TICKS		((uint32_t) 0x7FFFFFFFU)	/*!< Longest delay or period */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                SWTIMER STRUCTS                                 *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Called from the LPTIM2 interrupt when a timer expires */
+typedef void (*SWTIMER_CallbackTypeDef)(void *arg);
+
+/* Owned by the caller (static storage, or a stack frame that outlives it);
+ * the fields are only for the service to use. */
+typedef struct SWTIMER_TypeDef
+{
+	struct SWTIMER_TypeDef *next;	/*!< Next timer to expire */
+	uint32_t expiry;		/*!< Tick the timer is due at */
+	uint32_t period;		/*!< Ticks between expiries, 0 for a one-shot timer */
+	SWTIMER_CallbackTypeDef callback;
+	void *arg;
+	volatile uint8_t active;
+} SWTIMER_TypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                           SWTIMER FUNCTION PROTOTYPES                          *
+ *                                                                                *
+ * Running timers are kept in a list sorted by expiry. LPTIM2 counts free-running *
+ * ticks and its compare register is loaded with the first expiry only, so there  *
+ * is no periodic tick : the CPU is woken once per expiry (and once per counter   *
+ * wrap, every 64 s) and may sleep in between.                                    *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Runs LPTIM2 from LSE as the time base. LSE must already be
+  *	   running (LCD_Clock_Init does this).
+  * @param None
+  * @retval None
+  */
+void swtimer_init(void);
+
+/**
+  * @brief Starts a timer, or restarts it if it is already running.
+  * @param timer : Timer to start.
+  * @param delay_ms : Time to the first expiry; never less than asked for.
+  * @param period_ms : Time between later expiries, 0 for a one-shot timer.
+  *	   A periodic timer that falls a whole period behind skips the
+  *	   expiries it missed.
+  * @param callback : Called at each expiry, or NULL.
+  * @param arg : Passed to callback.
+  * @retval None
+  */
+void swtimer_start(SWTIMER_TypeDef *timer, uint32_t delay_ms, uint32_t period_ms,
+		   SWTIMER_CallbackTypeDef callback, void *arg);
+
+/**
+  * @brief Stops a timer; its callback will not be called again.
+  * @param timer : Timer to stop (it may already be stopped).
+  * @retval None
+  */
+void swtimer_stop(SWTIMER_TypeDef *timer);
+
+/**
+  * @brief Tells whether a timer is running.
+  * @param timer : Timer to check.
+  * @retval 1 if it is, 0 once a one-shot timer has expired or it was stopped
+  */
+uint8_t swtimer_active(const SWTIMER_TypeDef *timer);
+
+/**
+  * @brief Returns the free-running tick count (wraps every 48 days).
+  * @param None
+  * @retval Tick count
+  */
+uint32_t swtimer_ticks(void);
+
+/**
+  * @brief Converts milliseconds to ticks, rounding up.
+  * @param ms : Milliseconds.
+  * @retval Ticks, at most SWTIMER_MAX_TICKS
+  */
+uint32_t swtimer_ms_to_ticks(uint32_t ms);
+
+#endif
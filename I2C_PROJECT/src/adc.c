@@ -18,16 +18,28 @@
  *                                                                                *
 \**********************************************************************************/
 #include "../include/adc.h"
+#include "../../DS3231/include/dma.h"
 #include "../include/delay.h"
 #include "../include/ht16k33.h"
 #include "../include/timers.h"
+#include <stddef.h>
 
 /**********************************************************************************\
  *                                                                                *
  *                                  GLOBAL VARS                                   *
  *                                                                                *
 \**********************************************************************************/
-static volatile uint32_t prev_adconvs[MAX_REPEAT_ADCONV] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static volatile uint16_t adc_samples[ADC_DMA_NSAMPLES];
+static volatile uint8_t brightness_level = 0;
+static uint8_t brightness_written = 0xFF;  // Nothing written yet
+static void (*level_changed)(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE FUNCTIONS                                 *
+ *                                                                                *
+\**********************************************************************************/
+static uint8_t adc1_quantize(uint16_t avg, uint8_t level);
 
 /**********************************************************************************\
  *                                                                                *
@@ -87,10 +99,17 @@ static void adc1_configure(void)
         ADC1->SQR1 |= ADC_SQR1_SQ1_1 | ADC_SQR1_SQ1_2;  // Make channel 6 the only converted channel in the sequence
         ADC1->SMPR1 |= ADC_SMPR1_SMP6;  // Sample time = 640.5 ADC clock cycles
 
-        /* Generate interrupt at the end of conversion */ 
-        ADC1->IER |= ADC_IER_EOC;
-        NVIC_SetPriority(ADC1_2_IRQn, 10);  // Low priority
-        NVIC_EnableIRQ(ADC1_2_IRQn);
+	/* Average 16 conversions in hardware on every trigger */
+	ADC1->CFGR2 &= ~(ADC_CFGR2_OVSR | ADC_CFGR2_OVSS);
+	ADC1->CFGR2 |= ADC_OVS_RATIO_16 | ADC_OVS_SHIFT_4;
+	ADC1->CFGR2 |= ADC_CFGR2_ROVSE;
+
+	/* Results go straight to memory : no interrupt per conversion */
+	ADC1->IER &= ~ADC_IER_EOC;
+	ADC1->CFGR |= ADC_CFGR_OVRMOD;  // Keep the newest result on overrun
+	ADC1->CFGR |= ADC_CFGR_DMACFG;  // DMA circular mode
+	ADC1->CFGR |= ADC_CFGR_DMAEN;
+	dma_adc1_init(adc_samples, ADC_DMA_NSAMPLES);
 	
         /* Trigger A/D conversions on the rising edge of TIM1_CH2 PWM waveform */
         ADC1->CFGR |= ADCONV_TRIG_RISEDGE;
@@ -121,73 +140,67 @@ void adc1_init(void)
 	tim1_ch2_init();
 }
 
-void ADC1_2_IRQHandler(void)
+void adc1_brightness_service(void)
 {
-	if (NODE_VOLTAGE > 0x000U && NODE_VOLTAGE < 0x0FFU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY1);
-
-	} else if (NODE_VOLTAGE > 0x0FFU && NODE_VOLTAGE < 0x1FEU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY2);
-
-	} else if (NODE_VOLTAGE > 0x1FEU && NODE_VOLTAGE < 0x2FDU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY3);
-
-	} else if (NODE_VOLTAGE > 0x2FDU && NODE_VOLTAGE < 0x3FCU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY4);
-
-	} else if (NODE_VOLTAGE > 0x3FCU && NODE_VOLTAGE < 0x4FBU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY5);
-
-	} else if (NODE_VOLTAGE > 0x4FBU && NODE_VOLTAGE < 0x5FAU) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY6);
-
-	} else if (NODE_VOLTAGE > 0x5FAU && NODE_VOLTAGE < 0x6F9U) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY7);
+	uint8_t level = brightness_level;
 
-	} else if (NODE_VOLTAGE > 0x6F9U && NODE_VOLTAGE < 0x7F8U) {
+	if (level == brightness_written)
+		return;
 
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY8);
-
-	} else if (NODE_VOLTAGE > 0x7F8U && NODE_VOLTAGE < 0x8F7U) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY9);
-
-	} else if (NODE_VOLTAGE > 0x8F7U && NODE_VOLTAGE < 0x9F6U) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY10);
-
-	} else if (NODE_VOLTAGE > 0x9F6U && NODE_VOLTAGE < 0xAF5U) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY11);
-
-	} else if (NODE_VOLTAGE > 0xAF5U && NODE_VOLTAGE < 0xBF4U) {
-
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY12);
-
-	} else if (NODE_VOLTAGE > 0xBF4U && NODE_VOLTAGE < 0xCF3U) {
+	/* DUTY1 - DUTY16 are 0x0 - 0xF, so the level is the command parameter */
+	DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY1 + level);
+	brightness_written = level;
+}
 
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY13);
+void adc1_on_level_change(void (*callback)(void))
+{
+	level_changed = callback;
+}
 
-	} else if (NODE_VOLTAGE > 0xCF3U && NODE_VOLTAGE < 0xDF2U) {
+/**
+  * @brief Averages a full buffer of oversampled results and updates
+  *	   the brightness level.
+  * @param None
+  * @retval None
+  */
+void DMA1_Channel1_IRQHandler(void)
+{
+	uint8_t i, level;
+	uint32_t sum = 0;
 
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY14);
+	if (DMA1->ISR & DMA_ISR_TCIF1) {
+		DMA1->IFCR = DMA_IFCR_CTCIF1;
 
-	} else if (NODE_VOLTAGE > 0xDF2U && NODE_VOLTAGE < 0xEF1U) {
+		for (i = 0; i < ADC_DMA_NSAMPLES; i++)
+			sum += adc_samples[i];
 
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY15);
+		level = adc1_quantize((uint16_t) (sum >> ADC_DMA_NSAMPLES_SHIFT), brightness_level);
+		if (level != brightness_level) {
+			brightness_level = level;
+			if (level_changed != NULL)
+				level_changed();
+		}
+	}
+}
 
-	} else if (NODE_VOLTAGE > 0xEF1U && NODE_VOLTAGE < 0xFFFU) {
+/**
+  * @brief Maps a 12-bit reading onto 16 levels (256 counts each). The
+  *	   level only moves once the reading is ADC_LEVEL_HYST counts past
+  *	   the boundary of the current level.
+  * @param avg : Averaged 12-bit reading.
+  * @param level : Current level (0 - 15).
+  * @retval New level (0 - 15).
+  */
+static uint8_t adc1_quantize(uint16_t avg, uint8_t level)
+{
+	uint16_t lower = (uint16_t) level << ADC_LEVEL_SHIFT;
+	uint16_t upper = lower + (1U << ADC_LEVEL_SHIFT);
 
-		DISPLAY_set_brightness(HT16K33_DIMSETUP_DUTY16);
+	if (avg >= upper + ADC_LEVEL_HYST)
+		return (uint8_t) ((avg - ADC_LEVEL_HYST) >> ADC_LEVEL_SHIFT);
 
-	}
+	if (lower >= ADC_LEVEL_HYST && avg < lower - ADC_LEVEL_HYST)
+		return (uint8_t) ((avg + ADC_LEVEL_HYST) >> ADC_LEVEL_SHIFT);
 
-	ADC1->ISR |= ADC_ISR_EOC;  // Clear flag
+	return level;
 }
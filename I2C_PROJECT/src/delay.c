@@ -3,7 +3,7 @@
   * @author  Nolan R. H. Gagnon 	      					   *
   * @version V1.0								   *
   * @date    24-June-2017							   *
-  * @brief   Library to provide accurate delays using SysTick.			   *
+  * @brief   Delays that sleep on an LPTIM2 software timer.			   *
   *										   *
   **********************************************************************************
   * @attention									   *
@@ -14,74 +14,30 @@
   */
 
 /* Includes ----------------------------------------------------------------------*/
+#include <stddef.h>
+#include "../include/swtimer.h"
 #include "../include/delay.h"
-
-/* Private volatile variables ----------------------------------------------------*/
-static volatile uint32_t timing_delay;
+#include "../include/irq.h"
 
 /**
-  * @brief Delays the system for a number of milliseconds.
+  * @brief Delays the system for a number of milliseconds. The core sleeps
+  *	   until a one-shot timer expires instead of spinning. PRIMASK is
+  *	   left as the caller had it.
   * @param time_ms : Number of milliseconds to delay for.
   * @retval None
   */
 void delay(uint32_t time_ms)
 {
-        timing_delay = time_ms;
-        while (timing_delay != 0);
-}
-
-/**
-  * @brief Initialize SysTick for providing delays.
-  * @param ticks : Number of clock pulses needed for 
-  *		   the counter to reach zero.
-  * @retval None
-  */
-void systick_init(uint32_t ticks)
-{
-        // Disable SysTick IRQ and SysTick Counter
-        SysTick->CTRL = 0;
-
-        // Set reload register
-        SysTick->LOAD = ticks - 1;
-
-        // Set priority
-        NVIC_SetPriority(SysTick_IRQn, 2);
-
-        // Reset the SysTick counter value
-        SysTick->VAL = 0;
-
-        // Select processor clock
-        // 1 = processor clock; 0 = external clock
-         SysTick->CTRL |= SysTick_CTRL_CLKSOURCE;
-
-        // Enable SysTick IRQ and SysTick timer
-        SysTick->CTRL |= SysTick_CTRL_ENABLE;
-
-        //Enable SysTick exception request
-        // 1 = counting down to zero asserts the SysTick exception request
-        // 0 = counting down to zero does not assert the SysTick exception request
-        SysTick->CTRL |= SysTick_CTRL_TICKINT;
-}
-
-/**
-  * @brief Turns off SysTick timer.
-  * @param None
-  * @retval None
-  */
-void systick_deinit(void)
-{
-	SysTick->CTRL &= ~SysTick_CTRL_ENABLE;
-	SysTick->CTRL &= ~SysTick_CTRL_TICKINT;	
-}
-
-/**
-  * @brief Decreases the delay counter every time the SysTick counter
-  *	   reaches zero.
-  * @param None
-  * @retval None
-  */
-void SysTick_Handler(void)
-{
-        if (timing_delay > 0)
-                timing_delay--;
+	SWTIMER_TypeDef t;
+	uint32_t primask;
+
+	swtimer_start(&t, time_ms, 0, NULL, NULL);
+
+	primask = irq_save();
+	while (swtimer_active(&t)) {
+		irq_wait();
+		irq_restore(primask);
+		__disable_irq();
+	}
+	irq_restore(primask);
 }
@@ -18,7 +18,22 @@
  *                                                                                 *
 \***********************************************************************************/
 #include "../include/ht16k33.h"
-#include "../include/i2c.h"
+#include "../../DS3231/include/i2c.h"
+#include "../../DS3231/include/aux.h"
+
+/***********************************************************************************\
+ *                                                                                 *
+ *                                  PRIVATE VARS                                   *
+ *                                                                                 *
+\***********************************************************************************/
+/* Address pointer followed by the display RAM contents last written */
+static uint8_t frame[HT16K33_FRAME_NBYTES + 1] = {HT16K33_DISPDATR_PTR};
+static uint8_t frame_valid = 0;
+
+/* 7-segment codes (bit 0 = segment a ... bit 6 = segment g) for 0 - 9 */
+static const uint8_t seg_table[10] = {
+	0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F
+};
 
 /***********************************************************************************\
  *                                                                                 *
@@ -50,24 +65,43 @@ void DISPLAY_power_on(void)
 	parameterized_cmd = HT16K33_DSETUP | HT16K33_DSETUP_DISPON | HT16K33_DSETUP_BLKOFF;
 	payload[0] = parameterized_cmd;	
 	i2c1_transmit(1, HT16K33_I2C_ADDR, payload);
+
+	/* Display RAM is undefined after power-up */
+	frame_valid = 0;
 }
 
 void DISPLAY_write_time(uint8_t *tdata, uint8_t data_size)
 {
 	uint8_t i;
-	uint8_t *payload;		
+	uint8_t first;
+	uint8_t last;
+	uint8_t payload[HT16K33_FRAME_NBYTES + 1];
 	
-	payload = (uint8_t *) malloc((data_size + 1) * sizeof(uint8_t)); 
+	if (data_size > HT16K33_FRAME_NBYTES)
+		data_size = HT16K33_FRAME_NBYTES;
 
-	payload[0] = HT16K33_DISPDATR_PTR;
-	
-	for (i = 1; i < data_size + 1; i++) {
-		payload[i] = tdata[i - 1];	
+	/* Contents unknown (power-up or failed write) : send everything */
+	if (!frame_valid) {
+		for (i = 0; i < data_size; i++)
+			frame[i + 1] = tdata[i];
+		frame_valid = (i2c1_transmit(data_size + 1, HT16K33_I2C_ADDR, frame) == I2C_OK);
+		return;
 	}
 
-	i2c1_transmit(data_size + 1, HT16K33_I2C_ADDR, payload);	
+	/* Find the span of bytes that changed */
+	for (first = 0; first < data_size && frame[first + 1] == tdata[first]; first++);
+	if (first == data_size)
+		return;
+	for (last = data_size - 1; frame[last + 1] == tdata[last]; last--);
 
-	free(payload);
+	payload[0] = HT16K33_DISPDATR_PTR + first;
+	for (i = first; i <= last; i++) {
+		frame[i + 1] = tdata[i];
+		payload[i - first + 1] = tdata[i];
+	}
+
+	if (i2c1_transmit(last - first + 2, HT16K33_I2C_ADDR, payload) != I2C_OK)
+		frame_valid = 0;
 }
 
 void DISPLAY_set_blink_freq(uint8_t freq)
@@ -80,3 +114,24 @@ void DISPLAY_set_blink_freq(uint8_t freq)
 	
 	i2c1_transmit(1, HT16K33_I2C_ADDR, payload);		
 }
+
+void time_to_7seg(uint8_t hour, uint8_t min, uint8_t *segarr)
+{
+	uint8_t bcd;
+	
+	/* hour */	
+	bcd = int_to_rtc_reg_bcd(hour);
+	segarr[0] = seg_table[bcd >> 4];
+	segarr[1] = (uint8_t) 0x00;
+	segarr[2] = seg_table[bcd & 0x0F];
+	segarr[3] = (uint8_t) 0x00;
+	segarr[4] = (uint8_t) 0x02;  // Colon
+	segarr[5] = (uint8_t) 0x00;
+	
+	/* minute */
+	bcd = int_to_rtc_reg_bcd(min);
+	segarr[6] = seg_table[bcd >> 4];
+	segarr[7] = (uint8_t) 0x00;
+	segarr[8] = seg_table[bcd & 0x0F];	
+	segarr[9] = (uint8_t) 0x00;	
+}
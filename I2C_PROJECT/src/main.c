@@ -17,14 +17,33 @@
  *                                  INCLUDES                                       *
  *                                                                                 *
 \***********************************************************************************/
-#include "../include/i2c.h"
-#include "../include/dma.h"
-#include "../include/ds3231.h"
+#include "../../DS3231/include/i2c.h"
+#include "../../DS3231/include/dma.h"
+#include "../include/adc.h"
+#include "../../DS3231/include/ds3231.h"
+#include "../include/swrtc.h"
 #include "../include/lcd.h"
 #include "../include/ht16k33.h"
+#include "../include/swtimer.h"
+#include "../../SCHED/include/sched.h"
 #include "../include/delay.h"
 #include <stdio.h>
 
+/***********************************************************************************\
+ *                                                                                 *
+ *                                  DEFINES                                        *
+ *                                                                                 *
+\***********************************************************************************/
+#define SYSCLK_HZ		((uint32_t) 16000000U)
+#define SERVICE_PERIOD_MS	((uint32_t) 60000U)	// SWRTC resync check if no alarm edges arrive
+#define BUTTON_DEBOUNCE_MS	((uint32_t) 200U)
+
+/* Task events */
+#define EVT_ALARM		((uint32_t) 0x01)	// DS3231 alarm edge (clock task)
+#define EVT_SERVICE		((uint32_t) 0x02)	// Service timer expired (clock task)
+#define EVT_BUTTON		((uint32_t) 0x04)	// User button pressed (button task)
+#define EVT_BRIGHTNESS		((uint32_t) 0x08)	// Brightness level changed (brightness task)
+
 /***********************************************************************************\
  *                                                                                 *
  *                         PRIVATE FUNCTION PROTOTYPES                             *
@@ -33,6 +52,12 @@
 static void sysclk_init(void);
 static void exti_pin_init(void);
 static void button_pin_init(void);
+static void clock_task_run(uint32_t events);
+static void button_task_run(uint32_t events);
+static void brightness_task_run(uint32_t events);
+static void service_tick(void *arg);
+static uint8_t alarm_arm(void);
+static void brightness_changed(void);
 
 /***********************************************************************************\
  *                                                                                 *
@@ -46,6 +71,12 @@ static volatile DS3231_TypeDef rtc;
 static volatile Date_TypeDef d;
 static Alarm_TypeDef alrm;
 static volatile char sev_seg_arr[10];
+static SWTIMER_TypeDef service_timer;
+static uint32_t last_press;	// swtimer_ticks() at the latest accepted press
+static uint8_t alarm_ok;	// Alarm 1 programmed and its flag cleared
+static int clock_task;
+static int button_task;
+static int brightness_task;
 
 /***********************************************************************************\
  *                                                                                 *
@@ -62,9 +93,16 @@ void main(void)
 	LCD_Clear();
 	i2c1_init();
 
-	systick_init(16000);
+	swtimer_init();  // LPTIM2 time base for delay(); needs the LSE started above
+
+	/* The handlers only post events : the I2C and display work runs in tasks */
+	sched_init(SYSCLK_HZ, swtimer_ticks, SWTIMER_TICK_HZ);
+	clock_task = sched_add("clock", SCHED_PRIO_HIGHEST, clock_task_run);
+	button_task = sched_add("button", SCHED_PRIO_HIGHEST + 1, button_task_run);
+	brightness_task = sched_add("brightness", SCHED_PRIO_HIGHEST + 2, brightness_task_run);
+
 	adc1_init();
-	systick_deinit();
+	adc1_on_level_change(brightness_changed);
 
 	dma_i2c_rx_init();
 	dma_i2c_tx_init();
@@ -89,15 +127,16 @@ void main(void)
 		
 	//RTC_set_date(&d, &rtc);
 	
-	RTC_clear_interrupt_flag(&rtc, ALARM1);
+	/* Single DS3231 read; the display is refreshed from LPTIM1 from now on.
+	   If it fails, the service timer retries it. Started before EXTI2 is
+	   unmasked so the first alarm edge finds the software clock running */
+	SWRTC_init(&rtc);
+	SWRTC_now(&d, NULL);
 	
 	exti_pin_init();
 	
-	RTC_enable_interrupts(&rtc, &alrm);	
-
-	RTC_read_date(&d, &rtc);	
-	
-	LCD_Clear();
+	/* Retried by the clock task's service event if the bus is down */
+	alarm_ok = alarm_arm();
 	
 	if (d.minute < 10) {
 		if (d.hour < 10) 
@@ -117,9 +156,155 @@ void main(void)
 	
 	DISPLAY_write_time(sev_seg_arr, 10);	
 	
+	swtimer_start(&service_timer, SERVICE_PERIOD_MS, SERVICE_PERIOD_MS, service_tick, NULL);
+	sched_post(brightness_task, EVT_BRIGHTNESS);  // Write the initial level
+
 	ADC1->CR |= ADC_CR_ADSTART;	
-	while(1);
+	sched_run();
+}
+
+/**
+  * @brief Clock task : handles the DS3231 alarm edge (once a minute) and
+  *	   refreshes the LCD and the 7-segment display; resyncs the software
+  *	   clock when the service timer finds it due.
+  * @param events : EVT_ALARM, EVT_SERVICE.
+  * @retval None
+  */
+static void clock_task_run(uint32_t events)
+{
+	char buff[6];
+
+	if (events & EVT_ALARM) {
+		/* INT stays low, and no edge comes, until A1F is cleared */
+		if (RTC_clear_interrupt_flag(&rtc, ALARM1) != I2C_OK)
+			alarm_ok = 0;
+
+		/* Alarm fires on the minute : re-anchor without reading the date */
+		SWRTC_rtc_edge(&rtc);
+		SWRTC_now(&d, NULL);
+
+		if (d.minute < 10) {
+			if (d.hour < 10) 
+				sprintf(buff, "0%d:0%d", d.hour, d.minute);	
+			else
+				sprintf(buff, "%d:0%d", d.hour, d.minute);
+		} else {
+			if (d.hour < 10) 
+				sprintf(buff, "0%d:%d", d.hour, d.minute);
+			else
+				sprintf(buff, "%d:%d", d.hour, d.minute);
+		}
+
+		LCD_DisplayString((uint8_t *) buff);
+
+		time_to_7seg(d.hour, d.minute, sev_seg_arr);
+		DISPLAY_write_time(sev_seg_arr, 10);
+	}
+
+	if (events & EVT_SERVICE) {
+		if (!alarm_ok)
+			alarm_ok = alarm_arm();
+		SWRTC_service(&rtc);
+	}
+}
+
+/**
+  * @brief Clears the alarm 1 flag and programs the once-a-minute alarm.
+  * @param None
+  * @retval 1 on success, 0 if an I2C transfer failed
+  */
+static uint8_t alarm_arm(void)
+{
+	if (RTC_clear_interrupt_flag(&rtc, ALARM1) != I2C_OK)
+		return 0;
+
+	return RTC_enable_interrupts(&rtc, &alrm) == I2C_OK;
+}
+
+/**
+  * @brief Button task : shows the next of time, day, date and year.
+  * @param events : EVT_BUTTON.
+  * @retval None
+  */
+static void button_task_run(uint32_t events)
+{
+	char buff[6];
+	uint32_t now = swtimer_ticks();
+
+	/* Edges less than BUTTON_DEBOUNCE_MS after a press are contact bounce */
+	if (now - last_press < swtimer_ms_to_ticks(BUTTON_DEBOUNCE_MS))
+		return;
+	last_press = now;
+
+	btn_presses = (btn_presses + 1) % 4;
+	SWRTC_now(&d, NULL);
+		
+	switch (btn_presses) {
+	case 0:
+		if (d.minute < 10) {
+			if (d.hour < 10)
+				sprintf(buff, "0%d:0%d", d.hour, d.minute);
+			else
+				sprintf(buff, "%d:0%d", d.hour, d.minute);
+		} else {
+			if (d.hour < 10)
+				sprintf(buff, "0%d:%d", d.hour, d.minute);
+			else
+				sprintf(buff, "%d:%d", d.hour, d.minute);
+		}
+		break;
+	case 1:	
+		if (d.day >= 1 && d.day <= 7)
+			sprintf(buff, "%s", *(days + (d.day - 1)));
+		else
+			sprintf(buff, "ERROR");
+		break;
+	case 2:
+		if (d.month >= 1 && d.month <= 12)
+			sprintf(buff, "%s %d", *(months + (d.month - 1)), d.date);	
+		else
+			sprintf(buff, "ERROR");
+		break;
+	case 3:
+		sprintf(buff, "%d", d.year);
+		break;
+	default:
+		sprintf(buff, "ERROR");
+		break;
+	}
 	
+        LCD_DisplayString((uint8_t *) buff);
+}
+
+/**
+  * @brief Brightness task : writes a new brightness level to the HT16K33.
+  * @param events : EVT_BRIGHTNESS.
+  * @retval None
+  */
+static void brightness_task_run(uint32_t events)
+{
+	adc1_brightness_service();
+}
+
+/**
+  * @brief Service timer callback (LPTIM2 interrupt) : wakes the clock task.
+  * @param arg : Unused.
+  * @retval None
+  */
+static void service_tick(void *arg)
+{
+	sched_post(clock_task, EVT_SERVICE);
+}
+
+/**
+  * @brief Brightness level callback (DMA1 channel 1 interrupt) : wakes the
+  *	   brightness task.
+  * @param None
+  * @retval None
+  */
+static void brightness_changed(void)
+{
+	sched_post(brightness_task, EVT_BRIGHTNESS);
 }
 
 static void tip120_ctl_pin_init(void)
@@ -231,85 +416,28 @@ static void exti_pin_init(void)
 }
 
 /**
-  * @brief Handle interrupts generated by the button
+  * @brief Handle interrupts generated by the button : the display work
+  *	   is left to the button task.
   * @param None
   * @retval None
   */
 void EXTI0_IRQHandler(void)
 {
-	char buff[6];
-
         EXTI->PR1 |= EXTI_PR1_PIF0;
-	
-        // Wait for the button to be released   
-        while (GPIOA->IDR & GPIO_IDR_IDR_0);
 
-	btn_presses = (btn_presses + 1) % 4;
-		
-	LCD_Clear();
-	
-	switch (btn_presses) {
-	case 0:
-		if (d.minute < 10) {
-			if (d.hour < 10)
-				sprintf(buff, "0%d:0%d", d.hour, d.minute);
-			else
-				sprintf(buff, "%d:0%d", d.hour, d.minute);
-		} else {
-			if (d.hour < 10)
-				sprintf(buff, "0%d:%d", d.hour, d.minute);
-			else
-				sprintf(buff, "%d:%d", d.hour, d.minute);
-		}
-		break;
-	case 1:	
-		sprintf(buff, "%s", *(days + (d.day - 1)));
-		break;
-	case 2:
-		sprintf(buff, "%s %d", *(months + (d.month - 1)), d.date);	
-		break;
-	case 3:
-		sprintf(buff, "%d", d.year);
-		break;
-	default:
-		sprintf(buff, "ERROR");
-		break;
-	}
-	
-        LCD_DisplayString((uint8_t *) buff);
+	sched_post(button_task, EVT_BUTTON);
 }
 
 /**
-  * @brief Handle interrupts generated by the TCS34725 
-  *        RGB sensor.
+  * @brief Handle the DS3231 alarm : latches the edge for the software
+  *	   clock and leaves the I2C work to the clock task.
   * @param None
   * @retval None
   */
 void EXTI2_IRQHandler(void)
 {
-	char buff[6];
-
         EXTI->PR1 |= EXTI_PR1_PIF2;
-	RTC_clear_interrupt_flag(&rtc, ALARM1);
 
-	RTC_read_date(&d, &rtc);	
-	
-	LCD_Clear();
-
-	if (d.minute < 10) {
-		if (d.hour < 10) 
-			sprintf(buff, "0%d:0%d", d.hour, d.minute);	
-		else
-			sprintf(buff, "%d:0%d", d.hour, d.minute);
-	} else {
-		if (d.hour < 10) 
-			sprintf(buff, "0%d:%d", d.hour, d.minute);
-		else
-			sprintf(buff, "%d:%d", d.hour, d.minute);
-	}
-
-	LCD_DisplayString((uint8_t *) buff);
-
-	time_to_7seg(d.hour, d.minute, sev_seg_arr);
-	DISPLAY_write_time(sev_seg_arr, 10);
+	SWRTC_mark_edge();
+	sched_post(clock_task, EVT_ALARM);
 }
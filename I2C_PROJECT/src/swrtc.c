@@ -0,0 +1,354 @@
+/**********************************************************************************\
+ * @file    I2C_PROJECT/src/swrtc.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    04-July-2017                                                          *
+ * @brief   Software RTC : extrapolates DS3231 time with LPTIM1.                  *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+
+#include "../include/swrtc.h"
+#include <stddef.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE FUNCTIONS                                 *
+ *                                                                                *
+\**********************************************************************************/
+static void swrtc_lptim1_init(void);
+static uint32_t swrtc_read_cnt(void);
+static uint32_t swrtc_ticks(void);
+static uint32_t swrtc_corrected(uint32_t elapsed);
+static uint8_t swrtc_anchor(DS3231_TypeDef *rtc, uint32_t ticks, uint8_t exact);
+static uint8_t swrtc_date_valid(const Date_TypeDef *d);
+static uint8_t swrtc_days_in_month(uint8_t month, uint16_t year);
+static void swrtc_add_seconds(Date_TypeDef *d, uint32_t secs);
+static void swrtc_next_day(Date_TypeDef *d);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE VARS                                      *
+ *                                                                                *
+\**********************************************************************************/
+static const uint8_t days_in_month[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static volatile uint32_t periods;	// LPTIM1 auto-reload matches (whole seconds)
+static volatile uint32_t last_sync_period;
+static volatile uint8_t resync_due;
+static volatile uint32_t edge_ticks;	// Counter latched by SWRTC_mark_edge
+static volatile uint8_t edge_marked;
+
+/* The software clock is anchor_date + corrected(ticks - anchor_ticks) */
+static Date_TypeDef anchor_date = {0, 0, 0, DS3231_DAYR_SAT, 1, DS3231_MONTHR_JAN, 2000};
+static uint8_t anchored;	// anchor_date came from the DS3231
+static uint32_t anchor_ticks;
+static uint8_t anchor_exact;	// anchor_ticks sits exactly on a DS3231 second boundary
+static int32_t trim_q32;
+
+static SWRTC_StatsTypeDef swrtc_stats;
+
+int SWRTC_init(DS3231_TypeDef *rtc)
+{
+	swrtc_lptim1_init();
+
+	/* Left due until a read succeeds, so SWRTC_service keeps trying */
+	resync_due = 1;
+	return swrtc_anchor(rtc, swrtc_ticks(), 0) ? 0 : -1;
+}
+
+void SWRTC_now(Date_TypeDef *d, uint16_t *ms)
+{
+	uint32_t primask, ticks, elapsed;
+
+	/* Snapshot the anchor and the counter together */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	*d = anchor_date;
+	ticks = swrtc_ticks();
+	elapsed = swrtc_corrected(ticks - anchor_ticks);
+	__set_PRIMASK(primask);
+
+	swrtc_add_seconds(d, elapsed >> SWRTC_TICKS_SHIFT);
+
+	if (ms != NULL)
+		*ms = (uint16_t) (((elapsed & (SWRTC_TICKS_PER_SEC - 1)) * 1000U) >> SWRTC_TICKS_SHIFT);
+}
+
+void SWRTC_sync(DS3231_TypeDef *rtc)
+{
+	swrtc_anchor(rtc, swrtc_ticks(), 0);
+}
+
+void SWRTC_mark_edge(void)
+{
+	edge_ticks = swrtc_ticks();
+	edge_marked = 1;
+}
+
+void SWRTC_rtc_edge(DS3231_TypeDef *rtc)
+{
+	const uint32_t minute_ticks = 60U << SWRTC_TICKS_SHIFT;
+	uint32_t primask, ticks, raw, est, pos, actual;
+	int32_t err, trim_new;
+
+	/* The edge, not the time the task got to it, is on the minute */
+	primask = __get_PRIMASK();
+	__disable_irq();
+	ticks = edge_marked ? edge_ticks : swrtc_ticks();
+	edge_marked = 0;
+	__set_PRIMASK(primask);
+
+	/* The DS3231 just rolled over a second, so this read is phase exact */
+	if (resync_due && swrtc_anchor(rtc, ticks, 1))
+		return;
+
+	/* Nothing to measure the minute against yet */
+	if (!anchored)
+		return;
+
+	raw = ticks - anchor_ticks;
+	est = swrtc_corrected(raw);
+
+	/* The alarm fires at hh:mm:00, so round the estimate to the nearest minute */
+	pos = ((uint32_t) anchor_date.second << SWRTC_TICKS_SHIFT) + est;
+	pos %= minute_ticks;
+	if (pos < minute_ticks / 2)
+		err = -(int32_t) pos;
+	else
+		err = (int32_t) (minute_ticks - pos);
+	actual = est + err;
+
+	/* Measured rate error over the last anchor interval, smoothed by 1/4 */
+	if (anchor_exact && raw >= minute_ticks / 2) {
+		trim_new = (int32_t) ((int64_t) (int32_t) (actual - raw) * ((int64_t) 1 << 32) / raw);
+		trim_q32 += (trim_new - trim_q32) / 4;
+	}
+
+	swrtc_add_seconds(&anchor_date, actual >> SWRTC_TICKS_SHIFT);
+	anchor_date.second = 0;
+	anchor_ticks = ticks;
+	anchor_exact = 1;
+
+	swrtc_stats.edge_syncs++;
+	swrtc_stats.last_error_ticks = err;
+	swrtc_stats.trim_q32 = trim_q32;
+}
+
+void SWRTC_service(DS3231_TypeDef *rtc)
+{
+	if (resync_due)
+		SWRTC_sync(rtc);
+}
+
+void SWRTC_get_stats(SWRTC_StatsTypeDef *stats)
+{
+	*stats = swrtc_stats;
+}
+
+/**
+  * @brief Counts whole seconds and flags a DS3231 resync when one is due.
+  * @param None
+  * @retval None
+  */
+void LPTIM1_IRQHandler(void)
+{
+	if (LPTIM1->ISR & LPTIM_ISR_ARRM) {
+		LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+		periods++;
+		if ((periods - last_sync_period) >= SWRTC_RESYNC_PERIOD_S)
+			resync_due = 1;
+	}
+}
+
+/**
+  * @brief Runs LPTIM1 from LSE with a 1 s auto-reload period.
+  * @param None
+  * @retval None
+  */
+static void swrtc_lptim1_init(void)
+{
+	RCC->APB1ENR1 |= RCC_APB1ENR1_LPTIM1EN;
+
+	RCC->CCIPR &= ~RCC_CCIPR_LPTIM1SEL;
+	RCC->CCIPR |= LPTIM1_CLKSRC_LSE;
+
+	// CFGR and IER may only be written while the timer is disabled
+	LPTIM1->CR &= ~LPTIM_CR_ENABLE;
+	LPTIM1->CFGR = 0;	// Internal clock, prescaler /1, software start
+	LPTIM1->IER = LPTIM_IER_ARRMIE;
+	LPTIM1->CR |= LPTIM_CR_ENABLE;
+
+	// ARR may only be written while the timer is enabled
+	LPTIM1->ARR = SWRTC_TICKS_PER_SEC - 1;
+	while (!(LPTIM1->ISR & LPTIM_ISR_ARROK));
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+
+	NVIC_SetPriority(LPTIM1_IRQn, 0);
+	NVIC_EnableIRQ(LPTIM1_IRQn);
+
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+}
+
+/**
+  * @brief CNT is clocked asynchronously, so read until two reads agree.
+  * @param None
+  * @retval LPTIM1 counter value
+  */
+static uint32_t swrtc_read_cnt(void)
+{
+	uint32_t a, b;
+
+	do {
+		a = LPTIM1->CNT;
+		b = LPTIM1->CNT;
+	} while (a != b);
+
+	return a;
+}
+
+/**
+  * @brief Returns a free-running 32768 Hz tick count (wraps every 36 h).
+  * @param None
+  * @retval Tick count
+  */
+static uint32_t swrtc_ticks(void)
+{
+	uint32_t p, c;
+
+	do {
+		p = periods;
+		c = swrtc_read_cnt();
+	} while (p != periods);
+
+	// Counter wrapped but the match has not been serviced yet (IRQs masked)
+	if ((LPTIM1->ISR & LPTIM_ISR_ARRM) && c < (SWRTC_TICKS_PER_SEC / 2))
+		p++;
+
+	return (p << SWRTC_TICKS_SHIFT) + c;
+}
+
+/**
+  * @brief Applies the measured LSE rate error to an elapsed tick count.
+  * @param elapsed : Raw ticks since the anchor.
+  * @retval Corrected ticks
+  */
+static uint32_t swrtc_corrected(uint32_t elapsed)
+{
+	return elapsed + (int32_t) (((int64_t) elapsed * trim_q32) >> 32);
+}
+
+/**
+  * @brief Reads the DS3231 and makes it the new anchor. A failed read, or
+  *	   one that does not decode to a valid date, keeps the old anchor and
+  *	   leaves the resync due.
+  * @param rtc : Shadow copy of the DS3231 registers.
+  * @param ticks : Tick count at which the DS3231 time is latched.
+  * @param exact : Non-zero if ticks is on a DS3231 second boundary.
+  * @retval 1 if re-anchored, 0 otherwise
+  */
+static uint8_t swrtc_anchor(DS3231_TypeDef *rtc, uint32_t ticks, uint8_t exact)
+{
+	Date_TypeDef d;
+	uint32_t primask;
+
+	if (RTC_read_date(&d, rtc) != I2C_OK || !swrtc_date_valid(&d)) {
+		swrtc_stats.i2c_errors++;
+		return 0;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	anchor_date = d;
+	anchor_ticks = ticks;
+	anchor_exact = exact;
+	anchored = 1;
+	last_sync_period = periods;
+	resync_due = 0;
+	__set_PRIMASK(primask);
+
+	swrtc_stats.i2c_syncs++;
+	return 1;
+}
+
+/**
+  * @brief Checks every field of a date read from the DS3231 is in range.
+  * @param d : Date to check.
+  * @retval 1 if valid, 0 otherwise
+  */
+static uint8_t swrtc_date_valid(const Date_TypeDef *d)
+{
+	if (d->second > 59 || d->minute > 59 || d->hour > 23)
+		return 0;
+	if (d->day < 1 || d->day > 7 || d->month < 1 || d->month > 12)
+		return 0;
+
+	return d->date >= 1 && d->date <= swrtc_days_in_month(d->month, d->year);
+}
+
+/**
+  * @brief Length of a month.
+  * @param month : 1 - 12.
+  * @param year : Gregorian year.
+  * @retval Days
+  */
+static uint8_t swrtc_days_in_month(uint8_t month, uint16_t year)
+{
+	if (month == 2 && (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0))
+		return 29;
+
+	return days_in_month[month - 1];
+}
+
+/**
+  * @brief Advances a date by a number of seconds.
+  * @param d : Date to advance.
+  * @param secs : Seconds to add.
+  * @retval None
+  */
+static void swrtc_add_seconds(Date_TypeDef *d, uint32_t secs)
+{
+	uint32_t days;
+
+	secs += d->second + 60U * (d->minute + 60U * (uint32_t) d->hour);
+	days = secs / 86400U;
+	secs -= days * 86400U;
+
+	d->hour = secs / 3600U;
+	secs -= d->hour * 3600U;
+	d->minute = secs / 60U;
+	d->second = secs - d->minute * 60U;
+
+	while (days-- > 0)
+		swrtc_next_day(d);
+}
+
+/**
+  * @brief Advances a date to the next calendar day.
+  * @param d : Date to advance.
+  * @retval None
+  */
+static void swrtc_next_day(Date_TypeDef *d)
+{
+	uint8_t last = swrtc_days_in_month(d->month, d->year);
+
+	d->day = (d->day % 7) + 1;
+
+	if (d->date < last) {
+		d->date++;
+		return;
+	}
+
+	d->date = 1;
+	if (d->month < 12) {
+		d->month++;
+		return;
+	}
+
+	d->month = 1;
+	d->year++;
+}
@@ -0,0 +1,94 @@
+/**********************************************************************************\
+ * @file    LCD/include/lcd_core.h                                                *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    29-June-2017                                                          *
+ * @brief   STM32L476G-Discovery segment LCD : display functions shared by every  *
+ *          project. LCD_Initialization and the pin / clock setup stay in each    *
+ *          project's lcd.c.                                                      *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef LCD_CORE_H
+#define LCD_CORE_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                          LCD CORE FUNCTION PROTOTYPES                          *
+ *                                                                                *
+ * Everything is composed in a shadow of LCD->RAM and sent by LCD_Commit, one     *
+ * display update per frame; a frame that matches the last one is not sent.      *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Blanks the frame and commits it.
+  * @param None
+  * @retval None
+  */
+void LCD_Clear(void);
+
+/**
+  * @brief Copies the frame to LCD->RAM and requests a display update.
+  *        Nothing is written when the frame matches the last commit.
+  * @param None
+  * @retval None
+  */
+void LCD_Commit(void);
+
+/**
+  * @brief Displays a string of 6 characters or less ('.' and ':' after one of
+  *        the first four do not take a position). Unused positions are blanked.
+  * @param ptr : The string to display.
+  * @retval None
+  */
+void LCD_DisplayString(uint8_t* ptr);
+
+/**
+  * @brief Writes one character and commits the frame.
+  * @param ch : The character to display.
+  * @param point : Non-zero to add a point after the character.
+  * @param colon : Non-zero to add a colon after the character.
+  * @param position : Position on the display (0 - 5).
+  * @retval None
+  */
+void LCD_WriteChar(uint8_t* ch, char point, char colon, uint8_t position);
+
+/**
+  * @brief Starts scrolling a string of any length across the display.
+  *        Returns at once : the text advances one position per call to
+  *        LCD_ScrollTick(). The string must stay valid until scrolling ends.
+  * @param ptr : The string to scroll.
+  * @retval None
+  */
+void LCD_DisplayScrollingString(uint8_t* ptr);
+
+/**
+  * @brief Advances the scrolling text by one position. Call from a periodic
+  *        timer : the tick period sets the scroll speed.
+  * @param None
+  * @retval 1 while scrolling is in progress, 0 once it has finished
+  */
+uint8_t LCD_ScrollTick(void);
+
+/**
+  * @brief Displays "GAGNON" in a single display update.
+  * @param None
+  * @retval None
+  */
+void LCD_Display_Name(void);
+
+/**
+  * @brief Draws the bar segments set in t_bar.
+  * @param None
+  * @retval None
+  */
+void LCD_bar(void);
+
+#endif
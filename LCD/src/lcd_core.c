@@ -0,0 +1,414 @@
+/**********************************************************************************\
+ * @file    LCD/src/lcd_core.c                                                    *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    29-June-2017                                                          *
+ * @brief   STM32L476G-Discovery segment LCD : frame shadow, commit, glyphs and   *
+ *          string display. Shared by every project with the LCD; each one keeps  *
+ *          its own pin and clock setup in its lcd.c.                             *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#include "../include/lcd_core.h"
+#include <stm32l476xx.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+
+/*-----------------Data structures-----------------*/
+
+
+
+
+/* Frame is composed here and copied to LCD->RAM by LCD_Commit() */
+static uint32_t lcd_shadow[16];
+
+/* What LCD->RAM held after the last commit */
+static uint32_t lcd_committed[16];
+
+
+
+/* Scroller state (see LCD_ScrollTick) */
+#define LCD_SCROLL_BLANK_TICKS  3
+
+static uint8_t * volatile scroll_str = NULL;
+static uint16_t scroll_pos;
+static uint8_t scroll_blank;
+
+/*----------------------Macros----------------------*/
+
+
+
+uint8_t t_bar[2] = {0x00,0x00};
+
+#define BAR0_ON  t_bar[1] |= 8
+#define BAR0_OFF t_bar[1] &= ~8
+#define BAR1_ON  t_bar[0] |= 8
+#define BAR1_OFF t_bar[0] &= ~8
+#define BAR2_ON  t_bar[1] |= 2
+#define BAR2_OFF t_bar[1] &= ~2
+#define BAR3_ON  t_bar[0] |= 2 
+#define BAR3_OFF t_bar[0] &= ~2 
+
+#define DOT                   ((uint16_t) 0x8000 ) /* for add decimal point in string */
+#define DOUBLE_DOT            ((uint16_t) 0x4000) /* for add decimal point in string */
+
+/* code for '(' character */
+#define C_OPENPARMAP          ((uint16_t) 0x0028)
+
+/* code for ')' character */
+#define C_CLOSEPARMAP         ((uint16_t) 0x0011)
+
+/* code for 'd' character */
+#define C_DMAP                ((uint16_t) 0xf300)
+
+/* code for 'm' character */
+#define C_MMAP                ((uint16_t) 0xb210)
+
+/* code for 'n' character */
+#define C_NMAP                ((uint16_t) 0x2210)
+
+/* code for the micro sign (0xB5) */
+#define C_UMAP                ((uint16_t) 0x6084)
+
+/* constant code for '*' character */
+#define C_STAR                ((uint16_t) 0xA0DD)
+
+/* constant code for '-' character */
+#define C_MINUS               ((uint16_t) 0xA000)
+
+/* constant code for '+' character */
+#define C_PLUS                ((uint16_t) 0xA014)
+
+/* constant code for '/' */
+#define C_SLATCH              ((uint16_t) 0x00c0)
+
+/* constant code for the degree sign (0xB0) */
+#define C_PERCENT_1           ((uint16_t) 0xec00)
+
+/* constant code for small o */
+#define C_PERCENT_2           ((uint16_t) 0xb300)
+
+#define C_FULL                ((uint16_t) 0xffdd)
+
+
+
+/*-------------------Functions--------------------*/
+
+
+
+static void LCD_Compose_Char(uint8_t* ch, char point, char colon, uint8_t position);
+
+void LCD_DisplayString(uint8_t *ptr)
+{
+
+	/*
+	 *  Displays a string of 6 characters or less
+	 */
+	
+	int index = 0;
+	uint8_t *addressOfNextChar;
+	uint8_t *addressOfCurrentChar;
+	
+	
+	
+	while (*ptr != '\0') {  // As long as the end of the string hasn't been reached, continue processing chars
+		addressOfNextChar = ptr+1;  // store address of the next character, just in case the next char is a '.' or ':'
+		addressOfCurrentChar = ptr;
+		if (*addressOfCurrentChar == '.' || *addressOfCurrentChar == ':'){
+				ptr++;
+			continue;  /* If the current char is a '.' or a ':', then skip this iteration of the loop
+			            * the '.' or ':' was already included at the end of the previously displayed char
+									*/
+		}
+		if (*addressOfNextChar == '.' && index < 4) {  /* Index < 4 because only the first four positions on the LCD can display
+																									 * '.' and ':'
+																									 */
+			LCD_Compose_Char(addressOfCurrentChar, 1, 0, index);  /* If the next char in the input string is '.'
+																													* then include it as part of the current char
+																													*/
+		} else if (*addressOfNextChar == ':' && index < 4) {
+			LCD_Compose_Char(addressOfCurrentChar, 0, 1, index);	  /* If the next char in the input string is ':'
+																													* then include it as part of the current char
+																													*/
+		} else {
+			LCD_Compose_Char(addressOfCurrentChar, 0, 0, index);  // No '.' or ':' to include
+		}
+		index++;  
+		ptr++;  // Go to address of next char in the string
+	}
+
+	// Blank the positions the string did not reach
+	while (index < 6) {
+		LCD_Compose_Char((uint8_t *) " ", 0, 0, index);
+		index++;
+	}
+
+	// One display update for the whole string
+	LCD_Commit();
+}
+
+
+/**
+  * @brief Starts scrolling a string of any length across the display.
+  *        Returns at once : the text advances one position per call to
+  *        LCD_ScrollTick(). The string must stay valid until scrolling ends.
+  * @param ptr : The string to scroll.
+  * @retval None
+  */
+void LCD_DisplayScrollingString(uint8_t* ptr)
+{
+	scroll_str = NULL;  // Keep LCD_ScrollTick() off the state while it is reset
+	scroll_pos = 0;
+	scroll_blank = LCD_SCROLL_BLANK_TICKS;
+	scroll_str = ptr;
+
+	LCD_ScrollTick();  // Show the first six chars straight away
+}
+
+/**
+  * @brief Advances the scrolling text by one position. Call from a periodic
+  *        timer callback (SysTick, LPTIM, ...) : the tick period sets the
+  *        scroll speed. After the text has left the display, the screen
+  *        is held blank for LCD_SCROLL_BLANK_TICKS ticks.
+  * @param None
+  * @retval 1 while scrolling is in progress, 0 once it has finished
+  */
+uint8_t LCD_ScrollTick(void)
+{
+	uint8_t window[7];  // Six chars + '\0'
+	uint8_t *p = scroll_str;
+	uint8_t k;
+
+	if (p == NULL)
+		return 0;
+
+	if (p[scroll_pos] == '\0') {  // Text has scrolled off the display
+		if (scroll_blank == 0) {
+			scroll_str = NULL;
+			return 0;
+		}
+		scroll_blank--;
+		LCD_DisplayString((uint8_t *) "");
+		return 1;
+	}
+
+	// Next six chars; LCD_DisplayString blanks what is left over
+	for (k = 0; k < 6 && p[scroll_pos + k] != '\0'; k++)
+		window[k] = p[scroll_pos + k];
+	window[k] = '\0';
+
+	LCD_DisplayString(window);
+	scroll_pos++;
+
+	return 1;
+}
+
+
+void LCD_Display_Name(void)
+{
+	
+	/*
+	 *  Displays my last name ("GAGNON") on the LCD screen
+	 */
+		
+	uint8_t counter;
+	
+	// Clear the frame in place : a blank commit first would flash the display
+	for (counter = 0; counter <= 15; counter++)
+		lcd_shadow[counter] = 0;
+	
+	// Update the bits in the frame
+	lcd_shadow[0] |= (0xA182B270);
+	lcd_shadow[1] |= (0x9);
+	lcd_shadow[2] |= (0x77C0F138);
+	lcd_shadow[3] |= (0xE);
+	lcd_shadow[4] |= (0x0);
+	lcd_shadow[5] |= (0x0);
+	lcd_shadow[6] |= (0xC4020000);
+	lcd_shadow[7] |= (0x0);
+	
+	// Send the whole frame with a single update request
+	LCD_Commit();
+	
+}
+
+
+void LCD_Clear(void){
+  uint8_t counter = 0;
+
+  for (counter = 0; counter <= 15; counter++) {
+    lcd_shadow[counter] = 0;
+  }
+
+  /* Update the LCD display */
+	LCD_Commit();
+}
+
+/**
+  * @brief Copies the frame to LCD->RAM and requests a display update.
+  *        Nothing is written when the frame matches the last commit.
+  * @param None
+  * @retval None
+  */
+void LCD_Commit(void){
+  uint8_t counter = 0;
+  static uint8_t committed_valid = 0;
+
+  if (committed_valid) {
+    for (counter = 0; counter <= 15 && lcd_shadow[counter] == lcd_committed[counter]; counter++);
+    if (counter > 15)
+      return;
+  }
+
+  // LCD_RAM is write protected until the previous update has been taken
+	while ((LCD->SR & LCD_SR_UDR) != 0); // Wait for Update Display Request Bit
+
+  for (counter = 0; counter <= 15; counter++) {
+    LCD->RAM[counter] = lcd_shadow[counter];
+    lcd_committed[counter] = lcd_shadow[counter];
+  }
+  committed_valid = 1;
+
+	// Each time software modifies the LCD_RAM, it must set the UDR bit to transfer the updated
+	// data to the second level buffer. The UDR bit stays set until the end of the update and during
+	// this time the LCD_RAM is write protected.
+	LCD->SR |= LCD_SR_UDR; 								// Update display request. Cleared by hardware
+}
+
+
+// Setting bar on LCD, writes bar value in LCD frame buffer 
+void LCD_bar(void) {
+
+	// Bar 0: COM3, LCD_SEG11 -> MCU_LCD_SEG8
+	// Bar 1: COM2, LCD_SEG11 -> MCU_LCD_SEG8
+	// Bar 2: COM3, LCD_SEG9 -> MCU_LCD_SEG25
+	// Bar 3: COM2, LCD_SEG9 -> MCU_LCD_SEG25
+	
+  lcd_shadow[4] &= ~(1U << 8 | 1U << 25);
+  lcd_shadow[6] &= ~(1U << 8 | 1U << 25);
+	
+  /* bar1 bar3 */
+  if (BAR0_ON)
+		lcd_shadow[6] |= 1U << 8;
+  
+  if (BAR1_ON)
+		lcd_shadow[4] |= 1U << 8;
+ 
+	if (BAR2_ON)
+		lcd_shadow[6] |= 1U << 25;
+  
+  if (BAR1_ON)
+		lcd_shadow[4] |= 1U << 25;
+	
+	LCD_Commit();
+}
+
+/**
+  * @brief  Segment pattern for every 8-bit char code. Bits 15 - 12 are
+  *         driven on COM0, 11 - 8 on COM1, 7 - 4 on COM2 and 3 - 0 on COM3.
+  *         Codes not listed stay blank. Lower case letters reuse the upper
+  *         case patterns except for 'd', 'm' and 'n'.
+  */
+static const uint16_t GlyphMap[256] = {
+	[' '] = 0x0000, ['*'] = C_STAR, ['('] = C_OPENPARMAP, [')'] = C_CLOSEPARMAP,
+	['-'] = C_MINUS, ['+'] = C_PLUS, ['/'] = C_SLATCH, ['%'] = C_PERCENT_2,
+	[0xB5] = C_UMAP, [0xB0] = C_PERCENT_1, [255] = C_FULL,
+
+	['0'] = 0x5F00, ['1'] = 0x4200, ['2'] = 0xF500, ['3'] = 0x6700, ['4'] = 0xEa00,
+	['5'] = 0xAF00, ['6'] = 0xBF00, ['7'] = 0x4600, ['8'] = 0xFF00, ['9'] = 0xEF00,
+
+	['A'] = 0xFE00, ['B'] = 0x6714, ['C'] = 0x1d00, ['D'] = 0x4714, ['E'] = 0x9d00,
+	['F'] = 0x9c00, ['G'] = 0x3f00, ['H'] = 0xfa00, ['I'] = 0x0014, ['J'] = 0x5300,
+	['K'] = 0x9841, ['L'] = 0x1900, ['M'] = 0x5a48, ['N'] = 0x5a09, ['O'] = 0x5f00,
+	['P'] = 0xFC00, ['Q'] = 0x5F01, ['R'] = 0xFC01, ['S'] = 0xAF00, ['T'] = 0x0414,
+	['U'] = 0x5b00, ['V'] = 0x18c0, ['W'] = 0x5a81, ['X'] = 0x00c9, ['Y'] = 0x0058,
+	['Z'] = 0x05c0,
+
+	['a'] = 0xFE00, ['b'] = 0x6714, ['c'] = 0x1d00, ['d'] = C_DMAP, ['e'] = 0x9d00,
+	['f'] = 0x9c00, ['g'] = 0x3f00, ['h'] = 0xfa00, ['i'] = 0x0014, ['j'] = 0x5300,
+	['k'] = 0x9841, ['l'] = 0x1900, ['m'] = C_MMAP, ['n'] = C_NMAP, ['o'] = 0x5f00,
+	['p'] = 0xFC00, ['q'] = 0x5F01, ['r'] = 0xFC01, ['s'] = 0xAF00, ['t'] = 0x0414,
+	['u'] = 0x5b00, ['v'] = 0x18c0, ['w'] = 0x5a81, ['x'] = 0x00c9, ['y'] = 0x0058,
+	['z'] = 0x05c0
+};
+
+/* Bit n of the 64-bit pair (LCD->RAM[2*com], LCD->RAM[2*com + 1]) */
+#define LCD_BIT(n)                    ((uint64_t) 1U << (n))
+
+/* RAM bits set by 4-bit pattern v when its bits 0 - 3 land on RAM bits a, b, c, d */
+#define LCD_NIB(a, b, c, d, v)        ((((v) & 0x1) ? LCD_BIT(a) : 0) | (((v) & 0x2) ? LCD_BIT(b) : 0) | \
+                                       (((v) & 0x4) ? LCD_BIT(c) : 0) | (((v) & 0x8) ? LCD_BIT(d) : 0))
+
+#define LCD_NIB_ROW(a, b, c, d)       { LCD_NIB(a, b, c, d, 0),  LCD_NIB(a, b, c, d, 1),  LCD_NIB(a, b, c, d, 2),  LCD_NIB(a, b, c, d, 3),  \
+                                        LCD_NIB(a, b, c, d, 4),  LCD_NIB(a, b, c, d, 5),  LCD_NIB(a, b, c, d, 6),  LCD_NIB(a, b, c, d, 7),  \
+                                        LCD_NIB(a, b, c, d, 8),  LCD_NIB(a, b, c, d, 9),  LCD_NIB(a, b, c, d, 10), LCD_NIB(a, b, c, d, 11), \
+                                        LCD_NIB(a, b, c, d, 12), LCD_NIB(a, b, c, d, 13), LCD_NIB(a, b, c, d, 14), LCD_NIB(a, b, c, d, 15) }
+
+/**
+  * @brief  Per position, the RAM bits driven by each 4-bit slice of a glyph.
+  *         The same SEG lines are used on all four COMs, so one row serves
+  *         every slice. Entry 0xF doubles as the position's clear mask.
+  */
+static const uint64_t SegScatter[6][16] = {
+	LCD_NIB_ROW( 4, 23, 22,  3),  /* Position 1 */
+	LCD_NIB_ROW( 6, 13, 12,  5),  /* Position 2 */
+	LCD_NIB_ROW(15, 29, 28, 14),  /* Position 3 */
+	LCD_NIB_ROW(31, 33, 32, 30),  /* Position 4 */
+	LCD_NIB_ROW(35, 25, 24, 34),  /* Position 5 */
+	LCD_NIB_ROW(17,  8,  9, 26)   /* Position 6 */
+};
+
+/**
+  * @brief Write a character in the LCD frame buffer
+  * @param  ch: the character to display.
+  * @param  Point: a point to add in front of char
+  * @param  Colon: flag indicating if a colon character has to be added in front
+  *         of displayed character.         
+  * @param  Position: position in the LCD of the character to write [1:6]
+	*/
+
+void LCD_WriteChar(uint8_t* ch, char point, char colon, uint8_t position){
+  LCD_Compose_Char(ch, point, colon, position);
+  LCD_Commit();
+}
+
+/**
+  * @brief Write a character in the frame without updating the display
+  * @param  ch: the character to display.
+  * @param  Point: a point to add in front of char
+  * @param  Colon: flag indicating if a colon character has to be added in front
+  *         of displayed character.         
+  * @param  Position: position in the LCD of the character to write [1:6]
+	*/
+static void LCD_Compose_Char(uint8_t* ch, char point, char colon, uint8_t position){
+  uint16_t glyph;
+  uint64_t mask, bits;
+  uint8_t com;
+
+  if (position > 5)
+    return;
+
+  glyph = GlyphMap[*ch];
+
+  /* Set the digital point can be displayed if the point is on */
+  if (point)
+    glyph |= 0x0002;
+
+  /* Set the "COL" segment in the character that can be displayed if the colon is on */
+  if (colon)
+    glyph |= 0x0020;
+
+  mask = SegScatter[position][0xF];
+
+  for (com = 0; com < 4; com++) {
+    bits = SegScatter[position][(glyph >> (12 - 4 * com)) & 0x0F];
+    lcd_shadow[2 * com] = (lcd_shadow[2 * com] & ~(uint32_t) mask) | (uint32_t) bits;
+    lcd_shadow[2 * com + 1] = (lcd_shadow[2 * com + 1] & ~(uint32_t) (mask >> 32)) | (uint32_t) (bits >> 32);
+  }
+}
@@ -17,15 +17,53 @@
 /* TIMINGR Constants */
 #define I2C_CLK_FREQ_DIV_2		((uint32_t) 1U << 28)
 
+/* Error Recovery Constants */
+#define I2C_SYSCLK_FREQ			((uint32_t) 16000000U)	// HSI16 drives SYSCLK
+#define I2C_TIMEOUT_CYCLES		((uint32_t) (I2C_SYSCLK_FREQ / 100U))  // 10 ms per bus phase
+#define I2C_MAX_RETRIES			((uint8_t) 3U)  // attempts after the first failure
+#define I2C_BUS_CLEAR_PULSES		((uint8_t) 9U)  // SCL pulses needed to free a stuck slave
+#define I2C_BUS_CLEAR_HALF_CYCLES	((uint32_t) (I2C_SYSCLK_FREQ / 200000U))  // 5 us (100 kHz SCL)
+
+typedef enum {
+	I2C_OK = 0,		// transfer completed
+	I2C_ERR_NACK = 1,	// slave did not acknowledge its address or data
+	I2C_ERR_ARLO = 2,	// arbitration lost
+	I2C_ERR_BERR = 3,	// misplaced START/STOP detected on the bus
+	I2C_ERR_TIMEOUT = 4	// transfer did not complete in I2C_TIMEOUT_CYCLES
+} I2C_StatusTypeDef;
+
+typedef struct {
+	uint32_t transfers;		// transfers requested by drivers
+	uint32_t retries;		// transfers re-issued after an error
+	uint32_t failures;		// transfers abandoned after I2C_MAX_RETRIES
+	uint32_t nacks;			// NACKF events
+	uint32_t arlos;			// ARLO events
+	uint32_t berrs;			// BERR events
+	uint32_t timeouts;		// waits that exceeded I2C_TIMEOUT_CYCLES
+	uint32_t recoveries;		// bus-clear sequences performed
+	uint32_t last_recovery_cycles;	// duration of the latest recovery (SYSCLK cycles)
+	uint32_t max_recovery_cycles;	// longest recovery observed (SYSCLK cycles)
+} I2C_StatsTypeDef;
+
 // initialize i2c1 peripheral
 void i2c1_init(void);
 
 // configure pins used for i2c1
 static void i2c1_pins_init(void);
 
-void i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr);
+I2C_StatusTypeDef i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr);
 
 // transmit data on the i2c1 bus
-void i2c1_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr);
+I2C_StatusTypeDef i2c1_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr);
+
+// wait (bounded) for the bus to go idle, clearing it if it stays busy
+I2C_StatusTypeDef i2c1_wait_idle(void);
+
+// free a slave that holds SDA low and restart the peripheral
+void i2c1_bus_recover(void);
+
+// copy / zero the error and retry counters
+void i2c1_get_stats(I2C_StatsTypeDef *stats);
+void i2c1_reset_stats(void);
 
 #endif
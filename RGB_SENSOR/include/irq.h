@@ -0,0 +1,53 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stm32l476xx.h>
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              IRQ FUNCTIONS                                      *
+ *                                                                                 *
+ * PRIMASK helpers for the state the main loop shares with interrupt handlers :    *
+ * static inline, so masking costs no call.                                        *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Masks interrupts.
+  * @param None
+  * @retval PRIMASK before the call
+  */
+static inline uint32_t irq_save(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	return primask;
+}
+
+/**
+  * @brief Unmasks interrupts if they were unmasked before irq_save.
+  * @param primask : Value irq_save returned.
+  * @retval None
+  */
+static inline void irq_restore(uint32_t primask)
+{
+	if (!primask)
+		__enable_irq();
+}
+
+/**
+  * @brief Sleeps until an interrupt is pending. Call with interrupts masked,
+  *	   after testing what the handlers set : masked between the test and
+  *	   the WFI, nothing posted in between is slept through; the handler
+  *	   runs once PRIMASK is cleared.
+  * @param None
+  * @retval None
+  */
+static inline void irq_wait(void)
+{
+	__DSB();
+	__WFI();
+}
+
+#endif
@@ -79,7 +79,6 @@ uint8_t *enhance_color(uint8_t *raw_colr_dat)
 	
 	diff = comb_colr_dat[2] - comb_colr_dat[1]; 
 	sprintf(buff, "%d", diff);
-	LCD_Clear();
 	LCD_DisplayString((uint8_t *)buff);
 		
 	// Enhance colors	
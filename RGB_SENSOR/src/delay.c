@@ -16,19 +16,31 @@
 
 /* Includes ----------------------------------------------------------------------*/
 #include "../include/delay.h"
+#include "../include/irq.h"
 
 /* Private volatile variables ----------------------------------------------------*/
 static volatile uint32_t timing_delay;
 
 /**
-  * @brief Delays the system for a number of milliseconds.
+  * @brief Delays the system for a number of milliseconds. The core sleeps
+  *	   between SysTick interrupts instead of spinning. PRIMASK is left
+  *	   as the caller had it.
   * @param time_ms : Number of milliseconds to delay for.
   * @retval None
   */
 void delay(uint32_t time_ms)
 {
+        uint32_t primask;
+
         timing_delay = time_ms;
-        while (timing_delay != 0);
+
+        primask = irq_save();
+        while (timing_delay != 0) {
+                irq_wait();
+                irq_restore(primask);
+                __disable_irq();
+        }
+        irq_restore(primask);
 }
 
 /**
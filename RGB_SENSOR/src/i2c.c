@@ -20,6 +20,17 @@
 volatile uint32_t tc = 1;  // transfer complete
 volatile uint32_t rc = 1;  // read complete
 volatile uint32_t restart_req = 0; // restart request
+static volatile I2C_StatusTypeDef xfer_err = I2C_OK;  // error latched by the I2C1 IRQs
+static volatile I2C_StatsTypeDef i2c1_stats;  // error/retry counters
+
+/* Private function prototypes ---------------------------------------------------*/
+static void i2c1_cycle_counter_init(void);
+static void i2c1_bus_delay(void);
+static I2C_StatusTypeDef i2c1_wait(volatile uint32_t *done);
+static void i2c1_abort(I2C_StatusTypeDef status);
+static I2C_StatusTypeDef i2c1_try_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr);
+static I2C_StatusTypeDef i2c1_try_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr);
+
 /* Function Implementations ------------------------------------------------------*/
 
 /**
@@ -61,13 +72,31 @@ void i2c1_init(void)
 
 	// Enable interrupts
 	I2C1->CR1 |= I2C_CR1_TCIE;  // Unmask xfer cplt. interrupts
+	I2C1->CR1 |= I2C_CR1_NACKIE;  // Unmask NACK interrupts (I2C1_EV)
+	I2C1->CR1 |= I2C_CR1_ERRIE;  // Unmask BERR/ARLO/OVR interrupts (I2C1_ER)
 	NVIC_SetPriority(I2C1_EV_IRQn, 1);  // Register I2C1_EV_IRQn with NVIC
 	NVIC_EnableIRQ(I2C1_EV_IRQn);
+	NVIC_SetPriority(I2C1_ER_IRQn, 1);  // Register I2C1_ER_IRQn with NVIC
+	NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+	// Time base for transfer timeouts
+	i2c1_cycle_counter_init();
 
 	// Enable the I2C1 peripheral
 	I2C1->CR1 |= I2C_CR1_PE;
 }
 
+/**
+  * @brief Starts the DWT cycle counter used to time out bus waits.
+  * @param None
+  * @retval None
+  */
+static void i2c1_cycle_counter_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 /**
   * @brief Configure PB6 and PB7 for I2C1 SCL and SDA, respectively.
   * @param None
@@ -114,14 +143,254 @@ static void i2c1_pins_init(void)
 }
 
 /**
-  * @brief Transmits data to a slave on I2C1 bus.
+  * @brief Transmits data to a slave on I2C1 bus, retrying up to
+  *	   I2C_MAX_RETRIES times after a NACK, bus error, lost
+  *	   arbitration or timeout.
   * @param nbytes : Number of bytes to transmit.
   * @param slvaddr : Address of the slave that will receive the data.
   * @param payload_ptr : Pointer to memory region that contains the
   *	   data to be transmitted on the I2C1 bus.
+  * @retval I2C_OK, or the error that ended the last attempt.
+  */
+I2C_StatusTypeDef i2c1_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr)
+{
+	I2C_StatusTypeDef status;
+	uint8_t attempt;
+
+	i2c1_stats.transfers++;
+
+	for (attempt = 0; attempt <= I2C_MAX_RETRIES; attempt++) {
+		if (attempt > 0)
+			i2c1_stats.retries++;
+
+		status = i2c1_try_transmit(nbytes, slvaddr, payload_ptr);
+		if (status == I2C_OK)
+			return I2C_OK;
+
+		i2c1_abort(status);
+	}
+
+	i2c1_stats.failures++;
+	return status;
+}
+
+/**
+  * @brief Reads data from a slave on the I2C1 bus, retrying up to
+  *	   I2C_MAX_RETRIES times after a NACK, bus error, lost
+  *	   arbitration or timeout.
+  * @param nbytes : Number of bytes to read from the slave.
+  * @param slvaddr : Address of the slave to read from.
+  * @param reg : Slave register to read from.
+  * @param storage_ptr : Pointer to memory region where the 
+  *	   received data will be stored (in the master).
+  * @retval I2C_OK, or the error that ended the last attempt.
+  */
+I2C_StatusTypeDef i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr)
+{
+	I2C_StatusTypeDef status;
+	uint8_t attempt;
+
+	i2c1_stats.transfers++;
+
+	for (attempt = 0; attempt <= I2C_MAX_RETRIES; attempt++) {
+		if (attempt > 0)
+			i2c1_stats.retries++;
+
+		status = i2c1_try_read(nbytes, slvaddr, reg, storage_ptr);
+		if (status == I2C_OK)
+			return I2C_OK;
+
+		i2c1_abort(status);
+	}
+
+	i2c1_stats.failures++;
+	return status;
+}
+
+/**
+  * @brief Waits until the bus is idle. A bus that stays busy for
+  *	   I2C_TIMEOUT_CYCLES is assumed stuck and is cleared.
+  * @param None
+  * @retval I2C_OK if the bus went idle on its own, I2C_ERR_TIMEOUT otherwise.
+  */
+I2C_StatusTypeDef i2c1_wait_idle(void)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while (I2C1->ISR & I2C_ISR_BUSY) {
+		if ((DWT->CYCCNT - start) > I2C_TIMEOUT_CYCLES) {
+			i2c1_stats.timeouts++;
+			i2c1_bus_recover();
+			return I2C_ERR_TIMEOUT;
+		}
+	}
+
+	return I2C_OK;
+}
+
+/**
+  * @brief Frees a slave that is holding SDA low (e.g. after a reset in
+  *	   the middle of a read) and restarts the I2C1 state machine :
+  *
+  *	   (*) PB6/PB7 are taken from I2C1 and driven as open-drain GPIO.
+  *
+  *	   (*) SCL is pulsed until SDA is released (at most 9 pulses, which
+  *	       is enough to clock out any byte the slave is sending).
+  *
+  *	   (*) A STOP condition is generated and the pins are handed back.
+  *
+  * @param None
   * @retval None
   */
-void i2c1_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr)
+void i2c1_bus_recover(void)
+{
+	uint32_t start = DWT->CYCCNT;
+	uint32_t elapsed;
+	uint8_t i;
+
+	// Stop the peripheral and any transfer in flight
+	DMA1_Channel6->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+	I2C1->CR1 &= ~I2C_CR1_PE;
+	while (I2C1->CR1 & I2C_CR1_PE);
+
+	// Release both lines, then switch PB6 and PB7 to GPIO outputs (still open-drain)
+	GPIOB->ODR |= GPIO_ODR_ODR_6 | GPIO_ODR_ODR_7;
+	GPIOB->MODER &= ~(GPIO_MODER_MODER6 | GPIO_MODER_MODER7);
+	GPIOB->MODER |= GPIO_MODER_MODER6_0 | GPIO_MODER_MODER7_0;
+	i2c1_bus_delay();
+
+	// Clock SCL until the slave lets go of SDA
+	for (i = 0; i < I2C_BUS_CLEAR_PULSES && !(GPIOB->IDR & GPIO_IDR_IDR_7); i++) {
+		GPIOB->ODR &= ~GPIO_ODR_ODR_6;
+		i2c1_bus_delay();
+		GPIOB->ODR |= GPIO_ODR_ODR_6;
+		i2c1_bus_delay();
+	}
+
+	// STOP condition : SDA rises while SCL is high
+	GPIOB->ODR &= ~GPIO_ODR_ODR_6;
+	i2c1_bus_delay();
+	GPIOB->ODR &= ~GPIO_ODR_ODR_7;
+	i2c1_bus_delay();
+	GPIOB->ODR |= GPIO_ODR_ODR_6;
+	i2c1_bus_delay();
+	GPIOB->ODR |= GPIO_ODR_ODR_7;
+	i2c1_bus_delay();
+
+	// Give the pins back to I2C1 and restart it with clean flags
+	i2c1_pins_init();
+	I2C1->ICR = I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF | I2C_ICR_ARLOCF | I2C_ICR_OVRCF;
+	I2C1->CR1 |= I2C_CR1_PE;
+
+	restart_req = 0;
+	tc = 1;
+	rc = 1;
+	xfer_err = I2C_OK;
+
+	elapsed = DWT->CYCCNT - start;
+	i2c1_stats.recoveries++;
+	i2c1_stats.last_recovery_cycles = elapsed;
+	if (elapsed > i2c1_stats.max_recovery_cycles)
+		i2c1_stats.max_recovery_cycles = elapsed;
+}
+
+/**
+  * @brief Copies the I2C1 error/retry counters.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void i2c1_get_stats(I2C_StatsTypeDef *stats)
+{
+	*stats = *((I2C_StatsTypeDef *) &i2c1_stats);
+}
+
+/**
+  * @brief Zeros the I2C1 error/retry counters.
+  * @param None
+  * @retval None
+  */
+void i2c1_reset_stats(void)
+{
+	i2c1_stats.transfers = 0;
+	i2c1_stats.retries = 0;
+	i2c1_stats.failures = 0;
+	i2c1_stats.nacks = 0;
+	i2c1_stats.arlos = 0;
+	i2c1_stats.berrs = 0;
+	i2c1_stats.timeouts = 0;
+	i2c1_stats.recoveries = 0;
+	i2c1_stats.last_recovery_cycles = 0;
+	i2c1_stats.max_recovery_cycles = 0;
+}
+
+/**
+  * @brief Holds a bus line for half of a 100 kHz SCL period.
+  * @param None
+  * @retval None
+  */
+static void i2c1_bus_delay(void)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while ((DWT->CYCCNT - start) < I2C_BUS_CLEAR_HALF_CYCLES);
+}
+
+/**
+  * @brief Waits for an IRQ to set a completion flag.
+  * @param done : Completion flag (tc or rc).
+  * @retval I2C_OK, the error latched by the IRQs, or I2C_ERR_TIMEOUT.
+  */
+static I2C_StatusTypeDef i2c1_wait(volatile uint32_t *done)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while (*done == 0) {
+		if (xfer_err != I2C_OK)
+			return xfer_err;
+
+		if ((DWT->CYCCNT - start) > I2C_TIMEOUT_CYCLES) {
+			i2c1_stats.timeouts++;
+			return I2C_ERR_TIMEOUT;
+		}
+	}
+
+	return I2C_OK;
+}
+
+/**
+  * @brief Cleans up after a failed transfer so it can be re-issued.
+  *	   A NACK leaves the bus in a known state (the peripheral sends
+  *	   STOP on its own); anything else gets the bus-clear sequence.
+  * @param status : Error that ended the transfer.
+  * @retval None
+  */
+static void i2c1_abort(I2C_StatusTypeDef status)
+{
+	DMA1_Channel6->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+
+	if (status == I2C_ERR_NACK) {
+		restart_req = 0;
+		tc = 1;
+		rc = 1;
+		xfer_err = I2C_OK;
+		if (i2c1_wait_idle() == I2C_OK)
+			I2C1->ICR = I2C_ICR_STOPCF;
+	} else {
+		i2c1_bus_recover();
+	}
+}
+
+/**
+  * @brief Transmits data to a slave on I2C1 bus (single attempt).
+  * @param nbytes : Number of bytes to transmit.
+  * @param slvaddr : Address of the slave that will receive the data.
+  * @param payload_ptr : Pointer to memory region that contains the
+  *	   data to be transmitted on the I2C1 bus.
+  * @retval Transfer status.
+  */
+static I2C_StatusTypeDef i2c1_try_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr)
 {
 	// Configure I2C1 for writing
 	I2C1->CR2 &= ~I2C_CR2_RD_WRN;
@@ -145,22 +414,25 @@ void i2c1_transmit(size_t nbytes, uint8_t slvaddr, uint8_t *payload_ptr)
 	// Enable DMA1_Channel6
 	DMA1_Channel6->CCR |= DMA_CCR_EN;
 	
+	xfer_err = I2C_OK;
 	tc = 0;
 	I2C1->CR2 |= I2C_CR2_START;  // send start bit
-	while (tc == 0);
+	return i2c1_wait(&tc);
 }
 
 /**
-  * @brief Reads data from a slave on the I2C1 bus.
+  * @brief Reads data from a slave on the I2C1 bus (single attempt).
   * @param nbytes : Number of bytes to read from the slave.
   * @param slvaddr : Address of the slave to read from.
   * @param reg : Slave register to read from.
   * @param storage_ptr : Pointer to memory region where the 
   *	   received data will be stored (in the master).
-  * @retval None
+  * @retval Transfer status.
   */
-void i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr)
+static I2C_StatusTypeDef i2c1_try_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr)
 {
+	I2C_StatusTypeDef status;
+
 	// Set number of bytes to transmit	
 	I2C1->CR2 &= ~I2C_CR2_NBYTES;	
 	I2C1->CR2 |= 1 << 16;
@@ -183,10 +455,13 @@ void i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_pt
 	
 	restart_req = 1;	
 
+	xfer_err = I2C_OK;
 	tc = 0;
 	I2C1->CR2 |= I2C_CR2_START;  // send start bit
-	while (tc == 0);  // wait for transfer to complete
+	status = i2c1_wait(&tc);  // wait for transfer to complete
 	DMA1_Channel6->CCR &= ~DMA_CCR_EN;  // shut off the DMA
+	if (status != I2C_OK)
+		return status;
 
 	// Set number of bytes to receive	
 	I2C1->CR2 &= ~I2C_CR2_NBYTES;
@@ -201,7 +476,7 @@ void i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_pt
 	
 	rc = 0;  // read incomplete
 	I2C1->CR2 |= I2C_CR2_START;
-	while (rc == 0);
+	return i2c1_wait(&rc);
 }
 
 /**
@@ -211,6 +486,12 @@ void i2c1_read(size_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_pt
   */
 void I2C1_EV_IRQHandler(void)
 {
+	if (I2C1->ISR & I2C_ISR_NACKF) {
+		I2C1->ICR = I2C_ICR_NACKCF;  // STOP is sent by the peripheral
+		i2c1_stats.nacks++;
+		xfer_err = I2C_ERR_NACK;
+	}
+
 	if (I2C1->ISR & I2C_ISR_TC) {
 		if (restart_req == 1) {
 			tc = 1;
@@ -227,3 +508,27 @@ void I2C1_EV_IRQHandler(void)
 		}
 	}
 }
+
+/**
+  * @brief Handles error interrupts generated by the I2C1 peripheral.
+  *	   The waiting transfer sees the latched error and aborts.
+  * @param None
+  * @retval None
+  */
+void I2C1_ER_IRQHandler(void)
+{
+	if (I2C1->ISR & I2C_ISR_BERR) {
+		I2C1->ICR = I2C_ICR_BERRCF;
+		i2c1_stats.berrs++;
+		xfer_err = I2C_ERR_BERR;
+	}
+
+	if (I2C1->ISR & I2C_ISR_ARLO) {
+		I2C1->ICR = I2C_ICR_ARLOCF;
+		i2c1_stats.arlos++;
+		xfer_err = I2C_ERR_ARLO;
+	}
+
+	if (I2C1->ISR & I2C_ISR_OVR)
+		I2C1->ICR = I2C_ICR_OVRCF;  // Only possible in slave mode
+}
@@ -26,10 +26,16 @@
 #include "../include/lcd.h"
 #include "../include/delay.h"
 #include "../include/color_processing.h"
+#include "../../SCHED/include/sched.h"
 
 /* Private defines --------------------------------------------------------------*/
 #define PE8_AF1_TIM1_CH1N       ((uint32_t) 0x01)
 #define CK_PSC_NODIV            ((uint16_t) 0x00)
+#define SYSCLK_HZ		((uint32_t) 16000000U)
+
+/* Task events */
+#define EVT_BUTTON		((uint32_t) 0x01)  // User button pressed
+#define EVT_COLOR_READY		((uint32_t) 0x02)  // TCS34725 finished an integration
 /* Private function prototypes --------------------------------------------------*/
 static void exti_pin_init(void);
 static void sysclk_init(void);
@@ -39,6 +45,8 @@ static void led_ctrl_pin_init(void);
 static void button_pin_init(void);
 static void snsr_pwr_pin_init(void);
 static void snsr_pwr_on(void);
+static void button_task_run(uint32_t events);
+static void color_task_run(uint32_t events);
 /* Global variables -------------------------------------------------------------*/
 volatile uint32_t strip_color = 0x000000;
 
@@ -46,7 +54,9 @@ volatile uint8_t color_reg_base[1] = {TCS_CMDR_PTR | TCS_CMDR_AUTOINC_PROT | TCS
 
 uint16_t *ccr_buff_ptr;
 volatile RGB_Sensor_TypeDef *tcs34725;
-volatile uint8_t button_pressed = 0;
+uint8_t button_pressed = 0;
+static int button_task;
+static int color_task;
 
 /* Private functions ------------------------------------------------------------*/
 
@@ -57,8 +67,14 @@ volatile uint8_t button_pressed = 0;
   */
 int main(void)
 {
-	size_t i;
 	sysclk_init();  // SYSCLK_freq = 16 MHz
+
+	/* The EXTI handlers only post events : the I2C and LED work runs in tasks.
+	   No clock runs while the core sleeps, so loads are shares of time awake. */
+	sched_init(SYSCLK_HZ, NULL, 0);
+	color_task = sched_add("color", SCHED_PRIO_HIGHEST, color_task_run);
+	button_task = sched_add("button", SCHED_PRIO_HIGHEST + 1, button_task_run);
+
 	led_ctrl_pin_init();  // Initialize pin to control LED on TCS34725
 	button_pin_init();  // Initialize user button
 	pwm_pin_config();  // Initialize PE8
@@ -107,9 +123,61 @@ int main(void)
 	   the sensor is ready */
 	exti_pin_init();
 	
-	/* Run the program forever, waiting for the sensor
-	   to provide new color data */
-	while (1) {
+	/* Run the program forever, sleeping until the sensor
+	   provides new color data */
+	sched_run();
+}
+
+/**
+  * @brief Button task : lights the TCS34725 LED so the next reading
+  *	   is taken under it.
+  * @param events : EVT_BUTTON.
+  * @retval None
+  */
+static void button_task_run(uint32_t events)
+{
+	// Turn the LED on
+	GPIOA->ODR |= GPIO_ODR_ODR_2;
+
+	button_pressed = 1;
+}
+
+/**
+  * @brief Color task : clears the TCS34725 interrupt and, if the button
+  *	   was pressed, reads the color data, updates the LEDs and shows
+  *	   the color on the LCD as RRGGBB.
+  * @param events : EVT_COLOR_READY.
+  * @retval None
+  */
+static void color_task_run(uint32_t events)
+{
+	uint8_t *enh_colrs;
+	char buff[7];
+
+	tcs34725_interrupt_clr();
+
+	/* If the user button was pressed, read the 
+ 		sensor data and update the LEDs*/	
+	if (button_pressed) {
+		// Turn off the LED	
+		GPIOA->ODR &= ~GPIO_ODR_ODR_2;
+	
+		// Read color data from the rgb sensor
+		i2c1_read(8, TCS_I2C_ADDR, color_reg_base, tcs34725->COLRDATA);  // Get clear data
+		
+		// Enhance the raw color data returned by the sensor	
+		enh_colrs = enhance_color(tcs34725->COLRDATA);	
+	
+		// Update the LEDs	
+		strip_color = (enh_colrs[0] << 16) | (enh_colrs[1] << 8) | (enh_colrs[2] << 0);
+		color_update(ccr_buff_ptr, strip_color);
+
+		sprintf(buff, "%06lX", (unsigned long) strip_color);
+		LCD_DisplayString((uint8_t *) buff);
+		
+		free(enh_colrs);
+	
+		button_pressed = 0;
 	}
 }
 
@@ -324,7 +392,8 @@ static void tim1_config(void)
 }
 
 /**
-  * @brief Handle interrupts generated by the button
+  * @brief Handle interrupts generated by the button. Bounces merge
+  *	   into the one pending event, so there is no wait for release.
   * @param None
   * @retval None
   */
@@ -332,50 +401,18 @@ void EXTI0_IRQHandler(void)
 {
 	EXTI->PR1 |= EXTI_PR1_PIF0;
 
-	// Wait for the button to be released	
-	while (GPIOA->IDR & GPIO_IDR_IDR_0);	
-
-	// Turn the LED on
-	GPIOA->ODR |= GPIO_ODR_ODR_2;
-	
-	button_pressed = 1;
+	sched_post(button_task, EVT_BUTTON);
 }
 
 /**
   * @brief Handle interrupts generated by the TCS34725 
-  *	   RGB sensor.
+  *	   RGB sensor : the I2C work is left to the color task.
   * @param None
   * @retval None
   */
 void EXTI1_IRQHandler(void)
 {
-	uint8_t *enh_colrs;
-
 	EXTI->PR1 |= EXTI_PR1_PIF1;	
-	tcs34725_interrupt_clr();
-	
-	/* If the user button was pressed, read the 
- 		sensor data and update the LEDs*/	
-	if (button_pressed) {
-		// Turn off the LED	
-		GPIOA->ODR &= ~GPIO_ODR_ODR_2;
-	
-		// Read color data from the rgb sensor
-		i2c1_read(8, TCS_I2C_ADDR, color_reg_base, tcs34725->COLRDATA);  // Get clear data
-		
-		// Enhance the raw color data returned by the sensor	
-		enh_colrs = enhance_color(tcs34725->COLRDATA);	
-	
-		// Update the LEDs	
-		strip_color = (enh_colrs[0] << 16) | (enh_colrs[1] << 8) | (enh_colrs[2] << 0);
-		color_update(ccr_buff_ptr, strip_color);
-		
-		free(enh_colrs);
-	
-		button_pressed = 0;
 
-	/* Otherwise, the sensor threshold levels
-		must be adjusted */
-	} else {
-	}
+	sched_post(color_task, EVT_COLOR_READY);
 }
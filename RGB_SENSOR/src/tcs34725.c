@@ -102,7 +102,7 @@ void rgb_sensor_init(RGB_Sensor_TypeDef *RGB_SNSR)
 		TCS34725 via I2C bus */	
 	i2c1_transmit(17, TCS_I2C_ADDR, reg_settings);
 	
-	while (I2C1->ISR & I2C_ISR_BUSY);
+	i2c1_wait_idle();
 	
 	// Clear the TCS34725's interrupt flag for good measure 
 	tcs34725_interrupt_clr();
@@ -0,0 +1,137 @@
+/**********************************************************************************\
+ * @file    SCHED/include/sched.h                                                 *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    24-July-2017                                                          *
+ * @brief   Run-to-completion task scheduler with per-task CPU accounting,        *
+ *          shared by the projects.                                               *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef SCHED_H
+#define SCHED_H
+
+/**********************************************************************************\
+ *                                                                                *
+ *                               SCHED CONSTANTS                                  *
+ *                                                                                *
+\**********************************************************************************/
+#define SCHED_MAX_TASKS			8
+#define SCHED_PRIO_HIGHEST		((uint8_t) 0)	/*!< Lower values run first */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                SCHED STRUCTS                                   *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Runs to completion with the events posted since its last run */
+typedef void (*SCHED_TaskTypeDef)(uint32_t events);
+
+/* Called with interrupts masked when no task has events; must return with
+ * them still masked once an interrupt is pending */
+typedef void (*SCHED_IdleTypeDef)(void);
+
+typedef struct
+{
+	const char *name;
+	uint8_t priority;
+	uint32_t runs;			/*!< Since the stats were reset */
+	uint32_t run_ms;		/*!< Total time spent in the task */
+	uint32_t max_run_us;		/*!< Longest single run */
+	uint32_t max_latency_us;	/*!< Longest wait from a post to the run it caused */
+	uint32_t load_ppm;		/*!< Share of the elapsed time spent in the task */
+} SCHED_TaskStatsTypeDef;
+
+typedef struct
+{
+	uint32_t wakeups;		/*!< Idle hook calls ended by an interrupt */
+	uint32_t busy_ppm;		/*!< Share of the elapsed time spent awake, 0 without a clock */
+} SCHED_StatsTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                           SCHED FUNCTION PROTOTYPES                            *
+ *                                                                                *
+ * Tasks are plain functions run to completion from sched_run, never from an      *
+ * interrupt : handlers only post event flags. The ready task with the lowest     *
+ * priority value runs next, and the core sleeps in the idle hook when none is    *
+ * ready. Run time and latency come from the DWT cycle counter, which stops while *
+ * the core sleeps; the elapsed time the shares are taken of comes from a clock   *
+ * that keeps running.                                                            *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Clears the task table and starts the DWT cycle counter.
+  * @param cpu_freq : SYSCLK (Hz), to turn cycles into time.
+  * @param clock : Returns a tick count that runs while the core sleeps
+  *	   (swtimer_ticks where there is one), or NULL to take the shares of
+  *	   the time awake.
+  *	   The stats must be reset more often than it wraps.
+  * @param clock_hz : Rate of clock.
+  * @retval None
+  */
+void sched_init(uint32_t cpu_freq, uint32_t (*clock)(void), uint32_t clock_hz);
+
+/**
+  * @brief Adds a task. Tasks of equal priority run in the order added.
+  * @param name : Shown in the statistics; not copied.
+  * @param priority : SCHED_PRIO_HIGHEST or more.
+  * @param task : Task function.
+  * @retval Task id for sched_post, or -1 if SCHED_MAX_TASKS are already added
+  */
+int sched_add(const char *name, uint8_t priority, SCHED_TaskTypeDef task);
+
+/**
+  * @brief Replaces the idle hook. The default one sleeps with WFI.
+  * @param idle : New idle hook.
+  * @retval None
+  */
+void sched_set_idle(SCHED_IdleTypeDef idle);
+
+/**
+  * @brief Posts events to a task. Safe from interrupt handlers; events
+  *	   posted before the task runs are merged into one run.
+  * @param task : Id returned by sched_add.
+  * @param events : Non-zero task-defined flags.
+  * @retval None
+  */
+void sched_post(int task, uint32_t events);
+
+/**
+  * @brief Runs the ready tasks, highest priority first, and idles when none
+  *	   is. Never returns.
+  * @param None
+  * @retval None
+  */
+void sched_run(void);
+
+/**
+  * @brief Copies a task's counters, with its load worked out up to now.
+  * @param task : Id returned by sched_add.
+  * @param stats : Where to store the counters.
+  * @retval 0 on success, -1 if there is no such task
+  */
+int sched_get_task_stats(int task, SCHED_TaskStatsTypeDef *stats);
+
+/**
+  * @brief Copies the scheduler counters, with the busy share worked out up
+  *	   to now.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void sched_get_stats(SCHED_StatsTypeDef *stats);
+
+/**
+  * @brief Zeroes all counters and restarts the load window.
+  * @param None
+  * @retval None
+  */
+void sched_reset_stats(void);
+
+#endif
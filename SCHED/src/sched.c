@@ -0,0 +1,267 @@
+/**********************************************************************************\
+ * @file    SCHED/src/sched.c                                                     *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    24-July-2017                                                          *
+ * @brief   Run-to-completion task scheduler, shared by the projects. Interrupt   *
+ *          masking comes from the irq.h of the project it is built into.         *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+
+#include <stm32l476xx.h>
+#include <stddef.h>
+#include "../include/sched.h"
+#include "irq.h"
+
+/* Private types -----------------------------------------------------------------*/
+typedef struct
+{
+	SCHED_TaskTypeDef run;
+	const char *name;
+	uint8_t priority;
+	uint32_t events;		// Posted since the last run
+	uint32_t posted;		// DWT->CYCCNT when events stopped being 0
+
+	uint32_t runs;
+	uint64_t run_cycles;
+	uint32_t max_run;		// Cycles
+	uint32_t max_latency;		// Cycles
+} SCHED_SlotTypeDef;
+
+/* Private variables -------------------------------------------------------------*/
+static SCHED_SlotTypeDef tasks[SCHED_MAX_TASKS];
+static uint8_t order[SCHED_MAX_TASKS];	// Task ids, highest priority first
+static uint8_t ntasks;
+static volatile uint32_t ready;		// Bit n set : task n has events
+static SCHED_IdleTypeDef idle_hook;
+
+static uint32_t cpu_hz;
+static uint32_t cycles_per_us;
+static uint32_t (*sched_clock)(void);
+static uint32_t sched_clock_hz;
+
+/* Statistics */
+static uint32_t wakeups;
+static uint64_t awake_cycles;		// Since the stats were reset
+static uint32_t wake_cycle;		// DWT->CYCCNT at the latest wakeup
+static uint32_t stats_start;		// sched_clock() at the reset
+
+/* Private functions -------------------------------------------------------------*/
+static void sched_sleep(void);
+static void sched_idle(void);
+static uint32_t sched_share(uint64_t cycles);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void sched_init(uint32_t cpu_freq, uint32_t (*clock)(void), uint32_t clock_hz)
+{
+	ntasks = 0;
+	ready = 0;
+	idle_hook = sched_sleep;
+
+	cpu_hz = cpu_freq;
+	cycles_per_us = cpu_freq / 1000000U;
+	sched_clock = clock;
+	sched_clock_hz = clock_hz;
+
+	/* Cycle counter for run time, latency and time awake */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	sched_reset_stats();
+}
+
+int sched_add(const char *name, uint8_t priority, SCHED_TaskTypeDef task)
+{
+	SCHED_SlotTypeDef *t;
+	uint32_t primask;
+	uint8_t i, j;
+
+	if (ntasks >= SCHED_MAX_TASKS)
+		return -1;
+
+	t = &tasks[ntasks];
+	t->run = task;
+	t->name = name;
+	t->priority = priority;
+	t->events = 0;
+	t->runs = 0;
+	t->run_cycles = 0;
+	t->max_run = 0;
+	t->max_latency = 0;
+
+	/* Keep order sorted : after every task of the same priority or higher */
+	primask = irq_save();
+	for (i = 0; i < ntasks && tasks[order[i]].priority <= priority; i++)
+		;
+	for (j = ntasks; j > i; j--)
+		order[j] = order[j - 1];
+	order[i] = ntasks;
+	ntasks++;
+	irq_restore(primask);
+
+	return ntasks - 1;
+}
+
+void sched_set_idle(SCHED_IdleTypeDef idle)
+{
+	idle_hook = idle;
+}
+
+void sched_post(int task, uint32_t events)
+{
+	SCHED_SlotTypeDef *t;
+	uint32_t primask;
+
+	if (task < 0 || task >= ntasks || events == 0)
+		return;
+	t = &tasks[task];
+
+	primask = irq_save();
+	if (t->events == 0)
+		t->posted = DWT->CYCCNT;
+	t->events |= events;
+	ready |= 1U << task;
+	irq_restore(primask);
+}
+
+void sched_run(void)
+{
+	SCHED_SlotTypeDef *t;
+	uint32_t events, start, latency, cycles;
+	uint8_t i;
+
+	while (1) {
+		/* Masked from the test through the idle hook, see irq_wait */
+		__disable_irq();
+		for (i = 0; i < ntasks; i++)
+			if (ready & (1U << order[i]))
+				break;
+
+		if (i == ntasks) {
+			sched_idle();
+			__enable_irq();
+			continue;
+		}
+
+		t = &tasks[order[i]];
+		events = t->events;
+		t->events = 0;
+		ready &= ~(1U << order[i]);
+		start = DWT->CYCCNT;
+		latency = start - t->posted;
+		__enable_irq();
+
+		t->run(events);
+
+		cycles = DWT->CYCCNT - start;
+		t->runs++;
+		t->run_cycles += cycles;
+		if (cycles > t->max_run)
+			t->max_run = cycles;
+		if (latency > t->max_latency)
+			t->max_latency = latency;
+	}
+}
+
+int sched_get_task_stats(int task, SCHED_TaskStatsTypeDef *stats)
+{
+	SCHED_SlotTypeDef *t;
+
+	if (task < 0 || task >= ntasks)
+		return -1;
+	t = &tasks[task];
+
+	stats->name = t->name;
+	stats->priority = t->priority;
+	stats->runs = t->runs;
+	stats->run_ms = (uint32_t) (t->run_cycles / (cycles_per_us * 1000U));
+	stats->max_run_us = t->max_run / cycles_per_us;
+	stats->max_latency_us = t->max_latency / cycles_per_us;
+	stats->load_ppm = sched_share(t->run_cycles);
+
+	return 0;
+}
+
+void sched_get_stats(SCHED_StatsTypeDef *stats)
+{
+	stats->wakeups = wakeups;
+	stats->busy_ppm = 0;
+	if (sched_clock != NULL)
+		stats->busy_ppm = sched_share(awake_cycles + (DWT->CYCCNT - wake_cycle));
+}
+
+void sched_reset_stats(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < ntasks; i++) {
+		tasks[i].runs = 0;
+		tasks[i].run_cycles = 0;
+		tasks[i].max_run = 0;
+		tasks[i].max_latency = 0;
+	}
+
+	wakeups = 0;
+	awake_cycles = 0;
+	wake_cycle = DWT->CYCCNT;
+	stats_start = (sched_clock != NULL) ? sched_clock() : 0;
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Default idle hook : Sleep until an interrupt is pending.
+  * @param None
+  * @retval None
+  */
+static void sched_sleep(void)
+{
+	irq_wait();
+}
+
+/**
+  * @brief Runs the idle hook, keeping the time spent in it out of the time
+  *	   awake. Interrupts must be masked.
+  * @param None
+  * @retval None
+  */
+static void sched_idle(void)
+{
+	awake_cycles += DWT->CYCCNT - wake_cycle;
+
+	idle_hook();
+
+	wake_cycle = DWT->CYCCNT;
+	wakeups++;
+}
+
+/**
+  * @brief Works out what share of the time since the stats were reset a
+  *	   number of cycles is : of the clock's time if there is one, of the
+  *	   time awake otherwise.
+  * @param cycles : Cycles spent since the reset.
+  * @retval Share (ppm)
+  */
+static uint32_t sched_share(uint64_t cycles)
+{
+	uint64_t elapsed;
+
+	if (sched_clock != NULL)
+		elapsed = (uint64_t) (sched_clock() - stats_start) * cpu_hz / sched_clock_hz;
+	else
+		elapsed = awake_cycles + (DWT->CYCCNT - wake_cycle);
+
+	if (elapsed == 0)
+		return 0;
+	if (cycles >= elapsed)
+		return 1000000U;
+
+	return (uint32_t) (cycles * 1000000U / elapsed);
+}
@@ -0,0 +1,127 @@
+/**********************************************************************************\
+ * @file    SMART_WATCH/include/compositor.h                                      *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    07-July-2017                                                          *
+ * @brief   Dirty-rectangle compositor : repaints only what changed each frame.   *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include "./tft_lcd_interface.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                            COMPOSITOR CONSTANTS                                *
+ *                                                                                *
+\**********************************************************************************/
+#define COMP_MAX_LAYERS			16	/*!< Shapes on screen at once */
+#define COMP_MAX_DIRTY			8	/*!< Dirty rectangles kept per frame */
+#define COMP_MERGE_SLACK		((uint32_t) 64U)	/*!< Extra pixels worth painting to save a window */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                             COMPOSITOR STRUCTS                                 *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	uint32_t frames;		/*!< Commits that sent anything */
+	uint32_t rects;			/*!< Windows sent by the latest commit */
+	uint32_t pixels;		/*!< Pixels covered by those windows */
+	uint32_t bytes;			/*!< Bytes sent by the latest commit */
+	uint32_t max_bytes;		/*!< Largest commit so far */
+} COMP_StatsTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                        COMPOSITOR FUNCTION PROTOTYPES                          *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Empties the scene and clears the screen to the background.
+  * @param lcd : The LCD screen to composite onto.
+  * @param background : Background color (0xRRGGBB).
+  * @retval None
+  */
+void COMP_init(LCD_screen *lcd, uint32_t background);
+
+/**
+  * @brief Changes the background color. The screen is filled right away and
+  *	   every layer is redrawn at the next commit.
+  * @param background : Background color (0xRRGGBB).
+  * @retval None
+  */
+void COMP_set_background(uint32_t background);
+
+/**
+  * @brief Adds a shape on top of the scene. The shape is referenced, not
+  *	   copied; call COMP_invalidate after editing it.
+  * @param shape : Shape to draw.
+  * @param x : Horizontal location of shape's center.
+  * @param y : Vertical location of shape's center.
+  * @retval COMP_add : Layer id, or -1 if COMP_MAX_LAYERS are in use.
+  */
+int COMP_add(SHAPE_TypeDef *shape, int x, int y);
+
+/**
+  * @brief Removes a layer from the scene.
+  * @param id : Layer id from COMP_add.
+  * @retval None
+  */
+void COMP_remove(int id);
+
+/**
+  * @brief Moves a layer.
+  * @param id : Layer id from COMP_add.
+  * @param x : Horizontal location of shape's center.
+  * @param y : Vertical location of shape's center.
+  * @retval None
+  */
+void COMP_move(int id, int x, int y);
+
+/**
+  * @brief Shows or hides a layer.
+  * @param id : Layer id from COMP_add.
+  * @param visible : Non-zero to show.
+  * @retval None
+  */
+void COMP_set_visible(int id, uint8_t visible);
+
+/**
+  * @brief Marks a layer for repainting after its shape was edited.
+  * @param id : Layer id from COMP_add.
+  * @retval None
+  */
+void COMP_invalidate(int id);
+
+/**
+  * @brief Marks an arbitrary screen area for repainting.
+  * @param r : Inclusive rectangle.
+  * @retval None
+  */
+void COMP_invalidate_rect(const SHAPE_RectTypeDef *r);
+
+/**
+  * @brief Repaints every dirty rectangle (background, then the layers that
+  *	   touch it, bottom to top) and clears the dirty list.
+  * @param None
+  * @retval COMP_commit : Bytes sent to the LCD.
+  */
+uint32_t COMP_commit(void);
+
+/**
+  * @brief Copies the per-frame counters.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void COMP_get_stats(COMP_StatsTypeDef *stats);
+
+#endif
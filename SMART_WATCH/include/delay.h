@@ -1,42 +1,54 @@
 /**********************************************************************************\
- * @file    I2C_PROJECT/include/i2c.h                                             *
+ * @file    SMART_WATCH/include/delay.h                                           *
  * @author  Nolan R. H. Gagnon                                                    *
  * @version V2.0                                                                  *
  * @date    26-June-2017                                                          *
- * @brief   I2C Interface.                                                        *
+ * @brief   Provides accurate delays using system timer.                          *
  *                                                                                *
  **********************************************************************************
  * @attention                                                                     *
  *                                                                                *
- * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
  *                                                                                *
 \**********************************************************************************/
-#ifndef I2C_H
-#define I2C_H
+#ifndef DELAY_H
+#define DELAY_H
 
 /**********************************************************************************\
  *                                                                                *
- *                              I2C CONSTANTS                                     *
+ *                               SYSTICK CONSTANTS                                *
  *                                                                                *
 \**********************************************************************************/
-#define I2C_CLK_FREQ_DIV_2	((uint32_t) 1U << 28)
+#define SysTick_CTRL_ENABLE             ((uint32_t) 0x00000001)
+#define SysTick_CTRL_TICKINT            ((uint32_t) 0x00000002)
+#define SysTick_CTRL_CLKSOURCE          ((uint32_t) 0x00000004)
+#define SysTick_CTRL_COUNTFLAG          ((uint32_t) 0x00010000)
 
 /**********************************************************************************\
  *                                                                                *
- *                              I2C FUNCTIONS                                     *
+ *                           DELAY FUNCTION PROTOTYPES                            *
  *                                                                                *
 \**********************************************************************************/
 
-/* initialize i2c1 peripheral */
-void i2c1_init(void);
+/**
+  * @brief Initializes the SysTick system timer. 
+  * @param ticks : Number of clock pulses required for SysTick counter to reach 0. 
+  * @retval None
+  */
+void systick_init(uint32_t ticks);
 
-/* configure pins used for i2c1 */
-static void i2c1_pins_init(void);
+/**
+  * @brief Turn of the SysTick counter. 
+  * @param None
+  * @retval None
+  */
+void systick_deinit(void);
 
-/* transmit data on the i2c1 bus */
-void i2c1_transmit(uint8_t nbytes, uint8_t slvaddr, uint8_t *payload);
-
-/* read data from a slave on the i2c1 bus */
-void i2c1_read(uint8_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr);
+/**
+  * @brief Delay the processor for a number of milliseconds.
+  * @param time_ms : Number of milliseconds to delay. 
+  * @retval None
+  */
+void delay(uint32_t time_ms);
 
 #endif
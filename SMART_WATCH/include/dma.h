@@ -0,0 +1,70 @@
+/**********************************************************************************\
+ * @file    SMART_WATCH/include/dma.h                                             *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    06-July-2017                                                          *
+ * @brief   DMA Interface.                                                        *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef DMA_H
+#define DMA_H
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              DMA CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/* CxS request selection for the SPI channels :
+ *
+ *	SPI1 : DMA1 CH2 (RX), CH3 (TX)
+ *	SPI2 : DMA1 CH4 (RX), CH5 (TX)
+ *	SPI3 : DMA2 CH1 (RX), CH2 (TX)
+ */
+#define DMA1_REQ_SPI			((uint8_t) 0x1)
+#define DMA2_REQ_SPI3			((uint8_t) 0x3)
+
+#define DMA_MAX_XFER			((uint32_t) 0xFFFFU)	/*!< CNDTR is 16 bits wide */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              DMA FUNCTIONS                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Maps SPIx's RX and TX requests onto their channels, points both at
+  *	   SPIx->DR and enables the channels' interrupts.
+  * @param SPIx : SPI1, SPI2 or SPI3.
+  * @retval None
+  */
+void dma_spi_init(SPI_TypeDef *SPIx);
+
+/**
+  * @brief Programs and enables SPIx's channels for one transfer. Frame width
+  *	   follows SPIx's current data size. The caller then sets the SPI's
+  *	   DMA request enables (RXDMAEN before, TXDMAEN after this call).
+  * @param SPIx : SPI peripheral.
+  * @param tx : Frames to send.
+  * @param rx : Where to store received frames, or NULL to run TX only.
+  * @param count : Number of frames (1 - DMA_MAX_XFER).
+  * @param minc : Non-zero to walk through tx, zero to resend *tx count times.
+  * @retval None
+  */
+void dma_spi_start(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t count, uint8_t minc);
+
+/**
+  * @brief Acknowledges the transfer-complete flag of the channel that ends
+  *	   SPIx's transfer (RX, or TX for transmit-only) and disables both
+  *	   channels if it was set.
+  * @param SPIx : SPI peripheral.
+  * @retval 1 if the transfer completed, 0 otherwise
+  */
+uint8_t dma_spi_complete(SPI_TypeDef *SPIx);
+
+#endif
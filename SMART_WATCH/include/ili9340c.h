@@ -99,4 +99,172 @@
 #define ILI9340C_SET_DIGAMCTL2		((uint8_t) 0xE3)	/*!< Set digital gamma control settings (2) */
 #define ILI9340C_SET_IFCTL		((uint8_t) 0xF6)	/*!< Set interface control settings */
 
+/**********************************************************************************\
+ *                                                                                *
+ *                              ILI9340C CONSTANTS                                *
+ *                                                                                *
+\**********************************************************************************/
+#define ILI9340C_WIDTH			((uint16_t) 240)	/*!< Columns (portrait) */
+#define ILI9340C_HEIGHT			((uint16_t) 320)	/*!< Pages (portrait) */
+#define ILI9340C_NPIXELS		((uint32_t) ILI9340C_WIDTH * ILI9340C_HEIGHT)
+
+#define ILI9340C_SPI_TSCYCW_FREQ	((uint32_t) 10000000U)	/*!< 1 / t_scycw : datasheet write clock limit */
+#define ILI9340C_SPI_FAST_FREQ		((uint32_t) 20000000U)	/*!< Past the datasheet (see ili9340c.c) */
+
+#ifdef ILI9340C_SPI_FAST
+#define ILI9340C_SPI_MAX_FREQ		ILI9340C_SPI_FAST_FREQ	/*!< SCK for writes */
+#else
+#define ILI9340C_SPI_MAX_FREQ		ILI9340C_SPI_TSCYCW_FREQ	/*!< SCK for writes */
+#endif
+
+#define ILI9340C_MADCTL_MY		((uint8_t) 0x80)	/*!< Row address order */
+#define ILI9340C_MADCTL_MX		((uint8_t) 0x40)	/*!< Column address order */
+#define ILI9340C_MADCTL_MV		((uint8_t) 0x20)	/*!< Row/column exchange */
+#define ILI9340C_MADCTL_BGR		((uint8_t) 0x08)	/*!< Panel is wired BGR */
+#define ILI9340C_PIXFMT_16BPP		((uint8_t) 0x55)	/*!< RGB565 on both interfaces */
+#define ILI9340C_CTLDISP_BL_ON		((uint8_t) 0x24)	/*!< BCTRL | BL : SET_BRTNSS drives the backlight */
+#define ILI9340C_TEAR_VBLANK		((uint8_t) 0x00)	/*!< TEAR_ON mode : pulse once per frame */
+
+/* Control pins (SCK, MISO and MOSI are set up by spi_init) */
+#define ILI9340C_DC_PIN			((uint32_t) 10U)	/*!< PE10 : low = command, high = data */
+#define ILI9340C_RST_PIN		((uint32_t) 11U)	/*!< PE11 : active-low hardware reset */
+#define ILI9340C_CS_PIN			((uint32_t) 12U)	/*!< PE12 : active-low chip select */
+#define ILI9340C_TE_PIN			((uint32_t) 9U)		/*!< PE9 : tearing effect output (EXTI9) */
+
+/* 0xRRGGBB -> RGB565 */
+#define ILI9340C_RGB565(c)		((uint16_t) ((((c) >> 8) & 0xF800) | (((c) >> 5) & 0x07E0) | (((c) >> 3) & 0x001F)))
+
+/**********************************************************************************\
+ *                                                                                *
+ *                          ILI9340C FUNCTION PROTOTYPES                          *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Brings up SPI1 and its TX DMA channel, resets the controller and
+  *	   programs it for 16-bit portrait operation. Leaves the display off.
+  *	   SysTick must already be running (delay() is used for reset timing).
+  * @param None
+  * @retval None
+  */
+void ILI9340C_init(void);
+
+/**
+  * @brief Sends a command followed by its parameter bytes.
+  * @param cmd : One of the ILI9340C_* commands above.
+  * @param params : Parameter bytes (may be NULL when nparams is 0).
+  * @param nparams : Number of parameter bytes.
+  * @retval None
+  */
+void ILI9340C_write_cmd(uint8_t cmd, const uint8_t *params, uint8_t nparams);
+
+/**
+  * @brief Opens an inclusive window with CASET/PASET and issues RAMWRITE, so
+  *	   the pixels that follow fill it left to right, top to bottom.
+  * @param x0 : First column.
+  * @param y0 : First page (row).
+  * @param x1 : Last column.
+  * @param y1 : Last page (row).
+  * @retval None
+  */
+void ILI9340C_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+/**
+  * @brief Splits the panel into a fixed top area, a vertically scrolling area
+  *	   and a fixed bottom area (VSAREA). The three must add up to
+  *	   ILI9340C_HEIGHT.
+  * @param tfa : Top fixed area (lines).
+  * @param vsa : Vertical scrolling area (lines).
+  * @param bfa : Bottom fixed area (lines).
+  * @retval None
+  */
+void ILI9340C_set_scroll_area(uint16_t tfa, uint16_t vsa, uint16_t bfa);
+
+/**
+  * @brief Shows GRAM line vsp on the first line of the scrolling area; the
+  *	   lines after it follow, wrapping inside the area (VSSADDR). Only the
+  *	   scan-out moves : GRAM and set_window addressing are unchanged.
+  *	   NMOD_ON leaves scrolling mode.
+  * @param vsp : GRAM line, tfa <= vsp < tfa + vsa.
+  * @retval None
+  */
+void ILI9340C_scroll_to(uint16_t vsp);
+
+/**
+  * @brief Streams one color npixels times into the open window. Returns as
+  *	   soon as the DMA is running; the next driver call waits for it.
+  * @param color : RGB565 color.
+  * @param npixels : Number of pixels to write.
+  * @retval None
+  */
+void ILI9340C_fill(uint16_t color, uint32_t npixels);
+
+/**
+  * @brief Streams a pixel buffer into the open window. Returns as soon as the
+  *	   DMA is running; the buffer must stay untouched until ILI9340C_busy()
+  *	   reads 0.
+  * @param pixels : RGB565 pixels.
+  * @param npixels : Number of pixels to write.
+  * @retval None
+  */
+void ILI9340C_write_pixels(const uint16_t *pixels, uint32_t npixels);
+
+/**
+  * @brief Reports whether a pixel stream is still being transferred.
+  * @param None
+  * @retval 1 while DMA is feeding SPI1 or SPI1 is still shifting, 0 otherwise
+  */
+uint8_t ILI9340C_busy(void);
+
+/**
+  * @brief Waits for the current pixel stream to leave the SPI shifter and
+  *	   deselects the controller.
+  * @param None
+  * @retval None
+  */
+void ILI9340C_wait(void);
+
+/**
+  * @brief Turns the controller's tearing effect output on (one pulse per
+  *	   frame, at the line set with ILI9340C_set_tear_line) and unmasks its
+  *	   EXTI line, or turns both off. Turning it off starts any stream that
+  *	   is still waiting for TE.
+  * @param on : Non-zero to enable.
+  * @retval None
+  */
+void ILI9340C_te_enable(uint8_t on);
+
+/**
+  * @brief Makes TE pulse when the panel starts refreshing a line (SET_TEARLN).
+  *	   Line 0 is the start of the frame.
+  * @param line : Panel line (0 - ILI9340C_HEIGHT - 1).
+  * @retval None
+  */
+void ILI9340C_set_tear_line(uint16_t line);
+
+/**
+  * @brief Holds the next pixel stream (ILI9340C_fill or _write_pixels) until
+  *	   the next TE pulse; the EXTI interrupt then starts its DMA. Until then
+  *	   the driver counts as busy. TE must be enabled.
+  * @param None
+  * @retval None
+  */
+void ILI9340C_arm_te(void);
+
+/**
+  * @brief Returns the number of TE pulses seen (one per panel refresh while
+  *	   TE is enabled). Wraps at 2^32.
+  * @param None
+  * @retval Pulse count
+  */
+uint32_t ILI9340C_get_te_count(void);
+
+/**
+  * @brief Returns the number of bytes clocked out since reset (commands,
+  *	   parameters and pixels). Wraps at 2^32.
+  * @param None
+  * @retval Byte count
+  */
+uint32_t ILI9340C_get_tx_bytes(void);
+
 #endif
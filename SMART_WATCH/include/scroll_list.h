@@ -0,0 +1,123 @@
+/**********************************************************************************\
+ * @file    SMART_WATCH/include/scroll_list.h                                     *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    18-July-2017                                                          *
+ * @brief   Scrolling list on the panel's hardware vertical scroll.               *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef SCROLL_LIST_H
+#define SCROLL_LIST_H
+
+#include "./tft_lcd_interface.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                            SCROLL LIST CONSTANTS                               *
+ *                                                                                *
+\**********************************************************************************/
+#define SCROLL_MAX_ROW_ITEMS		8	/*!< Shapes drawn in one row */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                             SCROLL LIST STRUCTS                                *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	const SHAPE_InstanceTypeDef *items;	/*!< Shapes; x,y relative to the row's top-left */
+	uint8_t n;				/*!< Entries in items (<= SCROLL_MAX_ROW_ITEMS) */
+} SCROLL_RowTypeDef;
+
+typedef struct
+{
+	uint32_t steps;			/*!< Scrolls that moved the list */
+	uint32_t lines;			/*!< Panel lines repainted */
+	uint32_t bytes;			/*!< Bytes sent for those lines and the scroll commands */
+} SCROLL_StatsTypeDef;
+
+typedef struct
+{
+	LCD_screen *lcd;
+	const SCROLL_RowTypeDef *rows;
+	uint16_t nrows;
+	uint16_t row_h;			/*!< Every row is this many lines tall */
+	uint16_t top;			/*!< First panel line of the list (the top fixed area) */
+	uint16_t height;		/*!< Lines of the list on screen (the scrolling area) */
+	int32_t pos;			/*!< Content line shown on the list's first line */
+	SCROLL_StatsTypeDef stats;
+} SCROLL_ListTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                       SCROLL LIST FUNCTION PROTOTYPES                          *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Gives the list a full-width band of the panel, sets up the hardware
+  *	   scrolling area on it and draws the first screenful. Lines above and
+  *	   below the band stay fixed and are not touched; nothing else may draw
+  *	   inside the band while the list is open.
+  * @param list : List to set up.
+  * @param lcd : The LCD screen.
+  * @param top : First panel line of the band.
+  * @param height : Lines in the band (top + height <= ILI9340C_HEIGHT).
+  * @param rows : Row contents; referenced, not copied.
+  * @param nrows : Number of rows.
+  * @param row_h : Height of every row (lines).
+  * @retval None
+  */
+void SCROLL_init(SCROLL_ListTypeDef *list, LCD_screen *lcd, uint16_t top, uint16_t height,
+		 const SCROLL_RowTypeDef *rows, uint16_t nrows, uint16_t row_h);
+
+/**
+  * @brief Scrolls the list by moving the panel's scroll start and painting
+  *	   only the lines that come into view. Moves of a full band or more
+  *	   repaint the band.
+  * @param list : The list.
+  * @param dy : Lines to scroll; positive brings later rows up.
+  * @retval None
+  */
+void SCROLL_by(SCROLL_ListTypeDef *list, int32_t dy);
+
+/**
+  * @brief Scrolls the list so a content line is on its first line. The
+  *	   position is clamped to the content.
+  * @param list : The list.
+  * @param pos : Content line.
+  * @retval None
+  */
+void SCROLL_to(SCROLL_ListTypeDef *list, int32_t pos);
+
+/**
+  * @brief Repaints a row after its contents changed, if any of it is visible.
+  * @param list : The list.
+  * @param row : Row index.
+  * @retval None
+  */
+void SCROLL_invalidate_row(SCROLL_ListTypeDef *list, uint16_t row);
+
+/**
+  * @brief Copies the list's counters. All of them add up from SCROLL_init,
+  *	   whose own paint is included.
+  * @param list : The list.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void SCROLL_get_stats(const SCROLL_ListTypeDef *list, SCROLL_StatsTypeDef *stats);
+
+/**
+  * @brief Returns the panel to unscrolled scan-out. The band still holds the
+  *	   list's pixels in scrolled order, so the caller repaints it.
+  * @param list : The list.
+  * @retval None
+  */
+void SCROLL_close(SCROLL_ListTypeDef *list);
+
+#endif
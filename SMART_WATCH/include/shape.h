@@ -1,9 +1,155 @@
+/**********************************************************************************\
+ * @file    SMART_WATCH/include/shape.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    06-July-2017                                                          *
+ * @brief   Shapes drawn through the LCD interface.                               *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
 #ifndef SHAPE_H
 #define SHAPE_H
 
-typedef struct _shape
+/**********************************************************************************\
+ *                                                                                *
+ *                                SHAPE CONSTANTS                                 *
+ *                                                                                *
+\**********************************************************************************/
+#define SHAPE_FLAG_AA			((uint8_t) 0x01)	/*!< Anti-alias curved edges and 1-pixel lines */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  SHAPE ENUMS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef enum
+{
+	SHAPE_FILLED_RECT = 0,	/*!< width x height, solid */
+	SHAPE_RECT = 1,		/*!< width x height outline, stroke pixels thick */
+	SHAPE_ROUNDED_RECT = 2,	/*!< width x height, corners of radius; outline if stroke > 0 */
+	SHAPE_CIRCLE = 3,	/*!< Disc of radius; ring stroke pixels thick if stroke > 0 */
+	SHAPE_ARC = 4,		/*!< Ring of radius, stroke thick, clockwise from start to end */
+	SHAPE_LINE = 5,		/*!< (x0,y0) to (x1,y1), relative to the position, stroke thick */
+	SHAPE_BITMAP = 6,	/*!< width x height RGB565 pixels, row-major */
+	SHAPE_TEXT = 7		/*!< text in an RLE font (tools/asset_rle), one line */
+} SHAPE_KindTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                 SHAPE STRUCTS                                  *
+ *                                                                                *
+\**********************************************************************************/
+
+typedef struct
 {
+	uint16_t offset;	/*!< First run in the font's data */
+	uint8_t width;		/*!< Ink box */
+	uint8_t height;
+	uint8_t x_off;		/*!< Ink box position inside the glyph cell */
+	uint8_t y_off;
+	uint8_t advance;	/*!< Pen advance (0 : character not in the font) */
+} SHAPE_GlyphTypeDef;
 
+typedef struct
+{
+	const uint8_t *data;	/*!< Runs : one byte of (length - 1) << bpp | level */
+	const SHAPE_GlyphTypeDef *glyphs;
+	uint8_t first;		/*!< Character of glyphs[0] */
+	uint16_t count;		/*!< Entries in glyphs */
+	uint8_t bpp;		/*!< 1, 2 or 4 bits of coverage per pixel */
+	uint8_t height;		/*!< Line height */
+} SHAPE_FontTypeDef;
+
+/*
+ * Unused fields are ignored, so designated initializers only need the ones
+ * a primitive reads. Angles are in degrees, clockwise from 12 o'clock.
+ */
+typedef struct _shape
+{
+	SHAPE_KindTypeDef type;	/*!< Primitive */
+	uint32_t color;		/*!< Color (0xRRGGBB); unused by bitmaps */
+	uint16_t width;		/*!< Rectangles, bitmap */
+	uint16_t height;	/*!< Rectangles, bitmap */
+	uint16_t radius;	/*!< Circle, arc, rounded corners */
+	uint8_t stroke;		/*!< Outline / line thickness (pixels) */
+	uint8_t flags;		/*!< SHAPE_FLAG_* */
+	int16_t start;		/*!< Arc start angle */
+	int16_t end;		/*!< Arc end angle (start == end is a full ring) */
+	int16_t x0;		/*!< Line start, relative to the position */
+	int16_t y0;
+	int16_t x1;		/*!< Line end, relative to the position */
+	int16_t y1;
+	const uint16_t *pixels;	/*!< Bitmap data */
+	const SHAPE_FontTypeDef *font;	/*!< Text font */
+	const char *text;	/*!< Text (NUL-terminated) */
 } SHAPE_TypeDef;
 
+typedef struct
+{
+	int16_t x0;		/*!< Left column */
+	int16_t y0;		/*!< Top row */
+	int16_t x1;		/*!< Right column (inclusive) */
+	int16_t y1;		/*!< Bottom row (inclusive) */
+} SHAPE_RectTypeDef;
+
+typedef struct
+{
+	SHAPE_TypeDef *shape;	/*!< What to draw */
+	int16_t x;		/*!< Horizontal location of shape's center */
+	int16_t y;		/*!< Vertical location of shape's center */
+} SHAPE_InstanceTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                           SHAPE FUNCTION PROTOTYPES                            *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Returns the pixels a shape can touch when drawn at (x,y). Rectangles,
+  *	   bitmaps, circles and arcs are centered on (x,y); line endpoints are
+  *	   offsets from it.
+  * @param shape : Shape to measure.
+  * @param x : Horizontal location of shape's center.
+  * @param y : Vertical location of shape's center.
+  * @param r : Filled in with the inclusive bounding box.
+  * @retval None
+  */
+void SHAPE_get_bounds(const SHAPE_TypeDef *shape, int x, int y, SHAPE_RectTypeDef *r);
+
+/**
+  * @brief Rasterizes the part of a shape that falls inside a strip into the
+  *	   strip's pixel buffer, over whatever is already there.
+  * @param shape : Shape to draw.
+  * @param x : Horizontal location of shape's center.
+  * @param y : Vertical location of shape's center.
+  * @param strip : Screen area the buffer holds.
+  * @param buf : RGB565 pixels, row-major, (strip->x1 - strip->x0 + 1) per row.
+  * @retval None
+  */
+void SHAPE_raster(const SHAPE_TypeDef *shape, int x, int y, const SHAPE_RectTypeDef *strip, uint16_t *buf);
+
+/**
+  * @brief Intersects two rectangles.
+  * @param a : First rectangle.
+  * @param b : Second rectangle.
+  * @param out : Filled in with the overlap (may alias a or b).
+  * @retval 1 if the rectangles overlap, 0 otherwise (out is then undefined)
+  */
+uint8_t SHAPE_rect_intersect(const SHAPE_RectTypeDef *a, const SHAPE_RectTypeDef *b, SHAPE_RectTypeDef *out);
+
+/**
+  * @brief Points a line from its position out to a given length and angle
+  *	   (clock hands). Sets x0,y0 to the position and x1,y1 to the tip.
+  * @param shape : SHAPE_LINE to edit.
+  * @param deg : Angle, clockwise from 12 o'clock.
+  * @param length : Length (pixels).
+  * @retval None
+  */
+void SHAPE_line_polar(SHAPE_TypeDef *shape, int deg, int length);
+
 #endif
@@ -7,15 +7,158 @@
  *                                                                                 *
  ***********************************************************************************/
 
-#define PE12_AF5_SPI1_NSS		((uint32_t) 5U << (4 * 4)) 
+#define PE12_AF5_SPI1_NSS		((uint32_t) 5U << (4 * 4))
 #define PE13_AF5_SPI1_SCK		((uint32_t) 5U << (4 * 5))
 #define PE14_AF5_SPI1_MISO		((uint32_t) 5U << (4 * 6))
 #define PE15_AF5_SPI1_MOSI		((uint32_t) 5U << (4 * 7))
 
-/* Public functions ---------------------------------------------------------------*/
-void spi_init(SPI_TypeDef *SPIx);
+#define SPI_AF_SPI1_SPI2		((uint8_t) 5U)	/*!< PB13-15 = SPI2 SCK, MISO, MOSI */
+#define SPI_AF_SPI3			((uint8_t) 6U)	/*!< PC10-12 = SPI3 SCK, MISO, MOSI */
 
-/* Private functions --------------------------------------------------------------*/
-static void spi_pins_init(SPI_TypeDef *SPIx);
+/* Clock sources the SYSCLK mux can pick (RCC_CFGR_SWS) */
+#define SPI_HSI_FREQ			((uint32_t) 16000000U)
+#define SPI_HSE_FREQ			((uint32_t) 8000000U)	/*!< Only if a crystal is fitted */
+#define SPI_MSI_RESET_FREQ		((uint32_t) 4000000U)	/*!< MSI range 6, out of reset */
+
+/* Clock polarity (bit 1) and phase (bit 0) */
+#define SPI_MODE_0			((uint8_t) 0x0)	/*!< Idle low, sample on the rising edge */
+#define SPI_MODE_1			((uint8_t) 0x1)	/*!< Idle low, sample on the falling edge */
+#define SPI_MODE_2			((uint8_t) 0x2)	/*!< Idle high, sample on the falling edge */
+#define SPI_MODE_3			((uint8_t) 0x3)	/*!< Idle high, sample on the rising edge */
+
+#define SPI_FILL_FRAME			((uint16_t) 0xFFFF)	/*!< Clocked out when only receiving */
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              SPI STRUCTS                                        *
+ *                                                                                 *
+ ***********************************************************************************/
+
+typedef struct
+{
+	uint32_t max_freq;	/*!< Fastest SCK the slave tolerates (Hz) */
+	uint8_t mode;		/*!< SPI_MODE_0 - SPI_MODE_3 */
+	uint8_t data_size;	/*!< Frame size, 4 - 16 bits */
+} SPI_ConfigTypeDef;
+
+/* Called from the SPI or DMA interrupt once a transfer is done */
+typedef void (*SPI_CallbackTypeDef)(void);
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              SPI FUNCTIONS                                      *
+ *                                                                                 *
+ * Buffers hold one uint8_t per frame for frames of up to 8 bits and one uint16_t  *
+ * per frame above that. A NULL tx clocks out SPI_FILL_FRAME; a NULL rx drops what *
+ * comes back. Chip select is left to the caller (SPI1 sets up PE12 for it).       *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Sets up SPIx's pins, clock, DMA channels and interrupt, then
+  *	   configures it as an MSB-first master. The baud rate is the fastest
+  *	   PCLK / 2^n that does not exceed cfg->max_freq, with PCLK read back
+  *	   from the clock tree.
+  * @param SPIx : SPI1, SPI2 or SPI3.
+  * @param cfg : Instance settings.
+  * @retval None
+  */
+void spi_init(SPI_TypeDef *SPIx, const SPI_ConfigTypeDef *cfg);
+
+/**
+  * @brief Works out the frequency of the APB clock feeding SPIx from the
+  *	   SYSCLK mux, the PLL and the AHB / APB prescalers.
+  * @param SPIx : SPI peripheral.
+  * @retval PCLK2 for SPI1, PCLK1 for SPI2 and SPI3 (Hz)
+  */
+uint32_t spi_get_pclk(SPI_TypeDef *SPIx);
+
+/**
+  * @brief Returns the SCK frequency SPIx is set up for.
+  * @param SPIx : SPI peripheral.
+  * @retval SCK (Hz)
+  */
+uint32_t spi_get_freq(SPI_TypeDef *SPIx);
+
+/**
+  * @brief Changes the frame size. Waits for the bus to go idle first because
+  *	   DS may only be changed while the peripheral is disabled.
+  * @param SPIx : SPI peripheral.
+  * @param bits : Frame size (4 - 16 bits).
+  * @retval None
+  */
+void spi_set_data_size(SPI_TypeDef *SPIx, uint8_t bits);
+
+/**
+  * @brief Queues one 8-bit frame without waiting for it to go out.
+  * @param SPIx : SPI peripheral (8-bit frames).
+  * @param data : Byte to send.
+  * @retval None
+  */
+void spi_write8(SPI_TypeDef *SPIx, uint8_t data);
+
+/**
+  * @brief Full-duplex transfer, polled to the end.
+  * @param SPIx : SPI peripheral.
+  * @param tx : Frames to send, or NULL.
+  * @param rx : Where to store the frames received, or NULL.
+  * @param n : Number of frames.
+  * @retval None
+  */
+void spi_transfer(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n);
+
+/**
+  * @brief Starts a full-duplex transfer driven by the SPIx RXNE interrupt.
+  *	   Two frames are kept in flight, so the bus runs without gaps while
+  *	   the RX FIFO can never overrun.
+  * @param SPIx : SPI peripheral.
+  * @param tx : Frames to send, or NULL.
+  * @param rx : Where to store the frames received, or NULL.
+  * @param n : Number of frames (> 0).
+  * @param cb : Called once the last frame has been received, or NULL.
+  * @retval 1 if started, 0 if SPIx is busy with another transfer
+  */
+uint8_t spi_transfer_it(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n,
+			SPI_CallbackTypeDef cb);
+
+/**
+  * @brief Starts a full-duplex transfer run by the instance's DMA channels.
+  *	   When rx is NULL only the TX channel runs and cb is called once the
+  *	   last frame is in the TX FIFO; call spi_wait_idle before deselecting.
+  * @param SPIx : SPI peripheral.
+  * @param tx : Frames to send, or NULL.
+  * @param rx : Where to store the frames received, or NULL.
+  * @param n : Number of frames (1 - DMA_MAX_XFER).
+  * @param cb : Called from the DMA interrupt when done, or NULL.
+  * @retval 1 if started, 0 if SPIx is busy with another transfer
+  */
+uint8_t spi_transfer_dma(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n,
+			 SPI_CallbackTypeDef cb);
+
+/**
+  * @brief Sends the same frame n times by DMA (solid fills). Completes like
+  *	   a transmit-only spi_transfer_dma.
+  * @param SPIx : SPI peripheral.
+  * @param frame : The frame; must stay valid until cb.
+  * @param n : Number of frames (1 - DMA_MAX_XFER).
+  * @param cb : Called from the DMA interrupt when done, or NULL.
+  * @retval 1 if started, 0 if SPIx is busy with another transfer
+  */
+uint8_t spi_repeat_dma(SPI_TypeDef *SPIx, const void *frame, uint16_t n, SPI_CallbackTypeDef cb);
+
+/**
+  * @brief Tells whether an interrupt or DMA transfer is still running.
+  * @param SPIx : SPI peripheral.
+  * @retval 1 if busy, 0 otherwise
+  */
+uint8_t spi_busy(SPI_TypeDef *SPIx);
+
+/**
+  * @brief Waits until every queued frame has left the shifter, then drops
+  *	   whatever transmit-only traffic left in the RX FIFO (and OVR).
+  * @param SPIx : SPI peripheral.
+  * @retval None
+  */
+void spi_wait_idle(SPI_TypeDef *SPIx);
 
 #endif
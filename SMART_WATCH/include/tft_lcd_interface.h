@@ -23,6 +23,14 @@
 \**********************************************************************************/
 typedef struct _LCD_screen LCD_screen;
 
+#define LCD_FRAME_HIST_BINS			8	/*!< Frame times of 0 .. 7+ refreshes */
+
+typedef struct
+{
+	uint32_t frames;			/*!< LCD_begin_frame calls */
+	uint32_t refreshes;			/*!< TE pulses while paced */
+	uint32_t hist[LCD_FRAME_HIST_BINS];	/*!< Frames by refreshes since the previous one */
+} LCD_FrameStatsTypeDef;
 
 /**********************************************************************************\
  *                                                                                *
@@ -60,6 +68,8 @@ void LCD_turn_off(LCD_screen *lcd);
 
 /**
   * @brief Draw a shape on the LCD screen at position (x,y) in Cartesian coordinate system.
+  *	   Pixels of the shape's bounding box that the shape leaves uncovered are
+  *	   painted with the background color (use the compositor to layer shapes).
   * @param lcd : The LCD screen to draw on.
   * @param shape : Pointer to structure representing shape to be drawn on screen.
   * @param x : Horizontal location of shape's center.
@@ -69,7 +79,8 @@ void LCD_turn_off(LCD_screen *lcd);
 void LCD_draw_shape(LCD_screen *lcd, SHAPE_TypeDef *shape, int x, int y);
 
 /**
-  * @brief Sets the background color of an LCD screen.
+  * @brief Sets the background color of an LCD screen (only the clip area is
+  *	   repainted).
   * @param lcd : The LCD whose background color is to be changed.
   * @param color : The color to set the background of the LCD screen to.
   * @retval None
@@ -84,6 +95,80 @@ void LCD_set_background(LCD_screen *lcd, uint32_t color);
   */
 void LCD_set_brightness(LCD_screen *lcd, uint8_t brtnss);
 
+/**
+  * @brief Redraws an area from scratch : the background color last set with
+  *	   LCD_set_background, then each shape in list
+  *	   order. The area is rasterized a strip at a time into one of two
+  *	   LCD_STRIP_PIXELS buffers; each strip is streamed by DMA while the
+  *	   next one is rendered, so no framebuffer is needed.
+  * @param lcd : The LCD screen to draw on.
+  * @param area : Area to redraw (clipped to the clip area).
+  * @param list : Shapes that may touch the area, bottom first.
+  * @param n : Number of entries in list.
+  * @retval None
+  */
+void LCD_render(LCD_screen *lcd, const SHAPE_RectTypeDef *area, const SHAPE_InstanceTypeDef *const *list, uint8_t n);
+
+/**
+  * @brief Restricts LCD_draw_shape and LCD_set_background to a rectangle.
+  * @param lcd : The LCD screen to clip.
+  * @param clip : Area that may be written (NULL for the whole screen).
+  * @retval None
+  */
+void LCD_set_clip(LCD_screen *lcd, const SHAPE_RectTypeDef *clip);
+
+/**
+  * @brief Reads back the clip area (already intersected with the panel).
+  * @param lcd : The LCD screen.
+  * @param clip : Filled in with the clip rectangle.
+  * @retval None
+  */
+void LCD_get_clip(LCD_screen *lcd, SHAPE_RectTypeDef *clip);
+
+/**
+  * @brief Paces drawing to the panel refresh with the controller's tearing
+  *	   effect line (see LCD_begin_frame). Pacing stays off if no TE pulse
+  *	   arrives within LCD_TE_TIMEOUT_MS (TE not wired).
+  * @param lcd : The LCD screen.
+  * @param on : Non-zero to pace.
+  * @retval LCD_set_vsync : 1 if drawing is now paced, 0 otherwise.
+  */
+uint8_t LCD_set_vsync(LCD_screen *lcd, uint8_t on);
+
+/**
+  * @brief Starts a frame. When paced, the frame's first pixel stream waits
+  *	   until the panel starts refreshing line top, so writes from there
+  *	   down trail the scan and no refresh shows a half-written area. The
+  *	   number of refreshes since the previous frame goes in the histogram.
+  * @param lcd : The LCD screen.
+  * @param top : First line the frame writes.
+  * @retval None
+  */
+void LCD_begin_frame(LCD_screen *lcd, int16_t top);
+
+/**
+  * @brief Copies the frame-time histogram.
+  * @param lcd : The LCD screen.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void LCD_get_frame_stats(LCD_screen *lcd, LCD_FrameStatsTypeDef *stats);
+
+/**
+  * @brief Tells whether pixels are still on their way to the LCD. Peripheral
+  *	   clocks must keep running (no Stop mode) until this returns 0.
+  * @param lcd : The LCD screen.
+  * @retval 1 while sending, 0 when the bus is idle
+  */
+uint8_t LCD_busy(LCD_screen *lcd);
+
+/**
+  * @brief Returns the number of bytes sent to the LCD so far (wraps at 2^32).
+  * @param lcd : The LCD screen.
+  * @retval LCD_get_tx_bytes : Byte count.
+  */
+uint32_t LCD_get_tx_bytes(LCD_screen *lcd);
+
 /**********************************************************************************\
  *                                                                                *
  *                                LCD CONSTANTS                                   *
@@ -91,5 +176,7 @@ void LCD_set_brightness(LCD_screen *lcd, uint8_t brtnss);
 \**********************************************************************************/
 #define LCD_MIN_BRIGHTNESS                      ((uint8_t) 0x00)
 #define LCD_MAX_BRIGHTNESS                      ((uint8_t) 0xFF)
+#define LCD_STRIP_PIXELS                        ((uint32_t) 240 * 16)	/*!< One 240x16 strip (7.5 KB) per buffer */
+#define LCD_TE_TIMEOUT_MS                       ((uint32_t) 50U)	/*!< Four refreshes at 79 Hz */
 
 #endif
@@ -0,0 +1,135 @@
+/**********************************************************************************\
+ * @file    SMART_WATCH/include/watch.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    19-July-2017                                                          *
+ * @brief   Event-driven watch runtime : widgets redraw on events, the core       *
+ *          sleeps in between.                                                    *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "./compositor.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                               WATCH CONSTANTS                                  *
+ *                                                                                *
+\**********************************************************************************/
+#define WATCH_EVT_TICK			((uint32_t) 0x00000001)	/*!< Once a second (LPTIM1) */
+#define WATCH_EVT_BUTTON		((uint32_t) 0x00000002)	/*!< User button (PA0) pressed */
+#define WATCH_EVT_USER			((uint32_t) 0x00000100)	/*!< First event left to WATCH_post callers */
+
+#define WATCH_MAX_WIDGETS		8
+#define WATCH_TICKS_PER_SEC		((uint32_t) 32768U)	/*!< LPTIM1 runs from LSE */
+#define WATCH_TICKS_SHIFT		15			/*!< log2(WATCH_TICKS_PER_SEC) */
+#define LPTIM1_CLKSRC_LSE		((uint32_t) 3U << 18)	/*!< RCC_CCIPR LPTIM1SEL = LSE */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                WATCH STRUCTS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct _watch_widget
+{
+	uint32_t events;		/*!< WATCH_EVT_* that can change it */
+
+	/*!< Brings the widget's layers up to date (COMP_move, COMP_invalidate...).
+	     Returns non-zero if it changed anything on screen. */
+	uint8_t (*update)(struct _watch_widget *widget, uint32_t events);
+
+	void *data;			/*!< Owner's state */
+} WATCH_WidgetTypeDef;
+
+typedef struct
+{
+	uint32_t wakeups;		/*!< Sleeps ended by an interrupt */
+	uint32_t stops;			/*!< Of those, sleeps in Stop 2 */
+	uint32_t events;		/*!< Wakeups with something to do */
+	uint32_t frames;		/*!< Events that changed the screen */
+	uint32_t duty_ppm;		/*!< Time awake since the stats were reset (ppm) */
+	uint32_t last_render_us;	/*!< Widget updates + COMP_commit of the latest frame */
+	uint32_t max_render_us;
+	uint32_t last_render_bytes;	/*!< Bytes the latest frame sent to the LCD */
+} WATCH_StatsTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                          WATCH FUNCTION PROTOTYPES                             *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Starts LSE and the 1 s LPTIM1 tick, the user button interrupt and
+  *	   the cycle counter used for the statistics. The compositor must
+  *	   already be set up on lcd.
+  * @param lcd : The LCD screen.
+  * @param cpu_freq : SYSCLK (Hz), to turn cycles into time.
+  * @param clock_restore : Brings SYSCLK back after Stop 2 (the core wakes on
+  *	   HSI16). NULL keeps the runtime to Sleep mode.
+  * @param start_s : Time of day to count from (seconds since midnight).
+  * @retval None
+  */
+void WATCH_init(LCD_screen *lcd, uint32_t cpu_freq, void (*clock_restore)(void), uint32_t start_s);
+
+/**
+  * @brief Registers a widget. Widgets are updated in the order they were
+  *	   added, so later ones can rely on earlier ones.
+  * @param widget : Widget; referenced, not copied.
+  * @retval 0 on success, -1 if WATCH_MAX_WIDGETS are already registered
+  */
+int WATCH_add(WATCH_WidgetTypeDef *widget);
+
+/**
+  * @brief Raises events. Safe from interrupt handlers; events raised before
+  *	   the runtime gets to them are merged.
+  * @param events : WATCH_EVT_* bits.
+  * @retval None
+  */
+void WATCH_post(uint32_t events);
+
+/**
+  * @brief Returns the whole seconds elapsed since WATCH_init.
+  * @param None
+  * @retval Seconds
+  */
+uint32_t WATCH_seconds(void);
+
+/**
+  * @brief Returns the time of day : start_s plus the seconds since WATCH_init.
+  * @param None
+  * @retval Seconds since midnight (0 - 86399)
+  */
+uint32_t WATCH_time_of_day(void);
+
+/**
+  * @brief Runs the watch : sleeps until events are pending, lets the widgets
+  *	   that listen for them update, and commits one frame if any of them
+  *	   changed the screen. Sleeps in Stop 2 when the LCD is idle and a
+  *	   clock_restore was given, in Sleep otherwise. Never returns.
+  * @param None
+  * @retval None
+  */
+void WATCH_run(void);
+
+/**
+  * @brief Copies the counters, with the duty cycle worked out up to now.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void WATCH_get_stats(WATCH_StatsTypeDef *stats);
+
+/**
+  * @brief Zeroes the counters and restarts the duty cycle window.
+  * @param None
+  * @retval None
+  */
+void WATCH_reset_stats(void);
+
+#endif
@@ -0,0 +1,315 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/compositor.c                                         *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    07-July-2017                                                         *
+ * @brief   Dirty-rectangle compositor.	     	                                 *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/compositor.h"
+#include <stddef.h>
+
+/*
+ * Layer changes are only recorded between commits. COMP_commit turns each
+ * changed layer into two dirty rectangles (where it was drawn last time and
+ * where it is now), merges them and renders each merged window once. A
+ * second hand that moves every tick therefore costs its old and new bounding
+ * boxes instead of the 153,600-byte full frame.
+ */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE TYPES                                     *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	SHAPE_InstanceTypeDef inst;
+	SHAPE_RectTypeDef drawn;	// Area covered at the last commit
+	uint8_t used;
+	uint8_t visible;
+	uint8_t on_screen;		// drawn is valid
+	uint8_t changed;
+} COMP_LayerTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE FUNCTIONS                                 *
+ *                                                                                *
+\**********************************************************************************/
+static void comp_mark(SHAPE_RectTypeDef r);
+static void comp_drop(uint8_t i);
+static uint32_t comp_area(const SHAPE_RectTypeDef *r);
+static void comp_union(const SHAPE_RectTypeDef *a, const SHAPE_RectTypeDef *b, SHAPE_RectTypeDef *out);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE VARS                                      *
+ *                                                                                *
+\**********************************************************************************/
+static LCD_screen *comp_lcd;
+static SHAPE_RectTypeDef comp_screen;
+
+static COMP_LayerTypeDef layers[COMP_MAX_LAYERS];
+static SHAPE_RectTypeDef dirty[COMP_MAX_DIRTY];
+static uint8_t ndirty;
+
+static COMP_StatsTypeDef comp_stats;
+
+/* Public functions --------------------------------------------------------------*/
+
+void COMP_init(LCD_screen *lcd, uint32_t background)
+{
+	uint8_t i;
+
+	comp_lcd = lcd;
+	for (i = 0; i < COMP_MAX_LAYERS; i++)
+		layers[i].used = 0;
+
+	/* The panel size is whatever an unrestricted clip covers */
+	LCD_set_clip(lcd, NULL);
+	LCD_get_clip(lcd, &comp_screen);
+
+	COMP_set_background(background);
+}
+
+void COMP_set_background(uint32_t background)
+{
+	uint8_t i;
+
+	/* A plain DMA fill beats rendering the whole screen in strips */
+	ndirty = 0;
+	LCD_set_background(comp_lcd, background);
+
+	for (i = 0; i < COMP_MAX_LAYERS; i++) {
+		if (layers[i].used && layers[i].on_screen) {
+			layers[i].on_screen = 0;	// Already covered by the fill
+			layers[i].changed = 1;
+		}
+	}
+}
+
+int COMP_add(SHAPE_TypeDef *shape, int x, int y)
+{
+	int id;
+
+	for (id = 0; id < COMP_MAX_LAYERS; id++) {
+		if (!layers[id].used)
+			break;
+	}
+	if (id == COMP_MAX_LAYERS)
+		return -1;
+
+	layers[id].inst.shape = shape;
+	layers[id].inst.x = x;
+	layers[id].inst.y = y;
+	layers[id].used = 1;
+	layers[id].visible = 1;
+	layers[id].on_screen = 0;
+	layers[id].changed = 1;
+
+	return id;
+}
+
+void COMP_remove(int id)
+{
+	if (layers[id].on_screen)
+		comp_mark(layers[id].drawn);
+	layers[id].used = 0;
+}
+
+void COMP_move(int id, int x, int y)
+{
+	if (layers[id].inst.x == x && layers[id].inst.y == y)
+		return;
+
+	layers[id].inst.x = x;
+	layers[id].inst.y = y;
+	layers[id].changed = 1;
+}
+
+void COMP_set_visible(int id, uint8_t visible)
+{
+	visible = (visible != 0);
+	if (layers[id].visible == visible)
+		return;
+
+	layers[id].visible = visible;
+	layers[id].changed = 1;
+}
+
+void COMP_invalidate(int id)
+{
+	layers[id].changed = 1;
+}
+
+void COMP_invalidate_rect(const SHAPE_RectTypeDef *r)
+{
+	comp_mark(*r);
+}
+
+uint32_t COMP_commit(void)
+{
+	const SHAPE_InstanceTypeDef *list[COMP_MAX_LAYERS];
+	SHAPE_RectTypeDef r;
+	uint32_t start, pixels = 0;
+	uint8_t i, d, n;
+
+	/* Old and new footprint of every changed layer */
+	for (i = 0; i < COMP_MAX_LAYERS; i++) {
+		if (!layers[i].used || !layers[i].changed)
+			continue;
+
+		if (layers[i].on_screen)
+			comp_mark(layers[i].drawn);
+
+		SHAPE_get_bounds(layers[i].inst.shape, layers[i].inst.x, layers[i].inst.y, &r);
+		layers[i].drawn = r;
+		layers[i].on_screen = layers[i].visible;
+		layers[i].changed = 0;
+
+		if (layers[i].visible)
+			comp_mark(r);
+	}
+
+	if (ndirty == 0)
+		return 0;
+
+	start = LCD_get_tx_bytes(comp_lcd);
+
+	/* Top to bottom, so a paced frame's later windows trail the scan too */
+	for (d = 1; d < ndirty; d++) {
+		r = dirty[d];
+		for (i = d; i > 0 && dirty[i - 1].y0 > r.y0; i--)
+			dirty[i] = dirty[i - 1];
+		dirty[i] = r;
+	}
+	LCD_begin_frame(comp_lcd, dirty[0].y0);
+
+	/* Each window is rendered in strips and sent once, with no overdraw */
+	for (d = 0; d < ndirty; d++) {
+		n = 0;
+		for (i = 0; i < COMP_MAX_LAYERS; i++) {
+			if (layers[i].used && layers[i].on_screen &&
+			    SHAPE_rect_intersect(&layers[i].drawn, &dirty[d], &r))
+				list[n++] = &layers[i].inst;
+		}
+
+		LCD_render(comp_lcd, &dirty[d], list, n);
+		pixels += comp_area(&dirty[d]);
+	}
+
+	comp_stats.frames++;
+	comp_stats.rects = ndirty;
+	comp_stats.pixels = pixels;
+	comp_stats.bytes = LCD_get_tx_bytes(comp_lcd) - start;
+	if (comp_stats.bytes > comp_stats.max_bytes)
+		comp_stats.max_bytes = comp_stats.bytes;
+
+	ndirty = 0;
+
+	return comp_stats.bytes;
+}
+
+void COMP_get_stats(COMP_StatsTypeDef *stats)
+{
+	*stats = comp_stats;
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Adds a rectangle to the dirty list. Rectangles that overlap it, or
+  *	   whose union costs no more than COMP_MERGE_SLACK extra pixels, are
+  *	   folded in. When the list is full the cheapest union is taken.
+  * @param r : Inclusive rectangle (clipped to the screen here).
+  * @retval None
+  */
+static void comp_mark(SHAPE_RectTypeDef r)
+{
+	SHAPE_RectTypeDef u, o;
+	uint32_t cost, best_cost;
+	uint8_t i, best;
+
+	if (!SHAPE_rect_intersect(&r, &comp_screen, &r))
+		return;
+
+	i = 0;
+	while (i < ndirty) {
+		comp_union(&r, &dirty[i], &u);
+		if (SHAPE_rect_intersect(&r, &dirty[i], &o) ||
+		    comp_area(&u) <= comp_area(&r) + comp_area(&dirty[i]) + COMP_MERGE_SLACK) {
+			r = u;
+			comp_drop(i);
+			i = 0;	// The grown rectangle may now reach earlier ones
+		} else {
+			i++;
+		}
+	}
+
+	if (ndirty == COMP_MAX_DIRTY) {
+		best = 0;
+		best_cost = 0xFFFFFFFF;
+		for (i = 0; i < ndirty; i++) {
+			comp_union(&r, &dirty[i], &u);
+			cost = comp_area(&u) - comp_area(&dirty[i]);
+			if (cost < best_cost) {
+				best_cost = cost;
+				best = i;
+			}
+		}
+		comp_union(&r, &dirty[best], &r);
+		comp_drop(best);
+
+		/* Re-run the merge pass for the grown rectangle */
+		comp_mark(r);
+		return;
+	}
+
+	dirty[ndirty++] = r;
+}
+
+/**
+  * @brief Removes entry i from the dirty list (order does not matter).
+  * @param i : Index to remove.
+  * @retval None
+  */
+static void comp_drop(uint8_t i)
+{
+	dirty[i] = dirty[--ndirty];
+}
+
+/**
+  * @brief Number of pixels in an inclusive rectangle.
+  * @param r : Rectangle.
+  * @retval Pixel count
+  */
+static uint32_t comp_area(const SHAPE_RectTypeDef *r)
+{
+	return (uint32_t) (r->x1 - r->x0 + 1) * (uint32_t) (r->y1 - r->y0 + 1);
+}
+
+/**
+  * @brief Smallest rectangle containing both a and b.
+  * @param a : First rectangle.
+  * @param b : Second rectangle.
+  * @param out : Filled in with the union (may alias a or b).
+  * @retval None
+  */
+static void comp_union(const SHAPE_RectTypeDef *a, const SHAPE_RectTypeDef *b, SHAPE_RectTypeDef *out)
+{
+	SHAPE_RectTypeDef u;
+
+	u.x0 = (a->x0 < b->x0) ? a->x0 : b->x0;
+	u.y0 = (a->y0 < b->y0) ? a->y0 : b->y0;
+	u.x1 = (a->x1 > b->x1) ? a->x1 : b->x1;
+	u.y1 = (a->y1 > b->y1) ? a->y1 : b->y1;
+	*out = u;
+}
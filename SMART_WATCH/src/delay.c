@@ -0,0 +1,99 @@
+ /**********************************************************************************
+  * @file    SMART_WATCH/src/delay.c						   *
+  * @author  Nolan R. H. Gagnon 	      					   *
+  * @version V1.0								   *
+  * @date    24-June-2017							   *
+  * @brief   Library to provide accurate delays using SysTick.			   *
+  *										   *
+  **********************************************************************************
+  * @attention									   *
+  *										   *
+  * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>	   *
+  *										   *
+  **********************************************************************************
+  */
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/delay.h"
+
+/* Private volatile variables ----------------------------------------------------*/
+static volatile uint32_t timing_delay;
+
+/**
+  * @brief Delays the system for a number of milliseconds. The core sleeps
+  *	   in WFI between SysTick interrupts instead of spinning. Interrupts
+  *	   are masked around the test so the last tick cannot slip in between
+  *	   it and the WFI; PRIMASK is left as the caller had it.
+  * @param time_ms : Number of milliseconds to delay for.
+  * @retval None
+  */
+void delay(uint32_t time_ms)
+{
+        uint32_t primask = __get_PRIMASK();
+
+        timing_delay = time_ms;
+
+        __disable_irq();
+        while (timing_delay != 0) {
+                __WFI();
+                __set_PRIMASK(primask);
+                __disable_irq();
+        }
+        __set_PRIMASK(primask);
+}
+
+/**
+  * @brief Initialize SysTick for providing delays.
+  * @param ticks : Number of clock pulses needed for 
+  *		   the counter to reach zero.
+  * @retval None
+  */
+void systick_init(uint32_t ticks)
+{
+        // Disable SysTick IRQ and SysTick Counter
+        SysTick->CTRL = 0;
+
+        // Set reload register
+        SysTick->LOAD = ticks - 1;
+
+        // Set priority
+        NVIC_SetPriority(SysTick_IRQn, 2);
+
+        // Reset the SysTick counter value
+        SysTick->VAL = 0;
+
+        // Select processor clock
+        // 1 = processor clock; 0 = external clock
+         SysTick->CTRL |= SysTick_CTRL_CLKSOURCE;
+
+        // Enable SysTick IRQ and SysTick timer
+        SysTick->CTRL |= SysTick_CTRL_ENABLE;
+
+        //Enable SysTick exception request
+        // 1 = counting down to zero asserts the SysTick exception request
+        // 0 = counting down to zero does not assert the SysTick exception request
+        SysTick->CTRL |= SysTick_CTRL_TICKINT;
+}
+
+/**
+  * @brief Turns off SysTick timer.
+  * @param None
+  * @retval None
+  */
+void systick_deinit(void)
+{
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE;
+	SysTick->CTRL &= ~SysTick_CTRL_TICKINT;	
+}
+
+/**
+  * @brief Decreases the delay counter every time the SysTick counter
+  *	   reaches zero.
+  * @param None
+  * @retval None
+  */
+void SysTick_Handler(void)
+{
+        if (timing_delay > 0)
+                timing_delay--;
+}
@@ -0,0 +1,168 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/dma.c                                                *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    06-July-2017                                                         *
+ * @brief   DMA driver.		     	                                         *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/dma.h"
+#include <stddef.h>
+
+/* Private types -----------------------------------------------------------------*/
+typedef struct
+{
+	DMA_TypeDef *dma;
+	DMA_request_TypeDef *cselr;
+	DMA_Channel_TypeDef *rx, *tx;
+	uint8_t rx_ch, tx_ch;		// Channel numbers (flag and CxS positions)
+	uint8_t req;			// CxS value selecting the SPI
+	IRQn_Type rx_irq, tx_irq;
+} DMA_SpiMapTypeDef;
+
+static const DMA_SpiMapTypeDef spi_map[3] = {
+	{DMA1, DMA1_CSELR, DMA1_Channel2, DMA1_Channel3, 2, 3, DMA1_REQ_SPI,
+	 DMA1_Channel2_IRQn, DMA1_Channel3_IRQn},
+	{DMA1, DMA1_CSELR, DMA1_Channel4, DMA1_Channel5, 4, 5, DMA1_REQ_SPI,
+	 DMA1_Channel4_IRQn, DMA1_Channel5_IRQn},
+	{DMA2, DMA2_CSELR, DMA2_Channel1, DMA2_Channel2, 1, 2, DMA2_REQ_SPI3,
+	 DMA2_Channel1_IRQn, DMA2_Channel2_IRQn},
+};
+
+/* Private functions -------------------------------------------------------------*/
+static const DMA_SpiMapTypeDef *dma_spi_map(SPI_TypeDef *SPIx);
+static void dma_channel_init(const DMA_SpiMapTypeDef *m, DMA_Channel_TypeDef *ch, uint8_t n,
+			     SPI_TypeDef *SPIx);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void dma_spi_init(SPI_TypeDef *SPIx)
+{
+	const DMA_SpiMapTypeDef *m = dma_spi_map(SPIx);
+
+	if (m == NULL)
+		return;
+
+	/* Clock the DMA controller */
+	if (m->dma == DMA1)
+		RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	else
+		RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+
+	dma_channel_init(m, m->rx, m->rx_ch, SPIx);
+	m->rx->CCR &= ~DMA_CCR_DIR;  // Peripheral to memory
+	dma_channel_init(m, m->tx, m->tx_ch, SPIx);
+	m->tx->CCR |= DMA_CCR_DIR;  // Memory to peripheral
+
+	/* Only the channel that finishes a transfer has TCIE set (dma_spi_start) */
+	NVIC_SetPriority(m->rx_irq, 1);
+	NVIC_EnableIRQ(m->rx_irq);
+	NVIC_SetPriority(m->tx_irq, 1);
+	NVIC_EnableIRQ(m->tx_irq);
+}
+
+void dma_spi_start(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t count, uint8_t minc)
+{
+	const DMA_SpiMapTypeDef *m = dma_spi_map(SPIx);
+	uint32_t size;
+
+	if (m == NULL)
+		return;
+
+	m->rx->CCR &= ~DMA_CCR_EN;
+	m->tx->CCR &= ~DMA_CCR_EN;
+	m->dma->IFCR = (DMA_IFCR_CGIF1 << (4 * (m->rx_ch - 1))) |
+		       (DMA_IFCR_CGIF1 << (4 * (m->tx_ch - 1)));
+
+	/* Frames above 8 bits move as half-words, the rest as bytes */
+	size = (((SPIx->CR2 & SPI_CR2_DS) >> 8) >= 8) ? (DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0) : 0;
+
+	m->tx->CCR &= ~(DMA_CCR_PSIZE | DMA_CCR_MSIZE | DMA_CCR_MINC | DMA_CCR_TCIE);
+	m->tx->CCR |= size;
+	if (minc)
+		m->tx->CCR |= DMA_CCR_MINC;
+	m->tx->CMAR = (uint32_t) tx;
+	m->tx->CNDTR = count;
+
+	if (rx != NULL) {
+		/* The last frame is in when RX is done, so RX ends the transfer */
+		m->rx->CCR &= ~(DMA_CCR_PSIZE | DMA_CCR_MSIZE);
+		m->rx->CCR |= size | DMA_CCR_MINC | DMA_CCR_TCIE;
+		m->rx->CMAR = (uint32_t) rx;
+		m->rx->CNDTR = count;
+		m->rx->CCR |= DMA_CCR_EN;
+	} else {
+		m->tx->CCR |= DMA_CCR_TCIE;
+	}
+
+	m->tx->CCR |= DMA_CCR_EN;
+}
+
+uint8_t dma_spi_complete(SPI_TypeDef *SPIx)
+{
+	const DMA_SpiMapTypeDef *m = dma_spi_map(SPIx);
+	uint8_t ch;
+
+	if (m == NULL)
+		return 0;
+
+	ch = (m->rx->CCR & DMA_CCR_TCIE) ? m->rx_ch : m->tx_ch;
+	if (!(m->dma->ISR & (DMA_ISR_TCIF1 << (4 * (ch - 1)))))
+		return 0;
+
+	m->dma->IFCR = DMA_IFCR_CGIF1 << (4 * (ch - 1));
+	m->rx->CCR &= ~(DMA_CCR_EN | DMA_CCR_TCIE);
+	m->tx->CCR &= ~(DMA_CCR_EN | DMA_CCR_TCIE);
+
+	return 1;
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Looks up the channels serving SPIx.
+  * @param SPIx : SPI peripheral.
+  * @retval The channel map, or NULL for anything but SPI1 - SPI3
+  */
+static const DMA_SpiMapTypeDef *dma_spi_map(SPI_TypeDef *SPIx)
+{
+	if (SPIx == SPI1)
+		return &spi_map[0];
+	if (SPIx == SPI2)
+		return &spi_map[1];
+	if (SPIx == SPI3)
+		return &spi_map[2];
+	return NULL;
+}
+
+/**
+  * @brief Common channel setup : request mapping, SPIx->DR as the fixed
+  *	   peripheral address, one-shot, high priority.
+  * @param m : Channel map of SPIx.
+  * @param ch : Channel to set up.
+  * @param n : Its number.
+  * @param SPIx : SPI peripheral.
+  * @retval None
+  */
+static void dma_channel_init(const DMA_SpiMapTypeDef *m, DMA_Channel_TypeDef *ch, uint8_t n,
+			     SPI_TypeDef *SPIx)
+{
+	/* Disable the channel before changing settings */
+	ch->CCR &= ~DMA_CCR_EN;
+
+	m->cselr->CSELR &= ~(DMA_CSELR_C1S << (4 * (n - 1)));  // Clear channel selection bit field
+	m->cselr->CSELR |= (uint32_t) m->req << (4 * (n - 1));  // Map the channel on SPIx
+	ch->CPAR = (uint32_t) &(SPIx->DR);
+
+	ch->CCR &= ~DMA_CCR_PINC;  // Peripheral address not auto-incremented
+	ch->CCR &= ~DMA_CCR_CIRC;  // One-shot transfers
+	ch->CCR &= ~DMA_CCR_PL;
+	ch->CCR |= DMA_CCR_PL_1;  // High transfer priority
+}
@@ -0,0 +1,395 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/ili9340c.c                                           *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    06-July-2017                                                         *
+ * @brief   ILI9340C driver : 4-wire SPI with DMA-fed pixel streaming.           *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/ili9340c.h"
+#include "../include/spi.h"
+#include "../include/dma.h"
+#include "../include/delay.h"
+#include <stddef.h>
+
+/*
+ * SCK : the datasheet's serial write cycle (t_scycw) is 100 ns, so writes run
+ * at 10 MHz (SYSCLK / 8) and a full 240x320x16 bpp frame takes ~123 ms.
+ * Building with ILI9340C_SPI_FAST ('make fast_spi') doubles that to 20 MHz
+ * (SYSCLK / 4, ~61 ms a frame) : past the datasheet, so only for a panel it
+ * has been checked on. Nothing here reads back from the controller.
+ */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE FUNCTIONS                                 *
+ *                                                                                *
+\**********************************************************************************/
+static void ili9340c_pins_init(void);
+static void ili9340c_te_init(void);
+static void ili9340c_cmd(uint8_t cmd, const uint8_t *params, uint8_t nparams);
+static void ili9340c_stream(const uint16_t *src, uint32_t npixels, uint8_t minc);
+static void ili9340c_next_chunk(void);
+static void ili9340c_chunk_done(void);
+static void ili9340c_idle(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE VARS                                      *
+ *                                                                                *
+\**********************************************************************************/
+
+/* { cmd, nparams, params... } ; a zero command ends the table */
+static const uint8_t init_seq[] = {
+	ILI9340C_SET_PWRCTL1,    1, 0x23,		// GVDD = 4.60 V
+	ILI9340C_SET_PWRCTL2,    1, 0x10,		// Step-up factor
+	ILI9340C_SET_VCOMCTL1,   2, 0x3E, 0x28,		// VCOMH = 4.25 V, VCOML = -1.5 V
+	ILI9340C_SET_VCOMCTL2,   1, 0x86,		// VCOM offset
+	ILI9340C_SET_MADCTL,     1, ILI9340C_MADCTL_MX | ILI9340C_MADCTL_BGR,
+	ILI9340C_SET_PIXFMT,     1, ILI9340C_PIXFMT_16BPP,
+	ILI9340C_SET_FRMRTN,     2, 0x00, 0x18,		// f_osc, 79 Hz
+	ILI9340C_SET_DISPFUNC,   3, 0x08, 0x82, 0x27,	// 320 lines
+	ILI9340C_SET_GAMMA,      1, 0x01,		// Gamma curve 1
+	ILI9340C_SET_POSGAMCORR, 15, 0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1,
+				     0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00,
+	ILI9340C_SET_NEGGAMCORR, 15, 0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1,
+				     0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F,
+	ILI9340C_SET_CTLDISP,    1, ILI9340C_CTLDISP_BL_ON,
+	ILI9340C_NOP
+};
+
+/* Mode 0, MSB first; commands go out as bytes, pixels as 16-bit frames */
+static const SPI_ConfigTypeDef spi_cfg = {ILI9340C_SPI_MAX_FREQ, SPI_MODE_0, 8};
+
+/* Pixel stream in progress (split into DMA_MAX_XFER chunks) */
+static const uint16_t *xfer_src;
+static volatile uint32_t xfer_left;
+static volatile uint8_t xfer_busy;
+static uint8_t xfer_minc;
+static uint8_t selected;
+static uint16_t fill_color;
+static uint32_t tx_bytes;
+
+/* Tearing effect pacing */
+static volatile uint8_t te_armed;	// The next stream waits for TE
+static volatile uint8_t te_held;	// A stream is waiting for TE
+static volatile uint32_t te_count;
+
+/* Public functions --------------------------------------------------------------*/
+
+void ILI9340C_init(void)
+{
+	const uint8_t *p = init_seq;
+
+	ili9340c_pins_init();
+	ili9340c_te_init();
+	spi_init(SPI1, &spi_cfg);
+
+	/* Hardware reset : >= 10 us low, then up to 120 ms before commands */
+	GPIOE->BSRR = 1U << (ILI9340C_RST_PIN + 16);
+	delay(1);
+	GPIOE->BSRR = 1U << ILI9340C_RST_PIN;
+	delay(120);
+
+	while (p[0] != ILI9340C_NOP) {
+		ILI9340C_write_cmd(p[0], &p[2], p[1]);
+		p += 2 + p[1];
+	}
+
+	/* Sleep out needs 120 ms before DISP_ON / another SLEEP */
+	ILI9340C_write_cmd(ILI9340C_WAKEUP, NULL, 0);
+	delay(120);
+}
+
+void ILI9340C_write_cmd(uint8_t cmd, const uint8_t *params, uint8_t nparams)
+{
+	ili9340c_cmd(cmd, params, nparams);
+	ILI9340C_wait();
+}
+
+void ILI9340C_set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+	uint8_t caddr[4] = {x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF};
+	uint8_t paddr[4] = {y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF};
+
+	ili9340c_cmd(ILI9340C_SET_CADDR, caddr, 4);
+	ili9340c_cmd(ILI9340C_SET_PADDR, paddr, 4);
+	ili9340c_cmd(ILI9340C_RAMWRITE, NULL, 0);
+}
+
+void ILI9340C_set_scroll_area(uint16_t tfa, uint16_t vsa, uint16_t bfa)
+{
+	uint8_t p[6] = {tfa >> 8, tfa & 0xFF, vsa >> 8, vsa & 0xFF, bfa >> 8, bfa & 0xFF};
+
+	ILI9340C_write_cmd(ILI9340C_SET_VSAREA, p, 6);
+}
+
+void ILI9340C_scroll_to(uint16_t vsp)
+{
+	uint8_t p[2] = {vsp >> 8, vsp & 0xFF};
+
+	ILI9340C_write_cmd(ILI9340C_SET_VSSADDR, p, 2);
+}
+
+void ILI9340C_te_enable(uint8_t on)
+{
+	uint8_t mode = ILI9340C_TEAR_VBLANK;
+
+	if (on) {
+		ILI9340C_write_cmd(ILI9340C_TEAR_ON, &mode, 1);
+		EXTI->PR1 = EXTI_PR1_PIF9;
+		EXTI->IMR1 |= EXTI_IMR1_IM9;
+		return;
+	}
+
+	EXTI->IMR1 &= ~EXTI_IMR1_IM9;
+	te_armed = 0;
+	if (te_held) {
+		te_held = 0;
+		ili9340c_next_chunk();
+	}
+	ILI9340C_write_cmd(ILI9340C_TEAR_OFF, NULL, 0);
+}
+
+void ILI9340C_set_tear_line(uint16_t line)
+{
+	uint8_t p[2] = {line >> 8, line & 0xFF};
+
+	ILI9340C_write_cmd(ILI9340C_SET_TEARLN, p, 2);
+}
+
+void ILI9340C_arm_te(void)
+{
+	te_armed = 1;
+}
+
+uint32_t ILI9340C_get_te_count(void)
+{
+	return te_count;
+}
+
+void ILI9340C_fill(uint16_t color, uint32_t npixels)
+{
+	fill_color = color;
+	ili9340c_stream(&fill_color, npixels, 0);
+}
+
+void ILI9340C_write_pixels(const uint16_t *pixels, uint32_t npixels)
+{
+	ili9340c_stream(pixels, npixels, 1);
+}
+
+uint8_t ILI9340C_busy(void)
+{
+	/* DMA completes with the tail of the stream still in the TX FIFO */
+	return xfer_busy || (SPI1->SR & SPI_SR_BSY) != 0;
+}
+
+void ILI9340C_wait(void)
+{
+	ili9340c_idle();
+
+	if (selected) {
+		spi_wait_idle(SPI1);
+		GPIOE->BSRR = 1U << ILI9340C_CS_PIN;
+		selected = 0;
+	}
+}
+
+uint32_t ILI9340C_get_tx_bytes(void)
+{
+	return tx_bytes;
+}
+
+/**
+  * @brief Counts refreshes and starts a stream held by ILI9340C_arm_te. Runs
+  *	   at the DMA interrupt's priority so the two never nest.
+  * @param None
+  * @retval None
+  */
+void EXTI9_5_IRQHandler(void)
+{
+	if (EXTI->PR1 & EXTI_PR1_PIF9) {
+		EXTI->PR1 = EXTI_PR1_PIF9;
+		te_count++;
+
+		if (te_held) {
+			te_held = 0;
+			ili9340c_next_chunk();
+		}
+	}
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Configures the control pins :
+  *
+  *	   (*) PE10 = D/C
+  *	   (*) PE11 = RESET
+  *
+  *	   PE12 (chip select) is set up by spi_init.
+  * @param None
+  * @retval None
+  */
+static void ili9340c_pins_init(void)
+{
+	RCC->AHB2ENR |= RCC_AHB2ENR_GPIOEEN;
+
+	GPIOE->BSRR = (1U << ILI9340C_DC_PIN) | (1U << ILI9340C_RST_PIN);
+
+	GPIOE->MODER &= ~(GPIO_MODER_MODER10 | GPIO_MODER_MODER11);
+	GPIOE->MODER |= GPIO_MODER_MODER10_0 | GPIO_MODER_MODER11_0;  // General purpose output mode
+	GPIOE->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR10;  // D/C switches between SPI frames
+}
+
+/**
+  * @brief Routes PE9 (TE, input) to EXTI9 on the rising edge, left masked
+  *	   until ILI9340C_te_enable.
+  * @param None
+  * @retval None
+  */
+static void ili9340c_te_init(void)
+{
+	RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+	GPIOE->MODER &= ~GPIO_MODER_MODER9;  // Input mode
+	GPIOE->PUPDR &= ~GPIO_PUPDR_PUPDR9;
+
+	SYSCFG->EXTICR[2] &= ~SYSCFG_EXTICR3_EXTI9;
+	SYSCFG->EXTICR[2] |= SYSCFG_EXTICR3_EXTI9_PE;
+	EXTI->RTSR1 |= EXTI_RTSR1_RT9;
+	EXTI->FTSR1 &= ~EXTI_FTSR1_FT9;
+	EXTI->IMR1 &= ~EXTI_IMR1_IM9;
+
+	NVIC_SetPriority(EXTI9_5_IRQn, 1);
+	NVIC_EnableIRQ(EXTI9_5_IRQn);
+}
+
+/**
+  * @brief Sends a command and its parameters, leaving the controller selected
+  *	   with D/C high so pixel data can follow.
+  * @param cmd : Command byte.
+  * @param params : Parameter bytes.
+  * @param nparams : Number of parameter bytes.
+  * @retval None
+  */
+static void ili9340c_cmd(uint8_t cmd, const uint8_t *params, uint8_t nparams)
+{
+	ili9340c_idle();
+
+	if (selected)
+		spi_wait_idle(SPI1);
+	spi_set_data_size(SPI1, 8);
+
+	GPIOE->BSRR = 1U << (ILI9340C_CS_PIN + 16);
+	selected = 1;
+
+	/* D/C is sampled on the last bit of each byte, so only switch when idle */
+	GPIOE->BSRR = 1U << (ILI9340C_DC_PIN + 16);
+	spi_write8(SPI1, cmd);
+	spi_wait_idle(SPI1);
+	GPIOE->BSRR = 1U << ILI9340C_DC_PIN;
+
+	tx_bytes += 1 + nparams;
+	while (nparams-- > 0)
+		spi_write8(SPI1, *params++);
+}
+
+/**
+  * @brief Hands a pixel stream to SPI1's TX DMA in 16-bit frames.
+  * @param src : Pixels (or the single fill color).
+  * @param npixels : Number of pixels to send.
+  * @param minc : Non-zero to advance through src.
+  * @retval None
+  */
+static void ili9340c_stream(const uint16_t *src, uint32_t npixels, uint8_t minc)
+{
+	if (npixels == 0)
+		return;
+
+	/* Back-to-back streams into the same window */
+	ili9340c_idle();
+
+	/* RGB565 goes out MSB first, which is what a 16-bit frame does */
+	spi_set_data_size(SPI1, 16);
+
+	tx_bytes += 2 * npixels;
+	xfer_src = src;
+	xfer_left = npixels;
+	xfer_minc = minc;
+	xfer_busy = 1;
+
+	/* Held streams are started by EXTI9_5_IRQHandler */
+	if (te_armed) {
+		te_armed = 0;
+		te_held = 1;
+		return;
+	}
+
+	ili9340c_next_chunk();
+}
+
+/**
+  * @brief Starts the next (at most DMA_MAX_XFER pixel) chunk.
+  * @param None
+  * @retval None
+  */
+static void ili9340c_next_chunk(void)
+{
+	const uint16_t *src = xfer_src;
+	uint16_t n = (xfer_left > DMA_MAX_XFER) ? DMA_MAX_XFER : xfer_left;
+
+	/* Book-keep before starting : the completion IRQ chains from these */
+	xfer_left -= n;
+	if (xfer_minc)
+		xfer_src += n;
+
+	if (xfer_minc)
+		spi_transfer_dma(SPI1, src, NULL, n, ili9340c_chunk_done);
+	else
+		spi_repeat_dma(SPI1, src, n, ili9340c_chunk_done);
+}
+
+/**
+  * @brief DMA completion : chains the next chunk of a long pixel stream, or
+  *	   marks it done.
+  * @param None
+  * @retval None
+  */
+static void ili9340c_chunk_done(void)
+{
+	if (xfer_left > 0)
+		ili9340c_next_chunk();
+	else
+		xfer_busy = 0;
+}
+
+/**
+  * @brief Sleeps until the current pixel stream is done. A stream held for
+  *	   TE can take a whole refresh to start, so the core waits in WFI
+  *	   rather than spinning. Interrupts are masked around the test so the
+  *	   completion cannot slip in between it and the WFI (a pending
+  *	   interrupt still ends WFI while masked).
+  * @param None
+  * @retval None
+  */
+static void ili9340c_idle(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	while (xfer_busy) {
+		__WFI();
+		__set_PRIMASK(primask);
+		__disable_irq();
+	}
+	__set_PRIMASK(primask);
+}
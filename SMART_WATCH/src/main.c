@@ -1,6 +1,194 @@
-#include "../include/spi.h"
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/main.c                                               *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    06-July-2017                                                         *
+ * @brief   Smart watch main program.                                            *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/tft_lcd_interface.h"
+#include "../include/compositor.h"
+#include "../include/watch.h"
+#include "../include/delay.h"
+
+/* Private constants -------------------------------------------------------------*/
+#define SYSCLK_FREQ		((uint32_t) 80000000U)
+#define FACE_X			120
+#define FACE_Y			160
+#define FACE_START_S		((uint32_t) (10 * 3600 + 9 * 60 + 30))	// Demo : 10:09:30 until an RTC sets the time
+
+/* Private functions -------------------------------------------------------------*/
+static void sysclk_init(void);
+static uint8_t face_hands_update(WATCH_WidgetTypeDef *w, uint32_t events);
+static uint8_t face_seconds_update(WATCH_WidgetTypeDef *w, uint32_t events);
+static uint8_t face_stats_update(WATCH_WidgetTypeDef *w, uint32_t events);
+
+/* Private variables -------------------------------------------------------------*/
+static SHAPE_TypeDef dial = {.type = SHAPE_CIRCLE, .color = 0xC0C0C0, .radius = 100,
+			     .stroke = 4, .flags = SHAPE_FLAG_AA};
+static SHAPE_TypeDef hour_hand = {.type = SHAPE_LINE, .color = 0xFFFFFF, .stroke = 5};
+static SHAPE_TypeDef minute_hand = {.type = SHAPE_LINE, .color = 0xFFFFFF, .stroke = 3};
+static SHAPE_TypeDef second_hand = {.type = SHAPE_LINE, .color = 0xFF0000, .stroke = 1,
+				    .flags = SHAPE_FLAG_AA};
+static SHAPE_TypeDef cap = {.type = SHAPE_CIRCLE, .color = 0xFF0000, .radius = 5,
+			    .flags = SHAPE_FLAG_AA};
+
+static int hour_id, minute_id, second_id;
+static uint32_t shown_minute = 0xFFFFFFFF;
+static uint8_t seconds_on = 1;
+
+/* Duty cycle and render cost, refreshed every tick for the debugger */
+static volatile WATCH_StatsTypeDef stats;
+
+static WATCH_WidgetTypeDef hands = {WATCH_EVT_TICK, face_hands_update, NULL};
+static WATCH_WidgetTypeDef seconds = {WATCH_EVT_TICK | WATCH_EVT_BUTTON, face_seconds_update, NULL};
+static WATCH_WidgetTypeDef stats_widget = {WATCH_EVT_TICK, face_stats_update, NULL};
 
 void main(void)
 {
+	LCD_screen *lcd;
+
+	sysclk_init();			// SYSCLK = 80 MHz (PLL from HSI16)
+	systick_init(SYSCLK_FREQ / 1000);	// 1 ms ticks for delay()
+
+	lcd = get_LCD_instance();
+	COMP_init(lcd, 0x000080);
+	COMP_add(&dial, FACE_X, FACE_Y);
+	hour_id = COMP_add(&hour_hand, FACE_X, FACE_Y);
+	minute_id = COMP_add(&minute_hand, FACE_X, FACE_Y);
+	second_id = COMP_add(&second_hand, FACE_X, FACE_Y);
+	COMP_add(&cap, FACE_X, FACE_Y);
+
+	/* Hands move once a second; pace them so none is caught half-drawn */
+	LCD_set_vsync(lcd, 1);
+
+	WATCH_init(lcd, SYSCLK_FREQ, sysclk_init, FACE_START_S);
+	WATCH_add(&hands);
+	WATCH_add(&seconds);
+	WATCH_add(&stats_widget);
+
+	/* Draw the first frame, then only on events */
+	face_hands_update(&hands, WATCH_EVT_TICK);
+	face_seconds_update(&seconds, WATCH_EVT_TICK);
+	COMP_commit();
+	LCD_turn_on(lcd);
+
+	WATCH_run();
+}
+
+/**
+  * @brief Hour and minute hands : redrawn once a minute.
+  * @param w : Widget.
+  * @param events : Pending events.
+  * @retval 1 if the hands moved
+  */
+static uint8_t face_hands_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	uint32_t minute = WATCH_time_of_day() / 60;
+
+	(void) w;
+	(void) events;
+
+	if (minute == shown_minute)
+		return 0;
+	shown_minute = minute;
+
+	SHAPE_line_polar(&hour_hand, (int) ((minute % 720) / 2), 50);
+	SHAPE_line_polar(&minute_hand, (int) ((minute % 60) * 6), 80);
+	COMP_invalidate(hour_id);
+	COMP_invalidate(minute_id);
+
+	return 1;
+}
+
+/**
+  * @brief Second hand : moves every tick while shown; the button shows or
+  *	   hides it.
+  * @param w : Widget.
+  * @param events : Pending events.
+  * @retval 1 if the screen changed
+  */
+static uint8_t face_seconds_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	uint32_t now = WATCH_time_of_day();
+
+	(void) w;
+
+	if (events & WATCH_EVT_BUTTON) {
+		seconds_on = !seconds_on;
+		COMP_set_visible(second_id, seconds_on);
+		if (!seconds_on)
+			return 1;
+	}
+
+	if (!seconds_on)
+		return 0;
+
+	SHAPE_line_polar(&second_hand, (int) ((now % 60) * 6), 90);
+	COMP_invalidate(second_id);
+
+	return 1;
+}
+
+/**
+  * @brief Keeps the runtime's counters where a debugger can watch them.
+  *	   Never changes the screen.
+  * @param w : Widget.
+  * @param events : Pending events.
+  * @retval 0
+  */
+static uint8_t face_stats_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	WATCH_StatsTypeDef s;
+
+	(void) w;
+	(void) events;
+
+	WATCH_get_stats(&s);
+	stats = s;
+
+	return 0;
+}
+
+/**
+  * @brief Runs SYSCLK at 80 MHz from the main PLL (HSI16 / 2 * 20 / 2).
+  *	   SPI1 clocks the display at SYSCLK / 8 = 10 MHz (SYSCLK / 4 =
+  *	   20 MHz with ILI9340C_SPI_FAST), see ili9340c.c.
+  * @param None
+  * @retval None
+  */
+static void sysclk_init(void)
+{
+	// Enable HSI16 clock (16 MHz)
+	RCC->CR |= RCC_CR_HSION;
+	while ((RCC->CR & RCC_CR_HSIRDY) == 0);
+
+	// 80 MHz needs voltage range 1 (reset default) and 4 flash wait states
+	FLASH->ACR &= ~FLASH_ACR_LATENCY;
+	FLASH->ACR |= FLASH_ACR_LATENCY_4WS;
+	while ((FLASH->ACR & FLASH_ACR_LATENCY) != FLASH_ACR_LATENCY_4WS);
+
+	// Disable PLL before changing the settings
+	RCC->CR &= ~RCC_CR_PLLON;
+	while (RCC->CR & RCC_CR_PLLRDY);
+
+	// f_VCO = 16 MHz / 2 * 20 = 160 MHz; PLLCLK = f_VCO / 2 = 80 MHz
+	RCC->PLLCFGR = RCC_PLLCFGR_PLLSRC_HSI | (1U << 4) | (20U << 8);  // PLLM = 2, PLLN = 20, PLLR = 2
+
+	RCC->CR |= RCC_CR_PLLON;
+	while ((RCC->CR & RCC_CR_PLLRDY) == 0);
+	RCC->PLLCFGR |= RCC_PLLCFGR_PLLREN;
 
+	// Select PLL as SYSCLK (AHB, APB1 and APB2 undivided)
+	RCC->CFGR &= ~(RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2);
+	RCC->CFGR &= ~RCC_CFGR_SW;
+	RCC->CFGR |= RCC_CFGR_SW_PLL;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
 }
@@ -0,0 +1,198 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/scroll_list.c                                        *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    18-July-2017                                                         *
+ * @brief   Scrolling list on the panel's hardware vertical scroll.             *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/scroll_list.h"
+#include "../include/ili9340c.h"
+#include <stddef.h>
+
+/*
+ * The band's GRAM lines are used as a ring : content line L always lives on
+ * panel line top + (L % height), and VSSADDR picks which of them is shown
+ * first. Scrolling by d lines therefore only paints the d lines that come
+ * into view (over the ones that just left it) plus one 3-byte command,
+ * instead of the whole band.
+ */
+
+/* Private function prototypes ---------------------------------------------------*/
+static void scroll_paint(SCROLL_ListTypeDef *list, int32_t from, int32_t n);
+static void scroll_paint_lines(SCROLL_ListTypeDef *list, int32_t from, int32_t n, int32_t line);
+static int32_t scroll_max(const SCROLL_ListTypeDef *list);
+
+/* Public functions --------------------------------------------------------------*/
+
+void SCROLL_init(SCROLL_ListTypeDef *list, LCD_screen *lcd, uint16_t top, uint16_t height,
+		 const SCROLL_RowTypeDef *rows, uint16_t nrows, uint16_t row_h)
+{
+	uint32_t bytes = LCD_get_tx_bytes(lcd);
+
+	list->lcd = lcd;
+	list->rows = rows;
+	list->nrows = nrows;
+	list->row_h = row_h;
+	list->top = top;
+	list->height = height;
+	list->pos = 0;
+	list->stats.steps = 0;
+	list->stats.lines = 0;
+	list->stats.bytes = 0;
+
+	ILI9340C_set_scroll_area(top, height, ILI9340C_HEIGHT - top - height);
+	ILI9340C_scroll_to(top);
+	scroll_paint(list, 0, height);
+
+	list->stats.bytes = LCD_get_tx_bytes(lcd) - bytes;
+}
+
+void SCROLL_by(SCROLL_ListTypeDef *list, int32_t dy)
+{
+	SCROLL_to(list, list->pos + dy);
+}
+
+void SCROLL_to(SCROLL_ListTypeDef *list, int32_t pos)
+{
+	uint32_t bytes = LCD_get_tx_bytes(list->lcd);
+	int32_t old = list->pos;
+	int32_t d;
+
+	if (pos > scroll_max(list))
+		pos = scroll_max(list);
+	if (pos < 0)
+		pos = 0;
+
+	d = pos - old;
+	if (d == 0)
+		return;
+	list->pos = pos;
+
+	/* Move the scan-out first : until the paint lands, stale lines show
+	   where new ones are expected instead of over rows still in view */
+	ILI9340C_scroll_to(list->top + pos % list->height);
+
+	if (d >= list->height || d <= -(int32_t) list->height)
+		scroll_paint(list, pos, list->height);
+	else if (d > 0)
+		scroll_paint(list, old + list->height, d);
+	else
+		scroll_paint(list, pos, -d);
+
+	list->stats.steps++;
+	list->stats.bytes += LCD_get_tx_bytes(list->lcd) - bytes;
+}
+
+void SCROLL_invalidate_row(SCROLL_ListTypeDef *list, uint16_t row)
+{
+	int32_t a = (int32_t) row * list->row_h;
+	int32_t b = a + list->row_h;
+	uint32_t bytes;
+
+	if (a < list->pos)
+		a = list->pos;
+	if (b > list->pos + list->height)
+		b = list->pos + list->height;
+
+	if (a < b) {
+		bytes = LCD_get_tx_bytes(list->lcd);
+		scroll_paint(list, a, b - a);
+		list->stats.bytes += LCD_get_tx_bytes(list->lcd) - bytes;
+	}
+}
+
+void SCROLL_get_stats(const SCROLL_ListTypeDef *list, SCROLL_StatsTypeDef *stats)
+{
+	*stats = list->stats;
+}
+
+void SCROLL_close(SCROLL_ListTypeDef *list)
+{
+	ILI9340C_scroll_to(list->top);
+	ILI9340C_write_cmd(ILI9340C_NMOD_ON, NULL, 0);
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Paints visible content lines into their ring positions.
+  * @param list : The list.
+  * @param from : First content line.
+  * @param n : Number of lines (at most the band's height).
+  * @retval None
+  */
+static void scroll_paint(SCROLL_ListTypeDef *list, int32_t from, int32_t n)
+{
+	int32_t g = from % list->height;
+	int32_t first = (n < list->height - g) ? n : list->height - g;
+
+	scroll_paint_lines(list, from, first, list->top + g);
+	if (n > first)
+		scroll_paint_lines(list, from + first, n - first, list->top);
+
+	list->stats.lines += n;
+}
+
+/**
+  * @brief Paints content lines onto consecutive panel lines, one window per
+  *	   row they cross (and one for any blank space after the last row).
+  * @param list : The list.
+  * @param from : First content line.
+  * @param n : Number of lines.
+  * @param line : Panel line for content line from.
+  * @retval None
+  */
+static void scroll_paint_lines(SCROLL_ListTypeDef *list, int32_t from, int32_t n, int32_t line)
+{
+	SHAPE_InstanceTypeDef inst[SCROLL_MAX_ROW_ITEMS];
+	const SHAPE_InstanceTypeDef *draw[SCROLL_MAX_ROW_ITEMS];
+	const int32_t shift = line - from;	// Content line -> panel line
+	const int32_t end = from + n;
+	SHAPE_RectTypeDef area;
+	int32_t y, y1, r;
+	uint8_t i, cnt;
+
+	area.x0 = 0;
+	area.x1 = ILI9340C_WIDTH - 1;
+
+	for (y = from; y < end; y = y1) {
+		r = y / list->row_h;
+		y1 = (r < list->nrows) ? (r + 1) * list->row_h : end;
+		if (y1 > end)
+			y1 = end;
+
+		cnt = 0;
+		if (r < list->nrows) {
+			for (i = 0; i < list->rows[r].n && i < SCROLL_MAX_ROW_ITEMS; i++) {
+				inst[i] = list->rows[r].items[i];
+				inst[i].y += r * list->row_h + shift;
+				draw[i] = &inst[i];
+				cnt++;
+			}
+		}
+
+		area.y0 = y + shift;
+		area.y1 = y1 - 1 + shift;
+		LCD_render(list->lcd, &area, draw, cnt);
+	}
+}
+
+/**
+  * @brief Returns the last position that still fills the band with content.
+  * @param list : The list.
+  * @retval Largest valid pos
+  */
+static int32_t scroll_max(const SCROLL_ListTypeDef *list)
+{
+	int32_t content = (int32_t) list->nrows * list->row_h;
+
+	return (content > list->height) ? content - list->height : 0;
+}
@@ -0,0 +1,739 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/shape.c                                              *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.1                                                                 *
+ * @date    08-July-2017                                                         *
+ * @brief   Shape geometry and strip rasterizer.                                 *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/shape.h"
+#include "../include/ili9340c.h"
+#include <stddef.h>
+
+/*
+ * Shapes are rasterized one strip at a time, so every primitive has to be able
+ * to produce an arbitrary band of rows.
+ *
+ * Rectangles, rounded rectangles, circles and arcs share one row generator : a
+ * rounded rectangle of radius R (R = 0 is a plain rectangle, W = H = 2R + 1 a
+ * circle) minus an optional inner one inset by the stroke. Each row's extent
+ * uses the midpoint-circle criterion x^2 + y^2 <= R^2 + R, evaluated directly
+ * for that row. With SHAPE_FLAG_AA, pixels on a curved edge get a coverage
+ * of R + 1/2 - distance, measured in 1/16 pixel from an integer square root.
+ *
+ * Lines use Bresenham (with a square brush when stroke > 1), or Wu's
+ * algorithm with a 16.16 fixed-point error term for anti-aliased 1-pixel lines.
+ *
+ * Text glyphs are decoded from their runs straight into the strip; runs above
+ * the strip are skipped by length alone, so nothing is ever unpacked to RAM.
+ */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE TYPES                                     *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	const SHAPE_RectTypeDef *strip;
+	uint16_t *buf;
+	int stride;
+	uint16_t color;
+} SHAPE_CanvasTypeDef;
+
+/* One row of a rounded rectangle, in the outer shape's x coordinates */
+typedef struct
+{
+	int any_lo;		// Pixels touched
+	int any_hi;
+	int full_lo;		// Pixels fully covered
+	int full_hi;
+	int dy;			// Row distance from the corner centers (0 on straight rows)
+	int off;		// Left edge of this rectangle
+	int w;
+	int r;
+} SHAPE_RowTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE FUNCTIONS                                 *
+ *                                                                                *
+\**********************************************************************************/
+static void shape_rounded(SHAPE_CanvasTypeDef *cv, int ox, int oy, int w, int h, int r,
+			  int s, uint8_t aa, const SHAPE_TypeDef *arc);
+static void shape_row(int w, int h, int r, int off, int py, uint8_t aa, SHAPE_RowTypeDef *row);
+static uint8_t shape_cover(const SHAPE_RowTypeDef *row, int x);
+static uint8_t shape_in_arc(const SHAPE_TypeDef *arc, int dx, int dy);
+static void shape_direction(int deg, int32_t *dx, int32_t *dy);
+static void shape_line(SHAPE_CanvasTypeDef *cv, int x0, int y0, int x1, int y1, int w);
+static void shape_line_aa(SHAPE_CanvasTypeDef *cv, int x0, int y0, int x1, int y1);
+static void shape_bitmap(SHAPE_CanvasTypeDef *cv, const SHAPE_TypeDef *shape, int ox, int oy);
+static void shape_text(SHAPE_CanvasTypeDef *cv, const SHAPE_TypeDef *shape, int ox, int oy);
+static void shape_glyph(SHAPE_CanvasTypeDef *cv, const SHAPE_FontTypeDef *font,
+			const SHAPE_GlyphTypeDef *g, int gx, int gy);
+static int shape_text_width(const SHAPE_TypeDef *shape);
+static void shape_hspan(SHAPE_CanvasTypeDef *cv, int x0, int x1, int y);
+static void shape_plot(SHAPE_CanvasTypeDef *cv, int x, int y, uint8_t alpha);
+static uint16_t shape_blend(uint16_t fg, uint16_t bg, uint8_t alpha);
+static uint32_t shape_isqrt(uint32_t n);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PRIVATE VARS                                      *
+ *                                                                                *
+\**********************************************************************************/
+
+/* sin(0..90 degrees) in Q14 */
+static const int16_t sin_q14[91] = {
+	    0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+	 2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+	 5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+	 8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+/* Public functions --------------------------------------------------------------*/
+
+void SHAPE_get_bounds(const SHAPE_TypeDef *shape, int x, int y, SHAPE_RectTypeDef *r)
+{
+	int lo, hi;
+
+	switch (shape->type) {
+	case SHAPE_CIRCLE:
+	case SHAPE_ARC:
+		r->x0 = x - shape->radius;
+		r->y0 = y - shape->radius;
+		r->x1 = x + shape->radius;
+		r->y1 = y + shape->radius;
+		break;
+
+	case SHAPE_LINE:
+		/* Brush reach around each point; Wu also touches the next row/column */
+		lo = (shape->stroke > 1) ? -((shape->stroke - 1) / 2) : 0;
+		hi = (shape->stroke > 1) ? shape->stroke / 2 : ((shape->flags & SHAPE_FLAG_AA) ? 1 : 0);
+		r->x0 = x + ((shape->x0 < shape->x1) ? shape->x0 : shape->x1) + lo;
+		r->y0 = y + ((shape->y0 < shape->y1) ? shape->y0 : shape->y1) + lo;
+		r->x1 = x + ((shape->x0 > shape->x1) ? shape->x0 : shape->x1) + hi;
+		r->y1 = y + ((shape->y0 > shape->y1) ? shape->y0 : shape->y1) + hi;
+		break;
+
+	case SHAPE_TEXT:
+		lo = shape_text_width(shape);
+		r->x0 = x - lo / 2;
+		r->y0 = y - shape->font->height / 2;
+		r->x1 = r->x0 + lo - 1;
+		r->y1 = r->y0 + shape->font->height - 1;
+		break;
+
+	default:
+		r->x0 = x - shape->width / 2;
+		r->y0 = y - shape->height / 2;
+		r->x1 = r->x0 + shape->width - 1;
+		r->y1 = r->y0 + shape->height - 1;
+		break;
+	}
+}
+
+void SHAPE_raster(const SHAPE_TypeDef *shape, int x, int y, const SHAPE_RectTypeDef *strip, uint16_t *buf)
+{
+	SHAPE_CanvasTypeDef cv;
+	SHAPE_RectTypeDef b, clip;
+	uint8_t aa = shape->flags & SHAPE_FLAG_AA;
+	int w = shape->width, h = shape->height, r = shape->radius, s = shape->stroke;
+	int d = 2 * r + 1;
+
+	SHAPE_get_bounds(shape, x, y, &b);
+	if (!SHAPE_rect_intersect(&b, strip, &clip))
+		return;
+
+	cv.strip = strip;
+	cv.buf = buf;
+	cv.stride = strip->x1 - strip->x0 + 1;
+	cv.color = ILI9340C_RGB565(shape->color);
+
+	switch (shape->type) {
+	case SHAPE_FILLED_RECT:
+		shape_rounded(&cv, b.x0, b.y0, w, h, 0, 0, 0, NULL);
+		break;
+
+	case SHAPE_RECT:
+		shape_rounded(&cv, b.x0, b.y0, w, h, 0, (s > 0) ? s : 1, 0, NULL);
+		break;
+
+	case SHAPE_ROUNDED_RECT:
+		if (r > w / 2)
+			r = w / 2;
+		if (r > h / 2)
+			r = h / 2;
+		shape_rounded(&cv, b.x0, b.y0, w, h, r, s, aa, NULL);
+		break;
+
+	case SHAPE_CIRCLE:
+		shape_rounded(&cv, b.x0, b.y0, d, d, r, s, aa, NULL);
+		break;
+
+	case SHAPE_ARC:
+		shape_rounded(&cv, b.x0, b.y0, d, d, r, (s > 0) ? s : 1, aa, shape);
+		break;
+
+	case SHAPE_LINE:
+		if (aa && s <= 1)
+			shape_line_aa(&cv, x + shape->x0, y + shape->y0, x + shape->x1, y + shape->y1);
+		else
+			shape_line(&cv, x + shape->x0, y + shape->y0, x + shape->x1, y + shape->y1, (s > 0) ? s : 1);
+		break;
+
+	case SHAPE_BITMAP:
+		shape_bitmap(&cv, shape, b.x0, b.y0);
+		break;
+
+	case SHAPE_TEXT:
+		shape_text(&cv, shape, b.x0, b.y0);
+		break;
+	}
+}
+
+uint8_t SHAPE_rect_intersect(const SHAPE_RectTypeDef *a, const SHAPE_RectTypeDef *b, SHAPE_RectTypeDef *out)
+{
+	SHAPE_RectTypeDef r;
+
+	r.x0 = (a->x0 > b->x0) ? a->x0 : b->x0;
+	r.y0 = (a->y0 > b->y0) ? a->y0 : b->y0;
+	r.x1 = (a->x1 < b->x1) ? a->x1 : b->x1;
+	r.y1 = (a->y1 < b->y1) ? a->y1 : b->y1;
+	*out = r;
+
+	return (r.x0 <= r.x1 && r.y0 <= r.y1);
+}
+
+void SHAPE_line_polar(SHAPE_TypeDef *shape, int deg, int length)
+{
+	int32_t dx, dy;
+
+	shape_direction(deg, &dx, &dy);
+	shape->x0 = 0;
+	shape->y0 = 0;
+	shape->x1 = (int16_t) ((dx * length + (1 << 13)) >> 14);
+	shape->y1 = (int16_t) ((dy * length + (1 << 13)) >> 14);
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Rasterizes a w x h rounded rectangle of corner radius r, minus the
+  *	   rectangle inset by s (none if s is 0), into the strip. Fully covered
+  *	   runs are filled directly; only edge pixels are blended.
+  * @param cv : Strip being drawn.
+  * @param ox : Screen column of the left edge.
+  * @param oy : Screen row of the top edge.
+  * @param w : Width.
+  * @param h : Height.
+  * @param r : Corner radius (0 - min(w, h) / 2).
+  * @param s : Outline thickness, 0 for a solid shape.
+  * @param aa : Non-zero to anti-alias the curved edges.
+  * @param arc : Arc whose angular range limits the shape, or NULL.
+  * @retval None
+  */
+static void shape_rounded(SHAPE_CanvasTypeDef *cv, int ox, int oy, int w, int h, int r,
+			  int s, uint8_t aa, const SHAPE_TypeDef *arc)
+{
+	SHAPE_RowTypeDef o, in;
+	int y, y_end, x, x_end, run_end;
+	uint32_t co, ci;
+
+	y = (oy > cv->strip->y0) ? oy : cv->strip->y0;
+	y_end = (oy + h - 1 < cv->strip->y1) ? oy + h - 1 : cv->strip->y1;
+
+	for (; y <= y_end; y++) {
+		shape_row(w, h, r, 0, y - oy, aa, &o);
+		if (s > 0)
+			shape_row(w - 2 * s, h - 2 * s, (r > s) ? r - s : 0, s, y - oy - s, aa, &in);
+		else
+			shape_row(0, 0, 0, 0, 0, 0, &in);
+
+		x = (o.any_lo > cv->strip->x0 - ox) ? o.any_lo : cv->strip->x0 - ox;
+		x_end = (o.any_hi < cv->strip->x1 - ox) ? o.any_hi : cv->strip->x1 - ox;
+
+		while (x <= x_end) {
+			/* Inside the hole */
+			if (x >= in.full_lo && x <= in.full_hi) {
+				x = in.full_hi + 1;
+				continue;
+			}
+
+			/* Solid run up to the end of full coverage or the hole's edge */
+			if (arc == NULL && x >= o.full_lo && x <= o.full_hi &&
+			    !(x >= in.any_lo && x <= in.any_hi)) {
+				run_end = (o.full_hi < x_end) ? o.full_hi : x_end;
+				if (in.any_lo > x && in.any_lo <= run_end)
+					run_end = in.any_lo - 1;
+				shape_hspan(cv, ox + x, ox + run_end, y);
+				x = run_end + 1;
+				continue;
+			}
+
+			/* Edge pixel (or arc pixel) */
+			co = (x >= o.full_lo && x <= o.full_hi) ? 255 : shape_cover(&o, x);
+			ci = (x >= in.any_lo && x <= in.any_hi) ? shape_cover(&in, x) : 0;
+			co = (co * (256 - ci)) >> 8;
+
+			if (arc != NULL && !shape_in_arc(arc, x - r, y - oy - r))
+				co = 0;
+
+			if (co > 0)
+				shape_plot(cv, ox + x, y, co);
+			x++;
+		}
+	}
+}
+
+/**
+  * @brief Computes one row of a w x h rounded rectangle. Rows outside the
+  *	   rectangle (or a rectangle with no area) come back empty.
+  * @param w : Width.
+  * @param h : Height.
+  * @param r : Corner radius.
+  * @param off : Column of the left edge (the row is returned in those coordinates).
+  * @param py : Row, relative to the top edge.
+  * @param aa : Non-zero to separate fully covered from edge pixels.
+  * @param row : Filled in with the row's extent.
+  * @retval None
+  */
+static void shape_row(int w, int h, int r, int off, int py, uint8_t aa, SHAPE_RowTypeDef *row)
+{
+	int hw, full;
+
+	row->off = off;
+	row->w = w;
+	row->r = r;
+	row->dy = 0;
+	row->any_lo = row->full_lo = 0;
+	row->any_hi = row->full_hi = -1;
+
+	if (w <= 0 || h <= 0 || py < 0 || py >= h)
+		return;
+
+	if (py < r)
+		row->dy = r - py;
+	else if (py > h - 1 - r)
+		row->dy = py - (h - 1 - r);
+
+	row->any_lo = row->full_lo = off;
+	row->any_hi = row->full_hi = off + w - 1;
+	if (row->dy == 0)
+		return;
+
+	/* Midpoint criterion : inside the circle of radius r + 1/2 */
+	hw = shape_isqrt(r * r + r - row->dy * row->dy);
+	row->any_lo = off + r - hw;
+	row->any_hi = off + w - 1 - r + hw;
+	if (!aa)
+		return;
+
+	/* Fully covered : inside the circle of radius r - 1/2 */
+	full = r * r - r - row->dy * row->dy;
+	if (full < 0) {
+		row->full_lo = 0;
+		row->full_hi = -1;
+	} else {
+		hw = shape_isqrt(full);
+		row->full_lo = off + r - hw;
+		row->full_hi = off + w - 1 - r + hw;
+	}
+}
+
+/**
+  * @brief Coverage of an edge pixel : r + 1/2 minus its distance from the
+  *	   nearest corner center, in 1/16 pixel steps.
+  * @param row : Row the pixel is on.
+  * @param x : Pixel column (same coordinates as the row).
+  * @retval Coverage (0 - 255)
+  */
+static uint8_t shape_cover(const SHAPE_RowTypeDef *row, int x)
+{
+	int px = x - row->off, dx = 0;
+	int32_t cov;
+
+	if (px < row->r)
+		dx = row->r - px;
+	else if (px > row->w - 1 - row->r)
+		dx = px - (row->w - 1 - row->r);
+
+	cov = (row->r << 4) + 8 - (int32_t) shape_isqrt((uint32_t) (dx * dx + row->dy * row->dy) << 8);
+	if (cov <= 0)
+		return 0;
+	if (cov >= 16)
+		return 255;
+	return cov << 4;
+}
+
+/**
+  * @brief Tests whether a pixel lies in an arc's angular range.
+  * @param arc : Arc shape.
+  * @param dx : Column relative to the center.
+  * @param dy : Row relative to the center (down is positive).
+  * @retval 1 if inside, 0 otherwise
+  */
+static uint8_t shape_in_arc(const SHAPE_TypeDef *arc, int dx, int dy)
+{
+	int32_t sx, sy, ex, ey;
+	int sweep = ((arc->end - arc->start) % 360 + 360) % 360;
+
+	if (sweep == 0)
+		return 1;
+
+	shape_direction(arc->start, &sx, &sy);
+	shape_direction(arc->end, &ex, &ey);
+
+	/* With y pointing down, cross(u, p) > 0 means p is clockwise of u */
+	if (sweep <= 180)
+		return (sx * dy - sy * dx >= 0) && (dx * ey - dy * ex >= 0);
+
+	return !((ex * dy - ey * dx > 0) && (dx * sy - dy * sx > 0));
+}
+
+/**
+  * @brief Unit vector (Q14) pointing at an angle clockwise from 12 o'clock.
+  * @param deg : Angle in degrees (any value).
+  * @param dx : Filled in with the column component.
+  * @param dy : Filled in with the row component (down is positive).
+  * @retval None
+  */
+static void shape_direction(int deg, int32_t *dx, int32_t *dy)
+{
+	int a = (deg % 360 + 360) % 360;
+	int32_t s, c;
+
+	if (a <= 90) {
+		s = sin_q14[a];
+		c = sin_q14[90 - a];
+	} else if (a <= 180) {
+		s = sin_q14[180 - a];
+		c = -sin_q14[a - 90];
+	} else if (a <= 270) {
+		s = -sin_q14[a - 180];
+		c = -sin_q14[270 - a];
+	} else {
+		s = -sin_q14[360 - a];
+		c = sin_q14[a - 270];
+	}
+
+	*dx = s;
+	*dy = -c;
+}
+
+/**
+  * @brief Bresenham line; each point stamps a w x w square.
+  * @param cv : Strip being drawn.
+  * @param x0 : Start column.
+  * @param y0 : Start row.
+  * @param x1 : End column.
+  * @param y1 : End row.
+  * @param w : Stroke width.
+  * @retval None
+  */
+static void shape_line(SHAPE_CanvasTypeDef *cv, int x0, int y0, int x1, int y1, int w)
+{
+	int dx = (x1 > x0) ? x1 - x0 : x0 - x1;
+	int dy = (y1 > y0) ? y0 - y1 : y1 - y0;
+	int sx = (x0 < x1) ? 1 : -1;
+	int sy = (y0 < y1) ? 1 : -1;
+	int err = dx + dy, e2, k;
+	int lo = -((w - 1) / 2), hi = w / 2;
+
+	while (1) {
+		/* Skip points whose brush misses the strip */
+		if (y0 + hi >= cv->strip->y0 && y0 + lo <= cv->strip->y1) {
+			for (k = lo; k <= hi; k++)
+				shape_hspan(cv, x0 + lo, x0 + hi, y0 + k);
+		}
+
+		if (x0 == x1 && y0 == y1)
+			break;
+
+		e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+/**
+  * @brief Wu's anti-aliased line. The minor coordinate is tracked in 16.16
+  *	   fixed point; its fraction splits each step between two pixels.
+  * @param cv : Strip being drawn.
+  * @param x0 : Start column.
+  * @param y0 : Start row.
+  * @param x1 : End column.
+  * @param y1 : End row.
+  * @retval None
+  */
+static void shape_line_aa(SHAPE_CanvasTypeDef *cv, int x0, int y0, int x1, int y1)
+{
+	int steep = ((y1 > y0) ? y1 - y0 : y0 - y1) > ((x1 > x0) ? x1 - x0 : x0 - x1);
+	int t, i, j;
+	int32_t grad, acc;
+	uint8_t f;
+
+	if (steep) {
+		t = x0; x0 = y0; y0 = t;
+		t = x1; x1 = y1; y1 = t;
+	}
+	if (x0 > x1) {
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+	}
+
+	grad = (x1 == x0) ? 0 : (int32_t) (((int32_t) (y1 - y0) << 16) / (x1 - x0));
+	acc = (int32_t) y0 << 16;
+
+	for (i = x0; i <= x1; i++, acc += grad) {
+		j = acc >> 16;
+		f = (acc >> 8) & 0xFF;
+
+		if (steep) {
+			shape_plot(cv, j, i, 255 - f);
+			shape_plot(cv, j + 1, i, f);
+		} else {
+			shape_plot(cv, i, j, 255 - f);
+			shape_plot(cv, i, j + 1, f);
+		}
+	}
+}
+
+/**
+  * @brief Copies the part of a bitmap that falls inside the strip.
+  * @param cv : Strip being drawn.
+  * @param shape : Bitmap shape.
+  * @param ox : Screen column of the left edge.
+  * @param oy : Screen row of the top edge.
+  * @retval None
+  */
+static void shape_bitmap(SHAPE_CanvasTypeDef *cv, const SHAPE_TypeDef *shape, int ox, int oy)
+{
+	SHAPE_RectTypeDef b = {ox, oy, ox + shape->width - 1, oy + shape->height - 1};
+	const uint16_t *src;
+	uint16_t *dst;
+	int x, y;
+
+	if (!SHAPE_rect_intersect(&b, cv->strip, &b))
+		return;
+
+	for (y = b.y0; y <= b.y1; y++) {
+		src = shape->pixels + (y - oy) * shape->width + (b.x0 - ox);
+		dst = cv->buf + (y - cv->strip->y0) * cv->stride + (b.x0 - cv->strip->x0);
+		for (x = b.x0; x <= b.x1; x++)
+			*dst++ = *src++;
+	}
+}
+
+/**
+  * @brief Draws a line of text, skipping glyphs that miss the strip.
+  * @param cv : Strip being drawn.
+  * @param shape : Text shape.
+  * @param ox : Screen column of the first glyph cell.
+  * @param oy : Screen row of the top of the line.
+  * @retval None
+  */
+static void shape_text(SHAPE_CanvasTypeDef *cv, const SHAPE_TypeDef *shape, int ox, int oy)
+{
+	const SHAPE_FontTypeDef *font = shape->font;
+	const SHAPE_GlyphTypeDef *g;
+	const char *c;
+	uint8_t ch;
+	int gx, gy;
+
+	for (c = shape->text; *c != '\0'; c++) {
+		ch = (uint8_t) *c;
+		if (ch < font->first || ch >= font->first + font->count)
+			continue;
+
+		g = &font->glyphs[ch - font->first];
+		gx = ox + g->x_off;
+		gy = oy + g->y_off;
+
+		if (g->height > 0 && gy <= cv->strip->y1 && gy + g->height - 1 >= cv->strip->y0 &&
+		    gx <= cv->strip->x1 && gx + g->width - 1 >= cv->strip->x0)
+			shape_glyph(cv, font, g, gx, gy);
+
+		ox += g->advance;
+	}
+}
+
+/**
+  * @brief Expands one glyph's runs into the strip. Runs before the strip's
+  *	   first row are skipped whole and decoding stops after its last row.
+  * @param cv : Strip being drawn.
+  * @param font : Font the glyph belongs to.
+  * @param g : Glyph.
+  * @param gx : Screen column of the glyph's ink box.
+  * @param gy : Screen row of the glyph's ink box.
+  * @retval None
+  */
+static void shape_glyph(SHAPE_CanvasTypeDef *cv, const SHAPE_FontTypeDef *font,
+			const SHAPE_GlyphTypeDef *g, int gx, int gy)
+{
+	const uint8_t *p = font->data + g->offset;
+	uint8_t mask = (1U << font->bpp) - 1;
+	uint8_t step = 255 / mask;	// Level -> alpha (exact for 1, 2 and 4 bpp)
+	uint32_t i = 0, run, start, stop;
+	int row_lo = (cv->strip->y0 > gy) ? cv->strip->y0 - gy : 0;
+	int row_hi = (cv->strip->y1 < gy + g->height - 1) ? cv->strip->y1 - gy : g->height - 1;
+	int col, row, n;
+	uint8_t alpha;
+
+	start = (uint32_t) row_lo * g->width;
+	stop = (uint32_t) (row_hi + 1) * g->width;
+
+	while (i < stop) {
+		run = (*p >> font->bpp) + 1;
+		alpha = (*p & mask) * step;
+		p++;
+
+		if (alpha == 0 || i + run <= start) {
+			i += run;
+			continue;
+		}
+
+		/* Clip the run to the strip's rows and walk it across row ends */
+		n = ((i + run < stop) ? i + run : stop) - ((i > start) ? i : start);
+		if (i < start)
+			i = start;
+		row = i / g->width;
+		col = i - row * g->width;
+		i += n;
+
+		while (n-- > 0) {
+			shape_plot(cv, gx + col, gy + row, alpha);
+			if (++col == g->width) {
+				col = 0;
+				row++;
+			}
+		}
+	}
+}
+
+/**
+  * @brief Sum of the advances of a text's characters.
+  * @param shape : Text shape.
+  * @retval Width in pixels
+  */
+static int shape_text_width(const SHAPE_TypeDef *shape)
+{
+	const SHAPE_FontTypeDef *font = shape->font;
+	const char *c;
+	uint8_t ch;
+	int w = 0;
+
+	for (c = shape->text; *c != '\0'; c++) {
+		ch = (uint8_t) *c;
+		if (ch >= font->first && ch < font->first + font->count)
+			w += font->glyphs[ch - font->first].advance;
+	}
+
+	return w;
+}
+
+/**
+  * @brief Fills a horizontal run, clipped to the strip.
+  * @param cv : Strip being drawn.
+  * @param x0 : First column.
+  * @param x1 : Last column.
+  * @param y : Row.
+  * @retval None
+  */
+static void shape_hspan(SHAPE_CanvasTypeDef *cv, int x0, int x1, int y)
+{
+	uint16_t *p;
+
+	if (y < cv->strip->y0 || y > cv->strip->y1)
+		return;
+	if (x0 < cv->strip->x0)
+		x0 = cv->strip->x0;
+	if (x1 > cv->strip->x1)
+		x1 = cv->strip->x1;
+
+	p = cv->buf + (y - cv->strip->y0) * cv->stride + (x0 - cv->strip->x0);
+	for (; x0 <= x1; x0++)
+		*p++ = cv->color;
+}
+
+/**
+  * @brief Blends the shape color into one pixel, clipped to the strip.
+  * @param cv : Strip being drawn.
+  * @param x : Column.
+  * @param y : Row.
+  * @param alpha : Coverage (0 - 255).
+  * @retval None
+  */
+static void shape_plot(SHAPE_CanvasTypeDef *cv, int x, int y, uint8_t alpha)
+{
+	uint16_t *p;
+
+	if (alpha == 0 || x < cv->strip->x0 || x > cv->strip->x1 ||
+	    y < cv->strip->y0 || y > cv->strip->y1)
+		return;
+
+	p = cv->buf + (y - cv->strip->y0) * cv->stride + (x - cv->strip->x0);
+	*p = (alpha == 255) ? cv->color : shape_blend(cv->color, *p, alpha);
+}
+
+/**
+  * @brief RGB565 blend with 5-bit alpha. Spreading the pixel to 0x07E0F81F
+  *	   leaves room for all three channels to be scaled in one multiply.
+  * @param fg : Foreground color.
+  * @param bg : Background color.
+  * @param alpha : Foreground weight (0 - 255).
+  * @retval Blended color
+  */
+static uint16_t shape_blend(uint16_t fg, uint16_t bg, uint8_t alpha)
+{
+	uint32_t a = ((uint32_t) alpha + 4) >> 3;
+	uint32_t f = (fg | ((uint32_t) fg << 16)) & 0x07E0F81F;
+	uint32_t b = (bg | ((uint32_t) bg << 16)) & 0x07E0F81F;
+	uint32_t r = ((((f - b) * a) >> 5) + b) & 0x07E0F81F;
+
+	return (uint16_t) (r | (r >> 16));
+}
+
+/**
+  * @brief Integer square root (floor).
+  * @param n : Radicand.
+  * @retval floor(sqrt(n))
+  */
+static uint32_t shape_isqrt(uint32_t n)
+{
+	uint32_t root = 0, bit = 1UL << 30;
+
+	while (bit > n)
+		bit >>= 2;
+
+	while (bit != 0) {
+		if (n >= root + bit) {
+			n -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return root;
+}
@@ -14,46 +14,303 @@
 
 /* Includes ----------------------------------------------------------------------*/
 #include "../include/spi.h"
+#include "../include/dma.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private types -----------------------------------------------------------------*/
+typedef struct
+{
+	const uint8_t *tx;		// Next frame to send (NULL : SPI_FILL_FRAME)
+	uint8_t *rx;			// Where the next frame goes (NULL : dropped)
+	uint16_t tx_left;
+	uint16_t rx_left;
+	uint8_t wide;			// Frames are half-words
+	volatile uint8_t busy;
+	SPI_CallbackTypeDef cb;
+} SPI_XferTypeDef;
+
+static SPI_XferTypeDef xfer[3];
+
+/* MSI frequency for each MSIRANGE value (kHz) */
+static const uint16_t msi_khz[12] = {
+	100, 200, 400, 800, 1000, 2000, 4000, 8000, 16000, 24000, 32000, 48000
+};
+
+/* Private functions -------------------------------------------------------------*/
+static void spi_pins_init(SPI_TypeDef *SPIx);
+static SPI_XferTypeDef *spi_xfer(SPI_TypeDef *SPIx);
+static void spi_xfer_setup(SPI_TypeDef *SPIx, SPI_XferTypeDef *x, const void *tx, void *rx,
+			   uint16_t n, SPI_CallbackTypeDef cb);
+static void spi_put(SPI_TypeDef *SPIx, SPI_XferTypeDef *x);
+static void spi_take(SPI_TypeDef *SPIx, SPI_XferTypeDef *x);
+static void spi_irq(SPI_TypeDef *SPIx);
+static void spi_dma_irq(SPI_TypeDef *SPIx);
+static uint32_t spi_sysclk(void);
+static uint32_t spi_pll_input(void);
+static uint32_t spi_msi(void);
 
 /* Public functions --------------------------------------------------------------*/
-void spi_init(SPI_TypeDef *SPIx)
+
+void spi_init(SPI_TypeDef *SPIx, const SPI_ConfigTypeDef *cfg)
 {
+	uint32_t pclk, br = 0;
+
 	/* Configure pins for controlling SPIx */
-	spi_pins_init(SPIx);	
+	spi_pins_init(SPIx);
 
-	/* Clock the SPIx peripheral */	
+	/* Clock the SPIx peripheral */
 	if (SPIx == SPI1) {
-		RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;	
+		RCC->APB2ENR |= RCC_APB2ENR_SPI1EN;
+		NVIC_SetPriority(SPI1_IRQn, 1);
+		NVIC_EnableIRQ(SPI1_IRQn);
 	} else if (SPIx == SPI2) {
-		RCC->APB1ENR1 |= RCC_APB1ENR1_SPI2EN;	
+		RCC->APB1ENR1 |= RCC_APB1ENR1_SPI2EN;
+		NVIC_SetPriority(SPI2_IRQn, 1);
+		NVIC_EnableIRQ(SPI2_IRQn);
 	} else if (SPIx == SPI3) {
-		RCC->APB1ENR1 |= RCC_APB1ENR1_SPI3EN;	
+		RCC->APB1ENR1 |= RCC_APB1ENR1_SPI3EN;
+		NVIC_SetPriority(SPI3_IRQn, 1);
+		NVIC_EnableIRQ(SPI3_IRQn);
 	}
-	
-	/* Disable the peripheral before configuration */	
-	SPIx->CR1 &= ~SPI_CR1_SPE;	
-	
-	/* Set baud rate */
-	SPIx->CR1 &= ~SPI_CR1_BR;	
-	SPIx->CR1 |= 1U << 3;	// f_baud = 16 MHz / 4 = 4 MHz
+
+	/* Disable the peripheral before configuration */
+	SPIx->CR1 &= ~SPI_CR1_SPE;
+	SPIx->CR2 &= ~(SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN | SPI_CR2_TXEIE | SPI_CR2_RXNEIE);
+
+	/* Set baud rate : f_SCK = PCLK / 2^(BR + 1) */
+	pclk = spi_get_pclk(SPIx);
+	while (br < 7 && (pclk >> (br + 1)) > cfg->max_freq)
+		br++;
+	SPIx->CR1 &= ~SPI_CR1_BR;
+	SPIx->CR1 |= br << 3;
 
 	/* Set CPOL, CPHA combination */
-	SPIx->CR1 &= ~SPI_CR1_CPOL;  // Idle state is low voltage
-	SPIx->CR1 &= ~SPI_CR1_CPHA;  // Sample on the rising edge
+	SPIx->CR1 &= ~(SPI_CR1_CPOL | SPI_CR1_CPHA);
+	if (cfg->mode & 0x2)
+		SPIx->CR1 |= SPI_CR1_CPOL;  // Idle state is high voltage
+	if (cfg->mode & 0x1)
+		SPIx->CR1 |= SPI_CR1_CPHA;  // Sample on the second edge
 
 	/* Use full-duplex communications */
 	SPIx->CR1 &= ~SPI_CR1_RXONLY;
 	SPIx->CR1 &= ~SPI_CR1_BIDIOE;
-	
-	/* Transmit MSB first */	
-	SPIx->CR1 &= ~SPI_CR1_LSBFIRST;	
 
-	/* Use software slave management */		
-	SPIx->CR1 &= ~SPI_CR1_SSI;  // 0 is forced on the slave-select pin
+	/* Transmit MSB first */
+	SPIx->CR1 &= ~SPI_CR1_LSBFIRST;
+
+	/* Use software slave management (chip select is driven as a GPIO) */
+	SPIx->CR1 |= SPI_CR1_SSI;  // Internal NSS held high so master mode sticks
 	SPIx->CR1 |= SPI_CR1_SSM;  // Software slave management enabled
 
 	/* Configure as master */
-	SPIx->CR1 |= SPI_CR1_MSTR;	
+	SPIx->CR1 |= SPI_CR1_MSTR;
+
+	/* Frame size, with RXNE on a quarter-full FIFO for byte frames */
+	SPIx->CR2 &= ~SPI_CR2_DS;
+	SPIx->CR2 |= (uint32_t) (cfg->data_size - 1) << 8;
+	if (cfg->data_size <= 8)
+		SPIx->CR2 |= SPI_CR2_FRXTH;
+	else
+		SPIx->CR2 &= ~SPI_CR2_FRXTH;
+
+	dma_spi_init(SPIx);
+
+	SPIx->CR1 |= SPI_CR1_SPE;
+}
+
+uint32_t spi_get_pclk(SPI_TypeDef *SPIx)
+{
+	uint32_t hpre = (RCC->CFGR & RCC_CFGR_HPRE) >> 4;
+	uint32_t ppre, hclk = spi_sysclk();
+
+	/* HPRE 0xxx = /1, 1000 - 1011 = /2 - /16, 1100 - 1111 = /64 - /512 */
+	if (hpre & 0x8)
+		hclk >>= (hpre & 0x7) + ((hpre >= 0xC) ? 2 : 1);
+
+	/* PPREx 0xx = /1, 1xx = /2 - /16 */
+	if (SPIx == SPI1)
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> 11;
+	else
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> 8;
+	if (ppre & 0x4)
+		hclk >>= (ppre & 0x3) + 1;
+
+	return hclk;
+}
+
+uint32_t spi_get_freq(SPI_TypeDef *SPIx)
+{
+	return spi_get_pclk(SPIx) >> (((SPIx->CR1 & SPI_CR1_BR) >> 3) + 1);
+}
+
+void spi_set_data_size(SPI_TypeDef *SPIx, uint8_t bits)
+{
+	if (((SPIx->CR2 & SPI_CR2_DS) >> 8) == (uint32_t) (bits - 1))
+		return;
+
+	spi_wait_idle(SPIx);
+	SPIx->CR1 &= ~SPI_CR1_SPE;
+	SPIx->CR2 &= ~SPI_CR2_DS;
+	SPIx->CR2 |= (uint32_t) (bits - 1) << 8;
+	if (bits <= 8)
+		SPIx->CR2 |= SPI_CR2_FRXTH;
+	else
+		SPIx->CR2 &= ~SPI_CR2_FRXTH;
+	SPIx->CR1 |= SPI_CR1_SPE;
+}
+
+void spi_write8(SPI_TypeDef *SPIx, uint8_t data)
+{
+	/* A byte access, so the FIFO does not pack two frames into it */
+	while (!(SPIx->SR & SPI_SR_TXE));
+	*(volatile uint8_t *) &SPIx->DR = data;
+}
+
+void spi_transfer(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n)
+{
+	SPI_XferTypeDef x;
+
+	if (n == 0)
+		return;
+
+	spi_wait_idle(SPIx);
+	spi_xfer_setup(SPIx, &x, tx, rx, n, NULL);
+
+	/* Same two-deep pipeline as the interrupt mode */
+	spi_put(SPIx, &x);
+	if (x.tx_left > 0)
+		spi_put(SPIx, &x);
+
+	while (x.rx_left > 0) {
+		while (!(SPIx->SR & SPI_SR_RXNE));
+		spi_take(SPIx, &x);
+		if (x.tx_left > 0)
+			spi_put(SPIx, &x);
+	}
+}
+
+uint8_t spi_transfer_it(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n,
+			SPI_CallbackTypeDef cb)
+{
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	if (x == NULL || x->busy || n == 0)
+		return 0;
+
+	spi_wait_idle(SPIx);
+	spi_xfer_setup(SPIx, x, tx, rx, n, cb);
+	x->busy = 1;
+
+	spi_put(SPIx, x);
+	if (x->tx_left > 0)
+		spi_put(SPIx, x);
+	SPIx->CR2 |= SPI_CR2_RXNEIE;
+
+	return 1;
+}
+
+uint8_t spi_transfer_dma(SPI_TypeDef *SPIx, const void *tx, void *rx, uint16_t n,
+			 SPI_CallbackTypeDef cb)
+{
+	static const uint16_t fill = SPI_FILL_FRAME;
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	if (x == NULL || x->busy || n == 0)
+		return 0;
+
+	/* Stale frames in the RX FIFO would shift everything received */
+	if (rx != NULL)
+		spi_wait_idle(SPIx);
+
+	x->cb = cb;
+	x->busy = 1;
+
+	if (rx != NULL)
+		SPIx->CR2 |= SPI_CR2_RXDMAEN;
+	dma_spi_start(SPIx, (tx != NULL) ? tx : &fill, rx, n, tx != NULL);
+	SPIx->CR2 |= SPI_CR2_TXDMAEN;
+
+	return 1;
+}
+
+uint8_t spi_repeat_dma(SPI_TypeDef *SPIx, const void *frame, uint16_t n, SPI_CallbackTypeDef cb)
+{
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	if (x == NULL || x->busy || n == 0)
+		return 0;
+
+	x->cb = cb;
+	x->busy = 1;
+
+	dma_spi_start(SPIx, frame, NULL, n, 0);
+	SPIx->CR2 |= SPI_CR2_TXDMAEN;
+
+	return 1;
+}
+
+uint8_t spi_busy(SPI_TypeDef *SPIx)
+{
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	return (x != NULL) ? x->busy : 0;
+}
+
+void spi_wait_idle(SPI_TypeDef *SPIx)
+{
+	while (SPIx->SR & SPI_SR_FTLVL);
+	while (SPIx->SR & SPI_SR_BSY);
+
+	while (SPIx->SR & SPI_SR_FRLVL)
+		(void) *(volatile uint8_t *) &SPIx->DR;
+	(void) SPIx->SR;
+}
+
+void SPI1_IRQHandler(void)
+{
+	spi_irq(SPI1);
+}
+
+void SPI2_IRQHandler(void)
+{
+	spi_irq(SPI2);
+}
+
+void SPI3_IRQHandler(void)
+{
+	spi_irq(SPI3);
+}
+
+/* SPI1 RX, SPI1 TX, SPI2 RX, SPI2 TX, SPI3 RX, SPI3 TX */
+void DMA1_Channel2_IRQHandler(void)
+{
+	spi_dma_irq(SPI1);
+}
+
+void DMA1_Channel3_IRQHandler(void)
+{
+	spi_dma_irq(SPI1);
+}
+
+void DMA1_Channel4_IRQHandler(void)
+{
+	spi_dma_irq(SPI2);
+}
+
+void DMA1_Channel5_IRQHandler(void)
+{
+	spi_dma_irq(SPI2);
+}
+
+void DMA2_Channel1_IRQHandler(void)
+{
+	spi_dma_irq(SPI3);
+}
+
+void DMA2_Channel2_IRQHandler(void)
+{
+	spi_dma_irq(SPI3);
 }
 
 /* Private functions -------------------------------------------------------------*/
@@ -62,50 +319,273 @@ void spi_init(SPI_TypeDef *SPIx)
   * @brief Configures the pins used for the SPIx peripheral :
   *
   *	   SPI1 :
-  *	   (*) PE12 = SPI1_NSS (chip select)
+  *	   (*) PE12 = chip select (GPIO output, driven by the slave's driver)
   *	   (*) PE13 = SPI1_SCK
   *	   (*) PE14 = SPI1_MISO
   *	   (*) PE15 = SPI1_MOSI
   *
   *	   SPI2 :
+  *	   (*) PB13 = SPI2_SCK
+  *	   (*) PB14 = SPI2_MISO
+  *	   (*) PB15 = SPI2_MOSI
   *
   *	   SPI3 :
+  *	   (*) PC10 = SPI3_SCK
+  *	   (*) PC11 = SPI3_MISO
+  *	   (*) PC12 = SPI3_MOSI
   *
   * @param None
   * @retval None
   */
 static void spi_pins_init(SPI_TypeDef *SPIx)
 {
+	GPIO_TypeDef *port;
+	uint32_t pin, last, af;
+
 	if (SPIx == SPI1) {
 		/* Clock GPIO IO port E */
-		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOEEN;	
-	
-		/* Configure PE12 for SPI1_NSS */	
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOEEN;
+
+		/* Configure PE12 as chip select : hardware NSS would only toggle with
+		   SPE, but the chip select has to span a command and its data */
+		GPIOE->BSRR = GPIO_BSRR_BS_12;  // Deselected
 		GPIOE->MODER &= ~GPIO_MODER_MODER12;
-		GPIOE->MODER |= GPIO_MODER_MODER12_1;  // Alternative function mode
-		GPIOE->AFR[1] &= ~GPIO_AFRH_AFRH4;
-		GPIOE->AFR[1] |= PE12_AF5_SPI1_NSS;  // Alternative function 5 = SPI1_NSS
+		GPIOE->MODER |= GPIO_MODER_MODER12_0;  // General purpose output mode
 
-		/* Configure PE13 for SPI1_SCK */	
+		/* Configure PE13 for SPI1_SCK */
 		GPIOE->MODER &= ~GPIO_MODER_MODER13;
 		GPIOE->MODER |= GPIO_MODER_MODER13_1;  // Alternative function mode
 		GPIOE->AFR[1] &= ~GPIO_AFRH_AFRH5;
 		GPIOE->AFR[1] |= PE13_AF5_SPI1_SCK;  // Alternative function 5 = SPI1_SCK
 
-		/* Configure PE14 for SPI1_MISO */	
+		/* Configure PE14 for SPI1_MISO */
 		GPIOE->MODER &= ~GPIO_MODER_MODER14;
 		GPIOE->MODER |= GPIO_MODER_MODER14_1;  // Alternative function mode
 		GPIOE->AFR[1] &= ~GPIO_AFRH_AFRH6;
 		GPIOE->AFR[1] |= PE14_AF5_SPI1_MISO;  // Alternative function 5 = SPI1_MISO
 
-		/* Configure PE15 for SPI1_MOSI */	
+		/* Configure PE15 for SPI1_MOSI */
 		GPIOE->MODER &= ~GPIO_MODER_MODER15;
 		GPIOE->MODER |= GPIO_MODER_MODER15_1;  // Alternative function mode
 		GPIOE->AFR[1] &= ~GPIO_AFRH_AFRH7;
 		GPIOE->AFR[1] |= PE15_AF5_SPI1_MOSI;  // Alternative function 5 = SPI1_MOSI
-	} else if (SPIx == SPI2) {
-		/* Not needed right now */	
+
+		/* SCK and MOSI toggle at up to PCLK / 2 */
+		GPIOE->OSPEEDR |= GPIO_OSPEEDER_OSPEEDR13 | GPIO_OSPEEDER_OSPEEDR15;
+		return;
+	}
+
+	/* SPI2 and SPI3 use three consecutive pins in the high half of the port */
+	if (SPIx == SPI2) {
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOBEN;
+		port = GPIOB;
+		pin = 13;
+		last = 15;
+		af = SPI_AF_SPI1_SPI2;
 	} else if (SPIx == SPI3) {
-		/* Not needed right now */	
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOCEN;
+		port = GPIOC;
+		pin = 10;
+		last = 12;
+		af = SPI_AF_SPI3;
+	} else {
+		return;
 	}
+
+	for (; pin <= last; pin++) {
+		port->MODER &= ~(0x3U << (2 * pin));
+		port->MODER |= 0x2U << (2 * pin);  // Alternative function mode
+		port->AFR[1] &= ~(0xFU << (4 * (pin - 8)));
+		port->AFR[1] |= af << (4 * (pin - 8));
+		port->OSPEEDR |= 0x3U << (2 * pin);  // Very high speed
+	}
+}
+
+/**
+  * @brief Returns the transfer state of SPIx.
+  * @param SPIx : SPI peripheral.
+  * @retval The state, or NULL for anything but SPI1 - SPI3
+  */
+static SPI_XferTypeDef *spi_xfer(SPI_TypeDef *SPIx)
+{
+	if (SPIx == SPI1)
+		return &xfer[0];
+	if (SPIx == SPI2)
+		return &xfer[1];
+	if (SPIx == SPI3)
+		return &xfer[2];
+	return NULL;
+}
+
+/**
+  * @brief Loads a transfer into x, taking the frame width from SPIx.
+  * @param SPIx : SPI peripheral.
+  * @param x : Its transfer state.
+  * @param tx : Frames to send, or NULL.
+  * @param rx : Where to store the frames received, or NULL.
+  * @param n : Number of frames.
+  * @param cb : Completion callback, or NULL.
+  * @retval None
+  */
+static void spi_xfer_setup(SPI_TypeDef *SPIx, SPI_XferTypeDef *x, const void *tx, void *rx,
+			   uint16_t n, SPI_CallbackTypeDef cb)
+{
+	x->tx = tx;
+	x->rx = rx;
+	x->tx_left = n;
+	x->rx_left = n;
+	x->wide = ((SPIx->CR2 & SPI_CR2_DS) >> 8) >= 8;
+	x->cb = cb;
+}
+
+/**
+  * @brief Queues the next frame, with an access as wide as the frame.
+  *	   Half-words are copied out of the byte buffer, which need not be
+  *	   aligned or hold uint16_t objects.
+  * @param SPIx : SPI peripheral.
+  * @param x : Its transfer state.
+  * @retval None
+  */
+static void spi_put(SPI_TypeDef *SPIx, SPI_XferTypeDef *x)
+{
+	uint16_t frame = SPI_FILL_FRAME;
+
+	if (x->wide) {
+		if (x->tx != NULL) {
+			memcpy(&frame, x->tx, sizeof(frame));
+			x->tx += 2;
+		}
+		*(volatile uint16_t *) &SPIx->DR = frame;
+	} else {
+		if (x->tx != NULL)
+			frame = *x->tx++;
+		*(volatile uint8_t *) &SPIx->DR = (uint8_t) frame;
+	}
+	x->tx_left--;
+}
+
+/**
+  * @brief Reads the next received frame.
+  * @param SPIx : SPI peripheral.
+  * @param x : Its transfer state.
+  * @retval None
+  */
+static void spi_take(SPI_TypeDef *SPIx, SPI_XferTypeDef *x)
+{
+	uint16_t frame;
+
+	if (x->wide) {
+		frame = *(volatile uint16_t *) &SPIx->DR;
+		if (x->rx != NULL) {
+			memcpy(x->rx, &frame, sizeof(frame));
+			x->rx += 2;
+		}
+	} else {
+		frame = *(volatile uint8_t *) &SPIx->DR;
+		if (x->rx != NULL)
+			*x->rx++ = (uint8_t) frame;
+	}
+	x->rx_left--;
+}
+
+/**
+  * @brief RXNE : takes the frame that came in and queues the next one, so
+  *	   two stay in flight until the end.
+  * @param SPIx : SPI peripheral.
+  * @retval None
+  */
+static void spi_irq(SPI_TypeDef *SPIx)
+{
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	if (!(SPIx->SR & SPI_SR_RXNE) || !x->busy)
+		return;
+
+	spi_take(SPIx, x);
+	if (x->tx_left > 0)
+		spi_put(SPIx, x);
+
+	if (x->rx_left == 0) {
+		SPIx->CR2 &= ~SPI_CR2_RXNEIE;
+		x->busy = 0;
+		if (x->cb != NULL)
+			x->cb();
+	}
+}
+
+/**
+  * @brief Ends a DMA transfer : releases the SPI's DMA requests, then tells
+  *	   the owner, which may start the next transfer from the callback.
+  * @param SPIx : SPI peripheral.
+  * @retval None
+  */
+static void spi_dma_irq(SPI_TypeDef *SPIx)
+{
+	SPI_XferTypeDef *x = spi_xfer(SPIx);
+
+	if (!dma_spi_complete(SPIx))
+		return;
+
+	SPIx->CR2 &= ~(SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+	x->busy = 0;
+	if (x->cb != NULL)
+		x->cb();
+}
+
+/**
+  * @brief Follows the SYSCLK mux to the frequency it selects.
+  * @param None
+  * @retval SYSCLK (Hz)
+  */
+static uint32_t spi_sysclk(void)
+{
+	uint32_t pllcfgr = RCC->PLLCFGR;
+	uint32_t m, n, r;
+
+	switch (RCC->CFGR & RCC_CFGR_SWS) {
+	case RCC_CFGR_SWS_HSI:
+		return SPI_HSI_FREQ;
+	case RCC_CFGR_SWS_HSE:
+		return SPI_HSE_FREQ;
+	case RCC_CFGR_SWS_PLL:
+		/* f_VCO = f_in / PLLM * PLLN; PLLCLK = f_VCO / PLLR */
+		m = ((pllcfgr & RCC_PLLCFGR_PLLM) >> 4) + 1;
+		n = (pllcfgr & RCC_PLLCFGR_PLLN) >> 8;
+		r = (((pllcfgr & RCC_PLLCFGR_PLLR) >> 25) + 1) * 2;
+		return (uint32_t) ((uint64_t) spi_pll_input() * n / (m * r));
+	default:
+		return spi_msi();
+	}
+}
+
+/**
+  * @brief Follows the PLL source mux.
+  * @param None
+  * @retval PLL input (Hz)
+  */
+static uint32_t spi_pll_input(void)
+{
+	switch (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) {
+	case RCC_PLLCFGR_PLLSRC_HSI:
+		return SPI_HSI_FREQ;
+	case RCC_PLLCFGR_PLLSRC_HSE:
+		return SPI_HSE_FREQ;
+	default:
+		return spi_msi();
+	}
+}
+
+/**
+  * @brief MSI runs at the range in RCC_CR once MSIRGSEL is set; before that
+  *	   it is still on its reset range.
+  * @param None
+  * @retval MSI (Hz)
+  */
+static uint32_t spi_msi(void)
+{
+	uint32_t range = (RCC->CR & RCC_CR_MSIRANGE) >> 4;
+
+	if (!(RCC->CR & RCC_CR_MSIRGSEL) || range >= 12)
+		return SPI_MSI_RESET_FREQ;
+	return (uint32_t) msi_khz[range] * 1000U;
 }
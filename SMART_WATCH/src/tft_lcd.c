@@ -1,7 +1,282 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/tft_lcd.c                                            *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    06-July-2017                                                         *
+ * @brief   Color LCD Application-level Interface (ILI9340C panel).              *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
 #include "../include/tft_lcd_interface.h"
 #include "../include/ili9340c.h"
+#include "../include/delay.h"
+#include <stddef.h>
+
+/*
+ * Coordinates : (0,0) is the top-left pixel of the portrait panel, x grows to
+ * the right and y grows downward. Drawing is clipped to the panel and to the
+ * rectangle set with LCD_set_clip.
+ */
 
 struct _LCD_screen
 {
-
+	uint16_t width;		/*!< Columns */
+	uint16_t height;	/*!< Rows */
+	uint32_t background;	/*!< Background color (0xRRGGBB) */
+	uint8_t brightness;	/*!< Last value sent with SET_BRTNSS */
+	uint8_t on;		/*!< Display output enabled */
+	uint8_t in_use;		/*!< Handed out by get_LCD_instance */
+	SHAPE_RectTypeDef clip;	/*!< Drawing is confined to this area */
+	uint8_t vsync;		/*!< Frames are paced by TE */
+	uint32_t last_te;	/*!< TE count at the previous LCD_begin_frame */
+	LCD_FrameStatsTypeDef frame_stats;
 };
+
+/* There is one panel, so there is one (statically allocated) instance */
+static LCD_screen screen;
+static uint8_t hw_ready;
+
+/* Strip buffers for LCD_render : one is rendered while DMA sends the other */
+static uint16_t strip[2][LCD_STRIP_PIXELS];
+
+/* Private function prototypes ---------------------------------------------------*/
+static void lcd_fill_rect(LCD_screen *lcd, SHAPE_RectTypeDef r, uint32_t color);
+static void lcd_fill_buf(uint16_t *buf, uint32_t npixels, uint16_t color);
+
+/* Public functions --------------------------------------------------------------*/
+
+LCD_screen *get_LCD_instance(void)
+{
+	if (screen.in_use)
+		return NULL;
+
+	if (!hw_ready) {
+		ILI9340C_init();
+		hw_ready = 1;
+	}
+
+	screen.width = ILI9340C_WIDTH;
+	screen.height = ILI9340C_HEIGHT;
+	screen.background = 0x000000;
+	screen.brightness = LCD_MAX_BRIGHTNESS;
+	screen.on = 0;
+	screen.in_use = 1;
+	screen.vsync = 0;
+	LCD_set_clip(&screen, NULL);
+
+	return &screen;
+}
+
+void destroy_LCD_instance(LCD_screen *lcd)
+{
+	LCD_set_vsync(lcd, 0);
+	LCD_turn_off(lcd);
+	lcd->in_use = 0;
+}
+
+void LCD_turn_on(LCD_screen *lcd)
+{
+	ILI9340C_write_cmd(ILI9340C_DISP_ON, NULL, 0);
+	lcd->on = 1;
+}
+
+void LCD_turn_off(LCD_screen *lcd)
+{
+	ILI9340C_write_cmd(ILI9340C_DISP_OFF, NULL, 0);
+	lcd->on = 0;
+}
+
+void LCD_draw_shape(LCD_screen *lcd, SHAPE_TypeDef *shape, int x, int y)
+{
+	SHAPE_InstanceTypeDef inst = {shape, x, y};
+	const SHAPE_InstanceTypeDef *list = &inst;
+	SHAPE_RectTypeDef r;
+
+	SHAPE_get_bounds(shape, x, y, &r);
+
+	/* Solid rectangles need no pixels from the CPU at all */
+	if (shape->type == SHAPE_FILLED_RECT) {
+		lcd_fill_rect(lcd, r, shape->color);
+		return;
+	}
+
+	LCD_render(lcd, &r, &list, 1);
+}
+
+void LCD_set_background(LCD_screen *lcd, uint32_t color)
+{
+	lcd->background = color;
+	lcd_fill_rect(lcd, lcd->clip, color);
+}
+
+void LCD_set_brightness(LCD_screen *lcd, uint8_t brtnss)
+{
+	ILI9340C_write_cmd(ILI9340C_SET_BRTNSS, &brtnss, 1);
+	lcd->brightness = brtnss;
+}
+
+void LCD_render(LCD_screen *lcd, const SHAPE_RectTypeDef *area, const SHAPE_InstanceTypeDef *const *list, uint8_t n)
+{
+	SHAPE_RectTypeDef r, s;
+	uint16_t bg = ILI9340C_RGB565(lcd->background);
+	uint32_t w, h, lines, npixels;
+	uint8_t b = 0, i;
+
+	if (!SHAPE_rect_intersect(area, &lcd->clip, &r))
+		return;
+
+	/* Narrow areas get taller strips so each DMA stream stays long. The
+	   clipped area is never empty, so widths and heights are unsigned */
+	w = (uint32_t) (r.x1 - r.x0) + 1;
+	lines = LCD_STRIP_PIXELS / w;
+
+	ILI9340C_set_window(r.x0, r.y0, r.x1, r.y1);
+
+	s.x0 = r.x0;
+	s.x1 = r.x1;
+	for (s.y0 = r.y0; s.y0 <= r.y1; s.y0 = s.y1 + 1) {
+		h = (uint32_t) (r.y1 - s.y0) + 1;
+		if (h > lines)
+			h = lines;
+		s.y1 = (int16_t) (s.y0 + h - 1);
+		npixels = w * h;
+
+		/* strip[b] went out two streams ago and the previous stream only
+		   started once that one was done, so it is free to overwrite */
+		lcd_fill_buf(strip[b], npixels, bg);
+		for (i = 0; i < n; i++)
+			SHAPE_raster(list[i]->shape, list[i]->x, list[i]->y, &s, strip[b]);
+
+		ILI9340C_write_pixels(strip[b], npixels);
+		b ^= 1;
+	}
+}
+
+void LCD_set_clip(LCD_screen *lcd, const SHAPE_RectTypeDef *clip)
+{
+	SHAPE_RectTypeDef panel = {0, 0, lcd->width - 1, lcd->height - 1};
+
+	if (clip == NULL || !SHAPE_rect_intersect(clip, &panel, &lcd->clip)) {
+		lcd->clip = panel;
+		if (clip != NULL)
+			lcd->clip.x1 = -1;	// Nothing on the panel is writable
+	}
+}
+
+void LCD_get_clip(LCD_screen *lcd, SHAPE_RectTypeDef *clip)
+{
+	*clip = lcd->clip;
+}
+
+uint8_t LCD_set_vsync(LCD_screen *lcd, uint8_t on)
+{
+	uint32_t te;
+
+	if (!on) {
+		if (lcd->vsync)
+			ILI9340C_te_enable(0);
+		lcd->vsync = 0;
+		return 0;
+	}
+
+	if (lcd->vsync)
+		return 1;
+
+	ILI9340C_te_enable(1);
+	te = ILI9340C_get_te_count();
+	delay(LCD_TE_TIMEOUT_MS);
+	if (ILI9340C_get_te_count() == te) {
+		ILI9340C_te_enable(0);
+		return 0;
+	}
+
+	lcd->vsync = 1;
+	lcd->last_te = ILI9340C_get_te_count();
+	return 1;
+}
+
+void LCD_begin_frame(LCD_screen *lcd, int16_t top)
+{
+	uint32_t te = ILI9340C_get_te_count();
+	uint32_t n = te - lcd->last_te;
+
+	lcd->frame_stats.frames++;
+	if (lcd->vsync) {
+		lcd->frame_stats.refreshes += n;
+		lcd->frame_stats.hist[(n < LCD_FRAME_HIST_BINS) ? n : LCD_FRAME_HIST_BINS - 1]++;
+	}
+	lcd->last_te = te;
+
+	if (!lcd->vsync)
+		return;
+
+	if (top < 0)
+		top = 0;
+	if (top >= lcd->height)
+		top = lcd->height - 1;
+
+	/* SET_TEARLN goes out before the window : commands end a RAMWRITE */
+	ILI9340C_set_tear_line((uint16_t) top);
+	ILI9340C_arm_te();
+}
+
+void LCD_get_frame_stats(LCD_screen *lcd, LCD_FrameStatsTypeDef *stats)
+{
+	*stats = lcd->frame_stats;
+}
+
+uint8_t LCD_busy(LCD_screen *lcd)
+{
+	(void) lcd;
+	return ILI9340C_busy();
+}
+
+uint32_t LCD_get_tx_bytes(LCD_screen *lcd)
+{
+	(void) lcd;
+	return ILI9340C_get_tx_bytes();
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Fills a rectangle, clipped to the current clip area. The fill is
+  *	   queued on DMA; the next LCD call waits for it to finish.
+  * @param lcd : The LCD screen.
+  * @param r : Inclusive rectangle.
+  * @param color : Fill color (0xRRGGBB).
+  * @retval None
+  */
+static void lcd_fill_rect(LCD_screen *lcd, SHAPE_RectTypeDef r, uint32_t color)
+{
+	if (!SHAPE_rect_intersect(&r, &lcd->clip, &r))
+		return;
+
+	ILI9340C_set_window(r.x0, r.y0, r.x1, r.y1);
+	ILI9340C_fill(ILI9340C_RGB565(color), (uint32_t) (r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1));
+}
+
+/**
+  * @brief Sets every pixel of a strip buffer to one color, two at a time.
+  * @param buf : Strip buffer (32-bit aligned).
+  * @param npixels : Number of pixels.
+  * @param color : RGB565 color.
+  * @retval None
+  */
+static void lcd_fill_buf(uint16_t *buf, uint32_t npixels, uint16_t color)
+{
+	uint32_t *p = (uint32_t *) buf;
+	uint32_t pair = ((uint32_t) color << 16) | color;
+	uint32_t i;
+
+	for (i = 0; i < npixels / 2; i++)
+		*p++ = pair;
+	if (npixels & 1)
+		buf[npixels - 1] = color;
+}
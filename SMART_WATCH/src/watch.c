@@ -0,0 +1,379 @@
+/*********************************************************************************\
+ * @file    SMART_WATCH/src/watch.c                                              *
+ * @author  Nolan R. H. Gagnon                                                   *
+ * @version V1.0                                                                 *
+ * @date    19-July-2017                                                         *
+ * @brief   Event-driven watch runtime.	                                         *
+ *                                                                               *
+ *********************************************************************************
+ * @attention									 *
+ *										 *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>        *
+ *										 *
+\*********************************************************************************/
+
+/* Includes ----------------------------------------------------------------------*/
+#include "../include/watch.h"
+#include "../include/delay.h"
+#include <stddef.h>
+
+/*
+ * Nothing polls : the LPTIM1 tick (LSE, alive in Stop 2) and the button EXTI
+ * post events, and the main loop sleeps whenever none are pending. Stop 2 is
+ * only entered with the LCD bus idle, because SPI1 and DMA1 are not clocked
+ * in it; while a frame is still streaming (or waiting for TE) the core uses
+ * Sleep, which the DMA and EXTI interrupts end. SysTick is held off while
+ * asleep so it does not wake the core every millisecond.
+ *
+ * Time awake is measured with the DWT cycle counter from each wakeup to the
+ * next sleep, and compared against LPTIM1 time for the duty cycle.
+ */
+
+/* Private functions -------------------------------------------------------------*/
+static void watch_lse_init(void);
+static void watch_lptim1_init(void);
+static void watch_button_init(void);
+static void watch_sleep(void);
+static void watch_dispatch(uint32_t events);
+static uint32_t watch_read_cnt(void);
+static uint64_t watch_ticks(void);
+
+/* Private variables -------------------------------------------------------------*/
+static LCD_screen *watch_lcd;
+static WATCH_WidgetTypeDef *widgets[WATCH_MAX_WIDGETS];
+static uint8_t nwidgets;
+static uint32_t cycles_per_us;
+static uint32_t day_start;		// Time of day at WATCH_init (s)
+static void (*restore)(void);
+
+static volatile uint32_t pending;	// Events not handled yet
+static volatile uint32_t seconds;	// LPTIM1 auto-reload matches
+
+/* Statistics */
+static WATCH_StatsTypeDef watch_stats;
+static uint64_t awake_cycles;		// Since the stats were reset
+static uint64_t stats_start;		// watch_ticks() at the reset
+static uint32_t wake_cycle;		// DWT->CYCCNT at the latest wakeup
+
+/* Public functions --------------------------------------------------------------*/
+
+void WATCH_init(LCD_screen *lcd, uint32_t cpu_freq, void (*clock_restore)(void), uint32_t start_s)
+{
+	watch_lcd = lcd;
+	day_start = start_s % 86400U;
+	cycles_per_us = cpu_freq / 1000000U;
+	restore = clock_restore;
+	nwidgets = 0;
+	pending = 0;
+	seconds = 0;
+
+	/* Cycle counter for awake time and render cost */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	watch_lse_init();
+	watch_lptim1_init();
+	watch_button_init();
+
+	/* Stop 2 is the deepest mode that keeps LPTIM1 and SRAM; wake on HSI16 */
+	PWR->CR1 &= ~PWR_CR1_LPMS;
+	PWR->CR1 |= PWR_CR1_LPMS_STOP2;
+	RCC->CFGR |= RCC_CFGR_STOPWUCK;
+
+	WATCH_reset_stats();
+}
+
+int WATCH_add(WATCH_WidgetTypeDef *widget)
+{
+	if (nwidgets >= WATCH_MAX_WIDGETS)
+		return -1;
+
+	widgets[nwidgets++] = widget;
+	return 0;
+}
+
+void WATCH_post(uint32_t events)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	pending |= events;
+	__set_PRIMASK(primask);
+}
+
+uint32_t WATCH_seconds(void)
+{
+	return seconds;
+}
+
+uint32_t WATCH_time_of_day(void)
+{
+	return (day_start + seconds) % 86400U;
+}
+
+void WATCH_run(void)
+{
+	uint32_t events;
+
+	while (1) {
+		/* Masked between the test and the WFI so no event is slept through;
+		   the handler runs once PRIMASK is cleared */
+		__disable_irq();
+		events = pending;
+		pending = 0;
+		if (events == 0)
+			watch_sleep();
+		__enable_irq();
+
+		if (events != 0)
+			watch_dispatch(events);
+	}
+}
+
+void WATCH_get_stats(WATCH_StatsTypeDef *stats)
+{
+	uint64_t elapsed = watch_ticks() - stats_start;
+	uint64_t awake = awake_cycles + (DWT->CYCCNT - wake_cycle);
+
+	*stats = watch_stats;
+	stats->duty_ppm = 0;
+	if (elapsed > 0) {
+		/* Cycles to LPTIM1 ticks, then a share of the elapsed ticks */
+		awake = awake * WATCH_TICKS_PER_SEC / (cycles_per_us * 1000000U);
+		stats->duty_ppm = (uint32_t) (awake * 1000000U / elapsed);
+	}
+}
+
+void WATCH_reset_stats(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	watch_stats.wakeups = 0;
+	watch_stats.stops = 0;
+	watch_stats.events = 0;
+	watch_stats.frames = 0;
+	watch_stats.duty_ppm = 0;
+	watch_stats.last_render_us = 0;
+	watch_stats.max_render_us = 0;
+	watch_stats.last_render_bytes = 0;
+	awake_cycles = 0;
+	wake_cycle = DWT->CYCCNT;
+	stats_start = watch_ticks();
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief Counts seconds and posts the tick.
+  * @param None
+  * @retval None
+  */
+void LPTIM1_IRQHandler(void)
+{
+	if (LPTIM1->ISR & LPTIM_ISR_ARRM) {
+		LPTIM1->ICR = LPTIM_ICR_ARRMCF;
+		seconds++;
+		WATCH_post(WATCH_EVT_TICK);
+	}
+}
+
+/**
+  * @brief Posts a button press. Bounces land in the same pending word, so
+  *	   they merge into one event instead of needing a debounce delay.
+  * @param None
+  * @retval None
+  */
+void EXTI0_IRQHandler(void)
+{
+	if (EXTI->PR1 & EXTI_PR1_PIF0) {
+		EXTI->PR1 = EXTI_PR1_PIF0;
+		WATCH_post(WATCH_EVT_BUTTON);
+	}
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Starts the 32.768 kHz crystal if it is not already running. It is
+  *	   in the backup domain, so it may survive a reset.
+  * @param None
+  * @retval None
+  */
+static void watch_lse_init(void)
+{
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+	(void) RCC->APB1ENR1;  // Delay after an RCC peripheral clock enabling
+
+	PWR->CR1 |= PWR_CR1_DBP;  // Enable write access to Backup domain
+	while ((PWR->CR1 & PWR_CR1_DBP) == 0);
+
+	if ((RCC->BDCR & RCC_BDCR_LSERDY) == 0) {
+		RCC->BDCR |= RCC_BDCR_LSEON;
+		while ((RCC->BDCR & RCC_BDCR_LSERDY) == 0);
+	}
+}
+
+/**
+  * @brief Runs LPTIM1 from LSE with a 1 s auto-reload period. Its interrupt
+  *	   reaches the core in Stop 2 through EXTI line 32.
+  * @param None
+  * @retval None
+  */
+static void watch_lptim1_init(void)
+{
+	RCC->APB1ENR1 |= RCC_APB1ENR1_LPTIM1EN;
+
+	RCC->CCIPR &= ~RCC_CCIPR_LPTIM1SEL;
+	RCC->CCIPR |= LPTIM1_CLKSRC_LSE;
+
+	// CFGR and IER may only be written while the timer is disabled
+	LPTIM1->CR &= ~LPTIM_CR_ENABLE;
+	LPTIM1->CFGR = 0;	// Internal clock, prescaler /1, software start
+	LPTIM1->IER = LPTIM_IER_ARRMIE;
+	LPTIM1->CR |= LPTIM_CR_ENABLE;
+
+	// ARR may only be written while the timer is enabled
+	LPTIM1->ARR = WATCH_TICKS_PER_SEC - 1;
+	while (!(LPTIM1->ISR & LPTIM_ISR_ARROK));
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+
+	EXTI->IMR2 |= EXTI_IMR2_IM32;
+
+	NVIC_SetPriority(LPTIM1_IRQn, 2);
+	NVIC_EnableIRQ(LPTIM1_IRQn);
+
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+}
+
+/**
+  * @brief Configures the user button (PA0, joystick center) to interrupt on
+  *	   the press.
+  * @param None
+  * @retval None
+  */
+static void watch_button_init(void)
+{
+	// Enable Port A I/O Clock
+	RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+
+	// Configure PA0 as a digital input pin (pulled down on the board)
+	GPIOA->MODER &= ~GPIO_MODER_MODER0;
+
+	// Connect EXTI0 to PA0
+	RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+	SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI0;
+	SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI0_PA;
+
+	// Rising edge only, then unmask
+	EXTI->RTSR1 |= EXTI_RTSR1_RT0;
+	EXTI->FTSR1 &= ~EXTI_FTSR1_FT0;
+	EXTI->PR1 = EXTI_PR1_PIF0;
+	EXTI->IMR1 |= EXTI_IMR1_IM0;
+
+	NVIC_SetPriority(EXTI0_IRQn, 3);
+	NVIC_EnableIRQ(EXTI0_IRQn);
+}
+
+/**
+  * @brief Sleeps until an interrupt is pending. Called with interrupts
+  *	   masked; returns with them still masked.
+  * @param None
+  * @retval None
+  */
+static void watch_sleep(void)
+{
+	uint8_t deep = (restore != NULL) && !LCD_busy(watch_lcd);
+
+	awake_cycles += DWT->CYCCNT - wake_cycle;
+
+	SysTick->CTRL &= ~SysTick_CTRL_TICKINT;
+	if (deep)
+		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	__DSB();
+	__WFI();
+
+	if (deep) {
+		SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+		restore();
+		watch_stats.stops++;
+	}
+	SysTick->CTRL |= SysTick_CTRL_TICKINT;
+
+	wake_cycle = DWT->CYCCNT;
+	watch_stats.wakeups++;
+}
+
+/**
+  * @brief Lets every widget listening for the events update, then commits
+  *	   a frame if any changed the screen.
+  * @param events : Pending WATCH_EVT_* bits.
+  * @retval None
+  */
+static void watch_dispatch(uint32_t events)
+{
+	COMP_StatsTypeDef cs;
+	uint32_t start = DWT->CYCCNT;
+	uint32_t us;
+	uint8_t changed = 0;
+	uint8_t i;
+
+	watch_stats.events++;
+
+	for (i = 0; i < nwidgets; i++) {
+		if (widgets[i]->events & events)
+			changed |= widgets[i]->update(widgets[i], events);
+	}
+
+	if (!changed)
+		return;
+
+	COMP_commit();
+
+	us = (DWT->CYCCNT - start) / cycles_per_us;
+	COMP_get_stats(&cs);
+	watch_stats.frames++;
+	watch_stats.last_render_us = us;
+	watch_stats.last_render_bytes = cs.bytes;
+	if (us > watch_stats.max_render_us)
+		watch_stats.max_render_us = us;
+}
+
+/**
+  * @brief CNT is clocked asynchronously, so read until two reads agree.
+  * @param None
+  * @retval LPTIM1 counter value
+  */
+static uint32_t watch_read_cnt(void)
+{
+	uint32_t a, b;
+
+	do {
+		a = LPTIM1->CNT;
+		b = LPTIM1->CNT;
+	} while (a != b);
+
+	return a;
+}
+
+/**
+  * @brief Returns a free-running 32768 Hz tick count.
+  * @param None
+  * @retval Tick count
+  */
+static uint64_t watch_ticks(void)
+{
+	uint32_t s, c;
+
+	do {
+		s = seconds;
+		c = watch_read_cnt();
+	} while (s != seconds);
+
+	// Counter wrapped but the match has not been serviced yet (IRQs masked)
+	if ((LPTIM1->ISR & LPTIM_ISR_ARRM) && c < (WATCH_TICKS_PER_SEC / 2))
+		s++;
+
+	return ((uint64_t) s << WATCH_TICKS_SHIFT) + c;
+}
@@ -0,0 +1,289 @@
+/**********************************************************************************\
+ * @file    SWTIMER/src/swtimer.c                                                 *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    21-July-2017                                                          *
+ * @brief   Tickless software timers on an LPTIM, shared by the projects. The     *
+ *          LPTIM, its clock and interrupt masking come from the swtimer.h and    *
+ *          irq.h of the project it is built into.                                *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>         *
+ *                                                                                *
+\**********************************************************************************/
+
+#include <stm32l476xx.h>
+#include <stddef.h>
+#include "swtimer.h"
+#include "irq.h"
+
+/* Private variables -------------------------------------------------------------*/
+
+/* The LPTIM handler and the callbacks change the list too : masked around it */
+static SWTIMER_TypeDef *head;		// Running timers, earliest expiry first
+static volatile uint32_t wraps;		// LPTIM auto-reload matches
+static uint32_t cmp_loaded;		// Value last written to CMP
+
+/* Private functions -------------------------------------------------------------*/
+static uint32_t swtimer_read_cnt(void);
+static void swtimer_insert(SWTIMER_TypeDef *timer);
+static void swtimer_unlink(SWTIMER_TypeDef *timer);
+static void swtimer_arm(void);
+static void swtimer_expire(void);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void swtimer_init(void)
+{
+	head = NULL;
+	wraps = 0;
+
+#if SWTIMER_START_LSI
+	// LSI keeps running in Stop modes
+	RCC->CSR |= RCC_CSR_LSION;
+	while (!(RCC->CSR & RCC_CSR_LSIRDY));
+#endif
+
+	SWTIMER_RCC_ENR |= SWTIMER_RCC_EN;
+	RCC->CCIPR &= ~SWTIMER_CLKSEL;
+	RCC->CCIPR |= SWTIMER_CLKSRC;
+
+	// CFGR and IER may only be written while the timer is disabled
+	SWTIMER_LPTIM->CR &= ~LPTIM_CR_ENABLE;
+	SWTIMER_LPTIM->CFGR = SWTIMER_PRESC;	// Internal clock, software start
+	SWTIMER_LPTIM->IER = LPTIM_IER_ARRMIE | LPTIM_IER_CMPMIE;
+	SWTIMER_LPTIM->CR |= LPTIM_CR_ENABLE;
+
+	// ARR and CMP may only be written while the timer is enabled
+	SWTIMER_LPTIM->ARR = SWTIMER_CNT_MASK;
+	while (!(SWTIMER_LPTIM->ISR & LPTIM_ISR_ARROK));
+	SWTIMER_LPTIM->ICR = LPTIM_ICR_ARROKCF;
+
+	SWTIMER_LPTIM->CMP = 0;
+	while (!(SWTIMER_LPTIM->ISR & LPTIM_ISR_CMPOK));
+	SWTIMER_LPTIM->ICR = LPTIM_ICR_CMPOKCF;
+	cmp_loaded = 0;
+
+	NVIC_SetPriority(SWTIMER_IRQn, 2);
+	NVIC_EnableIRQ(SWTIMER_IRQn);
+
+	SWTIMER_LPTIM->CR |= LPTIM_CR_CNTSTRT;
+}
+
+void swtimer_start(SWTIMER_TypeDef *timer, uint32_t delay_ms, uint32_t period_ms,
+		   SWTIMER_CallbackTypeDef callback, void *arg)
+{
+	uint32_t primask = irq_save();
+
+	swtimer_unlink(timer);
+
+	timer->callback = callback;
+	timer->arg = arg;
+	timer->period = (period_ms != 0) ? swtimer_ms_to_ticks(period_ms) : 0;
+
+	/* The current tick is already partly over : one more makes sure the
+	   delay is never short */
+	timer->expiry = swtimer_ticks() + swtimer_ms_to_ticks(delay_ms) + 1;
+	timer->active = 1;
+
+	swtimer_insert(timer);
+	if (head == timer)
+		swtimer_arm();
+
+	irq_restore(primask);
+}
+
+void swtimer_stop(SWTIMER_TypeDef *timer)
+{
+	uint32_t primask = irq_save();
+
+	swtimer_unlink(timer);
+	timer->active = 0;
+
+	irq_restore(primask);
+}
+
+uint8_t swtimer_active(const SWTIMER_TypeDef *timer)
+{
+	return timer->active;
+}
+
+uint32_t swtimer_ticks(void)
+{
+	uint32_t w, c;
+
+	do {
+		w = wraps;
+		c = swtimer_read_cnt();
+	} while (w != wraps);
+
+	/* The auto-reload match comes with CNT = ARR, one count before the
+	   counter goes back to 0 : count from there so the tick count never
+	   runs ahead of a wrap that has been counted */
+	c = (c + 1) & SWTIMER_CNT_MASK;
+
+	// Counter wrapped but the match has not been serviced yet (IRQs masked)
+	if ((SWTIMER_LPTIM->ISR & LPTIM_ISR_ARRM) && c <= (SWTIMER_CNT_MASK >> 1))
+		w++;
+
+	return (w << 16) + c;
+}
+
+uint32_t swtimer_ms_to_ticks(uint32_t ms)
+{
+	uint64_t ticks = ((uint64_t) ms * SWTIMER_TICK_HZ + 999U) / 1000U;
+
+	return (ticks > SWTIMER_MAX_TICKS) ? SWTIMER_MAX_TICKS : (uint32_t) ticks;
+}
+
+/**
+  * @brief Counts counter wraps and runs the timers that are due.
+  * @param None
+  * @retval None
+  */
+void SWTIMER_IRQHandler(void)
+{
+	uint32_t isr = SWTIMER_LPTIM->ISR;
+
+	if (isr & LPTIM_ISR_ARRM) {
+		SWTIMER_LPTIM->ICR = LPTIM_ICR_ARRMCF;
+		wraps++;
+	}
+	if (isr & LPTIM_ISR_CMPM)
+		SWTIMER_LPTIM->ICR = LPTIM_ICR_CMPMCF;
+
+	swtimer_expire();
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief CNT is clocked asynchronously, so read until two reads agree.
+  * @param None
+  * @retval LPTIM counter value
+  */
+static uint32_t swtimer_read_cnt(void)
+{
+	uint32_t a, b;
+
+	do {
+		a = SWTIMER_LPTIM->CNT;
+		b = SWTIMER_LPTIM->CNT;
+	} while (a != b);
+
+	return a;
+}
+
+/**
+  * @brief Links a timer into the list after those due at the same tick or
+  *	   earlier, so timers with equal expiries run in the order started.
+  *	   Interrupts must be masked.
+  * @param timer : Timer to insert (not in the list).
+  * @retval None
+  */
+static void swtimer_insert(SWTIMER_TypeDef *timer)
+{
+	SWTIMER_TypeDef **p = &head;
+
+	while (*p != NULL && (int32_t) ((*p)->expiry - timer->expiry) <= 0)
+		p = &(*p)->next;
+
+	timer->next = *p;
+	*p = timer;
+}
+
+/**
+  * @brief Takes a timer out of the list if it is there. The compare register
+  *	   is left as it is : an early match finds nothing due. Interrupts must
+  *	   be masked.
+  * @param timer : Timer to remove.
+  * @retval None
+  */
+static void swtimer_unlink(SWTIMER_TypeDef *timer)
+{
+	SWTIMER_TypeDef **p = &head;
+
+	while (*p != NULL && *p != timer)
+		p = &(*p)->next;
+
+	if (*p != NULL)
+		*p = timer->next;
+	timer->next = NULL;
+}
+
+/**
+  * @brief Loads the first expiry into the compare register once it is less
+  *	   than a counter wrap away; further ones are loaded by the auto-reload
+  *	   match. Interrupts must be masked.
+  * @param None
+  * @retval None
+  */
+static void swtimer_arm(void)
+{
+	uint32_t now, cmp;
+
+	if (head == NULL)
+		return;
+
+	now = swtimer_ticks();
+	if ((int32_t) (head->expiry - now) <= 0) {
+		NVIC_SetPendingIRQ(SWTIMER_IRQn);
+		return;
+	}
+	if ((head->expiry - now) > SWTIMER_CNT_MASK)
+		return;
+
+	cmp = (head->expiry - 1) & SWTIMER_CNT_MASK;  // CNT = CMP reads as tick expiry
+	if (cmp != cmp_loaded) {
+		SWTIMER_LPTIM->CMP = cmp;
+		while (!(SWTIMER_LPTIM->ISR & LPTIM_ISR_CMPOK));
+		SWTIMER_LPTIM->ICR = LPTIM_ICR_CMPOKCF;
+		cmp_loaded = cmp;
+	}
+
+	// The counter may have gone past CMP while the write was synchronised
+	if ((int32_t) (head->expiry - swtimer_ticks()) <= 0)
+		NVIC_SetPendingIRQ(SWTIMER_IRQn);
+}
+
+/**
+  * @brief Runs the callbacks of the timers that are due, reloads the periodic
+  *	   ones and arms the next expiry. Callbacks may start and stop timers.
+  * @param None
+  * @retval None
+  */
+static void swtimer_expire(void)
+{
+	SWTIMER_TypeDef *t;
+	uint32_t primask, now;
+
+	primask = irq_save();
+	now = swtimer_ticks();
+
+	while (head != NULL && (int32_t) (head->expiry - now) <= 0) {
+		t = head;
+		head = t->next;
+		t->next = NULL;
+
+		if (t->period != 0) {
+			t->expiry += t->period;
+			if ((int32_t) (t->expiry - now) <= 0)
+				t->expiry = now + t->period;
+			swtimer_insert(t);
+		} else {
+			t->active = 0;
+		}
+
+		if (t->callback != NULL) {
+			irq_restore(primask);
+			t->callback(t->arg);
+			primask = irq_save();
+		}
+		now = swtimer_ticks();
+	}
+
+	swtimer_arm();
+	irq_restore(primask);
+}
@@ -0,0 +1,100 @@
+/*!
+ * @file
+ *
+ * @brief Timer-driven TC74 acquisition with median / EMA filtering
+ *
+ * @author Nrgagnon
+ *
+ * @date July 25, 2017
+ *
+ */
+
+#ifndef TC74_ACQ_H
+#define TC74_ACQ_H
+
+#include "./tc74_funcs.h"
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              TC74_ACQ CONSTANTS                                 *
+ *                                                                                 *
+ ***********************************************************************************/
+#define TC74_ACQ_PERIOD_MS		((uint32_t) 1000U)	/*!< One sample per period */
+#define TC74_ACQ_CONV_MS		((uint32_t) 125U)	/*!< First conversion out of standby (8 per s) */
+#define TC74_ACQ_POLL_MS		((uint32_t) 25U)	/*!< Data-ready re-poll interval */
+#define TC74_ACQ_MAX_POLLS		((uint8_t) 16U)		/*!< Polls before a sample is given up */
+
+#define TC74_ACQ_RING_SIZE		5			/*!< Latest readings, median taken over them (odd) */
+#define TC74_ACQ_EMA_SHIFT		2			/*!< EMA weight of a new median : 1/4 */
+#define TC74_ACQ_FRAC_BITS		8			/*!< Filtered value : 1/256 C units */
+#define TC74_ACQ_HYST			((int32_t) 1 << (TC74_ACQ_FRAC_BITS - 2))	/*!< 0.25 C */
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              TC74_ACQ STRUCTS                                   *
+ *                                                                                 *
+ ***********************************************************************************/
+typedef struct
+{
+	uint32_t samples;		/*!< Readings pushed into the ring */
+	uint32_t not_ready;		/*!< Polls that found no conversion yet */
+	uint32_t missed;		/*!< Samples given up after TC74_ACQ_MAX_POLLS */
+	uint32_t errors;		/*!< Samples lost to an I2C failure */
+	uint32_t changes;		/*!< Changes of the reported temperature */
+} TC74_AcqStatsTypeDef;
+
+/***********************************************************************************
+ *                                                                                 *
+ *                              TC74_ACQ FUNCTIONS                                 *
+ *                                                                                 *
+ * The TC74 is kept in standby between samples. Every TC74_ACQ_PERIOD_MS it is     *
+ * woken, and its CONFIG data-ready bit is polled from a one-shot timer until the  *
+ * first conversion is done, so nothing spins on the bus. The reading goes into a  *
+ * ring buffer; the median of the TC74_ACQ_RING_SIZE latest rejects single bad     *
+ * readings and an EMA smooths the medians. The reported whole-degree temperature  *
+ * only moves once the EMA is TC74_ACQ_HYST past the half-degree, so consumers are *
+ * only told about real changes.                                                   *
+ *                                                                                 *
+ ***********************************************************************************/
+
+/**
+  * @brief Starts the sample timer (swtimer_init and i2c1_init must have been
+  *	   called). The first sample is taken right away.
+  * @param wake : Called from the LPTIM1 interrupt whenever tc74_acq_service
+  *	   has work to do (typically posts to the task that calls it).
+  * @retval None
+  */
+void tc74_acq_start(void (*wake)(void));
+
+/**
+  * @brief Runs the acquisition step that is due : starts a conversion, polls
+  *	   data-ready, or reads and filters the sample. Call from a task, after
+  *	   wake (uses the I2C bus).
+  * @param None
+  * @retval 1 if the reported temperature changed (or was reported for the
+  *	   first time), 0 otherwise
+  */
+uint8_t tc74_acq_service(void);
+
+/**
+  * @brief Returns the reported temperature.
+  * @param None
+  * @retval Filtered temperature, rounded to whole degrees C
+  */
+int8_t tc74_acq_temperature(void);
+
+/**
+  * @brief Returns the filter output with its fractional bits.
+  * @param None
+  * @retval Filtered temperature (1 / 2^TC74_ACQ_FRAC_BITS C)
+  */
+int32_t tc74_acq_filtered(void);
+
+/**
+  * @brief Copies the acquisition counters.
+  * @param stats : Where to store the counters.
+  * @retval None
+  */
+void tc74_acq_get_stats(TC74_AcqStatsTypeDef *stats);
+
+#endif
@@ -1,13 +1,22 @@
 #ifndef TC74_FUNCS_H
 #define TC74_FUNCS_H
 
+#include "./tc74_i2c.h"
+
 /* TC74 CONSTANTS */
 #define TC74_I2C_ADDR		((uint8_t) 0x48)
 #define TC74_TEMPR_PTR		((uint8_t) 0x00)
 #define TC74_CFGR_PTR		((uint8_t) 0x01)
+#define TC74_CFGR_SHDN		((uint8_t) 0x80)	// Standby (no conversions)
+#define TC74_CFGR_DATA_RDY	((uint8_t) 0x40)	// First conversion done since power-up / standby
 
 /* TC74 COMMANDS */
 int8_t read_tc74_temp(void);
 float cels2fahr(int8_t cels);
+
+// single register accesses; the status of the I2C transfer is returned
+I2C_StatusTypeDef tc74_read_config(uint8_t *config);
+I2C_StatusTypeDef tc74_read_temp(int8_t *temp);
+I2C_StatusTypeDef tc74_standby(uint8_t enter);
 	
 #endif
@@ -5,7 +5,10 @@
 #include "../include/tc74_i2c.h"
 #include "../include/tc74_lcd.h"
 #include "../include/tc74_funcs.h"
+#include "../include/tc74_acq.h"
 #include "../include/servo.h"
+#include "../include/swtimer.h"
+#include "../../SCHED/include/sched.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,6 +18,15 @@
 #define PE8_AF1_TIM1_CH1N       ((uint32_t) 0x01 << (4 * 0))
 #define PB3_AF1_TIM2_CH2	((uint32_t) 0x01 << (4 * 3))
 #define CK_PSC_NODIV		((uint16_t) 0x00)
+#define SYSCLK_HZ		((uint32_t) 16000000U)
+#define FAN_ON_TEMP		((int8_t) 26)  // Fan runs above this (C)
+
+/* Task events */
+#define EVT_ACQ			((uint32_t) 0x01)  // Acquisition step due
+#define EVT_TEMPERATURE		((uint32_t) 0x02)  // Filtered temperature changed
+#define EVT_SCROLL		((uint32_t) 0x04)  // Banner scroll step due
+
+#define LCD_SCROLL_MS		((uint32_t) 300U)  // Banner scroll speed
 
 /* Private function prototypes ---------------------------------------------------*/
 static void sysclk_init(void);
@@ -22,6 +34,21 @@ static void pe8_pwm_config(void);
 static void pb3_pwm_config(void);
 static void tim1_ch1n_config(void);
 static void tim2_ch2_config(void);
+static void acq_wake(void);
+static void acq_task_run(uint32_t events);
+static void fan_task_run(uint32_t events);
+static void led_task_run(uint32_t events);
+static void lcd_task_run(uint32_t events);
+static void scroll_tick(void *arg);
+
+/* Private variables -------------------------------------------------------------*/
+static uint16_t *ccr_buff_ptr;
+static int acq_task;
+static int fan_task;
+static int led_task;
+static int lcd_task;
+static SWTIMER_TypeDef scroll_timer;
+static uint8_t banner[] = "TC74 TEMPERATURE SENSOR";
 
 /* Private functions -------------------------------------------------------------*/
 
@@ -32,11 +59,6 @@ static void tim2_ch2_config(void);
   */
 void main(void)
 {	
-	uint16_t *ccr_buff_ptr;
-	int8_t temperature;
-	char t_string[6];
-	size_t i;
-
 	ccr_buff_ptr = (uint16_t *) calloc(NUM_PERIODS_FOR_RESET + 
 					  (NUM_LEDS * NUM_COLOR_BITS), sizeof(uint16_t));
 	
@@ -61,21 +83,110 @@ void main(void)
 	
 	tc74_startup(ccr_buff_ptr);	
 
-	while(1) {
-		temperature = read_tc74_temp();	
-		set_color_with_temp(ccr_buff_ptr, temperature);
-		if (temperature > 26) {
-			rotate_servo_right();
-		} else {
-			stop_servo();
-		}
+	swtimer_init();
+
+	/* Acquisition comes first; the consumers only run when the filtered
+	   temperature changes, the fan before the slower LED strip and LCD */
+	sched_init(SYSCLK_HZ, swtimer_ticks, SWTIMER_TICK_HZ);
+	acq_task = sched_add("acq", SCHED_PRIO_HIGHEST, acq_task_run);
+	fan_task = sched_add("fan", SCHED_PRIO_HIGHEST + 1, fan_task_run);
+	led_task = sched_add("led", SCHED_PRIO_HIGHEST + 2, led_task_run);
+	lcd_task = sched_add("lcd", SCHED_PRIO_HIGHEST + 3, lcd_task_run);
+
+	/* The banner scrolls while the first readings fill the filter */
+	LCD_DisplayScrollingString(banner);
+	swtimer_start(&scroll_timer, LCD_SCROLL_MS, LCD_SCROLL_MS, scroll_tick, NULL);
+
+	tc74_acq_start(acq_wake);
+
+	sched_run();
+}
+
+/**
+  * @brief Acquisition timer callback (LPTIM1 interrupt) : wakes the
+  *	   acquisition task.
+  * @param None
+  * @retval None
+  */
+static void acq_wake(void)
+{
+	sched_post(acq_task, EVT_ACQ);
+}
+
+/**
+  * @brief Acquisition task : runs the TC74 acquisition step that is due and
+  *	   notifies the consumers when the filtered temperature changes.
+  * @param events : EVT_ACQ.
+  * @retval None
+  */
+static void acq_task_run(uint32_t events)
+{
+	if (!tc74_acq_service())
+		return;
+
+	sched_post(fan_task, EVT_TEMPERATURE);
+	sched_post(led_task, EVT_TEMPERATURE);
+	sched_post(lcd_task, EVT_TEMPERATURE);
+}
+
+/**
+  * @brief Fan task : runs the fan servo above FAN_ON_TEMP.
+  * @param events : EVT_TEMPERATURE.
+  * @retval None
+  */
+static void fan_task_run(uint32_t events)
+{
+	if (tc74_acq_temperature() > FAN_ON_TEMP) {
+		rotate_servo_right();
+	} else {
+		stop_servo();
+	}
+}
 
-		sprintf(t_string, "%d C", temperature);	
-		LCD_DisplayString((uint8_t *)t_string);
+/**
+  * @brief LED task : shows the temperature on the LED strip.
+  * @param events : EVT_TEMPERATURE.
+  * @retval None
+  */
+static void led_task_run(uint32_t events)
+{
+	set_color_with_temp(ccr_buff_ptr, tc74_acq_temperature());
+}
 
-		for (i = 0; i < 5000000; i++);
-		LCD_Clear();
+/**
+  * @brief Scroll timer callback (LPTIM1 interrupt) : wakes the LCD task for
+  *	   the next banner position.
+  * @param arg : Unused.
+  * @retval None
+  */
+static void scroll_tick(void *arg)
+{
+	sched_post(lcd_task, EVT_SCROLL);
+}
+
+/**
+  * @brief LCD task : steps the start-up banner, then shows the temperature
+  *	   on the LCD. A temperature change that comes while the banner is
+  *	   scrolling is shown once it has finished.
+  * @param events : EVT_SCROLL, EVT_TEMPERATURE.
+  * @retval None
+  */
+static void lcd_task_run(uint32_t events)
+{
+	char t_string[6];
+
+	if (events & EVT_SCROLL) {
+		if (LCD_ScrollTick())
+			return;
+		swtimer_stop(&scroll_timer);
+		events |= EVT_TEMPERATURE;
 	}
+
+	if (swtimer_active(&scroll_timer) || !(events & EVT_TEMPERATURE))
+		return;
+
+	sprintf(t_string, "%d C", tc74_acq_temperature());
+	LCD_DisplayString((uint8_t *)t_string);
 }
 
 /**
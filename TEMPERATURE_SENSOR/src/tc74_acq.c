@@ -0,0 +1,246 @@
+/**
+  **********************************************************************************
+  * @file    TEMPERATURE_SENSOR/src/tc74_acq.c
+  * @author  Nrgagnon
+  * @version V1.0
+  * @date    25-July-2017
+  * @brief   Timer-driven TC74 acquisition with median / EMA filtering.
+  *
+  **********************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon </center></h2>
+  *
+  **********************************************************************************
+  */
+
+/* Includes ----------------------------------------------------------------------*/
+#include <stm32l476xx.h>
+#include <stddef.h>
+#include "../include/tc74_acq.h"
+#include "../include/swtimer.h"
+#include "../include/irq.h"
+
+/* Private defines ---------------------------------------------------------------*/
+#define ACQ_DUE_SAMPLE		((uint8_t) 0x01)	// Sample timer expired
+#define ACQ_DUE_POLL		((uint8_t) 0x02)	// Data-ready poll timer expired
+
+/* Private variables -------------------------------------------------------------*/
+static SWTIMER_TypeDef sample_timer;
+static SWTIMER_TypeDef poll_timer;
+static void (*acq_wake)(void);
+static volatile uint8_t due;		// ACQ_DUE_* set by the timers
+
+static uint8_t converting;		// TC74 woken for a sample that is not read yet
+static uint8_t polls;			// Data-ready polls for that sample
+
+static int8_t ring[TC74_ACQ_RING_SIZE];
+static uint8_t ring_next;		// Where the next reading goes
+static uint8_t ring_used;
+
+static int32_t ema;			// 1 / 2^TC74_ACQ_FRAC_BITS C
+static int8_t reported;
+static uint8_t primed;			// ema and reported hold a value
+
+static TC74_AcqStatsTypeDef acq_stats;
+
+/* Private functions -------------------------------------------------------------*/
+static void tc74_acq_sample_tick(void *arg);
+static void tc74_acq_poll_tick(void *arg);
+static void tc74_acq_abort(void);
+static uint8_t tc74_acq_push(int8_t temp);
+static int8_t tc74_acq_round(int32_t value);
+
+/* Function Implementations ------------------------------------------------------*/
+
+void tc74_acq_start(void (*wake)(void))
+{
+	acq_wake = wake;
+	due = 0;
+	converting = 0;
+	polls = 0;
+	ring_next = 0;
+	ring_used = 0;
+	primed = 0;
+
+	acq_stats.samples = 0;
+	acq_stats.not_ready = 0;
+	acq_stats.missed = 0;
+	acq_stats.errors = 0;
+	acq_stats.changes = 0;
+
+	tc74_standby(1);  // Converts only when a sample is due
+	swtimer_start(&sample_timer, 0, TC74_ACQ_PERIOD_MS, tc74_acq_sample_tick, NULL);
+}
+
+uint8_t tc74_acq_service(void)
+{
+	I2C_StatusTypeDef status;
+	uint8_t pending, config;
+	int8_t temp;
+	uint32_t primask;
+
+	primask = irq_save();
+	pending = due;
+	due = 0;
+	irq_restore(primask);
+
+	if (pending & ACQ_DUE_SAMPLE) {
+		/* The previous sample never became ready */
+		if (converting)
+			acq_stats.missed++;
+
+		swtimer_stop(&poll_timer);
+		if (tc74_standby(0) != I2C_OK) {
+			acq_stats.errors++;
+			tc74_acq_abort();
+			return 0;
+		}
+
+		converting = 1;
+		polls = 0;
+		swtimer_start(&poll_timer, TC74_ACQ_CONV_MS, 0, tc74_acq_poll_tick, NULL);
+		return 0;
+	}
+
+	if (!(pending & ACQ_DUE_POLL) || !converting)
+		return 0;
+
+	if (tc74_read_config(&config) != I2C_OK) {
+		acq_stats.errors++;
+		tc74_acq_abort();
+		return 0;
+	}
+
+	if (!(config & TC74_CFGR_DATA_RDY)) {
+		acq_stats.not_ready++;
+		if (++polls >= TC74_ACQ_MAX_POLLS) {
+			acq_stats.missed++;
+			tc74_acq_abort();
+		} else {
+			swtimer_start(&poll_timer, TC74_ACQ_POLL_MS, 0, tc74_acq_poll_tick, NULL);
+		}
+		return 0;
+	}
+
+	status = tc74_read_temp(&temp);
+	tc74_acq_abort();  // Back to standby until the next sample
+	if (status != I2C_OK) {
+		acq_stats.errors++;
+		return 0;
+	}
+
+	return tc74_acq_push(temp);
+}
+
+int8_t tc74_acq_temperature(void)
+{
+	return reported;
+}
+
+int32_t tc74_acq_filtered(void)
+{
+	return ema;
+}
+
+void tc74_acq_get_stats(TC74_AcqStatsTypeDef *stats)
+{
+	*stats = acq_stats;
+}
+
+/* Private functions -------------------------------------------------------------*/
+
+/**
+  * @brief Sample timer callback (LPTIM1 interrupt) : a sample is due.
+  * @param arg : Unused.
+  * @retval None
+  */
+static void tc74_acq_sample_tick(void *arg)
+{
+	due |= ACQ_DUE_SAMPLE;
+	if (acq_wake != NULL)
+		acq_wake();
+}
+
+/**
+  * @brief Poll timer callback (LPTIM1 interrupt) : data-ready is to be
+  *	   checked again.
+  * @param arg : Unused.
+  * @retval None
+  */
+static void tc74_acq_poll_tick(void *arg)
+{
+	due |= ACQ_DUE_POLL;
+	if (acq_wake != NULL)
+		acq_wake();
+}
+
+/**
+  * @brief Ends the sample in progress and puts the TC74 back in standby.
+  * @param None
+  * @retval None
+  */
+static void tc74_acq_abort(void)
+{
+	converting = 0;
+	polls = 0;
+	tc74_standby(1);
+}
+
+/**
+  * @brief Pushes a reading into the ring, filters the median of the ring
+  *	   with the EMA, and updates the reported temperature once the EMA
+  *	   has moved TC74_ACQ_HYST past the half-degree.
+  * @param temp : TC74 reading (C).
+  * @retval 1 if the reported temperature changed, 0 otherwise
+  */
+static uint8_t tc74_acq_push(int8_t temp)
+{
+	int8_t sorted[TC74_ACQ_RING_SIZE];
+	int32_t median, err;
+	uint8_t i, j;
+
+	ring[ring_next] = temp;
+	ring_next = (ring_next + 1) % TC74_ACQ_RING_SIZE;
+	if (ring_used < TC74_ACQ_RING_SIZE)
+		ring_used++;
+	acq_stats.samples++;
+
+	/* Insertion sort : only a handful of bytes */
+	for (i = 0; i < ring_used; i++) {
+		for (j = i; j > 0 && sorted[j - 1] > ring[i]; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = ring[i];
+	}
+	median = (int32_t) sorted[ring_used / 2] << TC74_ACQ_FRAC_BITS;
+
+	if (!primed) {
+		ema = median;
+		reported = tc74_acq_round(ema);
+		primed = 1;
+		acq_stats.changes++;
+		return 1;
+	}
+
+	ema += (median - ema) >> TC74_ACQ_EMA_SHIFT;
+
+	err = ema - ((int32_t) reported << TC74_ACQ_FRAC_BITS);
+	if (err < 0)
+		err = -err;
+	if (err < ((int32_t) 1 << (TC74_ACQ_FRAC_BITS - 1)) + TC74_ACQ_HYST)
+		return 0;
+
+	reported = tc74_acq_round(ema);
+	acq_stats.changes++;
+	return 1;
+}
+
+/**
+  * @brief Rounds a filtered value to whole degrees.
+  * @param value : 1 / 2^TC74_ACQ_FRAC_BITS C.
+  * @retval Degrees C
+  */
+static int8_t tc74_acq_round(int32_t value)
+{
+	return (int8_t) ((value + ((int32_t) 1 << (TC74_ACQ_FRAC_BITS - 1))) >> TC74_ACQ_FRAC_BITS);
+}
@@ -3,19 +3,11 @@
 
 int8_t read_tc74_temp(void)
 {
-	int8_t cfgr_storage[1];
-	uint8_t config_reg[1] = {TC74_CFGR_PTR};
 	uint8_t temp_reg[1] = {TC74_TEMPR_PTR};
 	int8_t temp_data[1];
-	uint8_t data_rdy = 0;
-	
-	// Check if temperature data is ready	
-//	while (data_rdy == 0) {
-//	i2c1_read(1, TC74_I2C_ADDR, config_reg, cfgr_storage);
-//		data_rdy = cfgr_storage[0] & 0x40;
-//	}	
-	
-	// Read temperature now that it is ready	
+
+	/* Latest conversion, without waiting for TC74_CFGR_DATA_RDY : the
+	   acquisition (tc74_acq.c) polls it from a timer instead */
 	i2c1_read(1, TC74_I2C_ADDR, temp_reg, temp_data);	
 		
 	return temp_data[0];
@@ -25,3 +17,29 @@ float cels2fahr(int8_t cels)
 {
 	return ((9.0/5.0) * cels + 32);
 }
+
+I2C_StatusTypeDef tc74_read_config(uint8_t *config)
+{
+	uint8_t config_reg[1] = {TC74_CFGR_PTR};
+	int8_t cfgr_storage[1];
+	I2C_StatusTypeDef status;
+
+	status = i2c1_read(1, TC74_I2C_ADDR, config_reg, cfgr_storage);
+	*config = (uint8_t) cfgr_storage[0];
+
+	return status;
+}
+
+I2C_StatusTypeDef tc74_read_temp(int8_t *temp)
+{
+	uint8_t temp_reg[1] = {TC74_TEMPR_PTR};
+
+	return i2c1_read(1, TC74_I2C_ADDR, temp_reg, temp);
+}
+
+I2C_StatusTypeDef tc74_standby(uint8_t enter)
+{
+	uint8_t payload[2] = {TC74_CFGR_PTR, enter ? TC74_CFGR_SHDN : 0x00};
+
+	return i2c1_transmit(2, TC74_I2C_ADDR, payload);
+}
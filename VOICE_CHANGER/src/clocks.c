@@ -155,18 +155,29 @@ void pllsai1_init(int in_mul, int out_div)
 }
 
 /**
-  * @brief Causes a system delay with SysTick.
+  * @brief Causes a system delay with SysTick. The core sleeps in WFI
+  *	   between ticks instead of spinning; PRIMASK is left as the caller
+  *	   had it.
   * @param time_ms : Number of milliseconds to delay.
   * @retval None
   */
 void delay(uint32_t time_ms)
 {       
+        uint32_t primask = __get_PRIMASK();
+
 	/* Initialize global volatile variable TimingDelay.
 		This variable is decremented in the SysTick ISR */
         TimingDelay = time_ms;
 	
-	/* Wait for SysTick ISR to decrement TimingDelay to 0 */
-        while(TimingDelay != 0);
+	/* Wait for SysTick ISR to decrement TimingDelay to 0. Masked between
+		the test and the WFI so the last tick is not slept through */
+        __disable_irq();
+        while (TimingDelay != 0) {
+                __WFI();
+                __set_PRIMASK(primask);
+                __disable_irq();
+        }
+        __set_PRIMASK(primask);
 }
 
 /**
@@ -0,0 +1,320 @@
+/**********************************************************************************\
+ * @file    tools/adc_sim/adc_sim.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    26-June-2017                                                          *
+ * @brief   Host replayer for the I2C_PROJECT ambient-light brightness path.      *
+ *          Feeds ADC traces (oversampled 12-bit results, one per 10 ms           *
+ *          trigger) through DMA1 channel 1 into adc.c, runs the brightness       *
+ *          task whenever it is woken and counts the HT16K33 brightness writes.   *
+ *          The built-in traces check the level hysteresis; -f replays a          *
+ *          recorded one.                                                         *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "stm32l476xx.h"
+#include "adc.h"
+#include "ht16k33.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define SIM_TRIGGER_MS		10	/* TIM1_CH2 period */
+#define SIM_MAX_SAMPLES		100000	/* Longest trace replayed */
+#define SIM_FULL_SCALE		4095
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+GPIO_TypeDef sim_gpioa;
+RCC_TypeDef sim_rcc;
+ADC_TypeDef sim_adc1;
+ADC_Common_TypeDef sim_adc_common;
+DMA_TypeDef sim_dma1;
+
+static volatile uint16_t *dma_buf;	/* What adc.c handed DMA1 channel 1 */
+static uint16_t dma_len;
+
+static uint8_t woken;			/* Brightness task posted */
+static uint32_t writes;			/* DIMSETUP commands sent */
+static int last_duty;
+
+static uint16_t trace[SIM_MAX_SAMPLES];
+static uint32_t seed;
+
+void DMA1_Channel1_IRQHandler(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STAND-INS                                     *
+ *                                                                                *
+\**********************************************************************************/
+void dma_adc1_init(volatile uint16_t *samples, uint16_t nsamples)
+{
+	dma_buf = samples;
+	dma_len = nsamples;
+}
+
+void delay(uint32_t time_ms)
+{
+	(void) time_ms;
+}
+
+void tim1_ch2_init(void)
+{
+}
+
+/* The I2C write the brightness task makes */
+void DISPLAY_set_brightness(uint8_t duty)
+{
+	writes++;
+	last_duty = duty;
+}
+
+/* sched_post(brightness_task, EVT_BRIGHTNESS) */
+static void sim_level_changed(void)
+{
+	woken = 1;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TRACES                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Deterministic noise, so every run replays the same traces */
+static double sim_uniform(void)
+{
+	seed = seed * 1103515245U + 12345U;
+	return ((seed >> 8) & 0xFFFF) / 65535.0 * 2.0 - 1.0;
+}
+
+static uint16_t sim_clamp(double v)
+{
+	if (v < 0)
+		return 0;
+	if (v > SIM_FULL_SCALE)
+		return SIM_FULL_SCALE;
+	return (uint16_t) lrint(v);
+}
+
+/* Two minutes of dusk : full light down to dark, with sensor noise */
+static uint32_t trace_dusk(void)
+{
+	uint32_t i, n = 12000;
+
+	for (i = 0; i < n; i++)
+		trace[i] = sim_clamp(4000.0 - 3800.0 * i / n + 24.0 * sim_uniform());
+	return n;
+}
+
+/* Light parked on the level 7 / 8 boundary : wander, noise and single-sample
+   spikes, kept so every 8-result average stays inside ADC_LEVEL_HYST of it */
+static uint32_t trace_boundary(void)
+{
+	uint32_t i, n = 6000;
+	double v;
+
+	for (i = 0; i < n; i++) {
+		v = 2048.0 + 20.0 * sin(i / 150.0) + 12.0 * sim_uniform();
+		if (i % 37 == 0)
+			v += (i & 1) ? 100.0 : -100.0;
+		trace[i] = sim_clamp(v);
+	}
+	return n;
+}
+
+/* A lamp switched on and off : each switch is one step across many levels */
+static uint32_t trace_lamp(void)
+{
+	uint32_t i, n = 8000;
+
+	for (i = 0; i < n; i++)
+		trace[i] = sim_clamp(((i / 1000) % 2 ? 3500.0 : 600.0) + 30.0 * sim_uniform());
+	return n;
+}
+
+static uint32_t trace_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	uint32_t n = 0;
+	long v;
+
+	if (f == NULL) {
+		perror(path);
+		exit(2);
+	}
+	while (n < SIM_MAX_SAMPLES && fscanf(f, "%ld", &v) == 1)
+		trace[n++] = sim_clamp((double) v);
+	fclose(f);
+	return n;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  REPLAY                                        *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	uint32_t writes;	/* Brightness writes, the initial one included */
+	uint32_t naive;		/* Writes a quantizer without hysteresis would make */
+	uint32_t ups, downs;	/* Level moves */
+	int level;		/* Level written last */
+} SIM_ResultTypeDef;
+
+/* adc.c as main sets it up : level 0, nothing written yet */
+static void sim_init(void)
+{
+	adc1_init();
+	adc1_on_level_change(sim_level_changed);
+}
+
+static void sim_replay(const uint16_t *s, uint32_t n, SIM_ResultTypeDef *r)
+{
+	uint32_t i, k, sum;
+	int prev, naive_level = -1, lvl;
+
+	memset(r, 0, sizeof(*r));
+	writes = 0;
+	woken = 1;  /* main posts EVT_BRIGHTNESS to write the initial level */
+	prev = last_duty;
+
+	for (i = 0; i + dma_len <= n; i += dma_len) {
+		if (woken) {
+			woken = 0;
+			adc1_brightness_service();
+			if (last_duty != prev) {
+				if (last_duty > prev)
+					r->ups++;
+				else
+					r->downs++;
+			}
+			prev = last_duty;
+		}
+
+		/* A full buffer, then the transfer-complete interrupt */
+		for (k = 0, sum = 0; k < dma_len; k++) {
+			dma_buf[k] = s[i + k];
+			sum += s[i + k];
+		}
+		sim_dma1.ISR |= DMA_ISR_TCIF1;
+		sim_dma1.IFCR = 0;
+		DMA1_Channel1_IRQHandler();
+		if (sim_dma1.IFCR & DMA_IFCR_CTCIF1)
+			sim_dma1.ISR &= ~DMA_ISR_TCIF1;
+
+		lvl = (int) ((sum / dma_len) >> ADC_LEVEL_SHIFT);
+		if (lvl != naive_level)
+			r->naive++;
+		naive_level = lvl;
+	}
+
+	if (woken) {
+		woken = 0;
+		adc1_brightness_service();
+		if (last_duty > prev)
+			r->ups++;
+		else if (last_duty < prev)
+			r->downs++;
+	}
+
+	r->writes = writes;
+	r->level = last_duty - HT16K33_DIMSETUP_DUTY1;
+}
+
+static void sim_print(const char *name, uint32_t n, const SIM_ResultTypeDef *r)
+{
+	printf("  %-10s %6u %7.1f s %6u %6u %4u %5u %5d",
+	       name, n, n * SIM_TRIGGER_MS / 1000.0, r->writes, r->naive, r->ups, r->downs, r->level);
+}
+
+static void sim_usage(void)
+{
+	fprintf(stderr,
+		"usage: adc_sim [-f trace]\n"
+		"  Without -f, replays the built-in dusk, boundary-noise and lamp traces\n"
+		"  and checks the brightness writes. A trace file holds one oversampled\n"
+		"  12-bit result per %d ms trigger, whitespace separated.\n",
+		SIM_TRIGGER_MS);
+}
+
+int main(int argc, char **argv)
+{
+	SIM_ResultTypeDef r;
+	uint32_t n, failed = 0;
+	int ok;
+
+	if (argc == 3 && strcmp(argv[1], "-f") == 0) {
+		n = trace_load(argv[2]);
+		sim_init();
+		sim_replay(trace, n, &r);
+		printf("  %-10s %6s %9s %6s %6s %4s %5s %5s\n",
+		       "trace", "samples", "length", "writes", "naive", "ups", "downs", "level");
+		sim_print("file", n, &r);
+		printf("\n");
+		return 0;
+	}
+	if (argc != 1) {
+		sim_usage();
+		return 2;
+	}
+
+	/* Replayed back to back, like one run of the firmware : each trace
+	   starts from the level the previous one left */
+	sim_init();
+	printf("  %-10s %6s %9s %6s %6s %4s %5s %5s\n",
+	       "trace", "samples", "length", "writes", "naive", "ups", "downs", "level");
+
+	/* Level 0 written at power-on, straight up to 15, then every level
+	   down to 0 with each boundary crossed once */
+	seed = 1;
+	n = trace_dusk();
+	sim_replay(trace, n, &r);
+	ok = r.writes == 17 && r.ups == 1 && r.downs == 15 && r.level == 0;
+	sim_print("dusk", n, &r);
+	printf("  %s\n", ok ? "ok" : "FAIL");
+	failed += !ok;
+
+	/* Noise on a boundary : one move onto it, never a write after that */
+	seed = 2;
+	n = trace_boundary();
+	sim_replay(trace, n, &r);
+	ok = r.writes == 1 && r.ups == 1 && r.downs == 0 &&
+	     (r.level == 7 || r.level == 8) && r.naive > 10;
+	sim_print("boundary", n, &r);
+	printf("  %s\n", ok ? "ok" : "FAIL");
+	failed += !ok;
+
+	/* From the boundary down to the lamp-off level, then four switches on
+	   and three off : one write each */
+	seed = 3;
+	n = trace_lamp();
+	sim_replay(trace, n, &r);
+	ok = r.writes == 8 && r.ups == 4 && r.downs == 4 && r.level == 13;
+	sim_print("lamp", n, &r);
+	printf("  %s\n", ok ? "ok" : "FAIL");
+	failed += !ok;
+
+	printf("%u traces, %u failed\n%s\n", 3U, failed, failed ? "FAIL" : "PASS");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+/**********************************************************************************\
+ * @file    tools/adc_sim/stm32l476xx.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    26-June-2017                                                          *
+ * @brief   Host stand-in for the device header : just the registers the          *
+ *          I2C_PROJECT ADC1 driver (adc.c) uses, as plain memory.                *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              REGISTER BLOCKS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t ASCR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t AHB2ENR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t ISR;
+	volatile uint32_t IER;
+	volatile uint32_t CR;
+	volatile uint32_t CFGR;
+	volatile uint32_t CFGR2;
+	volatile uint32_t SMPR1;
+	volatile uint32_t SQR1;
+	volatile uint32_t DR;
+	volatile uint32_t DIFSEL;
+} ADC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CCR;
+} ADC_Common_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t ISR;
+	volatile uint32_t IFCR;
+} DMA_TypeDef;
+
+/* Defined by the replayer */
+extern GPIO_TypeDef sim_gpioa;
+extern RCC_TypeDef sim_rcc;
+extern ADC_TypeDef sim_adc1;
+extern ADC_Common_TypeDef sim_adc_common;
+extern DMA_TypeDef sim_dma1;
+
+#define GPIOA				(&sim_gpioa)
+#define RCC				(&sim_rcc)
+#define ADC1				(&sim_adc1)
+#define ADC123_COMMON			(&sim_adc_common)
+#define DMA1				(&sim_dma1)
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BIT DEFINITIONS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define RCC_AHB2ENR_GPIOAEN		((uint32_t) 0x00000001)
+#define RCC_AHB2ENR_ADCEN		((uint32_t) 0x00002000)
+
+#define GPIO_MODER_MODER1		((uint32_t) 0x0000000C)
+#define GPIO_ASCR_EN_1			((uint32_t) 0x00000002)
+
+#define ADC_ISR_ADRDY			((uint32_t) 0x00000001)
+#define ADC_IER_EOC			((uint32_t) 0x00000004)
+#define ADC_CR_ADEN			((uint32_t) 0x00000001)
+#define ADC_CR_ADVREGEN			((uint32_t) 0x10000000)
+#define ADC_CR_DEEPPWD			((uint32_t) 0x20000000)
+#define ADC_CFGR_DMAEN			((uint32_t) 0x00000001)
+#define ADC_CFGR_DMACFG			((uint32_t) 0x00000002)
+#define ADC_CFGR_RES			((uint32_t) 0x00000018)
+#define ADC_CFGR_ALIGN			((uint32_t) 0x00000020)
+#define ADC_CFGR_OVRMOD			((uint32_t) 0x00001000)
+#define ADC_CFGR2_ROVSE			((uint32_t) 0x00000001)
+#define ADC_CFGR2_OVSR			((uint32_t) 0x0000001C)
+#define ADC_CFGR2_OVSS			((uint32_t) 0x000001E0)
+#define ADC_SMPR1_SMP6			((uint32_t) 0x001C0000)
+#define ADC_SQR1_L			((uint32_t) 0x0000000F)
+#define ADC_SQR1_SQ1			((uint32_t) 0x000007C0)
+#define ADC_SQR1_SQ1_1			((uint32_t) 0x00000080)
+#define ADC_SQR1_SQ1_2			((uint32_t) 0x00000100)
+#define ADC_DIFSEL_DIFSEL		((uint32_t) 0x0007FFFF)
+#define ADC_CCR_DUAL			((uint32_t) 0x0000001F)
+#define ADC_CCR_CKMODE			((uint32_t) 0x00030000)
+#define ADC_CCR_CKMODE_0		((uint32_t) 0x00010000)
+#define ADC_CCR_PRESC			((uint32_t) 0x003C0000)
+
+#define DMA_ISR_TCIF1			((uint32_t) 0x00000002)
+#define DMA_IFCR_CTCIF1			((uint32_t) 0x00000002)
+
+#endif
@@ -0,0 +1,418 @@
+/**********************************************************************************\
+ * @file    tools/asset_rle/asset_rle.c                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    09-July-2017                                                          *
+ * @brief   Host asset compiler : turns a grayscale glyph sheet (PGM) into a      *
+ *          run-length-encoded 1/2/4-bpp atlas, emitted as a SHAPE_FontTypeDef    *
+ *          for SMART_WATCH (see SHAPE_TEXT in shape.h).                          *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/*
+ * Input is a binary (P5) or plain (P2) PGM holding one row of glyphs. Fonts
+ * and icons are rendered to PGM first, e.g. with ImageMagick :
+ *
+ *	convert -font Roboto.ttf -pointsize 48 label:0123456789: digits.pgm
+ *	convert icons.png -colorspace gray icons.pgm
+ *
+ * Glyphs are either fixed-width cells (-cells) or separated by blank columns,
+ * and are assigned to the characters of -chars in order. Each glyph is
+ * trimmed to its ink and stored as runs : one byte per run holding
+ * (length - 1) << bpp | level, so a run covers up to 256 >> bpp pixels.
+ */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define RLE_MAX_GLYPHS		256
+#define RLE_MAX_DATA		65535		/* Glyph offsets are 16 bits in the firmware */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TYPES                                         *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	int used;
+	unsigned offset;
+	int width, height;
+	int x_off, y_off;
+	int advance;
+} RLE_Glyph;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+static int img_w, img_h;
+static uint8_t *levels;			/* Quantized ink level per pixel */
+
+static RLE_Glyph glyphs[RLE_MAX_GLYPHS];
+static uint8_t data[RLE_MAX_DATA];
+static unsigned data_len;
+
+static int bpp = 4;
+static int invert = 0;
+static int cells = 0;
+static int gap = 1;
+static int space = -1;
+static const char *chars = NULL;
+static const char *name = "font";
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  PGM INPUT                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Reads the next header number, skipping whitespace and comments.
+  * @param f : Open PGM file.
+  * @retval Number, or -1 on a malformed header
+  */
+static int pgm_number(FILE *f)
+{
+	int c, n = 0, digits = 0;
+
+	do {
+		c = fgetc(f);
+		if (c == '#')
+			while (c != '\n' && c != EOF)
+				c = fgetc(f);
+	} while (isspace(c));
+
+	while (isdigit(c)) {
+		n = n * 10 + (c - '0');
+		digits++;
+		c = fgetc(f);
+	}
+
+	return digits ? n : -1;
+}
+
+/**
+  * @brief Loads a PGM and quantizes it to 2^bpp ink levels.
+  * @param path : File name.
+  * @retval 0 on success, -1 on error
+  */
+static int pgm_load(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	int magic, maxval, i, v, lmax = (1 << bpp) - 1;
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	if (fgetc(f) != 'P' || ((magic = fgetc(f)) != '5' && magic != '2')) {
+		fprintf(stderr, "asset_rle: %s is not a P2/P5 PGM\n", path);
+		fclose(f);
+		return -1;
+	}
+
+	img_w = pgm_number(f);
+	img_h = pgm_number(f);
+	maxval = pgm_number(f);
+	if (img_w <= 0 || img_h <= 0 || maxval <= 0 || maxval > 255) {
+		fprintf(stderr, "asset_rle: %s : unsupported header\n", path);
+		fclose(f);
+		return -1;
+	}
+
+	levels = malloc((size_t) img_w * img_h);
+	for (i = 0; i < img_w * img_h; i++) {
+		v = (magic == '5') ? fgetc(f) : pgm_number(f);
+		if (v < 0) {
+			fprintf(stderr, "asset_rle: %s : truncated\n", path);
+			fclose(f);
+			return -1;
+		}
+		if (invert)
+			v = maxval - v;
+		levels[i] = (uint8_t) ((v * lmax + maxval / 2) / maxval);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  ENCODING                                      *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Reports whether a column of the sheet has any ink.
+  * @param x : Column.
+  * @retval 1 if any pixel is non-zero
+  */
+static int column_has_ink(int x)
+{
+	int y;
+
+	for (y = 0; y < img_h; y++)
+		if (levels[y * img_w + x])
+			return 1;
+	return 0;
+}
+
+/**
+  * @brief Trims columns x0 - x1 to their ink and run-length encodes them.
+  * @param g : Glyph to fill in (x_off is relative to x0).
+  * @param x0 : First column.
+  * @param x1 : Last column.
+  * @retval 0 on success, -1 if the atlas is full
+  */
+static int encode_glyph(RLE_Glyph *g, int x0, int x1)
+{
+	int l = x1, r = x0, t = img_h, b = -1, x, y;
+	int max_run = 256 >> bpp, run = 0, cur = -1;
+
+	for (y = 0; y < img_h; y++)
+		for (x = x0; x <= x1; x++)
+			if (levels[y * img_w + x]) {
+				l = (x < l) ? x : l;
+				r = (x > r) ? x : r;
+				t = (y < t) ? y : t;
+				b = (y > b) ? y : b;
+			}
+
+	g->used = 1;
+	g->offset = data_len;
+	if (b < 0) {
+		g->width = g->height = g->x_off = g->y_off = 0;
+		return 0;
+	}
+
+	g->width = r - l + 1;
+	g->height = b - t + 1;
+	g->x_off = l - x0;
+	g->y_off = t;
+	if (x1 - x0 + 1 > 255 || img_h > 255) {
+		fprintf(stderr, "asset_rle: glyphs are limited to 255x255 pixels\n");
+		exit(1);
+	}
+
+	for (y = t; y <= b; y++) {
+		for (x = l; x <= r; x++) {
+			int v = levels[y * img_w + x];
+
+			if (v == cur && run < max_run) {
+				run++;
+				continue;
+			}
+			if (run > 0) {
+				if (data_len == RLE_MAX_DATA)
+					return -1;
+				data[data_len++] = (uint8_t) (((run - 1) << bpp) | cur);
+			}
+			cur = v;
+			run = 1;
+		}
+	}
+
+	if (data_len == RLE_MAX_DATA)
+		return -1;
+	data[data_len++] = (uint8_t) (((run - 1) << bpp) | cur);
+	return 0;
+}
+
+/**
+  * @brief Splits the sheet into glyphs and encodes them.
+  * @param None
+  * @retval 0 on success, -1 on error
+  */
+static int build_atlas(void)
+{
+	const char *c = chars;
+	int x = 0, x0, n = 0;
+	int cell_w = cells ? img_w / cells : 0;
+
+	for (; *c != '\0'; c++, n++) {
+		RLE_Glyph *g = &glyphs[(uint8_t) *c];
+
+		if (g->used) {
+			fprintf(stderr, "asset_rle: '%c' listed twice\n", *c);
+			return -1;
+		}
+
+		if (cells) {
+			if (n >= cells) {
+				fprintf(stderr, "asset_rle: more chars than cells\n");
+				return -1;
+			}
+			if (encode_glyph(g, n * cell_w, n * cell_w + cell_w - 1) != 0)
+				goto full;
+			g->advance = cell_w;
+			continue;
+		}
+
+		/* Blank-column separated : spaces take no room on the sheet */
+		if (*c == ' ') {
+			g->used = 1;
+			g->offset = data_len;
+			g->advance = (space >= 0) ? space : img_h / 3;
+			continue;
+		}
+
+		while (x < img_w && !column_has_ink(x))
+			x++;
+		if (x == img_w) {
+			fprintf(stderr, "asset_rle: ran out of glyphs at '%c'\n", *c);
+			return -1;
+		}
+		x0 = x;
+		while (x < img_w && column_has_ink(x))
+			x++;
+
+		if (encode_glyph(g, x0, x - 1) != 0)
+			goto full;
+		g->advance = g->width + gap;
+	}
+
+	return 0;
+
+full:
+	fprintf(stderr, "asset_rle: atlas exceeds %d bytes\n", RLE_MAX_DATA);
+	return -1;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  OUTPUT                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+static void emit(FILE *out, const char *src)
+{
+	int first = 255, last = 0, i, count;
+	unsigned pixels = 0, packed = 0, glyph_bytes;
+
+	for (i = 0; i < RLE_MAX_GLYPHS; i++) {
+		if (!glyphs[i].used)
+			continue;
+		first = (i < first) ? i : first;
+		last = (i > last) ? i : last;
+		pixels += glyphs[i].width * glyphs[i].height;
+		packed += (glyphs[i].width * glyphs[i].height * bpp + 7) / 8;
+	}
+	count = last - first + 1;
+	glyph_bytes = count * 8;	/* sizeof(SHAPE_GlyphTypeDef) */
+
+	fprintf(out, "/* Generated by tools/asset_rle from %s (%d bpp) : do not edit */\n", src, bpp);
+	fprintf(out, "#include \"../include/shape.h\"\n\n");
+
+	fprintf(out, "static const uint8_t %s_data[%u] = {", name, data_len ? data_len : 1);
+	for (i = 0; i < (int) data_len; i++)
+		fprintf(out, "%s0x%02X,", (i % 12) ? " " : "\n\t", data[i]);
+	if (data_len == 0)
+		fprintf(out, "\n\t0x00");
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const SHAPE_GlyphTypeDef %s_glyphs[%d] = {\n", name, count);
+	for (i = first; i <= last; i++) {
+		const RLE_Glyph *g = &glyphs[i];
+
+		fprintf(out, "\t{%5u, %3d, %3d, %3d, %3d, %3d},", g->offset, g->width, g->height,
+			g->x_off, g->y_off, g->used ? g->advance : 0);
+		if (isprint(i) && i != '\\' && i != '*')
+			fprintf(out, "\t/* '%c' */", i);
+		fprintf(out, "\n");
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "const SHAPE_FontTypeDef %s = {%s_data, %s_glyphs, %d, %d, %d, %d};\n",
+		name, name, name, first, count, bpp, img_h);
+
+	fprintf(stderr, "%s : %d table entries, %u px : RGB565 %u B, %d bpp packed %u B, RLE %u B + %u B table\n",
+		name, count, pixels, pixels * 2, bpp, packed, data_len, glyph_bytes);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: asset_rle -chars <string> [options] sheet.pgm\n"
+		"  -chars s   characters on the sheet, left to right\n"
+		"  -bpp n     1, 2 or 4 bits of coverage per pixel (default 4)\n"
+		"  -cells n   sheet is n equal-width cells (default : split at blank columns)\n"
+		"  -gap n     pixels after each split glyph (default 1)\n"
+		"  -space n   advance of ' ' when splitting (default height / 3)\n"
+		"  -invert    dark ink on a light sheet\n"
+		"  -name id   C identifier of the SHAPE_FontTypeDef (default font)\n"
+		"  -o file    output file (default stdout)\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *in = NULL, *out_path = NULL;
+	FILE *out = stdout;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-chars") == 0 && i + 1 < argc) {
+			chars = argv[++i];
+		} else if (strcmp(argv[i], "-bpp") == 0 && i + 1 < argc) {
+			bpp = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-cells") == 0 && i + 1 < argc) {
+			cells = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-gap") == 0 && i + 1 < argc) {
+			gap = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-space") == 0 && i + 1 < argc) {
+			space = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-invert") == 0) {
+			invert = 1;
+		} else if (strcmp(argv[i], "-name") == 0 && i + 1 < argc) {
+			name = argv[++i];
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out_path = argv[++i];
+		} else if (argv[i][0] == '-' || in != NULL) {
+			usage();
+			return 2;
+		} else {
+			in = argv[i];
+		}
+	}
+
+	if (in == NULL || chars == NULL || chars[0] == '\0' ||
+	    (bpp != 1 && bpp != 2 && bpp != 4) || cells < 0) {
+		usage();
+		return 2;
+	}
+
+	if (pgm_load(in) != 0 || build_atlas() != 0)
+		return 1;
+
+	if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+		perror(out_path);
+		return 1;
+	}
+
+	emit(out, in);
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
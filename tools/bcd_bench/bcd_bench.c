@@ -0,0 +1,379 @@
+/**********************************************************************************\
+ * @file    tools/bcd_bench/bcd_bench.c                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    26-June-2017                                                          *
+ * @brief   Host checks and benchmark for the shared BCD helpers and the          *
+ *          DS3231 date bursts : every BCD code both ways, every date of          *
+ *          1900 - 2099 and every time of day through RTC_set_date and           *
+ *          RTC_read_date, then the time per date of the table encoder against   *
+ *          the floor / log10 / pow one it replaced.                             *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "i2c.h"
+#include "ds3231.h"
+#include "aux.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define BENCH_NREGS		(DS3231_TEMPLSBR_PTR + 1)
+#define BENCH_DATES		200000	/* Dates set and read back per timed run */
+#define BENCH_RUNS		5	/* Best of */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+
+/* DS3231 register file behind the bus stand-ins */
+static uint8_t ds_regs[BENCH_NREGS];
+static uint8_t last_burst[DS3231_DATE_NREGS + 1];
+static uint8_t last_nbytes;
+static uint32_t transmits, reads;
+
+static uint32_t failures;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  BUS                                           *
+ *                                                                                *
+\**********************************************************************************/
+
+I2C_StatusTypeDef i2c1_transmit(uint8_t nbytes, uint8_t slvaddr, uint8_t *payload)
+{
+	uint8_t ptr = payload[0], i;
+
+	if (slvaddr != DS3231_I2C_ADDR || nbytes == 0)
+		return I2C_ERR_NACK;
+
+	transmits++;
+	last_nbytes = nbytes;
+	memcpy(last_burst, payload, nbytes < sizeof(last_burst) ? nbytes : sizeof(last_burst));
+	for (i = 1; i < nbytes; i++, ptr = (ptr + 1) % BENCH_NREGS)
+		ds_regs[ptr] = payload[i];
+	return I2C_OK;
+}
+
+I2C_StatusTypeDef i2c1_read(uint8_t nbytes, uint8_t slvaddr, uint8_t *reg, uint8_t *storage_ptr)
+{
+	uint8_t ptr = reg[0], i;
+
+	if (slvaddr != DS3231_I2C_ADDR)
+		return I2C_ERR_NACK;
+
+	reads++;
+	for (i = 0; i < nbytes; i++, ptr = (ptr + 1) % BENCH_NREGS)
+		storage_ptr[i] = ds_regs[ptr];
+	return I2C_OK;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  OLD ENCODER                                   *
+ *                                                                                *
+ * aux.c's get_digit and the RTC_set_date / RTC_read_date bodies as they were      *
+ * before the table : one digit at a time through libm, a malloc per read.         *
+ *                                                                                *
+\**********************************************************************************/
+static uint8_t old_get_digit(uint8_t digit, uint32_t num)
+{
+	uint8_t num_digits = floor(log10(num) + 1);
+
+	if (digit > num_digits)
+		return 0;
+	else
+		return (uint8_t)(((uint32_t)(num / (pow(10, digit - 1)))) % 10);
+}
+
+static void old_set_date(Date_TypeDef *d, DS3231_TypeDef *rtc)
+{
+	uint8_t date_settings[8];
+	uint8_t tens_digit, ones_digit, thousands_digit;
+
+	RTC_struct_reset(rtc);
+	date_settings[0] = DS3231_SECR_PTR;
+
+	tens_digit = old_get_digit(2, d->second);
+	ones_digit = old_get_digit(1, d->second);
+	rtc->SECR = 0x00 | (tens_digit << 4) | (ones_digit << 0);
+	date_settings[1] = rtc->SECR;
+
+	tens_digit = old_get_digit(2, d->minute);
+	ones_digit = old_get_digit(1, d->minute);
+	rtc->MINR = 0x00 | (tens_digit << 4) | (ones_digit << 0);
+	date_settings[2] = rtc->MINR;
+
+	tens_digit = old_get_digit(2, d->hour);
+	ones_digit = old_get_digit(1, d->hour);
+	rtc->HOURR &= ~DS3231_HOURR_NONMILTIME;
+	switch (tens_digit) {
+	case 0:
+		rtc->HOURR |= 0 << 4;
+		break;
+	case 1:
+		rtc->HOURR |= 1 << 4;
+		break;
+	case 2:
+		rtc->HOURR |= DS3231_HOURR_20HR;
+		break;
+	default:
+		break;
+	}
+	rtc->HOURR |= ones_digit << 0;
+	date_settings[3] = rtc->HOURR;
+
+	rtc->DAYR |= d->day;
+	date_settings[4] = rtc->DAYR;
+
+	tens_digit = old_get_digit(2, d->date);
+	ones_digit = old_get_digit(1, d->date);
+	rtc->DATER |= tens_digit << 4;
+	rtc->DATER |= ones_digit << 0;
+	date_settings[5] = rtc->DATER;
+
+	thousands_digit = old_get_digit(4, (uint32_t) d->year);
+	if (thousands_digit == 1)
+		rtc->MONTHR |= 0 << 7;
+	else
+		rtc->MONTHR |= 1 << 7;
+	tens_digit = old_get_digit(2, (uint32_t) d->month);
+	ones_digit = old_get_digit(1, (uint32_t) d->month);
+	rtc->MONTHR |= (tens_digit << 4) | (ones_digit << 0);
+	date_settings[6] = rtc->MONTHR;
+
+	tens_digit = old_get_digit(2, (uint32_t) d->year);
+	ones_digit = old_get_digit(1, (uint32_t) d->year);
+	rtc->YEARR |= (tens_digit << 4) | (ones_digit << 0);
+	date_settings[7] = rtc->YEARR;
+
+	i2c1_transmit(8, DS3231_I2C_ADDR, date_settings);
+}
+
+static void old_read_date(Date_TypeDef *d)
+{
+	uint8_t reg[1] = {DS3231_SECR_PTR};
+	uint8_t *storage = (uint8_t *) malloc(7 * sizeof(uint8_t));
+
+	i2c1_read(7, DS3231_I2C_ADDR, reg, storage);
+
+	d->second = rtc_reg_bcd_to_int(storage[0]);
+	d->minute = rtc_reg_bcd_to_int(storage[1]);
+	if (0x20 & storage[2])
+		storage[2] = 0x20 | (storage[2] & 0x0F);
+	else
+		storage[2] = (0x10 & storage[2]) | (storage[2] & 0x0F);
+	d->hour = rtc_reg_bcd_to_int(storage[2]);
+	d->day = storage[3] & 0x0F;
+	d->date = rtc_reg_bcd_to_int(storage[4]);
+	d->month = rtc_reg_bcd_to_int((uint8_t) (0x7F & storage[5]));
+	if (0x80 & storage[5])
+		d->year = 2000 + rtc_reg_bcd_to_int(storage[6]);
+	else
+		d->year = 1900 + rtc_reg_bcd_to_int(storage[6]);
+
+	free(storage);
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CHECKS                                        *
+ *                                                                                *
+\**********************************************************************************/
+static uint8_t ref_bcd(unsigned v)
+{
+	return (uint8_t) (((v / 10) << 4) | (v % 10));
+}
+
+static void fail(const char *what, unsigned a, unsigned b)
+{
+	if (failures++ < 10)
+		fprintf(stderr, "  %s : 0x%02X / 0x%02X\n", what, a, b);
+}
+
+/* Every encoder input and every valid BCD byte */
+static uint32_t check_bcd(void)
+{
+	uint32_t n, checked = 0;
+	uint8_t b;
+
+	for (n = 0; n < 256; n++, checked++) {
+		b = int_to_rtc_reg_bcd((uint8_t) n);
+		if (b != ref_bcd(n % 100))
+			fail("int_to_rtc_reg_bcd", n, b);
+		if (rtc_reg_bcd_to_int(b) != n % 100)
+			fail("bcd round trip", n, rtc_reg_bcd_to_int(b));
+	}
+
+	for (n = 0; n < 256; n++) {
+		if ((n & 0x0F) > 9 || (n >> 4) > 9)
+			continue;
+		checked++;
+		if (int_to_rtc_reg_bcd(rtc_reg_bcd_to_int((uint8_t) n)) != n)
+			fail("bcd byte round trip", n, int_to_rtc_reg_bcd(rtc_reg_bcd_to_int((uint8_t) n)));
+	}
+
+	/* get_digit lost libm too : every digit of a spread of 32-bit values */
+	for (n = 0; n < 1000000; n++, checked++) {
+		uint32_t v = n * 4294U + n % 7, p = 1;
+		uint8_t digit;
+
+		for (digit = 1; digit <= 10; digit++, p = (p > 429496729U) ? 0 : p * 10)
+			if (get_digit(digit, v) != (p ? v / p % 10 : 0))
+				fail("get_digit", v, digit);
+	}
+
+	return checked;
+}
+
+/* One date through RTC_set_date, the register file and RTC_read_date */
+static void check_date(Date_TypeDef *d, DS3231_TypeDef *rtc)
+{
+	Date_TypeDef back;
+	uint8_t want[DS3231_DATE_NREGS + 1];
+	uint32_t t0 = transmits, r0 = reads;
+
+	want[0] = DS3231_SECR_PTR;
+	want[1] = ref_bcd(d->second);
+	want[2] = ref_bcd(d->minute);
+	want[3] = ref_bcd(d->hour);
+	want[4] = d->day;
+	want[5] = ref_bcd(d->date);
+	want[6] = ref_bcd(d->month) | (d->year >= 2000 ? DS3231_MONTHR_CENTURY : 0);
+	want[7] = ref_bcd(d->year % 100);
+
+	if (RTC_set_date(d, rtc) != I2C_OK || transmits - t0 != 1 || last_nbytes != sizeof(want) ||
+	    memcmp(last_burst, want, sizeof(want)) != 0)
+		fail("set burst", d->year, last_burst[6]);
+
+	memset(&back, 0xFF, sizeof(back));
+	if (RTC_read_date(&back, rtc) != I2C_OK || reads - r0 != 1 || back.second != d->second || back.minute != d->minute ||
+	    back.hour != d->hour || back.day != d->day || back.date != d->date ||
+	    back.month != d->month || back.year != d->year)
+		fail("read burst", d->year, back.year);
+}
+
+static uint32_t check_bursts(void)
+{
+	static DS3231_TypeDef rtc;
+	Date_TypeDef d = {0, 0, 0, 1, 1, 1, 2000};
+	uint32_t tod, checked = 0;
+	unsigned y, m, day;
+
+	/* Every time of day */
+	for (tod = 0; tod < 86400; tod++, checked++) {
+		d.hour = tod / 3600;
+		d.minute = tod / 60 % 60;
+		d.second = tod % 60;
+		check_date(&d, &rtc);
+	}
+
+	/* Every calendar field of both centuries, at 23:59:59 */
+	d.hour = 23;
+	d.minute = 59;
+	d.second = 59;
+	for (y = 1900; y <= 2099; y++)
+		for (m = 1; m <= 12; m++)
+			for (day = 1; day <= 31; day++, checked++) {
+				d.year = y;
+				d.month = m;
+				d.date = day;
+				d.day = (y + m + day) % 7 + 1;
+				check_date(&d, &rtc);
+			}
+
+	return checked;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  BENCHMARK                                     *
+ *                                                                                *
+\**********************************************************************************/
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best-of time per date set and read back (ns) */
+static double bench(uint8_t old)
+{
+	static DS3231_TypeDef rtc;
+	Date_TypeDef d, back;
+	double best = 0, t;
+	uint32_t i, sum = 0;
+	int run;
+
+	for (run = 0; run < BENCH_RUNS; run++) {
+		t = now_ns();
+		for (i = 0; i < BENCH_DATES; i++) {
+			d.second = i % 60;
+			d.minute = i / 60 % 60;
+			d.hour = i / 3600 % 24;
+			d.day = i % 7 + 1;
+			d.date = i % 28 + 1;
+			d.month = i % 12 + 1;
+			d.year = 1900 + i % 200;
+			if (old) {
+				old_set_date(&d, &rtc);
+				old_read_date(&back);
+			} else {
+				RTC_set_date(&d, &rtc);
+				RTC_read_date(&back, &rtc);
+			}
+			sum += back.second + back.year;
+		}
+		t = (now_ns() - t) / BENCH_DATES;
+		if (run == 0 || t < best)
+			best = t;
+	}
+
+	if (sum == 0)  /* Keeps the loop from being dropped */
+		printf(" ");
+	return best;
+}
+
+int main(void)
+{
+	uint32_t n;
+	double t_old, t_new;
+
+	n = check_bcd();
+	printf("BCD codes and digits  : %u checked\n", n);
+	n = check_bursts();
+	printf("date bursts           : %u round trips\n", n);
+
+	t_old = bench(1);
+	t_new = bench(0);
+	printf("set + read, libm      : %8.1f ns / date\n", t_old);
+	printf("set + read, table     : %8.1f ns / date  (x%.1f)\n", t_new, t_old / t_new);
+
+	if (failures) {
+		printf("%u mismatches\nFAIL\n", failures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,26 @@
+/**********************************************************************************\
+ * @file    tools/feed_sim/stm32l476xx.h                                          *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    20-July-2017                                                          *
+ * @brief   Host stand-in for the device header : feed.c only masks interrupts.   *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/* Single-threaded host : there is nothing to mask */
+#define __disable_irq()			((void) 0)
+#define __enable_irq()			((void) 0)
+#define __get_PRIMASK()			((uint32_t) 0)
+#define __DSB()				((void) 0)	/* irq_wait : never called here */
+#define __WFI()				((void) 0)
+
+#endif
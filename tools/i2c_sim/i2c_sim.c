@@ -0,0 +1,461 @@
+/**********************************************************************************\
+ * @file    tools/i2c_sim/i2c_sim.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    23-June-2017                                                          *
+ * @brief   Host fault-injection simulator for the shared I2C1 driver. Runs       *
+ *          i2c.c and the DS3231 driver against a model of I2C1, DMA1 channels 6  *
+ *          and 7, the PB6 / PB7 open-drain lines and a DS3231, injects NACK,     *
+ *          ARLO, BERR and stuck-SDA faults into chosen transactions, and checks  *
+ *          the returned status, the data and the retry / recovery counters.      *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32l476xx.h"
+#include "i2c.h"
+#include "ds3231.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define SIM_NREGS		(DS3231_TEMPLSBR_PTR + 1)
+#define SIM_CYCLES_PER_READ	50	/* DWT->CYCCNT steps between two reads */
+#define SIM_MAX_FAULTS		8	/* Faulty transactions per scenario */
+
+/* Faults, injected when a START goes out */
+typedef enum
+{
+	FAULT_NONE = 0,
+	FAULT_NACK,		/* Slave does not acknowledge its address */
+	FAULT_ARLO,		/* Another master wins the bus */
+	FAULT_BERR,		/* Misplaced START / STOP seen during the transfer */
+	FAULT_STUCK		/* Slave holds SDA low : the START never goes out */
+} SIM_FaultTypeDef;
+
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Register models : i2c1, gpiob and dwt are what the firmware sees */
+static I2C_TypeDef i2c1;
+static GPIO_TypeDef gpiob = { .IDR = GPIO_IDR_IDR_6 | GPIO_IDR_IDR_7 };
+static DWT_Type dwt;
+RCC_TypeDef sim_rcc;
+DMA_Channel_TypeDef sim_dma1_ch6, sim_dma1_ch7;
+CoreDebug_Type sim_coredebug;
+static uint8_t ev_enabled, er_enabled, in_handler;
+
+/* Bus : SDA held low by the slave until it has seen sda_release SCL pulses */
+static uint8_t sda_held;
+static int sda_release;			/* -1 : never (shorted line) */
+static uint8_t scl_prev = 1, sda_prev = 1;
+static unsigned scl_pulses, stops;
+
+/* DS3231 model */
+static uint8_t ds_regs[SIM_NREGS];
+static uint8_t ds_ptr;
+
+/* Fault plan : faults[n] hits the n-th START of the scenario */
+static SIM_FaultTypeDef faults[SIM_MAX_FAULTS];
+static unsigned starts;
+static int stuck_after;			/* SCL pulses the next stuck slave needs */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  BUS MODEL                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Follows the PB6 / PB7 lines while the driver bit-bangs them :
+  *	   counts SCL pulses, releases a stuck SDA after enough of them and
+  *	   spots STOP conditions. Lines are open-drain with pull-ups.
+  * @param None
+  * @retval None
+  */
+static void sim_lines(void)
+{
+	uint8_t scl_gpio = (gpiob.MODER & GPIO_MODER_MODER6) == GPIO_MODER_MODER6_0;
+	uint8_t sda_gpio = (gpiob.MODER & GPIO_MODER_MODER7) == GPIO_MODER_MODER7_0;
+	uint8_t scl = !(scl_gpio && !(gpiob.ODR & GPIO_ODR_ODR_6));
+	uint8_t sda;
+
+	if (scl && !scl_prev && sda_held) {
+		scl_pulses++;
+		if (sda_release >= 0 && --sda_release <= 0)
+			sda_held = 0;
+	} else if (scl && !scl_prev) {
+		scl_pulses++;
+	}
+
+	sda = !sda_held && !(sda_gpio && !(gpiob.ODR & GPIO_ODR_ODR_7));
+	if (scl && scl_prev && sda && !sda_prev)
+		stops++;
+
+	scl_prev = scl;
+	sda_prev = sda;
+	gpiob.IDR = (scl ? GPIO_IDR_IDR_6 : 0) | (sda ? GPIO_IDR_IDR_7 : 0);
+}
+
+/**
+  * @brief Applies the firmware's writes to I2C1 : flag clears through ICR,
+  *	   STOP, and the reset PE = 0 does.
+  * @param None
+  * @retval None
+  */
+static void sim_regs(void)
+{
+	if (i2c1.ICR != 0) {
+		i2c1.ISR &= ~(i2c1.ICR & (I2C_ICR_NACKCF | I2C_ICR_STOPCF | I2C_ICR_BERRCF |
+					  I2C_ICR_ARLOCF | I2C_ICR_OVRCF));
+		i2c1.ICR = 0;
+	}
+
+	if (i2c1.CR2 & I2C_CR2_STOP) {
+		i2c1.CR2 &= ~I2C_CR2_STOP;
+		i2c1.ISR &= ~I2C_ISR_TC;
+		i2c1.ISR |= I2C_ISR_STOPF;
+	}
+
+	if (!(i2c1.CR1 & I2C_CR1_PE)) {
+		i2c1.ISR = 0;
+		i2c1.CR2 &= ~(I2C_CR2_START | I2C_CR2_STOP);
+	}
+
+	if (sda_held && (i2c1.CR1 & I2C_CR1_PE))
+		i2c1.ISR |= I2C_ISR_BUSY;
+	else
+		i2c1.ISR &= ~I2C_ISR_BUSY;
+}
+
+static void sim_ev_irq(void)
+{
+	if (ev_enabled) {
+		in_handler = 1;
+		I2C1_EV_IRQHandler();
+		in_handler = 0;
+	}
+}
+
+static void sim_er_irq(void)
+{
+	if (er_enabled) {
+		in_handler = 1;
+		I2C1_ER_IRQHandler();
+		in_handler = 0;
+	}
+}
+
+/**
+  * @brief Moves the DMA channel's bytes to or from the DS3231 model.
+  * @param read : Slave to master.
+  * @retval None
+  */
+static void sim_ds3231(uint8_t read)
+{
+	DMA_Channel_TypeDef *ch = read ? &sim_dma1_ch7 : &sim_dma1_ch6;
+	uint8_t *buf = ch->CMAR;
+	uint32_t n = ch->CNDTR, i;
+
+	if (!(ch->CCR & DMA_CCR_EN) || buf == NULL) {
+		fprintf(stderr, "i2c_sim: START without an enabled DMA channel\n");
+		exit(1);
+	}
+
+	for (i = 0; i < n; i++) {
+		if (read) {
+			buf[i] = ds_regs[ds_ptr];
+		} else if (i == 0) {
+			ds_ptr = buf[0];
+			continue;
+		} else {
+			ds_regs[ds_ptr] = buf[i];
+		}
+		ds_ptr = (uint8_t) ((ds_ptr + 1) % SIM_NREGS);
+	}
+	ch->CNDTR = 0;
+}
+
+/**
+  * @brief Runs the transaction a START begins, with the fault planned for
+  *	   it, and raises the interrupts it ends with.
+  * @param None
+  * @retval None
+  */
+static void sim_bus(void)
+{
+	SIM_FaultTypeDef f;
+
+	if (!(i2c1.CR2 & I2C_CR2_START) || !(i2c1.CR1 & I2C_CR1_PE) || sda_held)
+		return;  // A held SDA keeps the START pending until PE is cleared
+
+	f = starts < SIM_MAX_FAULTS ? faults[starts] : FAULT_NONE;
+	starts++;
+
+	if (f == FAULT_STUCK) {
+		/* Reset in the middle of a read : the slave drives a 0 bit */
+		sda_held = 1;
+		sda_release = stuck_after;
+		sim_lines();
+		sim_regs();
+		return;
+	}
+
+	i2c1.CR2 &= ~I2C_CR2_START;
+	i2c1.ISR &= ~I2C_ISR_TC;
+
+	switch (f) {
+	case FAULT_NACK:
+		i2c1.ISR |= I2C_ISR_NACKF | I2C_ISR_STOPF;  // STOP sent by the peripheral
+		sim_ev_irq();
+		return;
+	case FAULT_ARLO:
+		i2c1.ISR |= I2C_ISR_ARLO;
+		sim_er_irq();
+		return;
+	case FAULT_BERR:
+		i2c1.ISR |= I2C_ISR_BERR;
+		sim_er_irq();
+		return;
+	default:
+		break;
+	}
+
+	if ((i2c1.CR2 & I2C_CR2_SADD) >> 1 != DS3231_I2C_ADDR) {
+		i2c1.ISR |= I2C_ISR_NACKF | I2C_ISR_STOPF;
+		sim_ev_irq();
+		return;
+	}
+
+	sim_ds3231((i2c1.CR2 & I2C_CR2_RD_WRN) != 0);
+	i2c1.ISR |= I2C_ISR_TC;
+	sim_ev_irq();
+}
+
+I2C_TypeDef *sim_i2c1(void)
+{
+	sim_regs();
+	if (!in_handler)
+		sim_bus();
+	return &i2c1;
+}
+
+GPIO_TypeDef *sim_gpiob(void)
+{
+	sim_lines();
+	return &gpiob;
+}
+
+DWT_Type *sim_dwt(void)
+{
+	dwt.CYCCNT += SIM_CYCLES_PER_READ;
+	sim_lines();
+	sim_regs();
+	if (!in_handler)
+		sim_bus();
+	return &dwt;
+}
+
+void sim_nvic_enable(IRQn_Type irq)
+{
+	if (irq == I2C1_EV_IRQn)
+		ev_enabled = 1;
+	else if (irq == I2C1_ER_IRQn)
+		er_enabled = 1;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  SCENARIOS                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+typedef enum
+{
+	OP_WRITE = 0,		/* RTC_clear_interrupt_flag : one 2-byte write */
+	OP_READ,		/* 7-byte date read : pointer write, then read */
+	OP_ALARM		/* RTC_enable_interrupts : two writes */
+} SIM_OpTypeDef;
+
+typedef struct
+{
+	const char *name;
+	SIM_OpTypeDef op;
+	SIM_FaultTypeDef faults[SIM_MAX_FAULTS];
+	int stuck_after;	/* SCL pulses a stuck slave needs, -1 : never */
+	I2C_StatusTypeDef status;
+	I2C_StatsTypeDef expect;	/* Only the event counters are compared */
+	unsigned pulses;	/* SCL pulses of all bus clears, STOPs not counted */
+} SIM_ScenarioTypeDef;
+
+#define F4(f)	{ f, f, f, f }
+
+static const SIM_ScenarioTypeDef scenarios[] = {
+	{ "clean write",        OP_WRITE, {0}, 0, I2C_OK,
+	  { .transfers = 1 }, 0 },
+	{ "clean read",         OP_READ,  {0}, 0, I2C_OK,
+	  { .transfers = 1 }, 0 },
+	{ "NACK once",          OP_WRITE, { FAULT_NACK }, 0, I2C_OK,
+	  { .transfers = 1, .retries = 1, .nacks = 1 }, 0 },
+	{ "NACK on read addr",  OP_READ,  { FAULT_NACK }, 0, I2C_OK,
+	  { .transfers = 1, .retries = 1, .nacks = 1 }, 0 },
+	{ "ARLO once",          OP_WRITE, { FAULT_ARLO }, 0, I2C_OK,
+	  { .transfers = 1, .retries = 1, .arlos = 1, .recoveries = 1 }, 0 },
+	{ "BERR once",          OP_WRITE, { FAULT_BERR }, 0, I2C_OK,
+	  { .transfers = 1, .retries = 1, .berrs = 1, .recoveries = 1 }, 0 },
+	{ "BERR in read data",  OP_READ,  { FAULT_NONE, FAULT_BERR }, 0, I2C_OK,
+	  { .transfers = 1, .retries = 1, .berrs = 1, .recoveries = 1 }, 0 },
+	{ "stuck SDA, 5 clk",   OP_WRITE, { FAULT_STUCK }, 5, I2C_OK,
+	  { .transfers = 1, .retries = 1, .timeouts = 1, .recoveries = 1 }, 5 },
+	{ "stuck SDA on read",  OP_READ,  { FAULT_NONE, FAULT_STUCK }, 9, I2C_OK,
+	  { .transfers = 1, .retries = 1, .timeouts = 1, .recoveries = 1 }, 9 },
+	{ "NACK every try",     OP_WRITE, F4(FAULT_NACK), 0, I2C_ERR_NACK,
+	  { .transfers = 1, .retries = 3, .failures = 1, .nacks = 4 }, 0 },
+	{ "ARLO every try",     OP_WRITE, F4(FAULT_ARLO), 0, I2C_ERR_ARLO,
+	  { .transfers = 1, .retries = 3, .failures = 1, .arlos = 4, .recoveries = 4 }, 0 },
+	{ "SDA shorted",        OP_WRITE, { FAULT_STUCK }, -1, I2C_ERR_TIMEOUT,
+	  { .transfers = 1, .retries = 3, .failures = 1, .timeouts = 4, .recoveries = 4 },
+	  4 * I2C_BUS_CLEAR_PULSES },
+	{ "alarm, 1st write NACKs", OP_ALARM, F4(FAULT_NACK), 0, I2C_ERR_NACK,
+	  { .transfers = 1, .retries = 3, .failures = 1, .nacks = 4 }, 0 },
+	{ "alarm, 2nd write BERR",  OP_ALARM, { FAULT_NONE, FAULT_BERR }, 0, I2C_OK,
+	  { .transfers = 2, .retries = 1, .berrs = 1, .recoveries = 1 }, 0 },
+};
+
+/* Date the DS3231 model holds : 23-Jun-2017, Fri, 14:05:59 */
+static const uint8_t ds_date[DS3231_DATE_NREGS] = {0x59, 0x05, 0x14, 0x05, 0x23, 0x86, 0x17};
+
+static void sim_reset(const SIM_ScenarioTypeDef *sc)
+{
+	memset(ds_regs, 0, sizeof(ds_regs));
+	memcpy(ds_regs, ds_date, sizeof(ds_date));
+	ds_regs[DS3231_SR_PTR] = DS3231_SR_A1F;
+	ds_ptr = 0;
+
+	memcpy(faults, sc->faults, sizeof(faults));
+	stuck_after = sc->stuck_after;
+	starts = 0;
+
+	/* Free a line the previous scenario left shorted before counting again */
+	sda_held = 0;
+	sim_lines();
+	scl_pulses = 0;
+	stops = 0;
+	i2c1_reset_stats();
+}
+
+/**
+  * @brief Runs one scenario and compares what the driver returned, left in
+  *	   the DS3231 and counted with what it should have.
+  * @param sc : Scenario.
+  * @retval 1 if it passed, 0 otherwise
+  */
+static int sim_run(const SIM_ScenarioTypeDef *sc)
+{
+	static DS3231_TypeDef rtc;
+	I2C_StatsTypeDef st;
+	Alarm_TypeDef alarm = {0, 7, 12, 1, 1, ALARM1, PERMIN};
+	uint8_t reg = DS3231_SECR_PTR, buf[DS3231_DATE_NREGS];
+	I2C_StatusTypeDef status = I2C_OK;
+	int data_ok = 1, lines_ok, ok;
+
+	sim_reset(sc);
+	memset(buf, 0, sizeof(buf));
+
+	switch (sc->op) {
+	case OP_WRITE:
+		rtc.SR = DS3231_SR_A1F;
+		status = RTC_clear_interrupt_flag(&rtc, ALARM1);
+		if (status == I2C_OK)
+			data_ok = ds_regs[DS3231_SR_PTR] == 0;
+		break;
+	case OP_READ:
+		status = i2c1_read(DS3231_DATE_NREGS, DS3231_I2C_ADDR, &reg, buf);
+		if (status == I2C_OK)
+			data_ok = memcmp(buf, ds_date, sizeof(buf)) == 0;
+		break;
+	case OP_ALARM:
+		status = RTC_enable_interrupts(&rtc, &alarm);
+		if (status == I2C_OK)
+			data_ok = ds_regs[DS3231_ALRM1MINR_PTR] == (DS3231_ALRM1MINR_MASK2 | 0x07) &&
+				  ds_regs[DS3231_CTLR_PTR] == (DS3231_CTLR_INTEN | DS3231_CTLR_A1IE);
+		else
+			data_ok = ds_regs[DS3231_CTLR_PTR] == 0;  // Not enabled half-programmed
+		break;
+	}
+
+	i2c1_get_stats(&st);
+
+	/* After every bus clear : SDA free, pins back on I2C1, STOP sent */
+	lines_ok = (gpiob.MODER & (GPIO_MODER_MODER6 | GPIO_MODER_MODER7)) ==
+		   (GPIO_MODER_MODER6_1 | GPIO_MODER_MODER7_1) &&
+		   stops == (sc->stuck_after < 0 ? 0 : st.recoveries) &&
+		   (sc->stuck_after < 0 || !sda_held);
+
+	ok = status == sc->status && data_ok && lines_ok &&
+	     st.transfers == sc->expect.transfers && st.retries == sc->expect.retries &&
+	     st.failures == sc->expect.failures && st.nacks == sc->expect.nacks &&
+	     st.arlos == sc->expect.arlos && st.berrs == sc->expect.berrs &&
+	     st.timeouts == sc->expect.timeouts && st.recoveries == sc->expect.recoveries &&
+	     scl_pulses == sc->pulses + st.recoveries &&
+	     st.max_recovery_cycles >= st.last_recovery_cycles &&
+	     (st.recoveries == 0) == (st.last_recovery_cycles == 0);
+
+	printf("  %-22s %2d %3u %3u %4u  %3u %3u %3u %3u  %3u %4u %7u us  %s\n",
+	       sc->name, status, st.transfers, st.retries, st.failures, st.nacks, st.arlos,
+	       st.berrs, st.timeouts, st.recoveries, scl_pulses,
+	       st.max_recovery_cycles / (I2C_SYSCLK_FREQ / 1000000U), ok ? "ok" : "FAIL");
+
+	return ok;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+int main(int argc, char **argv)
+{
+	unsigned i, failed = 0;
+
+	if (argc > 1) {
+		fprintf(stderr,
+			"usage: i2c_sim\n"
+			"  Runs DS3231 transfers through i2c.c with NACK, ARLO, BERR and\n"
+			"  stuck-SDA faults injected, and checks the status, the data and\n"
+			"  the retry / recovery counters of each.\n");
+		return 2;
+	}
+
+	i2c1_init();
+
+	printf("  %-22s st trf rty fail  nck arl ber tmo  rcv  clk  max rcv\n", "scenario");
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+		failed += !sim_run(&scenarios[i]);
+
+	printf("%u scenarios, %u failed\n", i, failed);
+	printf("%s\n", failed == 0 ? "PASS" : "FAIL");
+
+	return failed == 0 ? 0 : 1;
+}
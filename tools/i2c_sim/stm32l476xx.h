@@ -0,0 +1,185 @@
+/**********************************************************************************\
+ * @file    tools/i2c_sim/stm32l476xx.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    23-June-2017                                                          *
+ * @brief   Host stand-in for the device header : just the registers the          *
+ *          I2C_PROJECT I2C1 driver (i2c.c) uses.                                 *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              REGISTER BLOCKS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t OTYPER;
+	volatile uint32_t OSPEEDR;
+	volatile uint32_t PUPDR;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+	volatile uint32_t BSRR;
+	volatile uint32_t LCKR;
+	volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+	volatile uint32_t CR2;
+	volatile uint32_t OAR1;
+	volatile uint32_t OAR2;
+	volatile uint32_t TIMINGR;
+	volatile uint32_t TIMEOUTR;
+	volatile uint32_t ISR;
+	volatile uint32_t ICR;
+	volatile uint32_t PECR;
+	volatile uint32_t RXDR;
+	volatile uint32_t TXDR;
+} I2C_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t AHB2ENR;
+	volatile uint32_t APB1ENR1;
+	volatile uint32_t CCIPR;
+} RCC_TypeDef;
+
+/* CMAR keeps a whole host pointer : the driver hands it stack buffers */
+typedef struct
+{
+	volatile uint32_t CCR;
+	volatile uint32_t CNDTR;
+	volatile uint32_t CPAR;
+	void *volatile CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef enum
+{
+	I2C1_EV_IRQn = 31,
+	I2C1_ER_IRQn = 32
+} IRQn_Type;
+
+/* Defined by the simulator */
+extern RCC_TypeDef sim_rcc;
+extern DMA_Channel_TypeDef sim_dma1_ch6, sim_dma1_ch7;
+extern CoreDebug_Type sim_coredebug;
+
+/**
+  * @brief Called on every use of I2C1, GPIOB and DWT. Applies what the
+  *	   firmware wrote since the previous call (flag clears, START, STOP,
+  *	   pin levels), runs the bus transaction a START begins and calls the
+  *	   I2C1 interrupt handlers it raises. DWT also moves the virtual cycle
+  *	   counter on.
+  * @param None
+  * @retval The register block
+  */
+I2C_TypeDef *sim_i2c1(void);
+GPIO_TypeDef *sim_gpiob(void);
+DWT_Type *sim_dwt(void);
+
+void sim_nvic_enable(IRQn_Type irq);
+
+#define I2C1				(sim_i2c1())
+#define GPIOB				(sim_gpiob())
+#define DWT				(sim_dwt())
+#define RCC				(&sim_rcc)
+#define DMA1_Channel6			(&sim_dma1_ch6)
+#define DMA1_Channel7			(&sim_dma1_ch7)
+#define CoreDebug			(&sim_coredebug)
+
+#define NVIC_SetPriority(irq, prio)	((void) (irq), (void) (prio))
+#define NVIC_EnableIRQ(irq)		sim_nvic_enable(irq)
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BIT DEFINITIONS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define RCC_AHB2ENR_GPIOBEN		((uint32_t) 0x00000002)
+#define RCC_APB1ENR1_I2C1EN		((uint32_t) 0x00200000)
+#define RCC_CCIPR_I2C1SEL		((uint32_t) 0x00003000)
+#define RCC_CCIPR_I2C1SEL_1		((uint32_t) 0x00002000)
+
+#define GPIO_MODER_MODER6		((uint32_t) 0x00003000)
+#define GPIO_MODER_MODER6_0		((uint32_t) 0x00001000)
+#define GPIO_MODER_MODER6_1		((uint32_t) 0x00002000)
+#define GPIO_MODER_MODER7		((uint32_t) 0x0000C000)
+#define GPIO_MODER_MODER7_0		((uint32_t) 0x00004000)
+#define GPIO_MODER_MODER7_1		((uint32_t) 0x00008000)
+#define GPIO_OTYPER_OT_6		((uint32_t) 0x00000040)
+#define GPIO_OTYPER_OT_7		((uint32_t) 0x00000080)
+#define GPIO_OSPEEDER_OSPEEDR6		((uint32_t) 0x00003000)
+#define GPIO_OSPEEDER_OSPEEDR6_1	((uint32_t) 0x00002000)
+#define GPIO_OSPEEDER_OSPEEDR7		((uint32_t) 0x0000C000)
+#define GPIO_OSPEEDER_OSPEEDR7_1	((uint32_t) 0x00008000)
+#define GPIO_PUPDR_PUPDR6		((uint32_t) 0x00003000)
+#define GPIO_PUPDR_PUPDR6_0		((uint32_t) 0x00001000)
+#define GPIO_PUPDR_PUPDR7		((uint32_t) 0x0000C000)
+#define GPIO_PUPDR_PUPDR7_0		((uint32_t) 0x00004000)
+#define GPIO_AFRL_AFRL6			((uint32_t) 0x0F000000)
+#define GPIO_AFRL_AFRL7			((uint32_t) 0xF0000000)
+#define GPIO_ODR_ODR_6			((uint32_t) 0x00000040)
+#define GPIO_ODR_ODR_7			((uint32_t) 0x00000080)
+#define GPIO_IDR_IDR_6			((uint32_t) 0x00000040)
+#define GPIO_IDR_IDR_7			((uint32_t) 0x00000080)
+
+#define I2C_CR1_PE			((uint32_t) 0x00000001)
+#define I2C_CR1_NACKIE			((uint32_t) 0x00000010)
+#define I2C_CR1_TCIE			((uint32_t) 0x00000040)
+#define I2C_CR1_ERRIE			((uint32_t) 0x00000080)
+#define I2C_CR1_TXDMAEN			((uint32_t) 0x00004000)
+#define I2C_CR1_RXDMAEN			((uint32_t) 0x00008000)
+
+#define I2C_CR2_SADD			((uint32_t) 0x000003FF)
+#define I2C_CR2_RD_WRN			((uint32_t) 0x00000400)
+#define I2C_CR2_ADD10			((uint32_t) 0x00000800)
+#define I2C_CR2_START			((uint32_t) 0x00002000)
+#define I2C_CR2_STOP			((uint32_t) 0x00004000)
+#define I2C_CR2_NBYTES			((uint32_t) 0x00FF0000)
+#define I2C_CR2_RELOAD			((uint32_t) 0x01000000)
+#define I2C_CR2_AUTOEND			((uint32_t) 0x02000000)
+
+#define I2C_ISR_NACKF			((uint32_t) 0x00000010)
+#define I2C_ISR_STOPF			((uint32_t) 0x00000020)
+#define I2C_ISR_TC			((uint32_t) 0x00000040)
+#define I2C_ISR_BERR			((uint32_t) 0x00000100)
+#define I2C_ISR_ARLO			((uint32_t) 0x00000200)
+#define I2C_ISR_OVR			((uint32_t) 0x00000400)
+#define I2C_ISR_BUSY			((uint32_t) 0x00008000)
+
+#define I2C_ICR_NACKCF			((uint32_t) 0x00000010)
+#define I2C_ICR_STOPCF			((uint32_t) 0x00000020)
+#define I2C_ICR_BERRCF			((uint32_t) 0x00000100)
+#define I2C_ICR_ARLOCF			((uint32_t) 0x00000200)
+#define I2C_ICR_OVRCF			((uint32_t) 0x00000400)
+
+#define DMA_CCR_EN			((uint32_t) 0x00000001)
+
+#define CoreDebug_DEMCR_TRCENA_Msk	((uint32_t) 0x01000000)
+#define DWT_CTRL_CYCCNTENA_Msk		((uint32_t) 0x00000001)
+
+#endif
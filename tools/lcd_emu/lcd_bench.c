@@ -0,0 +1,283 @@
+/**********************************************************************************\
+ * @file    tools/lcd_emu/lcd_bench.c                                             *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    29-June-2017                                                          *
+ * @brief   Host check and benchmark of the segment-LCD character path. Every     *
+ *          char code, at every position, with and without point and colon, must  *
+ *          leave LCD->RAM as the old LCD_Conv_Char_Seg path (lcd_old.c) did.     *
+ *          Then times both paths on display strings the projects show.           *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "stm32l476xx.h"
+#include "lcd_core.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define BENCH_NPOS		6
+#define BENCH_ITERATIONS	200000U	/* String pairs timed per string */
+#define BENCH_MAX_REPORTS	8	/* Mismatches printed before going quiet */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              FAKE PERIPHERALS                                  *
+ *                                                                                *
+\**********************************************************************************/
+GPIO_TypeDef emu_gpioa, emu_gpiob, emu_gpioc, emu_gpiod;
+RCC_TypeDef emu_rcc;
+PWR_TypeDef emu_pwr;
+LCD_TypeDef emu_lcd;
+
+static unsigned long udr_touches;	/* Waits on and requests for a display update */
+
+uint32_t lcd_emu_udr(void)
+{
+	udr_touches++;
+	return 0;
+}
+
+/* lcd_old.c */
+void old_LCD_WriteChar(uint8_t* ch, char point, char colon, uint8_t position);
+void old_LCD_DisplayString(uint8_t* ptr);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  HELPERS                                       *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Strings as the projects display them */
+static const char *const bench_strings[] = {
+	"10:09.30", "SUNDAY", "JUN 29", "2017", "24 C", "-12.5", "(AM)", "GAGNON"
+};
+#define BENCH_NSTRINGS	(sizeof(bench_strings) / sizeof(bench_strings[0]))
+
+static void bench_snapshot(uint32_t *ram)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		ram[i] = emu_lcd.RAM[i];
+}
+
+/* Blank RAM, or every position showing the full glyph with point and colon */
+static void bench_old_background(int full)
+{
+	uint8_t c = 255;
+	int pos;
+
+	memset((void *) emu_lcd.RAM, 0, sizeof(emu_lcd.RAM));
+	for (pos = 0; full && pos < BENCH_NPOS; pos++)
+		old_LCD_WriteChar(&c, 1, 1, (uint8_t) pos);
+}
+
+static void bench_new_background(int full)
+{
+	uint8_t c = 255;
+	int pos;
+
+	LCD_Clear();
+	for (pos = 0; full && pos < BENCH_NPOS; pos++)
+		LCD_WriteChar(&c, 1, 1, (uint8_t) pos);
+}
+
+static double bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned long long bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CHECKS                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Writes every char code at every position, with each point / colon
+  *	   combination, over a blank and over a full display, through both
+  *	   paths and compares the whole of LCD->RAM.
+  * @param None
+  * @retval Mismatches
+  */
+static unsigned bench_glyphs(void)
+{
+	uint32_t old_ram[16], new_ram[16];
+	unsigned cases = 0, failed = 0;
+	int code, pos, flags, full;
+	uint8_t c;
+
+	for (full = 0; full < 2; full++) {
+		for (code = 0; code < 256; code++) {
+			for (pos = 0; pos < BENCH_NPOS; pos++) {
+				for (flags = 0; flags < 4; flags++) {
+					c = (uint8_t) code;
+
+					bench_old_background(full);
+					old_LCD_WriteChar(&c, flags & 1, flags >> 1, (uint8_t) pos);
+					bench_snapshot(old_ram);
+
+					bench_new_background(full);
+					LCD_WriteChar(&c, flags & 1, flags >> 1, (uint8_t) pos);
+					bench_snapshot(new_ram);
+
+					cases++;
+					if (memcmp(old_ram, new_ram, sizeof(old_ram)) == 0)
+						continue;
+					if (failed++ < BENCH_MAX_REPORTS)
+						printf("  code 0x%02X pos %d point %d colon %d over %s : differs\n",
+						       code, pos, flags & 1, flags >> 1, full ? "full" : "blank");
+				}
+			}
+		}
+	}
+
+	printf("glyphs : %u cases (256 codes x %d positions x point/colon x 2 backgrounds), %u differ\n",
+	       cases, BENCH_NPOS, failed);
+	return failed;
+}
+
+/**
+  * @brief Displays each string on a blank display through both paths and
+  *	   compares LCD->RAM.
+  * @param None
+  * @retval Mismatches
+  */
+static unsigned bench_strings_match(void)
+{
+	uint32_t old_ram[16], new_ram[16];
+	unsigned failed = 0;
+	size_t i;
+
+	for (i = 0; i < BENCH_NSTRINGS; i++) {
+		bench_old_background(0);
+		old_LCD_DisplayString((uint8_t *) bench_strings[i]);
+		bench_snapshot(old_ram);
+
+		bench_new_background(0);
+		LCD_DisplayString((uint8_t *) bench_strings[i]);
+		bench_snapshot(new_ram);
+
+		if (memcmp(old_ram, new_ram, sizeof(old_ram)) != 0) {
+			printf("  \"%s\" : differs\n", bench_strings[i]);
+			failed++;
+		}
+	}
+
+	printf("strings : %u displayed, %u differ\n", (unsigned) BENCH_NSTRINGS, failed);
+	return failed;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TIMING                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Times one string through both paths. It alternates with a copy
+  *	   whose first char differs, so every call changes the frame and the
+  *	   new path cannot skip its commit.
+  * @param s : String to display.
+  * @retval None
+  */
+static void bench_time(const char *s)
+{
+	uint8_t a[16], b[16];
+	unsigned long long c0, c_old, c_new;
+	unsigned long u_old, u_new;
+	double t0, t_old, t_new;
+	unsigned i;
+
+	strcpy((char *) a, s);
+	strcpy((char *) b, s);
+	b[0] = (b[0] == '8') ? '0' : '8';
+
+	bench_old_background(0);
+	udr_touches = 0;
+	t0 = bench_now_ns();
+	c0 = bench_cycles();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		old_LCD_DisplayString(a);
+		old_LCD_DisplayString(b);
+	}
+	c_old = bench_cycles() - c0;
+	t_old = bench_now_ns() - t0;
+	u_old = udr_touches;
+
+	bench_new_background(0);
+	udr_touches = 0;
+	t0 = bench_now_ns();
+	c0 = bench_cycles();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		LCD_DisplayString(a);
+		LCD_DisplayString(b);
+	}
+	c_new = bench_cycles() - c0;
+	t_new = bench_now_ns() - t0;
+	u_new = udr_touches;
+
+	printf("  %-10s %8.1f %8.1f %8.0f %8.0f %7.1f %7.1f\n", s,
+	       t_old / (2.0 * BENCH_ITERATIONS), t_new / (2.0 * BENCH_ITERATIONS),
+	       c_old / (2.0 * BENCH_ITERATIONS), c_new / (2.0 * BENCH_ITERATIONS),
+	       u_old / (2.0 * BENCH_ITERATIONS), u_new / (2.0 * BENCH_ITERATIONS));
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+int main(void)
+{
+	unsigned failed;
+	size_t i;
+
+	emu_lcd.SR = LCD_SR_ENS | LCD_SR_RDY | LCD_SR_FCRSR | LCD_SR_UDD;
+
+	failed = bench_glyphs();
+	failed += bench_strings_match();
+
+	/* Host figures : only the old / new ratio carries over to the target.
+	   udr is the UDR waits and requests, each a stall on the target */
+	printf("per string :\n  %-10s %8s %8s %8s %8s %7s %7s\n", "string", "old ns", "new ns",
+	       "old cyc", "new cyc", "old udr", "new udr");
+	for (i = 0; i < BENCH_NSTRINGS; i++)
+		bench_time(bench_strings[i]);
+
+	printf("%s\n", failed ? "FAIL" : "PASS");
+	return failed ? 1 : 0;
+}
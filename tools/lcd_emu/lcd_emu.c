@@ -0,0 +1,647 @@
+/**********************************************************************************\
+ * @file    tools/lcd_emu/lcd_emu.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    05-July-2017                                                          *
+ * @brief   Host emulator for the Discovery board segment LCD. Runs lcd.c         *
+ *          against fake registers and renders every LCD->RAM update as ASCII     *
+ *          art and/or PNG, with a frame-diff log.                                *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32l476xx.h"
+#include "lcd.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define EMU_NPOS		6		/* Character positions on the glass */
+#define EMU_NBARS		4
+#define EMU_LINE_MAX		256
+
+#define EMU_CELL_W		26		/* Character cell, in unscaled pixels */
+#define EMU_CELL_H		40
+#define EMU_BAR_H		10
+#define EMU_SCALE		3
+
+#define EMU_PIX_BG		0xC8		/* Glass */
+#define EMU_PIX_OFF		0xBA		/* Unlit segment */
+#define EMU_PIX_ON		0x20		/* Lit segment */
+
+/* Glyph bits that are DP and colon; positions 5 and 6 have neither (bars use them) */
+#define EMU_GLYPH_DP		0x0002
+#define EMU_GLYPH_COL		0x0020
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TABLES                                        *
+ *                                                                                *
+\**********************************************************************************/
+enum { SEG_A, SEG_B, SEG_C, SEG_D, SEG_E, SEG_F, SEG_G, SEG_H,
+       SEG_J, SEG_K, SEG_M, SEG_N, SEG_P, SEG_Q, SEG_COL, SEG_DP, EMU_NSEGS };
+
+/* Segment driven by glyph bit n : the ST coding matrix used by GlyphMap in lcd.c */
+static const uint8_t glyph_seg[16] = {
+	SEG_N, SEG_DP, SEG_J, SEG_H,	/* bits 3 - 0   : COM3 */
+	SEG_P, SEG_COL, SEG_K, SEG_Q,	/* bits 7 - 4   : COM2 */
+	SEG_D, SEG_C, SEG_A, SEG_F,	/* bits 11 - 8  : COM1 */
+	SEG_E, SEG_M, SEG_B, SEG_G	/* bits 15 - 12 : COM0 */
+};
+
+/* Bit (0 - 63) of the LCD->RAM[2*com] / [2*com + 1] pair for glyph slice bits 0 - 3 (SegScatter in lcd.c) */
+static const uint8_t seg_bits[EMU_NPOS][4] = {
+	{ 4, 23, 22,  3},
+	{ 6, 13, 12,  5},
+	{15, 29, 28, 14},
+	{31, 33, 32, 30},
+	{35, 25, 24, 34},
+	{17,  8,  9, 26}
+};
+
+/* Bars : LCD->RAM word and bit (see LCD_bar) */
+static const uint8_t bar_word[EMU_NBARS] = {6, 4, 6, 4};
+static const uint8_t bar_bit[EMU_NBARS] = {8, 8, 25, 25};
+
+/* Segment outlines in a EMU_CELL_W x EMU_CELL_H cell : x0, y0, x1, y1 (dots have x0 == x1, y0 == y1) */
+static const int8_t seg_line[EMU_NSEGS][4] = {
+	[SEG_A] = { 5,  3, 19,  3}, [SEG_B] = {21,  5, 21, 18}, [SEG_C] = {21, 22, 21, 35},
+	[SEG_D] = { 5, 37, 19, 37}, [SEG_E] = { 3, 22,  3, 35}, [SEG_F] = { 3,  5,  3, 18},
+	[SEG_G] = { 5, 20, 10, 20}, [SEG_M] = {14, 20, 19, 20}, [SEG_H] = { 6,  6, 10, 17},
+	[SEG_J] = {12,  6, 12, 17}, [SEG_K] = {18,  6, 14, 17}, [SEG_Q] = {10, 23,  6, 34},
+	[SEG_P] = {12, 23, 12, 34}, [SEG_N] = {14, 23, 18, 34}, [SEG_DP] = {24, 37, 24, 37},
+	[SEG_COL] = {24, 13, 24, 13}
+};
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              FAKE PERIPHERALS                                  *
+ *                                                                                *
+\**********************************************************************************/
+GPIO_TypeDef emu_gpioa, emu_gpiob, emu_gpioc, emu_gpiod;
+RCC_TypeDef emu_rcc;
+PWR_TypeDef emu_pwr;
+LCD_TypeDef emu_lcd = { .SR = LCD_SR_ENS | LCD_SR_RDY | LCD_SR_FCRSR | LCD_SR_UDD };
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+static uint32_t frame[16];		/* LCD->RAM at the last captured frame */
+static uint16_t ref_glyph[128];		/* Glyph lcd.c produces for each ASCII char */
+static unsigned frame_count = 0;
+static unsigned bits_toggled = 0;
+static unsigned checks = 0;		/* expect / scrolling lines run */
+static unsigned failures = 0;
+static unsigned ticks = 0;		/* Simulated scroll timer expiries */
+static uint8_t scrolling = 0;		/* What the last LCD_ScrollTick returned */
+static char scroll_buf[EMU_LINE_MAX];	/* Scrolled text must outlive its script line */
+static int capture = 0;
+static int quiet = 0;
+static const char *png_prefix = NULL;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              DECODING                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Rebuilds the 16-bit glyph shown at a position from LCD->RAM.
+  * @param ram : LCD->RAM contents.
+  * @param pos : Position (0 - 5).
+  * @retval Glyph (same coding as GlyphMap in lcd.c)
+  */
+static uint16_t emu_glyph(const uint32_t *ram, int pos)
+{
+	uint16_t g = 0;
+	int com, b;
+
+	for (com = 0; com < 4; com++) {
+		for (b = 0; b < 4; b++) {
+			uint8_t bit = seg_bits[pos][b];
+
+			if (ram[2 * com + (bit >> 5)] & (1U << (bit & 31)))
+				g |= (uint16_t) (1U << (12 - 4 * com + b));
+		}
+	}
+
+	if (pos >= 4)
+		g &= (uint16_t) ~(EMU_GLYPH_DP | EMU_GLYPH_COL);
+
+	return g;
+}
+
+static int emu_bar(const uint32_t *ram, int bar)
+{
+	return (ram[bar_word[bar]] >> bar_bit[bar]) & 1;
+}
+
+/**
+  * @brief Maps a glyph back to the char lcd.c would draw it for.
+  * @param g : Glyph without DP / colon.
+  * @retval The char, or '?' when no char produces this glyph.
+  */
+static char emu_glyph_char(uint16_t g)
+{
+	static const char pref[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZdmn*()-+/%";
+	int c;
+
+	for (c = 0; pref[c] != '\0'; c++)
+		if (ref_glyph[(uint8_t) pref[c]] == g)
+			return pref[c];
+
+	for (c = 32; c < 127; c++)
+		if (ref_glyph[c] == g)
+			return (char) c;
+
+	return '?';
+}
+
+/**
+  * @brief Writes what the glass shows as text, with '.' and ':' after the
+  *	   char they belong to (same form LCD_DisplayString accepts).
+  * @param ram : LCD->RAM contents.
+  * @param buf : Destination (at least 3 * EMU_NPOS + 1 bytes).
+  * @retval None
+  */
+static void emu_text(const uint32_t *ram, char *buf)
+{
+	int pos;
+
+	for (pos = 0; pos < EMU_NPOS; pos++) {
+		uint16_t g = emu_glyph(ram, pos);
+
+		*buf++ = emu_glyph_char(g & (uint16_t) ~(EMU_GLYPH_DP | EMU_GLYPH_COL));
+		if (g & EMU_GLYPH_DP)
+			*buf++ = '.';
+		if (g & EMU_GLYPH_COL)
+			*buf++ = ':';
+	}
+	*buf = '\0';
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              RENDERING                                         *
+ *                                                                                *
+\**********************************************************************************/
+
+static void emu_ascii(FILE *out, const uint32_t *ram)
+{
+	char rows[5][EMU_NPOS * 8 + 1];
+	int pos, r, i;
+
+	memset(rows, ' ', sizeof(rows));
+	for (r = 0; r < 5; r++)
+		rows[r][EMU_NPOS * 8] = '\0';
+
+	for (pos = 0; pos < EMU_NPOS; pos++) {
+		uint16_t g = emu_glyph(ram, pos);
+		char on[EMU_NSEGS] = {0};
+		int x = pos * 8;
+
+		for (i = 0; i < 16; i++)
+			if (g & (1U << i))
+				on[glyph_seg[i]] = 1;
+
+		for (i = 1; i <= 5; i++) {
+			if (on[SEG_A]) rows[0][x + i] = '-';
+			if (on[SEG_D]) rows[4][x + i] = '-';
+		}
+		if (on[SEG_F]) rows[1][x] = '|';
+		if (on[SEG_H]) rows[1][x + 1] = '\\';
+		if (on[SEG_J]) rows[1][x + 3] = '|';
+		if (on[SEG_K]) rows[1][x + 5] = '/';
+		if (on[SEG_B]) rows[1][x + 6] = '|';
+		if (on[SEG_G]) rows[2][x + 1] = rows[2][x + 2] = '-';
+		if (on[SEG_M]) rows[2][x + 4] = rows[2][x + 5] = '-';
+		if (on[SEG_E]) rows[3][x] = '|';
+		if (on[SEG_Q]) rows[3][x + 1] = '/';
+		if (on[SEG_P]) rows[3][x + 3] = '|';
+		if (on[SEG_N]) rows[3][x + 5] = '\\';
+		if (on[SEG_C]) rows[3][x + 6] = '|';
+		if (on[SEG_COL]) rows[1][x + 7] = rows[3][x + 7] = '.';
+		if (on[SEG_DP]) rows[4][x + 7] = '.';
+	}
+
+	for (r = 0; r < 5; r++)
+		fprintf(out, "  %s\n", rows[r]);
+
+	fprintf(out, "  bars:");
+	for (i = 0; i < EMU_NBARS; i++)
+		fprintf(out, " %c", emu_bar(ram, i) ? '#' : '.');
+	fprintf(out, "\n");
+}
+
+static void emu_line(uint8_t *pix, int w, int x0, int y0, int x1, int y1, uint8_t v)
+{
+	int dx = abs(x1 - x0), dy = abs(y1 - y0);
+	int steps = (dx > dy ? dx : dy) * EMU_SCALE;
+	int s, bx, by;
+
+	for (s = 0; s <= steps; s++) {
+		int x = (x0 * EMU_SCALE) + (steps ? ((x1 - x0) * EMU_SCALE * s) / steps : 0);
+		int y = (y0 * EMU_SCALE) + (steps ? ((y1 - y0) * EMU_SCALE * s) / steps : 0);
+
+		/* Square brush, two unscaled pixels wide */
+		for (by = -EMU_SCALE; by < EMU_SCALE; by++)
+			for (bx = -EMU_SCALE; bx < EMU_SCALE; bx++)
+				pix[(y + by) * w + (x + bx)] = v;
+	}
+}
+
+static void emu_crc_table(uint32_t *table)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = (uint32_t) n;
+		for (k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+}
+
+static void emu_put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t) (v >> 24);
+	p[1] = (uint8_t) (v >> 16);
+	p[2] = (uint8_t) (v >> 8);
+	p[3] = (uint8_t) v;
+}
+
+static void emu_png_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+{
+	static uint32_t table[256];
+	uint32_t crc = 0xFFFFFFFFU;
+	uint8_t be[4];
+	uint32_t i;
+
+	if (table[1] == 0)
+		emu_crc_table(table);
+
+	emu_put32(be, len);
+	fwrite(be, 1, 4, f);
+	fwrite(type, 1, 4, f);
+	fwrite(data, 1, len, f);
+
+	for (i = 0; i < 4; i++)
+		crc = table[(crc ^ (uint8_t) type[i]) & 0xFF] ^ (crc >> 8);
+	for (i = 0; i < len; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	emu_put32(be, crc ^ 0xFFFFFFFFU);
+	fwrite(be, 1, 4, f);
+}
+
+/**
+  * @brief Writes an 8-bit greyscale PNG using stored (uncompressed) deflate
+  *	   blocks, so no zlib is needed.
+  * @param path : Output file.
+  * @param pix : w * h pixels, row major.
+  * @retval 0 on success, -1 if the file could not be written
+  */
+static int emu_write_png(const char *path, const uint8_t *pix, int w, int h)
+{
+	static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	size_t raw_len = (size_t) (w + 1) * h;
+	size_t nblocks = (raw_len + 65534) / 65535;
+	size_t zlen = 2 + raw_len + 5 * nblocks + 4;
+	uint8_t *raw, *z, *zp;
+	uint8_t ihdr[13];
+	uint32_t a = 1, b = 0;
+	size_t i, done;
+	FILE *f;
+	int y;
+
+	raw = malloc(raw_len);
+	z = malloc(zlen);
+	if (raw == NULL || z == NULL) {
+		free(raw);
+		free(z);
+		return -1;
+	}
+
+	/* Filter type 0 on every row */
+	for (y = 0; y < h; y++) {
+		raw[(size_t) y * (w + 1)] = 0;
+		memcpy(&raw[(size_t) y * (w + 1) + 1], &pix[(size_t) y * w], w);
+	}
+
+	zp = z;
+	*zp++ = 0x78;
+	*zp++ = 0x01;
+	for (done = 0; done < raw_len; ) {
+		size_t n = raw_len - done > 65535 ? 65535 : raw_len - done;
+
+		*zp++ = (done + n == raw_len);  /* BFINAL, BTYPE = stored */
+		*zp++ = (uint8_t) n;
+		*zp++ = (uint8_t) (n >> 8);
+		*zp++ = (uint8_t) ~n;
+		*zp++ = (uint8_t) (~n >> 8);
+		memcpy(zp, &raw[done], n);
+		zp += n;
+		done += n;
+	}
+	for (i = 0; i < raw_len; i++) {
+		a = (a + raw[i]) % 65521U;
+		b = (b + a) % 65521U;
+	}
+	emu_put32(zp, (b << 16) | a);
+
+	emu_put32(&ihdr[0], (uint32_t) w);
+	emu_put32(&ihdr[4], (uint32_t) h);
+	ihdr[8] = 8;	/* Bit depth */
+	ihdr[9] = 0;	/* Greyscale */
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+	f = fopen(path, "wb");
+	if (f != NULL) {
+		fwrite(sig, 1, sizeof(sig), f);
+		emu_png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+		emu_png_chunk(f, "IDAT", z, (uint32_t) zlen);
+		emu_png_chunk(f, "IEND", NULL, 0);
+		fclose(f);
+	}
+
+	free(raw);
+	free(z);
+	return f != NULL ? 0 : -1;
+}
+
+static int emu_png(const char *path, const uint32_t *ram)
+{
+	const int w = EMU_NPOS * EMU_CELL_W * EMU_SCALE;
+	const int h = (EMU_CELL_H + EMU_BAR_H) * EMU_SCALE;
+	uint8_t *pix = malloc((size_t) w * h);
+	int pos, i, rc;
+
+	if (pix == NULL)
+		return -1;
+	memset(pix, EMU_PIX_BG, (size_t) w * h);
+
+	for (pos = 0; pos < EMU_NPOS; pos++) {
+		uint16_t g = emu_glyph(ram, pos);
+		uint32_t lit = 0;
+		int x = pos * EMU_CELL_W;
+
+		for (i = 0; i < 16; i++)
+			if (g & (1U << i))
+				lit |= 1U << glyph_seg[i];
+
+		for (i = 0; i < EMU_NSEGS; i++) {
+			if ((i == SEG_DP || i == SEG_COL) && pos >= 4)
+				continue;
+			emu_line(pix, w, x + seg_line[i][0], seg_line[i][1], x + seg_line[i][2], seg_line[i][3],
+				 (lit & (1U << i)) ? EMU_PIX_ON : EMU_PIX_OFF);
+		}
+		if (lit & (1U << SEG_COL))
+			emu_line(pix, w, x + 24, 27, x + 24, 27, EMU_PIX_ON);
+	}
+
+	for (i = 0; i < EMU_NBARS; i++)
+		emu_line(pix, w, 4 + i * 20, EMU_CELL_H + 5, 18 + i * 20, EMU_CELL_H + 5,
+			 emu_bar(ram, i) ? EMU_PIX_ON : EMU_PIX_OFF);
+
+	rc = emu_write_png(path, pix, w, h);
+	free(pix);
+	return rc;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              FRAME CAPTURE                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+uint32_t lcd_emu_udr(void)
+{
+	char before[3 * EMU_NPOS + 1], after[3 * EMU_NPOS + 1];
+	char path[512];
+	uint32_t ram[16];
+	int i, changed_words = 0, flipped = 0;
+
+	for (i = 0; i < 16; i++)
+		ram[i] = emu_lcd.RAM[i];
+
+	if (!capture || memcmp(ram, frame, sizeof(ram)) == 0)
+		return 0;
+
+	emu_text(frame, before);
+	emu_text(ram, after);
+
+	printf("frame %u: \"%s\" <- \"%s\"  words:", frame_count, after, before);
+	for (i = 0; i < 16; i++) {
+		uint32_t x = ram[i] ^ frame[i];
+
+		if (x == 0)
+			continue;
+		printf(" %d", i);
+		changed_words++;
+		for (; x != 0; x &= x - 1)
+			flipped++;
+	}
+	printf("  bits: %d\n", flipped);
+
+	if (!quiet)
+		emu_ascii(stdout, ram);
+
+	if (png_prefix != NULL) {
+		snprintf(path, sizeof(path), "%s%04u.png", png_prefix, frame_count);
+		if (emu_png(path, ram) != 0)
+			fprintf(stderr, "lcd_emu: cannot write %s\n", path);
+	}
+
+	memcpy(frame, ram, sizeof(frame));
+	bits_toggled += (unsigned) flipped;
+	frame_count++;
+	return 0;
+}
+
+/**
+  * @brief Records the glyph lcd.c draws for every printable char so frames
+  *	   can be logged as text.
+  * @param None
+  * @retval None
+  */
+static void emu_learn_glyphs(void)
+{
+	uint8_t c;
+
+	for (c = 32; c < 127; c++) {
+		LCD_Clear();
+		LCD_WriteChar(&c, 0, 0, 0);
+		ref_glyph[c] = emu_glyph((const uint32_t *) emu_lcd.RAM, 0);
+	}
+	LCD_Clear();
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CHECKS                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Simulated scroll timer : expires n times, calling LCD_ScrollTick
+  *	   like the application's timer task does, and stops early once the
+  *	   scroller reports it has finished.
+  * @param n : Expiries.
+  * @retval None
+  */
+static void emu_tick(unsigned n)
+{
+	while (n-- > 0 && scrolling) {
+		ticks++;
+		scrolling = LCD_ScrollTick();
+	}
+}
+
+/**
+  * @brief Compares the glass with the text expected, given between double
+  *	   quotes so leading and trailing blanks are kept.
+  * @param arg : "<text>", in the form the frame log prints.
+  * @param lineno : Script line, for the report.
+  * @retval None
+  */
+static void emu_expect(const char *arg, unsigned lineno)
+{
+	char shown[3 * EMU_NPOS + 1];
+	size_t len = strlen(arg);
+
+	checks++;
+	emu_text((const uint32_t *) emu_lcd.RAM, shown);
+	if (len < 2 || arg[0] != '"' || arg[len - 1] != '"' ||
+	    strncmp(shown, arg + 1, len - 2) != 0 || shown[len - 2] != '\0') {
+		printf("line %u: expected %s, shown \"%s\" (tick %u)\n", lineno, arg, shown, ticks);
+		failures++;
+	}
+}
+
+static void emu_expect_scrolling(const char *arg, unsigned lineno)
+{
+	checks++;
+	if (scrolling != (uint8_t) atoi(arg)) {
+		printf("line %u: expected scrolling %s, got %u (tick %u)\n", lineno, arg, scrolling, ticks);
+		failures++;
+	}
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+static void emu_usage(void)
+{
+	fprintf(stderr,
+		"usage: lcd_emu [-q] [-o png_prefix] [script]\n"
+		"  Script lines (stdin if no file is given):\n"
+		"    text <string>    LCD_DisplayString\n"
+		"    scroll <string>  LCD_DisplayScrollingString + LCD_ScrollTick until done\n"
+		"    start <string>   LCD_DisplayScrollingString only\n"
+		"    tick [n]         n (default 1) scroll timer expiries : LCD_ScrollTick\n"
+		"    expect \"<text>\"  fail unless the glass shows <text>\n"
+		"    scrolling <0|1>  fail unless the last LCD_ScrollTick returned this\n"
+		"    clear            LCD_Clear\n"
+		"    bar              LCD_bar\n"
+		"    name             LCD_Display_Name\n"
+		"  -q  diff log only (no ASCII art)\n"
+		"  -o  also write <png_prefix>NNNN.png for every frame\n"
+		"  A script with checks ends with PASS or FAIL (exit status 1).\n");
+}
+
+int main(int argc, char **argv)
+{
+	char line[EMU_LINE_MAX];
+	FILE *in = stdin;
+	unsigned lineno = 0;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-q") == 0) {
+			quiet = 1;
+		} else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			png_prefix = argv[++i];
+		} else if (argv[i][0] == '-') {
+			emu_usage();
+			return 2;
+		} else if ((in = fopen(argv[i], "r")) == NULL) {
+			perror(argv[i]);
+			return 1;
+		}
+	}
+
+	emu_learn_glyphs();
+	for (i = 0; i < 16; i++)
+		frame[i] = emu_lcd.RAM[i];
+	capture = 1;
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		char *arg;
+
+		lineno++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+
+		arg = strchr(line, ' ');
+		if (arg != NULL)
+			*arg++ = '\0';
+		else
+			arg = line + strlen(line);
+
+		if (strcmp(line, "text") == 0) {
+			LCD_DisplayString((uint8_t *) arg);
+		} else if (strcmp(line, "scroll") == 0) {
+			strcpy(scroll_buf, arg);
+			LCD_DisplayScrollingString((uint8_t *) scroll_buf);
+			while (LCD_ScrollTick());
+			scrolling = 0;
+		} else if (strcmp(line, "start") == 0) {
+			strcpy(scroll_buf, arg);
+			LCD_DisplayScrollingString((uint8_t *) scroll_buf);
+			scrolling = 1;
+		} else if (strcmp(line, "tick") == 0) {
+			emu_tick(*arg != '\0' ? (unsigned) atoi(arg) : 1U);
+		} else if (strcmp(line, "expect") == 0) {
+			emu_expect(arg, lineno);
+		} else if (strcmp(line, "scrolling") == 0) {
+			emu_expect_scrolling(arg, lineno);
+		} else if (strcmp(line, "clear") == 0) {
+			LCD_Clear();
+		} else if (strcmp(line, "bar") == 0) {
+			LCD_bar();
+		} else if (strcmp(line, "name") == 0) {
+			LCD_Display_Name();
+		} else {
+			fprintf(stderr, "lcd_emu: line %u: unknown command '%s'\n", lineno, line);
+			return 1;
+		}
+	}
+
+	printf("%u frames, %u segment bits toggled\n", frame_count, bits_toggled);
+	if (checks == 0)
+		return 0;
+
+	printf("%u checks, %u failed\n%s\n", checks, failures, failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
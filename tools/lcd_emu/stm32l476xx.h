@@ -0,0 +1,122 @@
+/**********************************************************************************\
+ * @file    tools/lcd_emu/stm32l476xx.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    05-July-2017                                                          *
+ * @brief   Host stand-in for the device header : just the registers lcd.c uses.  *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              REGISTER BLOCKS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t OTYPER;
+	volatile uint32_t OSPEEDR;
+	volatile uint32_t PUPDR;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+	volatile uint32_t BSRR;
+	volatile uint32_t LCKR;
+	volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t AHB2ENR;
+	volatile uint32_t APB1ENR1;
+	volatile uint32_t APB2ENR;
+	volatile uint32_t BDCR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+} PWR_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR;
+	volatile uint32_t FCR;
+	volatile uint32_t SR;
+	volatile uint32_t CLR;
+	uint32_t RESERVED;
+	volatile uint32_t RAM[16];
+} LCD_TypeDef;
+
+/* Defined by the emulator */
+extern GPIO_TypeDef emu_gpioa, emu_gpiob, emu_gpioc, emu_gpiod;
+extern RCC_TypeDef emu_rcc;
+extern PWR_TypeDef emu_pwr;
+extern LCD_TypeDef emu_lcd;
+
+#define GPIOA				(&emu_gpioa)
+#define GPIOB				(&emu_gpiob)
+#define GPIOC				(&emu_gpioc)
+#define GPIOD				(&emu_gpiod)
+#define RCC				(&emu_rcc)
+#define PWR				(&emu_pwr)
+#define LCD				(&emu_lcd)
+
+/**
+  * @brief Called every time lcd.c touches LCD_SR_UDR (the wait before writing
+  *	   LCD->RAM and the request after it). Captures LCD->RAM when it has
+  *	   changed and always returns 0, so waits on UDR never block.
+  * @param None
+  * @retval 0
+  */
+uint32_t lcd_emu_udr(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BIT DEFINITIONS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define RCC_AHB2ENR_GPIOAEN		((uint32_t) 0x00000001)
+#define RCC_AHB2ENR_GPIOBEN		((uint32_t) 0x00000002)
+#define RCC_AHB2ENR_GPIOCEN		((uint32_t) 0x00000004)
+#define RCC_AHB2ENR_GPIODEN		((uint32_t) 0x00000008)
+#define RCC_APB1ENR1_LCDEN		((uint32_t) 0x00000200)
+#define RCC_APB1ENR1_PWREN		((uint32_t) 0x10000000)
+#define RCC_APB2ENR_SYSCFGEN		((uint32_t) 0x00000001)
+
+/* LSERDY shares LSEON's bit so the ready loop ends after one pass */
+#define RCC_BDCR_LSEON			((uint32_t) 0x00000001)
+#define RCC_BDCR_LSERDY			RCC_BDCR_LSEON
+#define RCC_BDCR_LSEBYP			((uint32_t) 0x00000004)
+#define RCC_BDCR_RTCSEL			((uint32_t) 0x00000300)
+#define RCC_BDCR_RTCSEL_0		((uint32_t) 0x00000100)
+#define RCC_BDCR_BDRST			((uint32_t) 0x00010000)
+
+#define PWR_CR1_DBP			((uint32_t) 0x00000100)
+
+#define LCD_CR_LCDEN			((uint32_t) 0x00000001)
+#define LCD_CR_VSEL			((uint32_t) 0x00000002)
+#define LCD_CR_DUTY			((uint32_t) 0x0000001C)
+#define LCD_CR_BIAS			((uint32_t) 0x00000060)
+#define LCD_CR_BIAS_1			((uint32_t) 0x00000040)
+#define LCD_CR_MUX_SEG			((uint32_t) 0x00000080)
+
+#define LCD_FCR_PON			((uint32_t) 0x00000070)
+#define LCD_FCR_CC			((uint32_t) 0x00001C00)
+
+#define LCD_SR_ENS			((uint32_t) 0x00000001)
+#define LCD_SR_UDR			(lcd_emu_udr())
+#define LCD_SR_UDD			((uint32_t) 0x00000008)
+#define LCD_SR_RDY			((uint32_t) 0x00000010)
+#define LCD_SR_FCRSR			((uint32_t) 0x00000020)
+
+#endif
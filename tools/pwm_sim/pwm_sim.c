@@ -0,0 +1,439 @@
+/**********************************************************************************\
+ * @file    tools/pwm_sim/pwm_sim.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    22-July-2017                                                          *
+ * @brief   Host checker for the CAT_FEEDER PWM timing. Runs pwm.c and servo.c    *
+ *          against a stand-in clock tree and checks, across SYSCLK sources and   *
+ *          AHB / APB prescalers : the timer clock pwm_get_clk decodes, the PSC   *
+ *          and ARR pwm_timing picks, and the compare values servo_angle_to_ccr   *
+ *          gives for the servo pulses.                                           *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32l476xx.h"
+#include "pwm.h"
+#include "servo.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define SIM_SENTINEL		((uint32_t) 0xA5A5A5A5U)	/* "Not written" */
+#define SIM_MAX_REPORTS		8	/* Failures printed per check before going quiet */
+
+/* PLLCFGR fields : PLLM and PLLR hold m - 1 and r / 2 - 1 */
+#define SIM_PLL(src, m, n, r)	((uint32_t) (src) | (uint32_t) ((m) - 1) << 4 | \
+				 (uint32_t) (n) << 8 | (uint32_t) ((r) / 2 - 1) << 25)
+#define SIM_MSI(range)		(RCC_CR_MSIRGSEL | (uint32_t) (range) << 4)
+
+typedef unsigned __int128 u128;
+typedef __int128 s128;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+RCC_TypeDef sim_rcc;
+TIM_TypeDef sim_tim1, sim_tim2, sim_tim5, sim_tim8, sim_tim15, sim_tim16, sim_tim17;
+
+/* Clock trees, with SYSCLK worked out by hand */
+typedef struct
+{
+	const char *name;
+	uint32_t cr, sws, pllcfgr;
+	uint32_t sysclk;
+} SIM_ClockTypeDef;
+
+static const SIM_ClockTypeDef clocks[] = {
+	{ "MSI reset",         0,            0,                0, 4000000 },
+	{ "MSI range 9 unsel", 9 << 4,       0,                0, 4000000 },	/* MSIRGSEL clear */
+	{ "MSI 100 kHz",       SIM_MSI(0),   0,                0, 100000 },
+	{ "MSI 200 kHz",       SIM_MSI(1),   0,                0, 200000 },
+	{ "MSI 400 kHz",       SIM_MSI(2),   0,                0, 400000 },
+	{ "MSI 800 kHz",       SIM_MSI(3),   0,                0, 800000 },
+	{ "MSI 1 MHz",         SIM_MSI(4),   0,                0, 1000000 },
+	{ "MSI 2 MHz",         SIM_MSI(5),   0,                0, 2000000 },
+	{ "MSI 4 MHz",         SIM_MSI(6),   0,                0, 4000000 },
+	{ "MSI 8 MHz",         SIM_MSI(7),   0,                0, 8000000 },
+	{ "MSI 16 MHz",        SIM_MSI(8),   0,                0, 16000000 },
+	{ "MSI 24 MHz",        SIM_MSI(9),   0,                0, 24000000 },
+	{ "MSI 32 MHz",        SIM_MSI(10),  0,                0, 32000000 },
+	{ "MSI 48 MHz",        SIM_MSI(11),  0,                0, 48000000 },
+	{ "MSI range 12",      SIM_MSI(12),  0,                0, 4000000 },	/* Reserved range */
+	{ "HSI",               0,            RCC_CFGR_SWS_HSI, 0, 16000000 },
+	{ "HSE",               0,            RCC_CFGR_SWS_HSE, 0, 8000000 },
+	{ "PLL HSI 80 MHz",    0,            RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_HSI, 1, 10, 2), 80000000 },
+	{ "PLL MSI 80 MHz",    0,            RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_MSI, 1, 40, 2), 80000000 },
+	{ "PLL MSI48 40 MHz",  SIM_MSI(11),  RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_MSI, 6, 10, 2), 40000000 },
+	{ "PLL HSE 40 MHz",    0,            RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_HSE, 1, 20, 4), 40000000 },
+	{ "PLL HSI 4 MHz",     0,            RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_HSI, 4, 8, 8), 4000000 },
+	{ "PLL HSE 26.6 MHz",  0,            RCC_CFGR_SWS_PLL,
+	  SIM_PLL(RCC_PLLCFGR_PLLSRC_HSE, 3, 60, 6), 26666666 },
+};
+#define SIM_NCLOCKS	(sizeof(clocks) / sizeof(clocks[0]))
+
+/* Dividers straight from the reference manual's HPRE and PPREx tables */
+static const uint32_t ahb_div[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 2, 4, 8, 16, 64, 128, 256, 512 };
+static const uint32_t apb_div[8] = { 1, 1, 1, 1, 2, 4, 8, 16 };
+
+/* Timers on each bus */
+static TIM_TypeDef *const apb1_tims[] = { TIM2, TIM5 };
+static TIM_TypeDef *const apb2_tims[] = { TIM1, TIM8, TIM15, TIM16, TIM17 };
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  HELPERS                                       *
+ *                                                                                *
+\**********************************************************************************/
+
+static void sim_set_clock(const SIM_ClockTypeDef *c, uint32_t hpre, uint32_t ppre1, uint32_t ppre2)
+{
+	sim_rcc.CR = c->cr;
+	sim_rcc.PLLCFGR = c->pllcfgr;
+	sim_rcc.CFGR = c->sws | hpre << 4 | ppre1 << 8 | ppre2 << 11;
+}
+
+/* Timer clock per the reference manual : PCLK, times 2 if the APB divides */
+static uint32_t sim_tim_clk(uint32_t sysclk, uint32_t hpre, uint32_t ppre)
+{
+	uint32_t div = ahb_div[hpre] * apb_div[ppre];
+
+	return sysclk / div * (apb_div[ppre] > 1 ? 2 : 1);
+}
+
+/* Counter steps in a period at CK_PSC, rounded to the nearest */
+static uint64_t sim_counts(uint32_t clk, uint32_t period_us)
+{
+	return ((uint64_t) clk * period_us + 500000U) / 1000000U;
+}
+
+/* Some prescaler reaches the period with ARR in range and a step no coarser
+   than asked */
+static int sim_reachable(uint32_t clk, uint32_t period_us, uint32_t resolution_ns, uint32_t max_arr)
+{
+	uint64_t counts = sim_counts(clk, period_us), div;
+
+	if (counts < 2)
+		return 0;
+	for (div = 1; div <= PWM_MAX_PSC + 1; div++) {
+		if (div * 1000000000000ULL / clk > (uint64_t) resolution_ns * 1000U)
+			return 0;
+		if (counts <= div * ((uint64_t) max_arr + 1))
+			return 1;
+	}
+	return 0;
+}
+
+static uint64_t sim_abs_diff(u128 a, u128 b)
+{
+	return (uint64_t) (a > b ? a - b : b - a);
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CHECKS                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Every clock tree with every HPRE and PPRE1 / PPRE2 value : each
+  *	   timer must see its own bus's clock.
+  * @param None
+  * @retval Failures
+  */
+static unsigned sim_get_clk(void)
+{
+	unsigned cases = 0, failed = 0;
+	uint32_t hpre, ppre, got, want;
+	size_t c, i;
+
+	for (c = 0; c < SIM_NCLOCKS; c++) {
+		for (hpre = 0; hpre < 16; hpre++) {
+			for (ppre = 0; ppre < 8; ppre++) {
+				/* The other bus on a different divider, so a mix-up shows */
+				sim_set_clock(&clocks[c], hpre, ppre, 7 - ppre);
+
+				want = sim_tim_clk(clocks[c].sysclk, hpre, ppre);
+				for (i = 0; i < sizeof(apb1_tims) / sizeof(apb1_tims[0]); i++, cases++) {
+					got = pwm_get_clk(apb1_tims[i]);
+					if (got != want && failed++ < SIM_MAX_REPORTS)
+						printf("  %s HPRE %u PPRE1 %u : APB1 timer %u Hz, want %u\n",
+						       clocks[c].name, hpre, ppre, got, want);
+				}
+
+				want = sim_tim_clk(clocks[c].sysclk, hpre, 7 - ppre);
+				for (i = 0; i < sizeof(apb2_tims) / sizeof(apb2_tims[0]); i++, cases++) {
+					got = pwm_get_clk(apb2_tims[i]);
+					if (got != want && failed++ < SIM_MAX_REPORTS)
+						printf("  %s HPRE %u PPRE2 %u : APB2 timer %u Hz, want %u\n",
+						       clocks[c].name, hpre, 7 - ppre, got, want);
+				}
+			}
+		}
+	}
+
+	printf("pwm_get_clk : %u cases (%u clock trees x 16 HPRE x 8 PPRE x 7 timers), %u failed\n",
+	       cases, (unsigned) SIM_NCLOCKS, failed);
+	return failed;
+}
+
+/**
+  * @brief Checks one pwm_timing result against the request.
+  * @param clk, period_us, res_ns, max_arr : pwm_timing's arguments.
+  * @param report : Non-zero to print a failure.
+  * @retval 0 if it holds, 1 otherwise
+  */
+static int sim_timing_case(uint32_t clk, uint32_t period_us, uint32_t res_ns, uint32_t max_arr,
+			   int report)
+{
+	PWM_TimingTypeDef t;
+	uint64_t counts = sim_counts(clk, period_us), div, err;
+	u128 got, want;
+	int ret, reachable;
+	const char *why = NULL;
+
+	memset(&t, 0xA5, sizeof(t));
+	ret = pwm_timing(clk, period_us, res_ns, max_arr, &t);
+	reachable = sim_reachable(clk, period_us, res_ns, max_arr);
+
+	if (ret != 0) {
+		if (ret != -1)
+			why = "bad return";
+		else if (reachable)
+			why = "refused a reachable period";
+	} else if (!reachable) {
+		why = "accepted an unreachable period";
+	} else {
+		div = (uint64_t) t.psc + 1;
+
+		/* PSC and ARR in range, ARR at least 1 so there is a duty cycle */
+		if (t.psc > PWM_MAX_PSC || t.arr < 1 || t.arr > max_arr)
+			why = "PSC / ARR out of range";
+		/* The finest step : one less would not cover the period */
+		else if (t.psc > 0 && counts <= (uint64_t) t.psc * ((uint64_t) max_arr + 1))
+			why = "prescaler not the smallest";
+		else if (t.tick_ps != div * 1000000000000ULL / clk)
+			why = "tick_ps wrong";
+		else if (t.tick_ps > (uint64_t) res_ns * 1000U)
+			why = "step coarser than asked";
+		else if ((u128) t.period_ns != (u128) (t.arr + 1ULL) * div * 1000000000U / clk)
+			why = "period_ns wrong";
+		else {
+			/* Within half a step of the period, plus half a CK_PSC cycle of
+			   rounding it to counts : in millionths of a CK_PSC cycle */
+			got = (u128) (t.arr + 1ULL) * div * 1000000U;
+			want = (u128) clk * period_us;
+			err = sim_abs_diff(got, want);
+			if (2 * (u128) err > (u128) (div + 1) * 1000000U)
+				why = "period off by more than half a step";
+		}
+	}
+
+	if (why == NULL)
+		return 0;
+	if (report)
+		printf("  %u Hz, %u us, %u ns step, ARR max %#x : %s (ret %d, PSC %u, ARR %u, period %llu ns)\n",
+		       clk, period_us, res_ns, max_arr, why, ret, t.psc, t.arr, (unsigned long long) t.period_ns);
+	return 1;
+}
+
+/**
+  * @brief pwm_timing over a grid of timer clocks, periods and steps, on 16
+  *	   and 32-bit timers.
+  * @param None
+  * @retval Failures
+  */
+static unsigned sim_timing(void)
+{
+	static const uint32_t clks[] = {
+		100000, 195312, 1000000, 4000000, 8000000, 16000000, 26666666, 48000000, 80000000
+	};
+	/* 10 s and up : TIM2 / TIM5 periods past 2^32 ns */
+	static const uint32_t periods_us[] = {
+		1, 2, 3, 7, 50, 1000, 16384, 20000, 65535, 1000000, 4294967, 10000000, 100000000,
+		4000000000U
+	};
+	static const uint32_t res_ns[] = { 1, 250, 1000, 1000000, 0xFFFFFFFFU };
+	static const uint32_t max_arrs[] = { PWM_MAX_ARR16, PWM_MAX_ARR32 };
+	unsigned cases = 0, failed = 0, ok = 0;
+	size_t c, p, r, a;
+
+	for (c = 0; c < sizeof(clks) / sizeof(clks[0]); c++)
+		for (p = 0; p < sizeof(periods_us) / sizeof(periods_us[0]); p++)
+			for (r = 0; r < sizeof(res_ns) / sizeof(res_ns[0]); r++)
+				for (a = 0; a < sizeof(max_arrs) / sizeof(max_arrs[0]); a++, cases++) {
+					if (sim_timing_case(clks[c], periods_us[p], res_ns[r], max_arrs[a],
+							    failed < SIM_MAX_REPORTS))
+						failed++;
+					else if (sim_reachable(clks[c], periods_us[p], res_ns[r], max_arrs[a]))
+						ok++;
+				}
+
+	printf("pwm_timing : %u cases, %u reachable, %u failed\n", cases, ok, failed);
+	return failed;
+}
+
+/**
+  * @brief Sweeps one servo across its angles, past both ends.
+  * @param servo : SERVO_1 or SERVO_2.
+  * @param TIMx : Its timer.
+  * @param cal : Its calibration.
+  * @param clock : Clock tree, for the report.
+  * @retval 0 if every angle holds, 1 otherwise
+  */
+static int sim_servo_sweep(uint8_t servo, TIM_TypeDef *TIMx, const SERVO_CalibrationTypeDef *cal,
+			   const char *clock)
+{
+	uint64_t div = (uint64_t) TIMx->PSC + 1;
+	uint32_t clk = pwm_get_clk(TIMx), ccr, prev = 0, first = 0, last = 0;
+	int32_t lo, hi, ca, span = cal->max_angle - cal->min_angle;
+	int64_t rise = (int64_t) cal->max_ns - cal->min_ns;
+	int increasing = (rise > 0) == (span > 0);
+	int angle;
+	s128 got, want, tol;
+
+	lo = (cal->min_angle < cal->max_angle) ? cal->min_angle : cal->max_angle;
+	hi = (cal->min_angle < cal->max_angle) ? cal->max_angle : cal->min_angle;
+
+	for (angle = lo - 100; angle <= hi + 100; angle++) {
+		ccr = servo_angle_to_ccr(servo, (int16_t) angle);
+		ca = angle < lo ? lo : angle > hi ? hi : angle;
+
+		/* Within half a step of the line, plus the ns the firmware truncates :
+		   compared as ns x span x clk so it stays exact */
+		got = (s128) ccr * div * 1000000000U * span;
+		want = ((s128) cal->min_ns * span + (s128) rise * (ca - cal->min_angle)) * clk;
+		tol = ((s128) div * 1000000000U / 2 + clk) * abs(span);
+		if (got - want > tol || want - got > tol) {
+			printf("  %s servo %u angle %d : CCR %u off the line\n", clock, servo, angle, ccr);
+			return 1;
+		}
+
+		if (angle > lo - 100 && (increasing ? ccr < prev : ccr > prev)) {
+			printf("  %s servo %u angle %d : CCR %u goes back from %u\n", clock, servo, angle, ccr, prev);
+			return 1;
+		}
+		if (angle == lo)
+			first = ccr;
+		if (angle == hi)
+			last = ccr;
+		prev = ccr;
+	}
+
+	/* Past either end : held at the end */
+	if (servo_angle_to_ccr(servo, (int16_t) (lo - 100)) != first ||
+	    servo_angle_to_ccr(servo, (int16_t) (hi + 100)) != last) {
+		printf("  %s servo %u : not clamped\n", clock, servo);
+		return 1;
+	}
+	return 0;
+}
+
+/**
+  * @brief Sets up TIM2 and TIM5 for the servo period on each clock tree, as
+  *	   main does, then sweeps the servos. Where the period is out of reach
+  *	   the timer must be left untouched.
+  * @param None
+  * @retval Failures
+  */
+static unsigned sim_servo(void)
+{
+	static const SERVO_CalibrationTypeDef cals[] = {
+		{ SERVO_MIN_PULSE_NS, SERVO_MAX_PULSE_NS, SERVO_MIN_ANGLE, SERVO_MAX_ANGLE },
+		{ 2400000, 600000, 0, 1800 },		/* Mounted the other way round */
+		{ 1000000, 2000000, 1350, -450 },	/* Swapped angles */
+	};
+	static const uint32_t dividers[][3] = {	/* HPRE, PPRE1, PPRE2 */
+		{ 0, 0, 0 }, { 0, 4, 5 }, { 8, 0, 0 }, { 9, 6, 4 }, { 15, 7, 7 }
+	};
+	TIM_TypeDef *const tims[SERVO_COUNT] = { TIM2, TIM5 };
+	unsigned cases = 0, failed = 0, refused = 0;
+	char clock[64];
+	size_t c, d, k;
+	uint8_t s;
+	int ret;
+
+	for (c = 0; c < SIM_NCLOCKS; c++) {
+		for (d = 0; d < sizeof(dividers) / sizeof(dividers[0]); d++) {
+			sim_set_clock(&clocks[c], dividers[d][0], dividers[d][1], dividers[d][2]);
+			snprintf(clock, sizeof(clock), "%s HPRE %u PPRE1 %u", clocks[c].name,
+				 dividers[d][0], dividers[d][1]);
+
+			for (s = 0; s < SERVO_COUNT; s++, cases++) {
+				TIM_TypeDef *TIMx = tims[s];
+
+				TIMx->PSC = SIM_SENTINEL;
+				TIMx->ARR = SIM_SENTINEL;
+				TIMx->EGR = 0;
+				ret = pwm_set_period(TIMx, SERVO_PERIOD_US, SERVO_RESOLUTION_NS);
+
+				if (ret != 0) {
+					refused++;
+					if (TIMx->PSC != SIM_SENTINEL || TIMx->ARR != SIM_SENTINEL ||
+					    TIMx->EGR != 0) {
+						printf("  %s servo %u : refused but TIM changed\n", clock, s);
+						failed++;
+					} else if (sim_reachable(pwm_get_clk(TIMx), SERVO_PERIOD_US,
+								 SERVO_RESOLUTION_NS, PWM_MAX_ARR32)) {
+						printf("  %s servo %u : refused a reachable period\n", clock, s);
+						failed++;
+					}
+					continue;
+				}
+				if (!(TIMx->EGR & TIM_EGR_UG)) {
+					printf("  %s servo %u : PSC not loaded\n", clock, s);
+					failed++;
+					continue;
+				}
+
+				for (k = 0; k < sizeof(cals) / sizeof(cals[0]); k++) {
+					servo_calibrate(s, &cals[k]);
+					failed += sim_servo_sweep(s, TIMx, &cals[k], clock);
+				}
+				servo_calibrate(s, &cals[0]);
+			}
+		}
+	}
+
+	printf("servo_angle_to_ccr : %u timer setups, %u out of reach, %u failed\n", cases, refused, failed);
+	return failed;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+int main(void)
+{
+	unsigned failed;
+
+	failed = sim_get_clk();
+	failed += sim_timing();
+	failed += sim_servo();
+
+	printf("%s\n", failed ? "FAIL" : "PASS");
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+/**********************************************************************************\
+ * @file    tools/pwm_sim/stm32l476xx.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    22-July-2017                                                          *
+ * @brief   Host stand-in for the device header : the clock tree registers       *
+ *          pwm.c reads back and the timers pwm.c and servo.c program.            *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              REGISTER BLOCKS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	volatile uint32_t CR;
+	volatile uint32_t CFGR;
+	volatile uint32_t PLLCFGR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+	volatile uint32_t DIER;
+	volatile uint32_t SR;
+	volatile uint32_t EGR;
+	volatile uint32_t PSC;
+	volatile uint32_t ARR;
+	volatile uint32_t CCR2;
+} TIM_TypeDef;
+
+typedef enum
+{
+	TIM2_IRQn = 28
+} IRQn_Type;
+
+/* Defined by the simulator */
+extern RCC_TypeDef sim_rcc;
+extern TIM_TypeDef sim_tim1, sim_tim2, sim_tim5, sim_tim8, sim_tim15, sim_tim16, sim_tim17;
+
+#define RCC				(&sim_rcc)
+#define TIM1				(&sim_tim1)
+#define TIM2				(&sim_tim2)
+#define TIM5				(&sim_tim5)
+#define TIM8				(&sim_tim8)
+#define TIM15				(&sim_tim15)
+#define TIM16				(&sim_tim16)
+#define TIM17				(&sim_tim17)
+
+#define NVIC_SetPriority(irq, prio)	((void) (irq), (void) (prio))
+#define NVIC_EnableIRQ(irq)		((void) (irq))
+
+/* Single-threaded host : there is nothing to mask */
+#define __disable_irq()			((void) 0)
+#define __enable_irq()			((void) 0)
+#define __get_PRIMASK()			((uint32_t) 0)
+#define __DSB()				((void) 0)	/* irq_wait : never called here */
+#define __WFI()				((void) 0)
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BIT DEFINITIONS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define RCC_CR_MSIRGSEL			((uint32_t) 0x00000008)
+#define RCC_CR_MSIRANGE			((uint32_t) 0x000000F0)
+#define RCC_CFGR_SWS			((uint32_t) 0x0000000C)
+#define RCC_CFGR_SWS_HSI		((uint32_t) 0x00000004)
+#define RCC_CFGR_SWS_HSE		((uint32_t) 0x00000008)
+#define RCC_CFGR_SWS_PLL		((uint32_t) 0x0000000C)
+#define RCC_CFGR_HPRE			((uint32_t) 0x000000F0)
+#define RCC_CFGR_PPRE1			((uint32_t) 0x00000700)
+#define RCC_CFGR_PPRE2			((uint32_t) 0x00003800)
+#define RCC_PLLCFGR_PLLSRC		((uint32_t) 0x00000003)
+#define RCC_PLLCFGR_PLLSRC_MSI		((uint32_t) 0x00000001)
+#define RCC_PLLCFGR_PLLSRC_HSI		((uint32_t) 0x00000002)
+#define RCC_PLLCFGR_PLLSRC_HSE		((uint32_t) 0x00000003)
+#define RCC_PLLCFGR_PLLM		((uint32_t) 0x00000070)
+#define RCC_PLLCFGR_PLLN		((uint32_t) 0x00007F00)
+#define RCC_PLLCFGR_PLLR		((uint32_t) 0x06000000)
+
+#define TIM_CR1_CEN			((uint32_t) 0x00000001)
+#define TIM_DIER_UIE			((uint32_t) 0x00000001)
+#define TIM_SR_UIF			((uint32_t) 0x00000001)
+#define TIM_EGR_UG			((uint32_t) 0x00000001)
+
+#endif
@@ -0,0 +1,84 @@
+/**********************************************************************************\
+ * @file    tools/swtimer_sim/stm32l476xx.h                                       *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    21-July-2017                                                          *
+ * @brief   Host stand-in for the device header : LPTIM1 and the NVIC are models  *
+ *          in swtimer_sim.c, run on a virtual clock.                             *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+typedef enum
+{
+	LPTIM1_IRQn = 65
+} IRQn_Type;
+
+typedef struct
+{
+	volatile uint32_t ISR;
+	volatile uint32_t ICR;
+	volatile uint32_t IER;
+	volatile uint32_t CFGR;
+	volatile uint32_t CR;
+	volatile uint32_t CMP;
+	volatile uint32_t ARR;
+	volatile uint32_t CNT;
+} LPTIM_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CSR;
+	volatile uint32_t APB1ENR1;
+	volatile uint32_t CCIPR;
+} RCC_TypeDef;
+
+/* Every LPTIM1 access goes through the model, which lets the counter run */
+LPTIM_TypeDef *sim_lptim(void);
+extern RCC_TypeDef sim_rcc;
+
+#define LPTIM1				(sim_lptim())
+#define RCC				(&sim_rcc)
+
+#define LPTIM_ISR_CMPM			((uint32_t) 0x00000001)
+#define LPTIM_ISR_ARRM			((uint32_t) 0x00000002)
+#define LPTIM_ISR_CMPOK			((uint32_t) 0x00000008)
+#define LPTIM_ISR_ARROK			((uint32_t) 0x00000010)
+#define LPTIM_ICR_CMPMCF		LPTIM_ISR_CMPM
+#define LPTIM_ICR_ARRMCF		LPTIM_ISR_ARRM
+#define LPTIM_ICR_CMPOKCF		LPTIM_ISR_CMPOK
+#define LPTIM_ICR_ARROKCF		LPTIM_ISR_ARROK
+#define LPTIM_IER_CMPMIE		LPTIM_ISR_CMPM
+#define LPTIM_IER_ARRMIE		LPTIM_ISR_ARRM
+#define LPTIM_CR_ENABLE			((uint32_t) 0x00000001)
+#define LPTIM_CR_CNTSTRT		((uint32_t) 0x00000004)
+
+#define RCC_CSR_LSION			((uint32_t) 0x00000001)
+#define RCC_CSR_LSIRDY			((uint32_t) 0x00000002)
+#define RCC_APB1ENR1_LPTIM1EN		((uint32_t) 0x80000000)
+#define RCC_CCIPR_LPTIM1SEL		((uint32_t) 0x000C0000)
+
+/* Core : PRIMASK and the NVIC pending bit are modelled, WFI runs the clock */
+void sim_disable_irq(void);
+void sim_enable_irq(void);
+uint32_t sim_get_primask(void);
+void sim_wfi(void);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+
+#define __disable_irq()			sim_disable_irq()
+#define __enable_irq()			sim_enable_irq()
+#define __get_PRIMASK()			sim_get_primask()
+#define __DSB()				((void) 0)
+#define __WFI()				sim_wfi()
+
+#endif
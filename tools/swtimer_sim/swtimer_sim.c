@@ -0,0 +1,536 @@
+/**********************************************************************************\
+ * @file    tools/swtimer_sim/swtimer_sim.c                                       *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    21-July-2017                                                          *
+ * @brief   Host simulator for the shared software timers. Runs swtimer.c         *
+ *          and delay.c against a model of LPTIM1 (16-bit counter, compare and    *
+ *          auto-reload matches, CMP write synchronisation), PRIMASK and the      *
+ *          NVIC on a virtual clock, and checks every expiry happens once, never  *
+ *          early and not late, across tick count wraps.                          *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stm32l476xx.h"
+#include "swtimer.h"
+#include "delay.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define SIM_SENTINEL		((uint32_t) 0xA5A5A5A5U)	/* "Not written" */
+#define SIM_TIMERS		16
+#define SIM_SLACK		64	/* Ticks the counter may run on during handlers */
+#define SIM_MAX_MASKED		30000	/* Longest masked window (< half a wrap) */
+#define SIM_OP_EVERY		5000	/* Max. ticks between scenario steps */
+#define SIM_TICKS_PER_DAY	((uint64_t) 86400U * SWTIMER_TICK_HZ)
+
+void LPTIM1_IRQHandler(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+
+/* LPTIM1 model : lp is what the firmware sees */
+static LPTIM_TypeDef lp = {0, 0, 0, 0, 0, SIM_SENTINEL, SIM_SENTINEL, 0};
+RCC_TypeDef sim_rcc = {RCC_CSR_LSIRDY, 0, 0};
+static uint32_t raw, cmp_eff, arr_eff = 1;
+static uint64_t sim_t;			/* Counter steps since CNTSTRT */
+static uint8_t running;
+static uint32_t jitter = 32;		/* 1 in jitter register accesses sees the counter step */
+
+/* Core model */
+static uint8_t primask, pending, in_handler, nvic_enabled;
+static uint64_t unmask_t;		/* Last time PRIMASK was cleared */
+
+/* Timers under test */
+typedef struct
+{
+	SWTIMER_TypeDef t;
+	uint64_t lo, hi;		/* Window the next expiry must fall in */
+	uint32_t period;
+	uint8_t running;
+} SIM_TimerTypeDef;
+
+static SIM_TimerTypeDef timers[SIM_TIMERS];
+
+/* Checks */
+static uint64_t handler_calls, fires, skips, cmp_writes, tick_checks;
+static uint32_t early, late, stray, tick_errors, delay_errors;
+static uint8_t chaining;		/* Callbacks start / stop other timers */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  LPTIM1 AND NVIC MODEL                         *
+ *                                                                                *
+\**********************************************************************************/
+
+static void sim_run(uint64_t n);
+
+/* The LPTIM1 line is level sensitive : it pends while an enabled flag is set,
+   and again on return from the handler if a flag is still set */
+static void sim_update_irq(void)
+{
+	if (nvic_enabled && !in_handler && (lp.ISR & lp.IER & (LPTIM_ISR_CMPM | LPTIM_ISR_ARRM)))
+		pending = 1;
+}
+
+static void sim_dispatch(void)
+{
+	while (pending && !primask && !in_handler) {
+		pending = 0;
+		in_handler = 1;
+		handler_calls++;
+		LPTIM1_IRQHandler();
+		in_handler = 0;
+		if (primask) {
+			fprintf(stderr, "LPTIM1 handler returned with interrupts masked\n");
+			exit(1);
+		}
+		sim_lptim();
+		sim_update_irq();
+	}
+}
+
+/* Applies the register writes made since the last access */
+static void sim_sync(void)
+{
+	uint32_t cmp;
+
+	if (lp.ICR != 0) {
+		lp.ISR &= ~lp.ICR;
+		lp.ICR = 0;
+	}
+	if (lp.ARR != SIM_SENTINEL) {
+		arr_eff = lp.ARR & 0xFFFFU;
+		lp.ARR = SIM_SENTINEL;
+		lp.ISR |= LPTIM_ISR_ARROK;
+	}
+	if (lp.CMP != SIM_SENTINEL) {
+		cmp = lp.CMP & 0xFFFFU;
+		lp.CMP = SIM_SENTINEL;
+		cmp_writes++;
+		/* The write takes a few kernel clocks : the old value may still match */
+		if (running && primask && (rand() & 1))
+			sim_run(1);
+		cmp_eff = cmp;
+		lp.ISR |= LPTIM_ISR_CMPOK;
+	}
+	if (!running && (lp.CR & LPTIM_CR_ENABLE) && (lp.CR & LPTIM_CR_CNTSTRT)) {
+		if (arr_eff != SWTIMER_CNT_MASK || lp.CFGR != SWTIMER_PRESC) {
+			fprintf(stderr, "LPTIM1 started with ARR %#x, CFGR %#x\n",
+				(unsigned) arr_eff, (unsigned) lp.CFGR);
+			exit(1);
+		}
+		running = 1;
+	}
+}
+
+LPTIM_TypeDef *sim_lptim(void)
+{
+	sim_sync();
+	/* The counter keeps running while the code executes */
+	if (running && jitter != 0 && rand() % jitter == 0)
+		sim_run(1);
+	lp.CNT = raw;
+	return &lp;
+}
+
+/* Counter steps to the next compare or auto-reload match */
+static uint32_t sim_next_match(void)
+{
+	uint32_t to_arr = (arr_eff - raw) & 0xFFFFU, to_cmp = (cmp_eff - raw) & 0xFFFFU;
+	uint32_t step = to_arr ? to_arr : 0x10000U;
+
+	return (to_cmp != 0 && to_cmp < step) ? to_cmp : step;
+}
+
+/* Advances the counter n steps, raising the matches and taking the interrupt */
+static void sim_run(uint64_t n)
+{
+	uint32_t step;
+
+	while (n > 0 && running) {
+		step = sim_next_match();
+		if (step > n)
+			step = (uint32_t) n;
+
+		raw = (raw + step) & 0xFFFFU;
+		sim_t += step;
+		n -= step;
+
+		if (raw == arr_eff)
+			lp.ISR |= LPTIM_ISR_ARRM;
+		if (raw == cmp_eff)
+			lp.ISR |= LPTIM_ISR_CMPM;
+		sim_update_irq();
+		sim_dispatch();
+	}
+}
+
+/* Ticks swtimer_ticks should read : the tick count starts at 1 */
+static uint64_t sim_now(void)
+{
+	return sim_t + 1;
+}
+
+void sim_disable_irq(void)
+{
+	primask = 1;
+}
+
+void sim_enable_irq(void)
+{
+	if (primask)
+		unmask_t = sim_now();
+	primask = 0;
+	sim_dispatch();
+}
+
+uint32_t sim_get_primask(void)
+{
+	return primask;
+}
+
+/* Sleep : the counter runs until an interrupt is taken, or pends if masked */
+void sim_wfi(void)
+{
+	uint64_t calls = handler_calls;
+
+	while (!pending && handler_calls == calls) {
+		if (!running || !(lp.IER & LPTIM_IER_ARRMIE)) {
+			fprintf(stderr, "WFI with nothing to wake the core\n");
+			exit(1);
+		}
+		sim_run(sim_next_match());
+	}
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority)
+{
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+	nvic_enabled = 1;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+	pending = 1;
+	sim_dispatch();
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TIMERS UNDER TEST                             *
+ *                                                                                *
+\**********************************************************************************/
+
+static void sim_fire(void *arg);
+
+static void sim_start(SIM_TimerTypeDef *s, uint32_t delay_ms, uint32_t period_ms)
+{
+	uint64_t before = sim_now();
+
+	s->lo = before + swtimer_ms_to_ticks(delay_ms) + 1;
+	s->hi = UINT64_MAX;	/* Until the start time is known */
+	s->period = period_ms ? swtimer_ms_to_ticks(period_ms) : 0;
+	s->running = 1;
+
+	swtimer_start(&s->t, delay_ms, period_ms, sim_fire, s);
+
+	/* The counter may have moved while swtimer_start read it */
+	if (s->hi == UINT64_MAX)
+		s->hi = sim_now() + swtimer_ms_to_ticks(delay_ms) + 1;
+}
+
+static void sim_stop(SIM_TimerTypeDef *s)
+{
+	swtimer_stop(&s->t);
+	s->running = 0;
+	if (swtimer_active(&s->t))
+		stray++;
+}
+
+static uint32_t sim_rand_delay(void)
+{
+	switch (rand() % 8) {
+	case 0:
+		return 0;
+	case 1:
+		return 1 + rand() % 3;
+	case 2:
+		return 60000U + (uint32_t) rand() % 200000U;	/* Several counter wraps */
+	default:
+		return (uint32_t) rand() % 3000U;
+	}
+}
+
+static uint32_t sim_rand_period(void)
+{
+	switch (rand() % 8) {
+	case 0:
+		return 1 + rand() % 20;
+	case 1:
+		return 50000U + (uint32_t) rand() % 100000U;
+	case 2:
+	case 3:
+	case 4:
+		return 0;
+	default:
+		return 100U + (uint32_t) rand() % 5000U;
+	}
+}
+
+/* Expiry callback : runs in the LPTIM1 handler */
+static void sim_fire(void *arg)
+{
+	SIM_TimerTypeDef *s = arg, *o;
+	uint64_t now = sim_now(), due;
+
+	/* Fired before sim_start could read the clock again */
+	if (s->hi == UINT64_MAX)
+		s->hi = now;
+	due = (s->hi > unmask_t) ? s->hi : unmask_t;
+
+	fires++;
+	if (!s->running) {
+		stray++;
+		fprintf(stderr, "timer %d fired while stopped\n", (int) (s - timers));
+		return;
+	}
+	if (now < s->lo) {
+		early++;
+		fprintf(stderr, "timer %d fired at %llu, due from %llu\n", (int) (s - timers),
+			(unsigned long long) now, (unsigned long long) s->lo);
+	}
+	if (now > due + SIM_SLACK) {
+		late++;
+		fprintf(stderr, "timer %d fired at %llu, due by %llu\n", (int) (s - timers),
+			(unsigned long long) now, (unsigned long long) due);
+	}
+
+	if (s->period == 0) {
+		s->running = 0;
+		if (swtimer_active(&s->t))
+			stray++;
+	} else {
+		/* Next expiry keeps the phase, unless the timer fell a whole
+		   period behind : the missed expiries are then skipped */
+		if (s->lo + s->period <= now)
+			skips++;
+		s->lo += s->period;
+		s->hi = ((s->hi > now) ? s->hi : now) + s->period;
+	}
+
+	/* Start and stop timers from the interrupt too */
+	if (chaining && rand() % 8 == 0) {
+		o = &timers[rand() % SIM_TIMERS];
+		if (rand() & 1)
+			sim_start(o, sim_rand_delay(), sim_rand_period());
+		else
+			sim_stop(o);
+	}
+}
+
+static void sim_check_ticks(void)
+{
+	uint64_t before = sim_now(), after;
+	uint32_t t = swtimer_ticks();
+
+	after = sim_now();
+	tick_checks++;
+	if ((uint32_t) (t - (uint32_t) before) > (uint32_t) (after - before)) {
+		tick_errors++;
+		fprintf(stderr, "swtimer_ticks %u at %llu\n", (unsigned) t,
+			(unsigned long long) before);
+	}
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  SCENARIOS                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Random starts, restarts and stops from main and from callbacks, with masked
+   windows, for days of virtual time */
+static void sim_random(uint64_t days)
+{
+	uint64_t end = sim_t + days * SIM_TICKS_PER_DAY, now;
+	SIM_TimerTypeDef *s;
+	int i;
+
+	chaining = 1;
+	while (sim_t < end) {
+		sim_run(1 + rand() % SIM_OP_EVERY);
+
+		s = &timers[rand() % SIM_TIMERS];
+		switch (rand() % 10) {
+		case 0:
+		case 1:
+		case 2:
+		case 3:
+			sim_start(s, sim_rand_delay(), sim_rand_period());
+			break;
+		case 4:
+		case 5:
+			sim_stop(s);
+			break;
+		case 6:
+			__disable_irq();
+			sim_check_ticks();
+			sim_run(rand() % SIM_MAX_MASKED);
+			sim_check_ticks();
+			__enable_irq();
+			break;
+		default:
+			sim_check_ticks();
+			break;
+		}
+	}
+	chaining = 0;
+
+	/* Nothing left overdue */
+	now = sim_now();
+	for (i = 0; i < SIM_TIMERS; i++) {
+		if (timers[i].running && now > timers[i].hi + SIM_SLACK) {
+			late++;
+			fprintf(stderr, "timer %d overdue at the end\n", i);
+		}
+		sim_stop(&timers[i]);
+	}
+}
+
+/* delay() sleeps at least as long as asked, with a timer running alongside,
+   and hands back PRIMASK as it found it */
+static uint32_t sim_delays(uint32_t n)
+{
+	uint64_t before, slept;
+	uint32_t i, ms;
+
+	sim_start(&timers[0], 0, 7);
+	for (i = 0; i < n; i++) {
+		ms = (i % 16 == 0) ? i % 3 : (uint32_t) rand() % 3000U;
+		before = sim_t;
+		delay(ms);
+		slept = sim_t - before;
+
+		/* A tick is 1 ms : ms + 1 counter steps cover ms whatever the phase */
+		if (slept < swtimer_ms_to_ticks(ms) + 1 || slept > swtimer_ms_to_ticks(ms) + 1 + SIM_SLACK) {
+			delay_errors++;
+			fprintf(stderr, "delay(%u) slept %llu ticks\n", ms, (unsigned long long) slept);
+		}
+		if (primask) {
+			delay_errors++;
+			fprintf(stderr, "delay(%u) returned with interrupts masked\n", ms);
+		}
+	}
+	sim_stop(&timers[0]);
+
+	return n;
+}
+
+/* One 1 s periodic timer and nothing else : count the interrupts taken */
+static uint64_t sim_idle(uint64_t hours, uint64_t *expiries)
+{
+	uint64_t end = sim_t + hours * 3600U * SWTIMER_TICK_HZ, calls = handler_calls;
+
+	*expiries = fires;
+	sim_start(&timers[1], 1000, 1000);
+	while (sim_t < end)
+		sim_wfi();
+	sim_stop(&timers[1]);
+	*expiries = fires - *expiries;
+
+	return handler_calls - calls;
+}
+
+static void sim_usage(void)
+{
+	fprintf(stderr,
+		"usage: swtimer_sim [-d days] [-s seed] [-j jitter]\n"
+		"  Runs %d timers with random delays and periods (some over a counter\n"
+		"  wrap, some 1 ms) started and stopped from main and from callbacks,\n"
+		"  with interrupts masked for up to %d ms at a time, for days of virtual\n"
+		"  time (default 60 : the 32-bit tick count wraps after 49.7). Then\n"
+		"  checks delay() and counts the interrupts of an idle 1 s timer.\n"
+		"  1 in jitter LPTIM1 accesses sees the counter step (0 : never, else\n"
+		"  at least 16; default 32).\n",
+		SIM_TIMERS, SIM_MAX_MASKED);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t days = 60, idle_calls, idle_expiries, idle_hours = 24;
+	unsigned seed = 1;
+	uint32_t delays;
+	clock_t wall = clock();
+	uint8_t ok;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			days = strtoull(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = (unsigned) strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			jitter = (uint32_t) strtoul(argv[++i], NULL, 0);
+		else {
+			sim_usage();
+			return 2;
+		}
+	}
+	if (jitter != 0 && jitter < 16) {
+		sim_usage();
+		return 2;
+	}
+	srand(seed);
+
+	swtimer_init();
+	sim_random(days);
+	delays = sim_delays(2000);
+	idle_calls = sim_idle(idle_hours, &idle_expiries);
+
+	/* Tickless : one interrupt per expiry plus one per counter wrap */
+	ok = early == 0 && late == 0 && stray == 0 && tick_errors == 0 && delay_errors == 0 &&
+	     idle_calls <= idle_expiries + idle_hours * 3600U * SWTIMER_TICK_HZ / 0x10000U + 2;
+
+	printf("%llu days of random timers (seed %u, jitter 1/%u), %u delays, %llu h idle\n",
+	       (unsigned long long) days, seed, (unsigned) jitter, (unsigned) delays,
+	       (unsigned long long) idle_hours);
+	printf("  expiries         : %llu (%llu periods skipped)\n", (unsigned long long) fires,
+	       (unsigned long long) skips);
+	printf("  early / late     : %u / %u\n", early, late);
+	printf("  stray expiries   : %u\n", stray);
+	printf("  tick reads       : %llu, %u wrong\n", (unsigned long long) tick_checks,
+	       tick_errors);
+	printf("  delay errors     : %u\n", delay_errors);
+	printf("  interrupts       : %llu (%llu CMP writes)\n", (unsigned long long) handler_calls,
+	       (unsigned long long) cmp_writes);
+	printf("  idle interrupts  : %llu for %llu expiries\n", (unsigned long long) idle_calls,
+	       (unsigned long long) idle_expiries);
+	printf("  wall time        : %.2f s\n", (double) (clock() - wall) / CLOCKS_PER_SEC);
+	printf("%s\n", ok ? "PASS" : "FAIL");
+
+	return ok ? 0 : 1;
+}
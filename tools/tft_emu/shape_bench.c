@@ -0,0 +1,236 @@
+/**********************************************************************************\
+ * @file    tools/tft_emu/shape_bench.c                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    18-July-2017                                                          *
+ * @brief   Host benchmark of SHAPE_raster. Draws each primitive over its bounds  *
+ *          in LCD_STRIP_PIXELS strips, as LCD_render does, with anti-aliasing    *
+ *          off and on, and reports the time per shape and the pixels per second. *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "shape.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define BENCH_WIDTH		240
+#define BENCH_HEIGHT		320
+#define BENCH_STRIP_PIXELS	(240 * 16)	/* LCD_STRIP_PIXELS */
+#define BENCH_MIN_NS		50e6		/* Time each case for at least this long */
+#define BENCH_X			120		/* Where every shape is drawn */
+#define BENCH_Y			160
+
+/* Synthetic 4 bpp font : digits and ':' with 16x24 ink boxes */
+#define FONT_FIRST		'0'
+#define FONT_COUNT		11
+#define FONT_W			16
+#define FONT_H			24
+#define FONT_RUNS		5		/* Runs per row */
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+static uint16_t strip[BENCH_STRIP_PIXELS];
+
+static uint8_t font_data[FONT_COUNT * FONT_H * FONT_RUNS];
+static SHAPE_GlyphTypeDef font_glyphs[FONT_COUNT];
+static const SHAPE_FontTypeDef font = {
+	font_data, font_glyphs, FONT_FIRST, FONT_COUNT, 4, 28
+};
+
+static uint16_t bitmap[64 * 64];
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CASES                                         *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	const char *name;
+	SHAPE_TypeDef shape;
+	uint8_t aa;		/* SHAPE_FLAG_AA changes the output */
+} BENCH_CaseTypeDef;
+
+/* Sizes close to what the watch face draws */
+static BENCH_CaseTypeDef cases[] = {
+	{ "filled rect",  { .type = SHAPE_FILLED_RECT, .color = 0x336699, .width = 200, .height = 60 }, 0 },
+	{ "rect",         { .type = SHAPE_RECT, .color = 0x336699, .width = 200, .height = 60, .stroke = 3 }, 0 },
+	{ "rounded fill", { .type = SHAPE_ROUNDED_RECT, .color = 0x336699, .width = 200, .height = 60,
+			    .radius = 12 }, 1 },
+	{ "rounded edge", { .type = SHAPE_ROUNDED_RECT, .color = 0x336699, .width = 200, .height = 60,
+			    .radius = 12, .stroke = 3 }, 1 },
+	{ "disc",         { .type = SHAPE_CIRCLE, .color = 0xFFFFFF, .radius = 100 }, 1 },
+	{ "ring",         { .type = SHAPE_CIRCLE, .color = 0xFFFFFF, .radius = 100, .stroke = 4 }, 1 },
+	{ "arc",          { .type = SHAPE_ARC, .color = 0x00FF00, .radius = 100, .stroke = 6,
+			    .start = 0, .end = 270 }, 1 },
+	{ "line 1px",     { .type = SHAPE_LINE, .color = 0xFF0000, .stroke = 1,
+			    .x0 = 0, .y0 = 0, .x1 = 60, .y1 = -80 }, 1 },
+	{ "line 4px",     { .type = SHAPE_LINE, .color = 0xFF0000, .stroke = 4,
+			    .x0 = 0, .y0 = 0, .x1 = 60, .y1 = -80 }, 1 },
+	{ "bitmap",       { .type = SHAPE_BITMAP, .width = 64, .height = 64, .pixels = bitmap }, 0 },
+	{ "text",         { .type = SHAPE_TEXT, .color = 0xFFFFFF, .font = &font, .text = "10:09:30" }, 0 },
+};
+#define BENCH_NCASES	(sizeof(cases) / sizeof(cases[0]))
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  HELPERS                                       *
+ *                                                                                *
+\**********************************************************************************/
+
+/* Each row : blank, edge, solid, edge, blank. Rows the digit's bits pick
+   are hollow, so the glyphs differ and keep some transparent runs */
+static void bench_font(void)
+{
+	uint8_t *p = font_data;
+	int g, row, hollow;
+
+	for (g = 0; g < FONT_COUNT; g++) {
+		font_glyphs[g].offset = (uint16_t) (p - font_data);
+		font_glyphs[g].width = FONT_W;
+		font_glyphs[g].height = FONT_H;
+		font_glyphs[g].x_off = 1;
+		font_glyphs[g].y_off = 2;
+		font_glyphs[g].advance = FONT_W + 2;
+
+		for (row = 0; row < FONT_H; row++) {
+			hollow = (row / 3 + g) & 1;
+			*p++ = (1 << 4) | 0;		/* 2 blank */
+			*p++ = (0 << 4) | 7;		/* 1 edge */
+			*p++ = (9 << 4) | (hollow ? 0 : 15);	/* 10 solid or blank */
+			*p++ = (0 << 4) | 7;		/* 1 edge */
+			*p++ = (1 << 4) | 0;		/* 2 blank */
+		}
+	}
+}
+
+static double bench_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+  * @brief Draws a shape once over its on-screen bounds, strip by strip, the
+  *	   way LCD_render splits a dirty rectangle.
+  * @param shape : Shape to draw.
+  * @param r : Its bounds, clipped to the screen.
+  * @retval None
+  */
+static void bench_draw(const SHAPE_TypeDef *shape, const SHAPE_RectTypeDef *r)
+{
+	SHAPE_RectTypeDef s;
+	uint32_t w, h, lines;
+
+	w = (uint32_t) (r->x1 - r->x0) + 1;
+	lines = BENCH_STRIP_PIXELS / w;
+	s.x0 = r->x0;
+	s.x1 = r->x1;
+
+	for (s.y0 = r->y0; s.y0 <= r->y1; s.y0 = (int16_t) (s.y1 + 1)) {
+		h = (uint32_t) (r->y1 - s.y0) + 1;
+		if (h > lines)
+			h = lines;
+		s.y1 = (int16_t) (s.y0 + h - 1);
+
+		memset(strip, 0, w * h * sizeof(strip[0]));
+		SHAPE_raster(shape, BENCH_X, BENCH_Y, &s, strip);
+	}
+}
+
+/**
+  * @brief Times one shape.
+  * @param shape : Shape to draw.
+  * @param r : Its bounds, clipped to the screen.
+  * @retval Nanoseconds per shape
+  */
+static double bench_time(const SHAPE_TypeDef *shape, const SHAPE_RectTypeDef *r)
+{
+	unsigned long n = 0, batch = 1;
+	double t0, t;
+
+	bench_draw(shape, r);	/* Warm the caches */
+
+	t0 = bench_now_ns();
+	do {
+		unsigned long i;
+
+		for (i = 0; i < batch; i++)
+			bench_draw(shape, r);
+		n += batch;
+		batch *= 2;
+		t = bench_now_ns() - t0;
+	} while (t < BENCH_MIN_NS);
+
+	return t / n;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+int main(void)
+{
+	const SHAPE_RectTypeDef screen = { 0, 0, BENCH_WIDTH - 1, BENCH_HEIGHT - 1 };
+	SHAPE_RectTypeDef r;
+	uint32_t pixels;
+	double ns;
+	size_t i;
+
+	bench_font();
+	for (i = 0; i < sizeof(bitmap) / sizeof(bitmap[0]); i++)
+		bitmap[i] = (uint16_t) (i * 0x0841);
+
+	/* Host figures : only the ratios between shapes and between AA off and
+	   on carry over to the target. Pixels are the clipped bounds, which is
+	   what LCD_render clears and streams for the shape */
+	printf("  %-12s %7s %10s %9s %10s %9s\n", "shape", "pixels", "ns", "Mpix/s", "AA ns", "AA Mpix/s");
+	for (i = 0; i < BENCH_NCASES; i++) {
+		SHAPE_TypeDef *shape = &cases[i].shape;
+
+		SHAPE_get_bounds(shape, BENCH_X, BENCH_Y, &r);
+		if (!SHAPE_rect_intersect(&r, &screen, &r)) {
+			printf("  %-12s off screen\n", cases[i].name);
+			return 1;
+		}
+		pixels = ((uint32_t) (r.x1 - r.x0) + 1) * ((uint32_t) (r.y1 - r.y0) + 1);
+
+		shape->flags = 0;
+		ns = bench_time(shape, &r);
+		printf("  %-12s %7lu %10.0f %9.1f", cases[i].name, (unsigned long) pixels, ns, pixels * 1e3 / ns);
+
+		if (cases[i].aa) {
+			shape->flags = SHAPE_FLAG_AA;
+			ns = bench_time(shape, &r);
+			printf(" %10.0f %9.1f\n", ns, pixels * 1e3 / ns);
+		} else {
+			printf(" %10s %9s\n", "-", "-");
+		}
+	}
+
+	return 0;
+}
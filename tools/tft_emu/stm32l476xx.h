@@ -0,0 +1,403 @@
+/**********************************************************************************\
+ * @file    tools/tft_emu/stm32l476xx.h                                           *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    17-July-2017                                                          *
+ * @brief   Host stand-in for the device header : just the registers the          *
+ *          SMART_WATCH display stack (spi.c, dma.c, ili9340c.c) and the watch    *
+ *          runtime (watch.c) use.                                                *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+#ifndef STM32L476XX_H
+#define STM32L476XX_H
+
+#include <stdint.h>
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              REGISTER BLOCKS                                   *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	volatile uint32_t MODER;
+	volatile uint32_t OTYPER;
+	volatile uint32_t OSPEEDR;
+	volatile uint32_t PUPDR;
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+	volatile uint32_t BSRR;
+	volatile uint32_t LCKR;
+	volatile uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t IMR1;
+	volatile uint32_t EMR1;
+	volatile uint32_t RTSR1;
+	volatile uint32_t FTSR1;
+	volatile uint32_t SWIER1;
+	volatile uint32_t PR1;
+	volatile uint32_t IMR2;
+} EXTI_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t MEMRMP;
+	volatile uint32_t CFGR1;
+	volatile uint32_t EXTICR[4];
+} SYSCFG_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR;
+	volatile uint32_t CFGR;
+	volatile uint32_t PLLCFGR;
+	volatile uint32_t AHB1ENR;
+	volatile uint32_t AHB2ENR;
+	volatile uint32_t APB1ENR1;
+	volatile uint32_t APB2ENR;
+	volatile uint32_t CCIPR;
+	volatile uint32_t BDCR;
+} RCC_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+} PWR_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t ISR;
+	volatile uint32_t ICR;
+	volatile uint32_t IER;
+	volatile uint32_t CFGR;
+	volatile uint32_t CR;
+	volatile uint32_t CMP;
+	volatile uint32_t ARR;
+	volatile uint32_t CNT;
+} LPTIM_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t SCR;
+} SCB_Type;
+
+typedef struct
+{
+	volatile uint32_t CTRL;
+} SysTick_Type;
+
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+	volatile uint32_t CR1;
+	volatile uint32_t CR2;
+	volatile uint32_t SR;
+	volatile uint32_t DR;
+} SPI_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t ISR;
+	volatile uint32_t IFCR;
+} DMA_TypeDef;
+
+/* CMAR holds a truncated host pointer : the emulator is linked -no-pie */
+typedef struct
+{
+	volatile uint32_t CCR;
+	volatile uint32_t CNDTR;
+	volatile uint32_t CPAR;
+	volatile uint32_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t CSELR;
+} DMA_request_TypeDef;
+
+typedef enum
+{
+	EXTI0_IRQn = 6,
+	DMA1_Channel2_IRQn = 12,
+	DMA1_Channel3_IRQn = 13,
+	DMA1_Channel4_IRQn = 14,
+	DMA1_Channel5_IRQn = 15,
+	EXTI9_5_IRQn = 23,
+	SPI1_IRQn = 35,
+	SPI2_IRQn = 36,
+	SPI3_IRQn = 51,
+	DMA2_Channel1_IRQn = 56,
+	DMA2_Channel2_IRQn = 57,
+	LPTIM1_IRQn = 65
+} IRQn_Type;
+
+/* Defined by the emulator */
+extern GPIO_TypeDef emu_gpioa, emu_gpiob, emu_gpioc, emu_gpioe;
+extern RCC_TypeDef emu_rcc;
+extern SPI_TypeDef emu_spi1, emu_spi2, emu_spi3;
+extern DMA_TypeDef emu_dma1, emu_dma2;
+extern DMA_Channel_TypeDef emu_dma1_ch2, emu_dma1_ch3, emu_dma1_ch4, emu_dma1_ch5;
+extern DMA_Channel_TypeDef emu_dma2_ch1, emu_dma2_ch2;
+extern DMA_request_TypeDef emu_dma1_cselr, emu_dma2_cselr;
+extern EXTI_TypeDef emu_exti;
+extern SYSCFG_TypeDef emu_syscfg;
+extern PWR_TypeDef emu_pwr;
+extern SCB_Type emu_scb;
+extern SysTick_Type emu_systick;
+extern CoreDebug_Type emu_coredebug;
+
+/**
+  * @brief Called on every use of GPIOE and SPI1. Decodes the BSRR write
+  *	   and/or DR write made since the previous call. Firmware never
+  *	   writes one of them twice without naming GPIOE or SPI1 in between.
+  * @param None
+  * @retval The register block
+  */
+GPIO_TypeDef *tft_emu_gpioe(void);
+SPI_TypeDef *tft_emu_spi1(void);
+
+/**
+  * @brief Called when spi_write8 waits on TXE. The byte it is about to store
+  *	   in DR is picked up by the next hook.
+  * @param None
+  * @retval SPI_SR_TXE set (never blocks)
+  */
+uint32_t tft_emu_spi_txe(void);
+
+/**
+  * @brief Called when the driver waits for the bus to go idle.
+  * @param None
+  * @retval 0 (FIFO empty, not busy)
+  */
+uint32_t tft_emu_spi_idle(void);
+
+/**
+  * @brief Called whenever DMA_CCR_EN is evaluated. Like every hook, it first
+  *	   runs an enabled SPI1 TX transfer on channel 3 to completion and
+  *	   calls the transfer-complete handler.
+  * @param None
+  * @retval DMA_CCR_EN's bit
+  */
+uint32_t tft_emu_dma_en(void);
+
+/**
+  * @brief Stands in for WFI : returns at once if a hook just ran a DMA
+  *	   completion, otherwise moves emulated time on to the next TE pulse
+  *	   and runs its handler.
+  * @param None
+  * @retval None
+  */
+void tft_emu_wfi(void);
+
+/**
+  * @brief Called on every use of LPTIM1. Works CNT and the auto-reload
+  *	   match flag out from emulated time, once the counter was started.
+  * @param None
+  * @retval The register block
+  */
+LPTIM_TypeDef *tft_emu_lptim1(void);
+
+/**
+  * @brief Called on every use of DWT. CYCCNT follows emulated time at
+  *	   SYSCLK; writes to it are ignored (only differences are used).
+  * @param None
+  * @retval The register block
+  */
+DWT_Type *tft_emu_dwt(void);
+
+#define GPIOA				(&emu_gpioa)
+#define GPIOB				(&emu_gpiob)
+#define GPIOC				(&emu_gpioc)
+#define GPIOE				(tft_emu_gpioe())
+#define RCC				(&emu_rcc)
+#define SPI1				(tft_emu_spi1())
+#define SPI2				(&emu_spi2)
+#define SPI3				(&emu_spi3)
+#define DMA1				(&emu_dma1)
+#define DMA2				(&emu_dma2)
+#define DMA1_Channel2			(&emu_dma1_ch2)
+#define DMA1_Channel3			(&emu_dma1_ch3)
+#define DMA1_Channel4			(&emu_dma1_ch4)
+#define DMA1_Channel5			(&emu_dma1_ch5)
+#define DMA2_Channel1			(&emu_dma2_ch1)
+#define DMA2_Channel2			(&emu_dma2_ch2)
+#define DMA1_CSELR			(&emu_dma1_cselr)
+#define DMA2_CSELR			(&emu_dma2_cselr)
+#define EXTI				(&emu_exti)
+#define SYSCFG				(&emu_syscfg)
+#define PWR				(&emu_pwr)
+#define LPTIM1				(tft_emu_lptim1())
+#define SCB				(&emu_scb)
+#define SysTick				(&emu_systick)
+#define DWT				(tft_emu_dwt())
+#define CoreDebug			(&emu_coredebug)
+
+#define NVIC_SetPriority(irq, prio)	((void) (irq), (void) (prio))
+#define NVIC_EnableIRQ(irq)		((void) (irq))
+
+/* Interrupts only ever run from the emulator's hooks */
+#define __WFI()				tft_emu_wfi()
+#define __DSB()				((void) 0)
+#define __disable_irq()			((void) 0)
+#define __enable_irq()			((void) 0)
+#define __get_PRIMASK()			((uint32_t) 0)
+#define __set_PRIMASK(m)		((void) (m))
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BIT DEFINITIONS                                   *
+ *                                                                                *
+\**********************************************************************************/
+#define RCC_CR_MSIRGSEL			((uint32_t) 0x00000008)
+#define RCC_CR_MSIRANGE			((uint32_t) 0x000000F0)
+#define RCC_CFGR_SWS			((uint32_t) 0x0000000C)
+#define RCC_CFGR_SWS_HSI		((uint32_t) 0x00000004)
+#define RCC_CFGR_SWS_HSE		((uint32_t) 0x00000008)
+#define RCC_CFGR_SWS_PLL		((uint32_t) 0x0000000C)
+#define RCC_CFGR_HPRE			((uint32_t) 0x000000F0)
+#define RCC_CFGR_PPRE1			((uint32_t) 0x00000700)
+#define RCC_CFGR_PPRE2			((uint32_t) 0x00003800)
+#define RCC_PLLCFGR_PLLSRC		((uint32_t) 0x00000003)
+#define RCC_PLLCFGR_PLLSRC_HSI		((uint32_t) 0x00000002)
+#define RCC_PLLCFGR_PLLSRC_HSE		((uint32_t) 0x00000003)
+#define RCC_PLLCFGR_PLLM		((uint32_t) 0x00000070)
+#define RCC_PLLCFGR_PLLN		((uint32_t) 0x00007F00)
+#define RCC_PLLCFGR_PLLREN		((uint32_t) 0x01000000)
+#define RCC_PLLCFGR_PLLR		((uint32_t) 0x06000000)
+#define RCC_AHB1ENR_DMA1EN		((uint32_t) 0x00000001)
+#define RCC_AHB1ENR_DMA2EN		((uint32_t) 0x00000002)
+#define RCC_AHB2ENR_GPIOBEN		((uint32_t) 0x00000002)
+#define RCC_AHB2ENR_GPIOCEN		((uint32_t) 0x00000004)
+#define RCC_AHB2ENR_GPIOEEN		((uint32_t) 0x00000010)
+#define RCC_CFGR_STOPWUCK		((uint32_t) 0x00008000)
+#define RCC_CCIPR_LPTIM1SEL		((uint32_t) 0x000C0000)
+#define RCC_BDCR_LSEON			((uint32_t) 0x00000001)
+#define RCC_BDCR_LSERDY			((uint32_t) 0x00000002)
+#define RCC_AHB2ENR_GPIOAEN		((uint32_t) 0x00000001)
+#define RCC_APB1ENR1_LPTIM1EN		((uint32_t) 0x80000000)
+#define RCC_APB1ENR1_PWREN		((uint32_t) 0x10000000)
+#define RCC_APB1ENR1_SPI2EN		((uint32_t) 0x00004000)
+#define RCC_APB1ENR1_SPI3EN		((uint32_t) 0x00008000)
+#define RCC_APB2ENR_SYSCFGEN		((uint32_t) 0x00000001)
+#define RCC_APB2ENR_SPI1EN		((uint32_t) 0x00001000)
+
+#define GPIO_MODER_MODER0		((uint32_t) 0x00000003)
+#define GPIO_MODER_MODER9		((uint32_t) 0x000C0000)
+#define GPIO_MODER_MODER10		((uint32_t) 0x00300000)
+#define GPIO_MODER_MODER10_0		((uint32_t) 0x00100000)
+#define GPIO_MODER_MODER11		((uint32_t) 0x00C00000)
+#define GPIO_MODER_MODER11_0		((uint32_t) 0x00400000)
+#define GPIO_MODER_MODER12		((uint32_t) 0x03000000)
+#define GPIO_MODER_MODER12_0		((uint32_t) 0x01000000)
+#define GPIO_MODER_MODER13		((uint32_t) 0x0C000000)
+#define GPIO_MODER_MODER13_1		((uint32_t) 0x08000000)
+#define GPIO_MODER_MODER14		((uint32_t) 0x30000000)
+#define GPIO_MODER_MODER14_1		((uint32_t) 0x20000000)
+#define GPIO_MODER_MODER15		((uint32_t) 0xC0000000)
+#define GPIO_MODER_MODER15_1		((uint32_t) 0x80000000)
+#define GPIO_OSPEEDER_OSPEEDR10		((uint32_t) 0x00300000)
+#define GPIO_OSPEEDER_OSPEEDR13		((uint32_t) 0x0C000000)
+#define GPIO_OSPEEDER_OSPEEDR15		((uint32_t) 0xC0000000)
+#define GPIO_AFRH_AFRH5			((uint32_t) 0x00F00000)
+#define GPIO_AFRH_AFRH6			((uint32_t) 0x0F000000)
+#define GPIO_AFRH_AFRH7			((uint32_t) 0xF0000000)
+#define GPIO_PUPDR_PUPDR9		((uint32_t) 0x000C0000)
+#define GPIO_BSRR_BS_12			((uint32_t) 0x00001000)
+
+#define SYSCFG_EXTICR1_EXTI0		((uint32_t) 0x00000007)
+#define SYSCFG_EXTICR1_EXTI0_PA		((uint32_t) 0x00000000)
+#define SYSCFG_EXTICR3_EXTI9		((uint32_t) 0x00000070)
+#define SYSCFG_EXTICR3_EXTI9_PE		((uint32_t) 0x00000040)
+#define EXTI_IMR1_IM0			((uint32_t) 0x00000001)
+#define EXTI_RTSR1_RT0			((uint32_t) 0x00000001)
+#define EXTI_FTSR1_FT0			((uint32_t) 0x00000001)
+#define EXTI_PR1_PIF0			((uint32_t) 0x00000001)
+#define EXTI_IMR2_IM32			((uint32_t) 0x00000001)
+#define EXTI_IMR1_IM9			((uint32_t) 0x00000200)
+#define EXTI_RTSR1_RT9			((uint32_t) 0x00000200)
+#define EXTI_FTSR1_FT9			((uint32_t) 0x00000200)
+#define EXTI_PR1_PIF9			((uint32_t) 0x00000200)
+
+#define SPI_CR1_CPHA			((uint32_t) 0x00000001)
+#define SPI_CR1_CPOL			((uint32_t) 0x00000002)
+#define SPI_CR1_MSTR			((uint32_t) 0x00000004)
+#define SPI_CR1_BR			((uint32_t) 0x00000038)
+#define SPI_CR1_SPE			((uint32_t) 0x00000040)
+#define SPI_CR1_LSBFIRST		((uint32_t) 0x00000080)
+#define SPI_CR1_SSI			((uint32_t) 0x00000100)
+#define SPI_CR1_SSM			((uint32_t) 0x00000200)
+#define SPI_CR1_RXONLY			((uint32_t) 0x00000400)
+#define SPI_CR1_BIDIOE			((uint32_t) 0x00004000)
+
+#define SPI_CR2_RXDMAEN			((uint32_t) 0x00000001)
+#define SPI_CR2_TXDMAEN			((uint32_t) 0x00000002)
+#define SPI_CR2_DS			((uint32_t) 0x00000F00)
+#define SPI_CR2_DS_0			((uint32_t) 0x00000100)
+#define SPI_CR2_DS_1			((uint32_t) 0x00000200)
+#define SPI_CR2_DS_2			((uint32_t) 0x00000400)
+#define SPI_CR2_RXNEIE			((uint32_t) 0x00000040)
+#define SPI_CR2_TXEIE			((uint32_t) 0x00000080)
+#define SPI_CR2_FRXTH			((uint32_t) 0x00001000)
+
+/* Status polls go through the emulator so the byte stream can be followed */
+#define SPI_SR_TXE			(tft_emu_spi_txe())
+#define SPI_SR_BSY			(tft_emu_spi_idle())
+#define SPI_SR_FTLVL			(tft_emu_spi_idle())
+#define SPI_SR_FRLVL			(tft_emu_spi_idle())
+
+/* Nothing is received : polled and interrupt transfers are not modelled */
+#define SPI_SR_RXNE			((uint32_t) 0x00000001)
+
+#define DMA_CCR_EN			(tft_emu_dma_en())
+#define DMA_CCR_TCIE			((uint32_t) 0x00000002)
+#define DMA_CCR_DIR			((uint32_t) 0x00000010)
+#define DMA_CCR_CIRC			((uint32_t) 0x00000020)
+#define DMA_CCR_PINC			((uint32_t) 0x00000040)
+#define DMA_CCR_MINC			((uint32_t) 0x00000080)
+#define DMA_CCR_PSIZE			((uint32_t) 0x00000300)
+#define DMA_CCR_PSIZE_0			((uint32_t) 0x00000100)
+#define DMA_CCR_MSIZE			((uint32_t) 0x00000C00)
+#define DMA_CCR_MSIZE_0			((uint32_t) 0x00000400)
+#define DMA_CCR_PL			((uint32_t) 0x00003000)
+#define DMA_CCR_PL_1			((uint32_t) 0x00002000)
+
+#define DMA_ISR_TCIF1			((uint32_t) 0x00000002)
+#define DMA_ISR_TCIF3			((uint32_t) 0x00000200)
+#define DMA_IFCR_CGIF1			((uint32_t) 0x00000001)
+#define DMA_CSELR_C1S			((uint32_t) 0x0000000F)
+
+#define PWR_CR1_DBP			((uint32_t) 0x00000100)
+#define PWR_CR1_LPMS			((uint32_t) 0x00000007)
+#define PWR_CR1_LPMS_STOP2		((uint32_t) 0x00000002)
+
+#define LPTIM_ISR_ARRM			((uint32_t) 0x00000002)
+#define LPTIM_ISR_ARROK			((uint32_t) 0x00000010)
+#define LPTIM_ICR_ARRMCF		((uint32_t) 0x00000002)
+#define LPTIM_ICR_ARROKCF		((uint32_t) 0x00000010)
+#define LPTIM_IER_ARRMIE		((uint32_t) 0x00000002)
+#define LPTIM_CR_ENABLE			((uint32_t) 0x00000001)
+#define LPTIM_CR_CNTSTRT		((uint32_t) 0x00000004)
+
+#define SCB_SCR_SLEEPDEEP_Msk		((uint32_t) 0x00000004)
+#define CoreDebug_DEMCR_TRCENA_Msk	((uint32_t) 0x01000000)
+#define DWT_CTRL_CYCCNTENA_Msk		((uint32_t) 0x00000001)
+
+#endif
@@ -0,0 +1,1606 @@
+/**********************************************************************************\
+ * @file    tools/tft_emu/tft_emu.c                                               *
+ * @author  Nolan R. H. Gagnon                                                    *
+ * @version V1.0                                                                  *
+ * @date    17-July-2017                                                          *
+ * @brief   Host emulator for the SMART_WATCH ILI9340C panel. Runs the display    *
+ *          stack (spi.c, dma.c, ili9340c.c, shape.c, tft_lcd.c, compositor.c)    *
+ *          against fake registers, decodes the SPI byte stream into a model of   *
+ *          the controller's GRAM and writes every frame as a PNG, with the       *
+ *          bytes and chip-select transactions it cost. The watch runtime         *
+ *          (watch.c) can run on top, with LPTIM1 ticks in emulated time.         *
+ *                                                                                *
+ **********************************************************************************
+ * @attention                                                                     *
+ *                                                                                *
+ * <h2><center>&copy; COPYRIGHT(c) 2017 Nolan R. H. Gagnon  </center></h2>        *
+ *                                                                                *
+\**********************************************************************************/
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  INCLUDES                                      *
+ *                                                                                *
+\**********************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32l476xx.h"
+#include "ili9340c.h"
+#include "spi.h"
+#include "compositor.h"
+#include "scroll_list.h"
+#include "watch.h"
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  CONSTANTS                                     *
+ *                                                                                *
+\**********************************************************************************/
+#define EMU_W			ILI9340C_WIDTH	/* GRAM columns */
+#define EMU_H			ILI9340C_HEIGHT	/* GRAM rows */
+#define EMU_LINE_MAX		256
+#define EMU_MAX_TOKENS		16
+#define EMU_MAX_PARAMS		16
+#define EMU_MAX_ROWS		64	/* Rows in the demo scrolling list */
+#define EMU_SECOND_NS		1000000000ULL	/* LPTIM1 auto-reload period */
+
+#define EMU_DC			(1U << ILI9340C_DC_PIN)
+#define EMU_RST			(1U << ILI9340C_RST_PIN)
+#define EMU_CS			(1U << ILI9340C_CS_PIN)
+
+#define EMU_BLANK		0xFFFFFF	/* Normally-white glass with no drive */
+
+/* The clock tree sysclk_init sets up : PLL from HSI16, /2 * 20 / 2 */
+#define EMU_PCLK_FREQ		80000000U
+#define EMU_PLLCFGR		(RCC_PLLCFGR_PLLSRC_HSI | (1U << 4) | (20U << 8) | RCC_PLLCFGR_PLLREN)
+
+/* Fastest SCK the glass takes : tSCYCW, unless built with make fast_spi,
+   which runs past the datasheet on purpose */
+#ifdef ILI9340C_SPI_FAST
+#define EMU_SCK_LIMIT		ILI9340C_SPI_FAST_FREQ
+#else
+#define EMU_SCK_LIMIT		ILI9340C_SPI_TSCYCW_FREQ
+#endif
+
+/* Register checks, each reported once */
+#define EMU_ERR_SPI_CLOCK	0x001
+#define EMU_ERR_SPI_MASTER	0x002
+#define EMU_ERR_SPI_MODE	0x004
+#define EMU_ERR_SPI_SCK		0x008
+#define EMU_ERR_DMA_CLOCK	0x010
+#define EMU_ERR_DMA_REQ		0x020
+#define EMU_ERR_DMA_PATH	0x040
+#define EMU_ERR_DMA_SIZE	0x080
+
+/* Refresh timing : f_osc / (2^DIVA * RTNA) lines per second, 320 lines + 4 porch */
+#define EMU_OSC_HZ		615000ULL
+#define EMU_VBP			2
+#define EMU_FRAME_LINES		(EMU_H + 4)
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  TYPES                                         *
+ *                                                                                *
+\**********************************************************************************/
+typedef struct
+{
+	uint32_t gram[EMU_H][EMU_W];	/* 0xRRGGBB as received */
+	uint8_t madctl;
+	uint8_t pixfmt;
+	uint16_t sc, ec;		/* Column window (CASET) */
+	uint16_t sp, ep;		/* Page window (PASET) */
+	uint16_t col, page;		/* RAMWRITE pointer */
+	uint16_t tfa, vsa, bfa;		/* Scroll areas (VSAREA) */
+	uint16_t vsp;			/* First line of the scroll area (VSSADDR) */
+	uint8_t scrolling;		/* VSSADDR seen since the last NORON / PTLON */
+	uint8_t sleeping;
+	uint8_t disp_on;
+	uint8_t inverted;
+	uint8_t brightness;
+	uint8_t te_on;			/* TEAR_ON */
+	uint16_t tear_line;		/* SET_TEARLN */
+	uint8_t diva, rtna;		/* SET_FRMRTN */
+	int tear_rel;			/* Scan line vs write row at the last pixel : -1 behind, 1 at/ahead */
+	int tear_s;			/* Scan line at the last pixel */
+	uint8_t torn;			/* The current RAMWRITE was overtaken by the scan */
+	uint8_t cmd;			/* Command the data bytes belong to */
+	uint8_t params[EMU_MAX_PARAMS];
+	uint8_t nparams;
+	uint8_t pix[3];			/* Partial pixel */
+	uint8_t npix;
+} EMU_PanelTypeDef;
+
+typedef struct
+{
+	uint32_t bytes;			/* Clocked in while selected */
+	uint32_t transactions;		/* Chip select assert / deassert pairs */
+	uint32_t commands;
+	uint32_t windows;		/* RAMWRITEs */
+	uint32_t pixels;
+	uint32_t stray;			/* Clocked out while deselected or in reset */
+	uint32_t te;			/* TE pulses delivered */
+	uint32_t tears;			/* RAMWRITEs the scan overtook mid-way */
+	uint32_t delay_ms;
+} EMU_CountTypeDef;
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              FAKE PERIPHERALS                                  *
+ *                                                                                *
+\**********************************************************************************/
+GPIO_TypeDef emu_gpioa, emu_gpiob, emu_gpioc, emu_gpioe;
+RCC_TypeDef emu_rcc;
+SPI_TypeDef emu_spi1 = { .CR2 = SPI_CR2_DS_2 | SPI_CR2_DS_1 | SPI_CR2_DS_0, .SR = 0x00000002 };
+SPI_TypeDef emu_spi2, emu_spi3;
+DMA_TypeDef emu_dma1, emu_dma2;
+DMA_Channel_TypeDef emu_dma1_ch2, emu_dma1_ch3, emu_dma1_ch4, emu_dma1_ch5;
+DMA_Channel_TypeDef emu_dma2_ch1, emu_dma2_ch2;
+DMA_request_TypeDef emu_dma1_cselr, emu_dma2_cselr;
+EXTI_TypeDef emu_exti;
+SYSCFG_TypeDef emu_syscfg;
+PWR_TypeDef emu_pwr;
+LPTIM_TypeDef emu_lptim1;
+SCB_Type emu_scb;
+SysTick_Type emu_systick;
+DWT_Type emu_dwt;
+CoreDebug_Type emu_coredebug;
+
+/* Firmware */
+void DMA1_Channel3_IRQHandler(void);
+void EXTI9_5_IRQHandler(void);
+void LPTIM1_IRQHandler(void);
+void EXTI0_IRQHandler(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  STATE                                         *
+ *                                                                                *
+\**********************************************************************************/
+static EMU_PanelTypeDef panel;
+static uint32_t odr;			/* PE10 - PE12 as the panel sees them */
+static int dr_pending = 0;
+static unsigned irqs = 0;		/* Interrupt handlers the hooks have run */
+static uint32_t reg_errors = 0;		/* EMU_ERR_* already reported */
+static EMU_CountTypeDef count, total;
+static EMU_CountTypeDef last;		/* The frame logged last */
+static unsigned checks = 0;		/* expect lines run */
+static unsigned failures = 0;
+static uint32_t driver_bytes = 0;	/* ILI9340C_get_tx_bytes at the last frame */
+static unsigned frame_count = 0;
+static uint64_t now_ns = 0;		/* Emulated time : bus bytes and delays */
+static uint64_t frame_start_ns = 0;
+static const char *png_prefix = NULL;
+
+static LCD_screen *lcd;
+static SHAPE_TypeDef shapes[COMP_MAX_LAYERS];
+static uint8_t shape_used[COMP_MAX_LAYERS];
+
+/* Demo list : a card, an icon and a text bar per row */
+static SCROLL_ListTypeDef list;
+static SCROLL_RowTypeDef rows[EMU_MAX_ROWS];
+static SHAPE_TypeDef row_shapes[EMU_MAX_ROWS][3];
+static SHAPE_InstanceTypeDef row_items[EMU_MAX_ROWS][3];
+static uint8_t list_open = 0;
+
+/* Watch runtime : once run is called, WATCH_run never returns and the
+   script goes on from its WFI */
+static uint8_t watch_open = 0;		/* WATCH_init done */
+static uint8_t watch_running = 0;	/* WATCH_run is on the stack */
+static uint8_t lptim_started = 0;
+static uint64_t lptim_start_ns;		/* LPTIM1 CNTSTRT */
+static uint32_t lptim_matches = 0;	/* Auto-reload matches delivered */
+static uint64_t wait_until = 0;		/* Script lines wait until this time */
+static uint32_t watch_frames = 0;	/* WATCH_StatsTypeDef frames already logged */
+static uint32_t shown_minute;		/* Demo face state, as main.c keeps it */
+static uint8_t seconds_on;
+static uint32_t user_updates = 0;	/* Calls of the WATCH_EVT_USER widget */
+
+static FILE *script;
+static unsigned lineno = 0;
+
+static void emu_frame(const char *label);
+static int emu_script_line(void);
+static int emu_finish(void);
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PANEL MODEL                                       *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Power-on / hardware reset defaults (ILI9340 datasheet, section 11).
+  * @param None
+  * @retval None
+  */
+static void emu_panel_reset(void)
+{
+	panel.madctl = 0x00;
+	panel.pixfmt = 0x66;
+	panel.sc = 0;
+	panel.ec = EMU_W - 1;
+	panel.sp = 0;
+	panel.ep = EMU_H - 1;
+	panel.col = panel.page = 0;
+	panel.tfa = 0;
+	panel.vsa = EMU_H;
+	panel.bfa = 0;
+	panel.vsp = 0;
+	panel.scrolling = 0;
+	panel.sleeping = 1;
+	panel.disp_on = 0;
+	panel.inverted = 0;
+	panel.brightness = 0;
+	panel.te_on = 0;
+	panel.tear_line = 0;
+	panel.diva = 0;
+	panel.rtna = 0x1B;
+	panel.cmd = ILI9340C_NOP;
+	panel.nparams = 0;
+	panel.npix = 0;
+}
+
+static uint16_t emu_param16(int i)
+{
+	return (uint16_t) ((panel.params[i] << 8) | panel.params[i + 1]);
+}
+
+static uint64_t emu_line_ns(void)
+{
+	return ((uint64_t) panel.rtna << panel.diva) * 1000000000ULL / EMU_OSC_HZ;
+}
+
+/**
+  * @brief Returns the line being refreshed at a given time (-EMU_VBP .. -1
+  *	   and EMU_H .. are porch lines).
+  * @param t : Emulated time (ns).
+  * @retval Panel line
+  */
+static int emu_scanline(uint64_t t)
+{
+	return (int) ((t / emu_line_ns()) % EMU_FRAME_LINES) - EMU_VBP;
+}
+
+/**
+  * @brief Returns the time of the first TE pulse after t.
+  * @param t : Emulated time (ns).
+  * @retval Time of the pulse (ns)
+  */
+static uint64_t emu_next_te(uint64_t t)
+{
+	uint64_t line = emu_line_ns();
+	uint64_t frame = line * EMU_FRAME_LINES;
+	uint64_t offset = (EMU_VBP + panel.tear_line) * line;
+
+	if (t < offset)
+		return offset;
+	return ((t - offset) / frame + 1) * frame + offset;
+}
+
+static int emu_te_live(void)
+{
+	return panel.te_on && !panel.sleeping && (emu_exti.IMR1 & EXTI_IMR1_IM9);
+}
+
+/**
+  * @brief Moves emulated time forward, delivering the TE interrupts that
+  *	   fall on the way. A handler may start a held stream, whose bytes move
+  *	   time on further.
+  * @param t : New time (ns).
+  * @retval None
+  */
+static void emu_advance(uint64_t t)
+{
+	uint64_t te;
+
+	while (emu_te_live() && (te = emu_next_te(now_ns)) <= t) {
+		now_ns = te;
+		count.te++;
+		irqs++;
+		emu_exti.PR1 |= EXTI_PR1_PIF9;
+		EXTI9_5_IRQHandler();
+		emu_exti.PR1 &= ~EXTI_PR1_PIF9;
+	}
+
+	if (now_ns < t)
+		now_ns = t;
+}
+
+/**
+  * @brief Stores one pixel at the write pointer and advances it through the
+  *	   window, wrapping back to its start like the controller does.
+  * @param rgb : 0xRRGGBB.
+  * @retval None
+  */
+static void emu_panel_store(uint32_t rgb)
+{
+	uint16_t c = panel.col, r = panel.page;
+
+	/* MV exchanges the axes, then MX / MY mirror GRAM columns / rows */
+	if (panel.madctl & ILI9340C_MADCTL_MV) {
+		c = panel.page;
+		r = panel.col;
+	}
+	if (panel.madctl & ILI9340C_MADCTL_MX)
+		c = (uint16_t) (EMU_W - 1 - c);
+	if (panel.madctl & ILI9340C_MADCTL_MY)
+		r = (uint16_t) (EMU_H - 1 - r);
+
+	if (c < EMU_W && r < EMU_H)
+		panel.gram[r][c] = rgb;
+	count.pixels++;
+
+	/* The scan passing the write pointer going down shows the top of the
+	   window new and the rest old in the same refresh */
+	if (panel.disp_on && !panel.sleeping) {
+		int s = emu_scanline(now_ns);
+		int rel = (s < (int) r) ? -1 : 1;
+
+		if (panel.tear_rel < 0 && rel > 0 && s >= panel.tear_s && !panel.torn) {
+			panel.torn = 1;
+			count.tears++;
+		}
+		panel.tear_rel = rel;
+		panel.tear_s = s;
+	}
+
+	if (++panel.col > panel.ec) {
+		panel.col = panel.sc;
+		if (++panel.page > panel.ep)
+			panel.page = panel.sp;
+	}
+}
+
+static void emu_panel_pixel_byte(uint8_t b)
+{
+	uint32_t r, g, bl;
+	uint16_t v;
+
+	panel.pix[panel.npix++] = b;
+
+	if ((panel.pixfmt & 0x07) == 0x05) {
+		/* 16 bpp : RRRRRGGG GGGBBBBB */
+		if (panel.npix < 2)
+			return;
+		v = (uint16_t) ((panel.pix[0] << 8) | panel.pix[1]);
+		r = (v >> 11) & 0x1F;
+		g = (v >> 5) & 0x3F;
+		bl = v & 0x1F;
+		r = (r << 3) | (r >> 2);
+		g = (g << 2) | (g >> 4);
+		bl = (bl << 3) | (bl >> 2);
+	} else {
+		/* 18 bpp : one byte per channel, top 6 bits used */
+		if (panel.npix < 3)
+			return;
+		r = panel.pix[0] & 0xFC;
+		g = panel.pix[1] & 0xFC;
+		bl = panel.pix[2] & 0xFC;
+	}
+
+	panel.npix = 0;
+	emu_panel_store((r << 16) | (g << 8) | bl);
+}
+
+static void emu_panel_cmd(uint8_t cmd)
+{
+	count.commands++;
+	panel.cmd = cmd;
+	panel.nparams = 0;
+	panel.npix = 0;
+
+	switch (cmd) {
+	case ILI9340C_SWRST:
+		emu_panel_reset();
+		break;
+	case ILI9340C_SLEEP:
+		panel.sleeping = 1;
+		break;
+	case ILI9340C_WAKEUP:
+		panel.sleeping = 0;
+		break;
+	case ILI9340C_PMOD_ON:
+	case ILI9340C_NMOD_ON:
+		panel.scrolling = 0;
+		break;
+	case ILI9340C_INV_OFF:
+		panel.inverted = 0;
+		break;
+	case ILI9340C_INV_ON:
+		panel.inverted = 1;
+		break;
+	case ILI9340C_DISP_OFF:
+		panel.disp_on = 0;
+		break;
+	case ILI9340C_DISP_ON:
+		panel.disp_on = 1;
+		break;
+	case ILI9340C_RAMWRITE:
+		panel.col = panel.sc;
+		panel.page = panel.sp;
+		panel.tear_rel = 0;
+		panel.torn = 0;
+		count.windows++;
+		break;
+	case ILI9340C_TEAR_OFF:
+		panel.te_on = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+  * @brief Applies a command once its last parameter has arrived.
+  * @param None
+  * @retval None
+  */
+static void emu_panel_param(void)
+{
+	switch (panel.cmd) {
+	case ILI9340C_SET_CADDR:
+		if (panel.nparams == 4) {
+			panel.sc = emu_param16(0);
+			panel.ec = emu_param16(2);
+		}
+		break;
+	case ILI9340C_SET_PADDR:
+		if (panel.nparams == 4) {
+			panel.sp = emu_param16(0);
+			panel.ep = emu_param16(2);
+		}
+		break;
+	case ILI9340C_SET_MADCTL:
+		if (panel.nparams == 1)
+			panel.madctl = panel.params[0];
+		break;
+	case ILI9340C_SET_PIXFMT:
+		if (panel.nparams == 1)
+			panel.pixfmt = panel.params[0];
+		break;
+	case ILI9340C_SET_VSAREA:
+		if (panel.nparams == 6) {
+			panel.tfa = emu_param16(0);
+			panel.vsa = emu_param16(2);
+			panel.bfa = emu_param16(4);
+			if (panel.tfa + panel.vsa + panel.bfa != EMU_H)
+				fprintf(stderr, "tft_emu: VSAREA %u + %u + %u != %u lines\n",
+					panel.tfa, panel.vsa, panel.bfa, EMU_H);
+		}
+		break;
+	case ILI9340C_SET_VSSADDR:
+		if (panel.nparams == 2) {
+			panel.vsp = emu_param16(0);
+			panel.scrolling = 1;
+		}
+		break;
+	case ILI9340C_TEAR_ON:
+		if (panel.nparams == 1)
+			panel.te_on = 1;
+		break;
+	case ILI9340C_SET_TEARLN:
+		if (panel.nparams == 2)
+			panel.tear_line = emu_param16(0);
+		break;
+	case ILI9340C_SET_FRMRTN:
+		if (panel.nparams == 2) {
+			panel.diva = panel.params[0] & 0x03;
+			panel.rtna = panel.params[1] & 0x1F;
+			if (panel.rtna < 0x10)
+				panel.rtna = 0x10;
+		}
+		break;
+	case ILI9340C_SET_BRTNSS:
+		if (panel.nparams == 1)
+			panel.brightness = panel.params[0];
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+  * @brief Feeds one byte clocked into the controller.
+  * @param dc : D/C level (0 = command).
+  * @param b : The byte.
+  * @retval None
+  */
+static void emu_panel_byte(uint8_t dc, uint8_t b)
+{
+	if (!dc) {
+		emu_panel_cmd(b);
+		return;
+	}
+
+	if (panel.cmd == ILI9340C_RAMWRITE || panel.cmd == ILI9340C_CONT_MEMWR) {
+		emu_panel_pixel_byte(b);
+		return;
+	}
+
+	if (panel.nparams < EMU_MAX_PARAMS) {
+		panel.params[panel.nparams++] = b;
+		emu_panel_param();
+	}
+}
+
+/**
+  * @brief Returns what the glass shows at a screen position. The module's
+  *	   source driver scans GRAM columns right to left, which is why the
+  *	   firmware sets MX for an upright image.
+  * @param x : Screen column.
+  * @param y : Screen row.
+  * @retval 0xRRGGBB
+  */
+static uint32_t emu_panel_scanout(int x, int y)
+{
+	uint32_t c;
+	int row = y;
+
+	if (panel.sleeping || !panel.disp_on)
+		return EMU_BLANK;
+
+	if (panel.scrolling && panel.vsa > 0 && y >= panel.tfa && y < panel.tfa + panel.vsa)
+		row = panel.tfa + ((y - panel.tfa) + (panel.vsp - panel.tfa) + panel.vsa) % panel.vsa;
+	if (row < 0 || row >= EMU_H)
+		return EMU_BLANK;
+
+	c = panel.gram[row][EMU_W - 1 - x];
+
+	/* The glass is BGR : without the BGR bit red and blue trade places */
+	if (!(panel.madctl & ILI9340C_MADCTL_BGR))
+		c = ((c & 0xFF) << 16) | (c & 0x00FF00) | ((c >> 16) & 0xFF);
+	if (panel.inverted)
+		c ^= 0xFFFFFF;
+
+	return c;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              BUS DECODING                                      *
+ *                                                                                *
+\**********************************************************************************/
+
+static uint32_t emu_sck_freq(void)
+{
+	return EMU_PCLK_FREQ >> (((emu_spi1.CR1 & SPI_CR1_BR) >> 3) + 1);
+}
+
+static void emu_reg_error(uint32_t err, const char *msg)
+{
+	if (reg_errors & err)
+		return;
+	reg_errors |= err;
+	fprintf(stderr, "tft_emu: register check: %s\n", msg);
+}
+
+/**
+  * @brief Checks SPI1 is set up the way the panel needs it whenever a frame
+  *	   goes out : clocked, enabled master with software NSS, mode 0, MSB
+  *	   first, and SCK within EMU_SCK_LIMIT.
+  * @param None
+  * @retval None
+  */
+static void emu_check_spi(void)
+{
+	uint32_t cr1 = emu_spi1.CR1;
+	uint32_t need = SPI_CR1_SPE | SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI;
+
+	if (!(emu_rcc.APB2ENR & RCC_APB2ENR_SPI1EN))
+		emu_reg_error(EMU_ERR_SPI_CLOCK, "SPI1 used without RCC_APB2ENR_SPI1EN");
+	if ((cr1 & need) != need)
+		emu_reg_error(EMU_ERR_SPI_MASTER, "SPI1 not an enabled master with SSM/SSI");
+	if (cr1 & (SPI_CR1_CPOL | SPI_CR1_CPHA | SPI_CR1_LSBFIRST | SPI_CR1_RXONLY))
+		emu_reg_error(EMU_ERR_SPI_MODE, "SPI1 not in mode 0, MSB first, full duplex");
+	if (emu_sck_freq() > EMU_SCK_LIMIT)
+		emu_reg_error(EMU_ERR_SPI_SCK, "SPI1 SCK above the ILI9340C write cycle limit (tSCYCW)");
+}
+
+/**
+  * @brief Checks DMA1 channel 3 before it runs : clocked, mapped on SPI1_TX,
+  *	   memory to SPI1->DR, and moving items as wide as SPI1's frames.
+  * @param None
+  * @retval None
+  */
+static void emu_check_dma(void)
+{
+	uint32_t ccr = emu_dma1_ch3.CCR;
+	int wide = ((emu_spi1.CR2 & SPI_CR2_DS) >> 8) >= 8;
+
+	if (!(emu_rcc.AHB1ENR & RCC_AHB1ENR_DMA1EN))
+		emu_reg_error(EMU_ERR_DMA_CLOCK, "DMA1 used without RCC_AHB1ENR_DMA1EN");
+	if (((emu_dma1_cselr.CSELR >> 8) & 0xF) != 1)
+		emu_reg_error(EMU_ERR_DMA_REQ, "DMA1 channel 3 not mapped on SPI1_TX (C3S)");
+	if (!(ccr & DMA_CCR_DIR) || (ccr & DMA_CCR_PINC) ||
+	    emu_dma1_ch3.CPAR != (uint32_t) (uintptr_t) &emu_spi1.DR)
+		emu_reg_error(EMU_ERR_DMA_PATH, "DMA1 channel 3 not memory to SPI1->DR");
+	if (((ccr & DMA_CCR_PSIZE) == DMA_CCR_PSIZE_0) != wide ||
+	    ((ccr & DMA_CCR_MSIZE) == DMA_CCR_MSIZE_0) != wide)
+		emu_reg_error(EMU_ERR_DMA_SIZE, "DMA1 channel 3 item size does not match SPI1 DS");
+}
+
+static void emu_bus_byte(uint8_t b)
+{
+	emu_advance(now_ns + 8000000000ULL / emu_sck_freq());
+
+	if ((odr & EMU_CS) || !(odr & EMU_RST)) {
+		count.stray++;
+		return;
+	}
+
+	count.bytes++;
+	emu_panel_byte((odr & EMU_DC) != 0, b);
+}
+
+/**
+  * @brief Sends one access to SPI1->DR out on the bus. A 16-bit access with
+  *	   frames of 8 bits or fewer packs two frames, low byte first.
+  * @param data : Value written to DR.
+  * @param access16 : Non-zero for a half-word access.
+  * @retval None
+  */
+static void emu_bus_frame(uint16_t data, int access16)
+{
+	uint32_t bits = ((emu_spi1.CR2 & SPI_CR2_DS) >> 8) + 1;
+
+	emu_check_spi();
+
+	if (bits > 8) {
+		emu_bus_byte((uint8_t) (data >> 8));
+		emu_bus_byte((uint8_t) data);
+	} else {
+		emu_bus_byte((uint8_t) data);
+		if (access16)
+			emu_bus_byte((uint8_t) (data >> 8));
+	}
+}
+
+static void emu_gpio_update(uint32_t bsrr)
+{
+	uint32_t old = odr;
+
+	odr = (odr & ~(bsrr >> 16)) | (bsrr & 0xFFFF);
+
+	if (!(old & EMU_CS) && (odr & EMU_CS))
+		count.transactions++;
+	if ((old & EMU_RST) && !(odr & EMU_RST))
+		emu_panel_reset();
+
+	emu_gpioe.ODR = odr;
+}
+
+/**
+  * @brief Runs an SPI1 TX transfer once channel 3 is enabled with items left
+  *	   and SPI1 requests DMA, then takes the completion interrupt. The
+  *	   handler may queue the next chunk, which the next hook runs.
+  * @param None
+  * @retval None
+  */
+static void emu_dma_run(void)
+{
+	const uint16_t *src;
+	uint32_t i, n = emu_dma1_ch3.CNDTR;
+	int minc;
+
+	/* DMA_CCR_EN is a hook here : bit 0 */
+	if (n == 0 || !(emu_dma1_ch3.CCR & 0x1) || !(emu_spi1.CR2 & SPI_CR2_TXDMAEN))
+		return;
+
+	emu_check_dma();
+
+	src = (const uint16_t *) (uintptr_t) emu_dma1_ch3.CMAR;
+	minc = (emu_dma1_ch3.CCR & DMA_CCR_MINC) != 0;
+	emu_dma1_ch3.CNDTR = 0;
+
+	for (i = 0; i < n; i++)
+		emu_bus_frame(src[minc ? i : 0], 1);
+
+	emu_dma1.ISR |= DMA_ISR_TCIF3;
+	if (emu_dma1_ch3.CCR & DMA_CCR_TCIE) {
+		irqs++;
+		DMA1_Channel3_IRQHandler();
+	}
+	emu_dma1.ISR &= ~DMA_ISR_TCIF3;
+}
+
+/**
+  * @brief Decodes whatever the firmware stored in DR and BSRR since the
+  *	   previous hook.
+  * @param None
+  * @retval None
+  */
+static void emu_sync(void)
+{
+	if (dr_pending) {
+		dr_pending = 0;
+		emu_bus_frame((uint16_t) (emu_spi1.DR & 0xFF), 0);
+	}
+
+	if (emu_gpioe.BSRR != 0) {
+		emu_gpio_update(emu_gpioe.BSRR);
+		emu_gpioe.BSRR = 0;
+	}
+
+	emu_dma_run();
+}
+
+GPIO_TypeDef *tft_emu_gpioe(void)
+{
+	emu_sync();
+	return &emu_gpioe;
+}
+
+SPI_TypeDef *tft_emu_spi1(void)
+{
+	emu_sync();
+	return &emu_spi1;
+}
+
+uint32_t tft_emu_spi_txe(void)
+{
+	emu_sync();
+	dr_pending = 1;
+	return 0x00000002;
+}
+
+uint32_t tft_emu_spi_idle(void)
+{
+	emu_sync();
+	return 0;
+}
+
+uint32_t tft_emu_dma_en(void)
+{
+	emu_sync();
+	return 0x00000001;
+}
+
+/**
+  * @brief WFI under WATCH_run. A stream held for TE waits for the pulse.
+  *	   With the bus idle, a frame the runtime committed is logged and the
+  *	   script goes on until a line raises an interrupt or lets time pass;
+  *	   time then moves to the next LPTIM1 match and its handler runs.
+  * @param None
+  * @retval None
+  */
+static void emu_watch_wfi(void)
+{
+	WATCH_StatsTypeDef ws;
+	unsigned before = irqs;
+	uint64_t next;
+	uint8_t busy = LCD_busy(lcd);
+
+	if (irqs != before)
+		return;
+	if (busy) {
+		if (!emu_te_live()) {
+			fprintf(stderr, "tft_emu: WFI with the LCD busy and no TE to wait for\n");
+			exit(1);
+		}
+		emu_advance(emu_next_te(now_ns));
+		return;
+	}
+
+	WATCH_get_stats(&ws);
+	if (ws.frames != watch_frames) {
+		watch_frames = ws.frames;
+		emu_frame("watch");
+	}
+
+	for (;;) {
+		next = lptim_start_ns + (uint64_t) (lptim_matches + 1) * EMU_SECOND_NS;
+		if (next <= now_ns || next <= wait_until)
+			break;
+		if (now_ns < wait_until) {
+			emu_advance(wait_until);
+			continue;
+		}
+		if (!emu_script_line())
+			exit(emu_finish());
+		if (irqs != before)
+			return;
+	}
+
+	emu_advance(next);
+	irqs++;
+	LPTIM1_IRQHandler();
+	lptim_matches++;
+}
+
+void tft_emu_wfi(void)
+{
+	unsigned before = irqs;
+
+	/* A transfer started before the WFI may have finished by now */
+	emu_sync();
+	if (irqs != before)
+		return;
+
+	if (watch_running) {
+		emu_watch_wfi();
+		return;
+	}
+
+	if (!emu_te_live()) {
+		fprintf(stderr, "tft_emu: WFI with no interrupt that could end it\n");
+		exit(1);
+	}
+	emu_advance(emu_next_te(now_ns));
+}
+
+LPTIM_TypeDef *tft_emu_lptim1(void)
+{
+	uint64_t ticks;
+
+	if (!lptim_started && (emu_lptim1.CR & LPTIM_CR_CNTSTRT)) {
+		lptim_started = 1;
+		lptim_start_ns = now_ns;
+	}
+
+	/* ARR writes land at once; flag clears are applied by the match count */
+	emu_lptim1.ISR |= LPTIM_ISR_ARROK;
+	emu_lptim1.ICR = 0;
+
+	if (lptim_started) {
+		ticks = (now_ns - lptim_start_ns) * WATCH_TICKS_PER_SEC / EMU_SECOND_NS;
+		emu_lptim1.CNT = (uint32_t) (ticks % WATCH_TICKS_PER_SEC);
+		if (ticks / WATCH_TICKS_PER_SEC > lptim_matches)
+			emu_lptim1.ISR |= LPTIM_ISR_ARRM;
+		else
+			emu_lptim1.ISR &= ~LPTIM_ISR_ARRM;
+	}
+
+	return &emu_lptim1;
+}
+
+DWT_Type *tft_emu_dwt(void)
+{
+	emu_dwt.CYCCNT = (uint32_t) (now_ns * (EMU_PCLK_FREQ / 1000000U) / 1000U);
+	return &emu_dwt;
+}
+
+/* sysclk_init after Stop 2 : the emulated clock tree never leaves the PLL */
+static void emu_clock_restore(void)
+{
+}
+
+/* Stands in for delay.c : nothing ticks SysTick on the host */
+void delay(uint32_t time_ms)
+{
+	count.delay_ms += time_ms;
+	emu_advance(now_ns + (uint64_t) time_ms * 1000000ULL);
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              PNG OUTPUT                                        *
+ *                                                                                *
+\**********************************************************************************/
+
+static void emu_crc_table(uint32_t *table)
+{
+	uint32_t c;
+	int n, k;
+
+	for (n = 0; n < 256; n++) {
+		c = (uint32_t) n;
+		for (k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+}
+
+static void emu_put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t) (v >> 24);
+	p[1] = (uint8_t) (v >> 16);
+	p[2] = (uint8_t) (v >> 8);
+	p[3] = (uint8_t) v;
+}
+
+static void emu_png_chunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+{
+	static uint32_t table[256];
+	uint32_t crc = 0xFFFFFFFFU;
+	uint8_t be[4];
+	uint32_t i;
+
+	if (table[1] == 0)
+		emu_crc_table(table);
+
+	emu_put32(be, len);
+	fwrite(be, 1, 4, f);
+	fwrite(type, 1, 4, f);
+	fwrite(data, 1, len, f);
+
+	for (i = 0; i < 4; i++)
+		crc = table[(crc ^ (uint8_t) type[i]) & 0xFF] ^ (crc >> 8);
+	for (i = 0; i < len; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	emu_put32(be, crc ^ 0xFFFFFFFFU);
+	fwrite(be, 1, 4, f);
+}
+
+/**
+  * @brief Writes what the glass shows as an 8-bit RGB PNG using stored
+  *	   (uncompressed) deflate blocks, so no zlib is needed.
+  * @param path : Output file.
+  * @retval 0 on success, -1 if the file could not be written
+  */
+static int emu_write_png(const char *path)
+{
+	static const uint8_t sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	const size_t stride = 3 * EMU_W + 1;
+	size_t raw_len = stride * EMU_H;
+	size_t nblocks = (raw_len + 65534) / 65535;
+	size_t zlen = 2 + raw_len + 5 * nblocks + 4;
+	uint8_t *raw, *z, *zp;
+	uint8_t ihdr[13];
+	uint32_t a = 1, b = 0;
+	size_t i, done;
+	FILE *f;
+	int x, y;
+
+	raw = malloc(raw_len);
+	z = malloc(zlen);
+	if (raw == NULL || z == NULL) {
+		free(raw);
+		free(z);
+		return -1;
+	}
+
+	/* Filter type 0 on every row */
+	for (y = 0; y < EMU_H; y++) {
+		uint8_t *p = &raw[(size_t) y * stride];
+
+		*p++ = 0;
+		for (x = 0; x < EMU_W; x++) {
+			uint32_t c = emu_panel_scanout(x, y);
+
+			*p++ = (uint8_t) (c >> 16);
+			*p++ = (uint8_t) (c >> 8);
+			*p++ = (uint8_t) c;
+		}
+	}
+
+	zp = z;
+	*zp++ = 0x78;
+	*zp++ = 0x01;
+	for (done = 0; done < raw_len; ) {
+		size_t n = raw_len - done > 65535 ? 65535 : raw_len - done;
+
+		*zp++ = (done + n == raw_len);  /* BFINAL, BTYPE = stored */
+		*zp++ = (uint8_t) n;
+		*zp++ = (uint8_t) (n >> 8);
+		*zp++ = (uint8_t) ~n;
+		*zp++ = (uint8_t) (~n >> 8);
+		memcpy(zp, &raw[done], n);
+		zp += n;
+		done += n;
+	}
+	for (i = 0; i < raw_len; i++) {
+		a = (a + raw[i]) % 65521U;
+		b = (b + a) % 65521U;
+	}
+	emu_put32(zp, (b << 16) | a);
+
+	emu_put32(&ihdr[0], (uint32_t) EMU_W);
+	emu_put32(&ihdr[4], (uint32_t) EMU_H);
+	ihdr[8] = 8;	/* Bit depth */
+	ihdr[9] = 2;	/* RGB */
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+	f = fopen(path, "wb");
+	if (f != NULL) {
+		fwrite(sig, 1, sizeof(sig), f);
+		emu_png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+		emu_png_chunk(f, "IDAT", z, (uint32_t) zlen);
+		emu_png_chunk(f, "IEND", NULL, 0);
+		fclose(f);
+	}
+
+	free(raw);
+	free(z);
+	return f != NULL ? 0 : -1;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              FRAME CAPTURE                                     *
+ *                                                                                *
+\**********************************************************************************/
+
+/**
+  * @brief Logs the traffic since the previous frame and writes the PNG.
+  * @param label : What produced the frame.
+  * @retval None
+  */
+static void emu_frame(const char *label)
+{
+	uint32_t sck = emu_sck_freq();
+	uint32_t drv = ILI9340C_get_tx_bytes();
+	char path[512];
+
+	emu_sync();
+
+	printf("frame %u (%s): %u bytes, %u transactions, %u cmds, %u windows, %u pixels, %.2f ms @ %.1f MHz",
+	       frame_count, label, count.bytes, count.transactions, count.commands, count.windows,
+	       count.pixels, count.bytes * 8000.0 / sck, sck / 1e6);
+	printf(", %.2f ms elapsed", (now_ns - frame_start_ns) / 1e6);
+	if (count.te != 0)
+		printf(", %u TE", count.te);
+	if (count.tears != 0)
+		printf(", %u TORN", count.tears);
+	if (count.delay_ms != 0)
+		printf(", %u ms delays", count.delay_ms);
+	if (count.stray != 0)
+		printf(", %u stray bytes", count.stray);
+	printf("\n");
+
+	/* The driver's own byte count should agree with what reached the panel */
+	if (drv - driver_bytes != count.bytes)
+		printf("  driver counted %u bytes\n", drv - driver_bytes);
+	driver_bytes = drv;
+
+	if (png_prefix != NULL) {
+		snprintf(path, sizeof(path), "%s%04u.png", png_prefix, frame_count);
+		if (emu_write_png(path) != 0)
+			fprintf(stderr, "tft_emu: cannot write %s\n", path);
+	}
+
+	total.bytes += count.bytes;
+	total.transactions += count.transactions;
+	total.pixels += count.pixels;
+	total.tears += count.tears;
+	last = count;
+	memset(&count, 0, sizeof(count));
+	frame_start_ns = now_ns;
+	frame_count++;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                              SCRIPT                                            *
+ *                                                                                *
+\**********************************************************************************/
+
+static int emu_tokens(char *s, char **tok)
+{
+	int n = 0;
+
+	for (s = strtok(s, " \t"); s != NULL && n < EMU_MAX_TOKENS; s = strtok(NULL, " \t"))
+		tok[n++] = s;
+
+	return n;
+}
+
+/**
+  * @brief Adds a shape as a new compositor layer. The compositor hands out
+  *	   the lowest free id, so shapes[id] mirrors its layer table.
+  * @param s : Shape to copy into the layer's slot.
+  * @param x : Horizontal location of shape's center.
+  * @param y : Vertical location of shape's center.
+  * @retval Layer id, or -1 if the scene is full
+  */
+static int emu_add(const SHAPE_TypeDef *s, int x, int y)
+{
+	int id;
+
+	for (id = 0; id < COMP_MAX_LAYERS && shape_used[id]; id++);
+	if (id == COMP_MAX_LAYERS)
+		return -1;
+
+	shapes[id] = *s;
+	if (COMP_add(&shapes[id], x, y) != id)
+		return -1;
+	shape_used[id] = 1;
+	printf("layer %d\n", id);
+
+	return id;
+}
+
+static int emu_layer(const char *s)
+{
+	int id = atoi(s);
+
+	return (id >= 0 && id < COMP_MAX_LAYERS && shape_used[id]) ? id : -1;
+}
+
+/**
+  * @brief Opens the demo scrolling list : nrows notification cards.
+  * @param top : First panel line of the list.
+  * @param height : Lines of the list on screen.
+  * @param nrows : Number of rows (<= EMU_MAX_ROWS).
+  * @param row_h : Row height.
+  * @retval None
+  */
+static void emu_list(int top, int height, int nrows, int row_h)
+{
+	static const uint32_t card[4] = {0x203040, 0x302040, 0x204030, 0x404020};
+	int r;
+
+	for (r = 0; r < nrows; r++) {
+		SHAPE_TypeDef *s = row_shapes[r];
+		SHAPE_InstanceTypeDef *it = row_items[r];
+
+		memset(s, 0, 3 * sizeof(*s));
+		s[0].type = SHAPE_ROUNDED_RECT;
+		s[0].width = ILI9340C_WIDTH - 8;
+		s[0].height = row_h - 4;
+		s[0].radius = 6;
+		s[0].color = card[r % 4];
+		s[0].flags = SHAPE_FLAG_AA;
+		s[1].type = SHAPE_CIRCLE;
+		s[1].radius = row_h / 2 - 8;
+		s[1].color = 0x40A0FF;
+		s[1].flags = SHAPE_FLAG_AA;
+		s[2].type = SHAPE_FILLED_RECT;
+		s[2].width = 40 + (r * 37) % 120;
+		s[2].height = 6;
+		s[2].color = 0xE0E0E0;
+
+		it[0] = (SHAPE_InstanceTypeDef) {&s[0], ILI9340C_WIDTH / 2, row_h / 2};
+		it[1] = (SHAPE_InstanceTypeDef) {&s[1], row_h / 2, row_h / 2};
+		it[2] = (SHAPE_InstanceTypeDef) {&s[2], row_h + 4 + s[2].width / 2, row_h / 2};
+
+		rows[r].items = it;
+		rows[r].n = 3;
+	}
+
+	SCROLL_init(&list, lcd, (uint16_t) top, (uint16_t) height, rows, (uint16_t) nrows, (uint16_t) row_h);
+	list_open = 1;
+}
+
+/**
+  * @brief Demo face hour and minute hands (layers 1 and 2), as main.c.
+  * @param w : Widget.
+  * @param events : Pending events.
+  * @retval 1 if the hands moved
+  */
+static uint8_t emu_hands_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	uint32_t minute = WATCH_time_of_day() / 60;
+
+	(void) w;
+	(void) events;
+
+	if (minute == shown_minute)
+		return 0;
+	shown_minute = minute;
+
+	SHAPE_line_polar(&shapes[1], (int) ((minute % 720) / 2), 50);
+	SHAPE_line_polar(&shapes[2], (int) ((minute % 60) * 6), 80);
+	COMP_invalidate(1);
+	COMP_invalidate(2);
+	return 1;
+}
+
+/**
+  * @brief Demo face second hand (layer 3), as main.c : the button shows or
+  *	   hides it.
+  * @param w : Widget.
+  * @param events : Pending events.
+  * @retval 1 if the screen changed
+  */
+static uint8_t emu_seconds_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	(void) w;
+
+	if (events & WATCH_EVT_BUTTON) {
+		seconds_on = !seconds_on;
+		COMP_set_visible(3, seconds_on);
+		if (!seconds_on)
+			return 1;
+	}
+
+	if (!seconds_on)
+		return 0;
+
+	SHAPE_line_polar(&shapes[3], (int) ((WATCH_time_of_day() % 60) * 6), 90);
+	COMP_invalidate(3);
+	return 1;
+}
+
+/* Listens for WATCH_EVT_USER only and never changes the screen */
+static uint8_t emu_user_update(WATCH_WidgetTypeDef *w, uint32_t events)
+{
+	(void) w;
+	(void) events;
+
+	user_updates++;
+	return 0;
+}
+
+static WATCH_WidgetTypeDef emu_widgets[3] = {
+	{WATCH_EVT_TICK, emu_hands_update, NULL},
+	{WATCH_EVT_TICK | WATCH_EVT_BUTTON, emu_seconds_update, NULL},
+	{WATCH_EVT_USER, emu_user_update, NULL}
+};
+
+/**
+  * @brief Starts the watch runtime over the demo face (layers 1 - 3 are
+  *	   the hour, minute and second hands) and logs its first frame, as
+  *	   main.c draws it.
+  * @param start_s : Time of day (s).
+  * @retval 0, or -1 if layers 1 - 3 are not lines
+  */
+static int emu_watch(uint32_t start_s)
+{
+	int id;
+
+	for (id = 1; id <= 3; id++) {
+		if (!shape_used[id] || shapes[id].type != SHAPE_LINE)
+			return -1;
+	}
+
+	WATCH_init(lcd, EMU_PCLK_FREQ, emu_clock_restore, start_s);
+	for (id = 0; id < 3; id++)
+		WATCH_add(&emu_widgets[id]);
+	watch_open = 1;
+	shown_minute = 0xFFFFFFFF;
+	seconds_on = 1;
+
+	emu_hands_update(&emu_widgets[0], WATCH_EVT_TICK);
+	emu_seconds_update(&emu_widgets[1], WATCH_EVT_TICK);
+	COMP_commit();
+	while (LCD_busy(lcd) && emu_te_live()) {
+		emu_advance(emu_next_te(now_ns));
+		emu_sync();
+	}
+	emu_frame("watch");
+	return 0;
+}
+
+/**
+  * @brief Compares a count of the frame logged last with what the script
+  *	   expects.
+  *	   expects, or one of the watch runtime's counters.
+  * @param what : bytes, transactions, cmds, windows, pixels or torn; or
+  *	   wakeups, stops, events, frames, duty_ppm, render_us, render_bytes
+  *	   or updates (calls of the WATCH_EVT_USER widget).
+  * @param value : Expected count.
+  * @retval 0, or -1 if what is not a count
+  */
+static int emu_expect(const char *what, uint32_t value)
+{
+	static WATCH_StatsTypeDef ws;
+	static const struct { const char *name; const uint32_t *count; uint8_t watch; } fields[] = {
+		{"bytes", &last.bytes, 0}, {"transactions", &last.transactions, 0},
+		{"cmds", &last.commands, 0}, {"windows", &last.windows, 0},
+		{"pixels", &last.pixels, 0}, {"torn", &last.tears, 0},
+		{"wakeups", &ws.wakeups, 1}, {"stops", &ws.stops, 1},
+		{"events", &ws.events, 1}, {"frames", &ws.frames, 1},
+		{"duty_ppm", &ws.duty_ppm, 1}, {"render_us", &ws.last_render_us, 1},
+		{"render_bytes", &ws.last_render_bytes, 1}, {"updates", &user_updates, 1}
+	};
+	unsigned i;
+
+	for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if (strcmp(what, fields[i].name) != 0)
+			continue;
+		if (fields[i].watch) {
+			if (!watch_open)
+				return -1;
+			WATCH_get_stats(&ws);
+		}
+		checks++;
+		if (*fields[i].count != value) {
+			if (fields[i].watch)
+				printf("  expected %u %s, got %u\n", value, what, *fields[i].count);
+			else
+				printf("  expected %u %s in frame %u, got %u\n",
+				       value, what, frame_count - 1, *fields[i].count);
+			failures++;
+		}
+		return 0;
+	}
+
+	return -1;
+}
+
+/**
+  * @brief Runs one script line.
+  * @param line : The line (modified).
+  * @retval 0, or -1 if the line is not understood
+  */
+static int emu_command(char *line)
+{
+	char *t[EMU_MAX_TOKENS];
+	SHAPE_TypeDef s;
+	int n = emu_tokens(line, t);
+	int i, id;
+
+	if (n == 0)
+		return 0;
+
+	memset(&s, 0, sizeof(s));
+	if (strcmp(t[n - 1], "aa") == 0) {
+		s.flags = SHAPE_FLAG_AA;
+		n--;
+	}
+
+#define ARG(i)	((int) strtol(t[i], NULL, 0))
+#define RGB(i)	((uint32_t) strtoul(t[i], NULL, 16))
+
+	if (strcmp(t[0], "bg") == 0 && n == 2) {
+		COMP_set_background(RGB(1));
+	} else if (strcmp(t[0], "fill") == 0 && n == 6) {
+		s.type = SHAPE_FILLED_RECT;
+		s.width = ARG(1);
+		s.height = ARG(2);
+		s.color = RGB(5);
+		return emu_add(&s, ARG(3), ARG(4)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "rect") == 0 && n == 7) {
+		s.type = SHAPE_RECT;
+		s.width = ARG(1);
+		s.height = ARG(2);
+		s.stroke = ARG(3);
+		s.color = RGB(6);
+		return emu_add(&s, ARG(4), ARG(5)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "round") == 0 && n == 8) {
+		s.type = SHAPE_ROUNDED_RECT;
+		s.width = ARG(1);
+		s.height = ARG(2);
+		s.radius = ARG(3);
+		s.stroke = ARG(4);
+		s.color = RGB(7);
+		return emu_add(&s, ARG(5), ARG(6)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "circle") == 0 && n == 6) {
+		s.type = SHAPE_CIRCLE;
+		s.radius = ARG(1);
+		s.stroke = ARG(2);
+		s.color = RGB(5);
+		return emu_add(&s, ARG(3), ARG(4)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "arc") == 0 && n == 8) {
+		s.type = SHAPE_ARC;
+		s.radius = ARG(1);
+		s.stroke = ARG(2);
+		s.start = ARG(3);
+		s.end = ARG(4);
+		s.color = RGB(7);
+		return emu_add(&s, ARG(5), ARG(6)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "line") == 0 && n == 9) {
+		s.type = SHAPE_LINE;
+		s.x0 = ARG(1);
+		s.y0 = ARG(2);
+		s.x1 = ARG(3);
+		s.y1 = ARG(4);
+		s.stroke = ARG(5);
+		s.color = RGB(8);
+		return emu_add(&s, ARG(6), ARG(7)) < 0 ? -1 : 0;
+	} else if (strcmp(t[0], "move") == 0 && n == 4 && (id = emu_layer(t[1])) >= 0) {
+		COMP_move(id, ARG(2), ARG(3));
+	} else if (strcmp(t[0], "show") == 0 && n == 2 && (id = emu_layer(t[1])) >= 0) {
+		COMP_set_visible(id, 1);
+	} else if (strcmp(t[0], "hide") == 0 && n == 2 && (id = emu_layer(t[1])) >= 0) {
+		COMP_set_visible(id, 0);
+	} else if (strcmp(t[0], "remove") == 0 && n == 2 && (id = emu_layer(t[1])) >= 0) {
+		COMP_remove(id);
+		shape_used[id] = 0;
+	} else if (strcmp(t[0], "color") == 0 && n == 3 && (id = emu_layer(t[1])) >= 0) {
+		shapes[id].color = RGB(2);
+		COMP_invalidate(id);
+	} else if (strcmp(t[0], "polar") == 0 && n == 4 && (id = emu_layer(t[1])) >= 0
+		   && shapes[id].type == SHAPE_LINE) {
+		SHAPE_line_polar(&shapes[id], ARG(2), ARG(3));
+		COMP_invalidate(id);
+	} else if (strcmp(t[0], "expect") == 0 && n == 3 && frame_count > 0) {
+		return emu_expect(t[1], (uint32_t) ARG(2));
+	} else if (strcmp(t[0], "commit") == 0 && n == 1) {
+		COMP_commit();
+		/* A TE-paced window is held for the pulse : log it once it is out
+		   (the DMA the pulse starts only runs on a hook, hence the sync) */
+		while (LCD_busy(lcd) && emu_te_live()) {
+			emu_advance(emu_next_te(now_ns));
+			emu_sync();
+		}
+		emu_frame("commit");
+	} else if (strcmp(t[0], "frame") == 0 && n == 1) {
+		emu_frame("frame");
+	} else if (strcmp(t[0], "on") == 0 && n == 1) {
+		LCD_turn_on(lcd);
+	} else if (strcmp(t[0], "off") == 0 && n == 1) {
+		LCD_turn_off(lcd);
+	} else if (strcmp(t[0], "brightness") == 0 && n == 2) {
+		LCD_set_brightness(lcd, (uint8_t) ARG(1));
+	} else if (strcmp(t[0], "list") == 0 && n == 5 && ARG(3) > 0 && ARG(3) <= EMU_MAX_ROWS
+		   && ARG(4) > 16 && ARG(2) > 0 && ARG(1) >= 0 && ARG(1) + ARG(2) <= EMU_H) {
+		emu_list(ARG(1), ARG(2), ARG(3), ARG(4));
+		emu_frame("list");
+	} else if (strcmp(t[0], "scroll") == 0 && n == 2 && list_open) {
+		SCROLL_StatsTypeDef st;
+
+		SCROLL_by(&list, ARG(1));
+		SCROLL_get_stats(&list, &st);
+		printf("scroll to %d : %u lines, %u bytes so far\n", (int) list.pos, st.lines, st.bytes);
+		emu_frame("scroll");
+	} else if (strcmp(t[0], "unlist") == 0 && n == 1 && list_open) {
+		SCROLL_close(&list);
+		list_open = 0;
+	} else if (strcmp(t[0], "vsync") == 0 && n == 2) {
+		printf("vsync %s\n", LCD_set_vsync(lcd, strcmp(t[1], "on") == 0) ? "on" : "off");
+	} else if (strcmp(t[0], "idle") == 0 && n == 2) {
+		emu_advance(now_ns + (uint64_t) ARG(1) * 1000ULL);
+	} else if (strcmp(t[0], "watch") == 0 && n == 2 && !watch_open) {
+		return emu_watch((uint32_t) ARG(1));
+	} else if (strcmp(t[0], "run") == 0 && n == 1 && watch_open && !watch_running) {
+		watch_running = 1;
+		wait_until = now_ns;
+		WATCH_run();
+	} else if (strcmp(t[0], "tick") == 0 && n == 2 && watch_running && ARG(1) > 0) {
+		wait_until = lptim_start_ns + (uint64_t) (lptim_matches + ARG(1)) * EMU_SECOND_NS;
+	} else if (strcmp(t[0], "press") == 0 && n == 1 && watch_open) {
+		irqs++;
+		emu_exti.PR1 |= EXTI_PR1_PIF0;
+		EXTI0_IRQHandler();
+	} else if (strcmp(t[0], "post") == 0 && n == 1 && watch_open) {
+		irqs++;
+		WATCH_post(WATCH_EVT_USER);
+	} else if (strcmp(t[0], "wstats") == 0 && n == 1 && watch_open) {
+		WATCH_StatsTypeDef ws;
+
+		WATCH_get_stats(&ws);
+		printf("watch %02u:%02u:%02u : %u wakeups (%u stops), %u events, %u frames, "
+		       "duty %u ppm, last render %u us / %u bytes, max %u us\n",
+		       WATCH_time_of_day() / 3600, WATCH_time_of_day() / 60 % 60, WATCH_time_of_day() % 60,
+		       ws.wakeups, ws.stops, ws.events, ws.frames, ws.duty_ppm,
+		       ws.last_render_us, ws.last_render_bytes, ws.max_render_us);
+	} else if (strcmp(t[0], "wreset") == 0 && n == 1 && watch_open) {
+		WATCH_reset_stats();
+	} else if (strcmp(t[0], "hist") == 0 && n == 1) {
+		LCD_FrameStatsTypeDef fs;
+
+		LCD_get_frame_stats(lcd, &fs);
+		printf("frame times (refreshes):");
+		for (i = 0; i < LCD_FRAME_HIST_BINS; i++)
+			printf(" %d%s:%u", i, i == LCD_FRAME_HIST_BINS - 1 ? "+" : "", fs.hist[i]);
+		printf("  (%u frames)\n", fs.frames);
+	} else if (strcmp(t[0], "cmd") == 0 && n >= 2 && n - 2 <= EMU_MAX_PARAMS) {
+		uint8_t p[EMU_MAX_PARAMS];
+
+		for (i = 2; i < n; i++)
+			p[i - 2] = (uint8_t) strtoul(t[i], NULL, 16);
+		ILI9340C_write_cmd((uint8_t) strtoul(t[1], NULL, 16), p, (uint8_t) (n - 2));
+	} else {
+		return -1;
+	}
+
+#undef ARG
+#undef RGB
+
+	return 0;
+}
+
+/**********************************************************************************\
+ *                                                                                *
+ *                                  MAIN                                          *
+ *                                                                                *
+\**********************************************************************************/
+
+static void emu_usage(void)
+{
+	fprintf(stderr,
+		"usage: tft_emu [-o png_prefix] [script]\n"
+		"  Boots the panel (frame 0), then runs script lines (stdin if no file).\n"
+		"  Colors are RRGGBB hex; positions are shape centers; 'aa' at the end of\n"
+		"  a shape line anti-aliases it. Each new shape prints its layer id.\n"
+		"    bg RRGGBB                          COMP_set_background\n"
+		"    fill w h x y RRGGBB                filled rectangle\n"
+		"    rect w h stroke x y RRGGBB         rectangle outline\n"
+		"    round w h r stroke x y RRGGBB      rounded rectangle\n"
+		"    circle r stroke x y RRGGBB         disc (stroke 0) or ring\n"
+		"    arc r stroke start end x y RRGGBB  clockwise arc, degrees from 12 o'clock\n"
+		"    line x0 y0 x1 y1 stroke x y RRGGBB line, ends relative to (x,y)\n"
+		"    move id x y | show id | hide id | remove id | color id RRGGBB\n"
+		"    polar id deg length                SHAPE_line_polar on a line layer (a hand)\n"
+		"    commit                             COMP_commit, then log the frame\n"
+		"    frame                              log the frame without a commit\n"
+		"    on | off | brightness n            LCD_turn_on / off / set_brightness\n"
+		"    list top height nrows row_h        open a demo scrolling list (SCROLL_init)\n"
+		"    scroll dy                          SCROLL_by, then log the frame\n"
+		"    unlist                             SCROLL_close\n"
+		"    vsync on|off                       LCD_set_vsync (TE pacing)\n"
+		"    idle us                            let emulated time pass (CPU work)\n"
+		"    hist                               print the LCD frame-time histogram\n"
+		"    cmd HH [HH...]                     raw ILI9340C_write_cmd (hex bytes)\n"
+		"    watch hhmmss_s                     WATCH_init over the demo face : layers\n"
+		"                                       1 - 3 (lines) are the hour, minute and\n"
+		"                                       second hands; logs the first frame\n"
+		"    run                                WATCH_run : the lines after it run from\n"
+		"                                       its WFI, each committed frame is logged\n"
+		"    tick n                             (after run) let n LPTIM1 seconds pass\n"
+		"    press | post                       user button / WATCH_post(WATCH_EVT_USER)\n"
+		"    wstats | wreset                    print / reset the watch counters\n"
+		"    expect count n                     fail unless the last frame had n bytes,\n"
+		"                                       transactions, cmds, windows, pixels or torn;\n"
+		"                                       or the watch had n wakeups, stops, events,\n"
+		"                                       frames, duty_ppm, render_us, render_bytes\n"
+		"                                       or updates (WATCH_EVT_USER widget calls)\n"
+		"  -o  also write <png_prefix>NNNN.png for every frame\n"
+		"  Time advances with bus bytes, delays, idle and tick only (rendering is free);\n"
+		"  TORN counts windows the panel's refresh overtook while being written.\n"
+		"  A script with expect lines ends with PASS or FAIL (exit status 1).\n");
+}
+
+/**
+  * @brief Reads and runs the next script line, skipping comments. Exits on
+  *	   a line that cannot run.
+  * @param None
+  * @retval 1 if a line was read, 0 at the end of the script
+  */
+static int emu_script_line(void)
+{
+	char line[EMU_LINE_MAX], copy[EMU_LINE_MAX];
+
+	do {
+		if (fgets(line, sizeof(line), script) == NULL)
+			return 0;
+		lineno++;
+		line[strcspn(line, "\r\n")] = '\0';
+	} while (line[0] == '#');
+
+	strcpy(copy, line);
+	if (emu_command(line) != 0) {
+		fprintf(stderr, "tft_emu: line %u: cannot run '%s'\n", lineno, copy);
+		exit(1);
+	}
+	return 1;
+}
+
+/**
+  * @brief Prints the totals and the checks' verdict.
+  * @param None
+  * @retval Exit status
+  */
+static int emu_finish(void)
+{
+	printf("%u frames, %u bytes, %u transactions, %u pixels, %u torn\n",
+	       frame_count, total.bytes, total.transactions, total.pixels, total.tears);
+	if (checks == 0)
+		return 0;
+
+	printf("%u checks, %u failed\n%s\n", checks, failures, failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	script = stdin;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			png_prefix = argv[++i];
+		} else if (argv[i][0] == '-') {
+			emu_usage();
+			return 2;
+		} else if ((script = fopen(argv[i], "r")) == NULL) {
+			perror(argv[i]);
+			return 1;
+		}
+	}
+
+	/* sysclk_init has run; the SPI driver reads the clock tree back */
+	emu_rcc.CFGR = RCC_CFGR_SWS_PLL;
+	emu_rcc.PLLCFGR = EMU_PLLCFGR;
+
+	/* LSE is in the backup domain and kept running through the reset */
+	emu_rcc.BDCR = RCC_BDCR_LSEON | RCC_BDCR_LSERDY;
+
+	/* GRAM powers up with garbage; start from the reset values */
+	emu_panel_reset();
+	odr = EMU_RST | EMU_CS;
+
+	lcd = get_LCD_instance();
+	COMP_init(lcd, 0x000000);
+	LCD_turn_on(lcd);
+	emu_frame("boot");
+
+	/* A script that runs the watch ends inside WATCH_run, from its WFI */
+	while (emu_script_line());
+
+	return emu_finish();
+}